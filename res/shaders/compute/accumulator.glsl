@@ -11,6 +11,15 @@ layout(std430, binding = 29) buffer DeltaVBuffer {
     vec4 deltaVs[];
 };
 
+// The same buffer as fixed point, written by the impulse shader in the deterministic mode
+layout(std430, binding = 29) buffer DeltaVFixedBuffer {
+    ivec4 deltaVsFixed[];
+};
+
+
+uniform uint object_count; // Live objects (the buffers may be larger)
+uniform uint deterministic = 0; // 1 if the velocity changes are in fixed point
+uniform float fixed_point_scale = 65536.0; // Fixed point units per m/s
 
 // --- Main Shader Logic ---
 layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
@@ -18,14 +27,17 @@ layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
 void main(){
     uint gid = gl_GlobalInvocationID.x;
 
-    if (gid >= properties.length())
+    if (gid >= object_count)
         return;
 
 
     if(properties[gid].inverseMass > 0.0){
-        properties[gid].velocity += deltaVs[gid];
+        if (deterministic != 0)
+            properties[gid].velocity.xyz += vec3(deltaVsFixed[gid].xyz) / fixed_point_scale;
+        else
+            properties[gid].velocity += deltaVs[gid];
     }
 
-    // Reset accumulators for next iteration
+    // Reset accumulators for next iteration (zero in both representations)
     deltaVs[gid] = vec4(0.0);
 }
\ No newline at end of file
@@ -22,8 +22,19 @@ layout(std430, binding = 22) buffer SecondResultsBuffer{
     uint second_results[];
 };
 
+layout(std430, binding = 13) buffer BodyWorldBuffer {
+    uint body_worlds[];
+};
+
+layout(std430, binding = 14) buffer WorldOffsetsBuffer {
+    uint world_offsets[]; // First body of each world, followed by the number of bodies
+};
 
 
+
+uniform uint object_count; // Live objects (the buffers may be larger)
+uniform uint world_count = 0; // Independent worlds, 0 for a single world
+
 layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
 
 
@@ -32,7 +43,7 @@ void main() {
     uint start = gl_GlobalInvocationID.x % 64;
 
     // Early exit if out of bounds
-    if (gid >= spheres.length()) return;
+    if (gid >= object_count) return;
 
     if(start == 0){
         // Initialize collision count if this is the first invocation
@@ -40,8 +51,11 @@ void main() {
     }
     barrier();
 
+    // Bodies are only tested against the following ones of their world
+    uint last = world_count > 0 ? world_offsets[body_worlds[gid] + 1] : object_count;
+
     vec4 current = spheres[gid];
-    for (uint i = gid + 1 + start; i < spheres.length(); i+=64) {
+    for (uint i = gid + 1 + start; i < last; i+=64) {
         vec4 other = spheres[i];
         float r = current.w + other.w;
 
@@ -36,10 +36,33 @@ layout(std430, binding = 29) buffer DeltaVBuffer {
     vec4 deltaVs[]; // Accumulates deltaV.xyz for each object
 };
 
+// The same buffer as fixed point, used by the deterministic mode: integer additions give the same
+// sum in any order, float ones do not
+layout(std430, binding = 29) buffer DeltaVFixedBuffer {
+    ivec4 deltaVsFixed[];
+};
+
+// World of each object and parameters of each world (only read if world_count > 0)
+layout(std430, binding = 13) buffer BodyWorldBuffer {
+    uint body_worlds[];
+};
+
+layout(std430, binding = 15) buffer WorldParamsBuffer {
+    vec4 world_params[]; // xyz gravity, w restitution
+};
+
 
 uniform float delta_time;
 uniform float DefaultRestitution = 0.2;
+uniform uint world_count = 0; // Independent worlds, 0 to use DefaultRestitution
 uniform float DefaultFrictionCoefficient = 0.1;
+uniform uint deterministic = 0; // 1 to accumulate in fixed point
+uniform float fixed_point_scale = 65536.0; // Fixed point units per m/s
+
+ivec3 toFixed(vec3 value) {
+    // Clamped so the sum of a few contacts cannot overflow
+    return ivec3(clamp(round(value * fixed_point_scale), vec3(-1073741824.0), vec3(1073741824.0)));
+}
 // --- Shader Execution Configuration ---
 layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in; // Workgroup size
 
@@ -85,7 +108,7 @@ void main() {
             float bias = - BaumgarteBeta * inv_dt * max(0.0f, depth - BaumgarteSlop);
 
             // --- Restitution Term ---
-            float restitution = DefaultRestitution;
+            float restitution = world_count > 0 ? world_params[body_worlds[contact.indexA]].w : DefaultRestitution;
 
             // --- Calculate Normal Impulse Scalar (j_normal_scalar) ---
             // j = - (Relative Velocity component + Position Correction component) / Effective Mass
@@ -137,13 +160,26 @@ void main() {
             vec3 deltaVB =  totalImpulseOnB * invMass2;
 
             // Atomically add the velocity changes.
-            atomicAdd(deltaVs[contact.indexA].x, deltaVA.x);
-            atomicAdd(deltaVs[contact.indexA].y, deltaVA.y);
-            atomicAdd(deltaVs[contact.indexA].z, deltaVA.z);
-
-            atomicAdd(deltaVs[contact.indexB].x, deltaVB.x);
-            atomicAdd(deltaVs[contact.indexB].y, deltaVB.y);
-            atomicAdd(deltaVs[contact.indexB].z, deltaVB.z);
+            if (deterministic != 0) {
+                ivec3 fixedA = toFixed(deltaVA);
+                ivec3 fixedB = toFixed(deltaVB);
+                atomicAdd(deltaVsFixed[contact.indexA].x, fixedA.x);
+                atomicAdd(deltaVsFixed[contact.indexA].y, fixedA.y);
+                atomicAdd(deltaVsFixed[contact.indexA].z, fixedA.z);
+
+                atomicAdd(deltaVsFixed[contact.indexB].x, fixedB.x);
+                atomicAdd(deltaVsFixed[contact.indexB].y, fixedB.y);
+                atomicAdd(deltaVsFixed[contact.indexB].z, fixedB.z);
+            }
+            else {
+                atomicAdd(deltaVs[contact.indexA].x, deltaVA.x);
+                atomicAdd(deltaVs[contact.indexA].y, deltaVA.y);
+                atomicAdd(deltaVs[contact.indexA].z, deltaVA.z);
+
+                atomicAdd(deltaVs[contact.indexB].x, deltaVB.x);
+                atomicAdd(deltaVs[contact.indexB].y, deltaVB.y);
+                atomicAdd(deltaVs[contact.indexB].z, deltaVB.z);
+            }
         }
     }
 
@@ -0,0 +1,205 @@
+#version 430 core
+
+// Same SAT test as narrow_working.glsl, but C_PAIR_LANES invocations test each pair together
+// instead of one invocation testing a pair on its own. The lanes of a pair transform the vertices
+// of both bodies into shared memory once, split the candidate axes (the normals of both bodies and
+// the cross products of their edges) and the first lane picks the axis of least penetration from
+// their results. Ties go to the first axis in the order of narrow_working.glsl, so both give the
+// same manifolds. Experimental: on llvmpipe it is slower than narrow_working.glsl, it has not been
+// measured on a gpu yet
+
+#include "common_structs.glsl"
+
+layout(std430, binding = 1) buffer TransformBuffer {
+    mat4 transforms[];
+};
+
+layout(std430, binding = 20) buffer CollisionPairsBuffer {
+    ivec2 collisionPairs[];
+};
+
+layout(std430, binding = 21) buffer CollisionCountBuffer{
+    uint collisionCount;
+};
+
+#ifdef SHAPE_VERTICES
+// Shape baked in by the simulator, the loops over it get constant bounds
+const vec4 objectVertices[] = vec4[](SHAPE_VERTICES);
+const vec4 objectNormals[] = vec4[](SHAPE_NORMALS);
+const vec4 objectEdges[] = vec4[](SHAPE_EDGES);
+#else
+layout(std430, binding = 23) buffer ObjectVerticesBuffer {
+    vec4 objectVertices[];
+};
+
+layout(std430, binding = 24) buffer ObjectNormalsBuffer {
+    vec4 objectNormals[];
+};
+
+layout(std430, binding = 25) buffer ObjectEdgesBuffer {
+    vec4 objectEdges[];
+};
+#endif
+
+struct ContactManifold {
+    uint indexA;
+    uint indexB;
+    vec4 normal;          // World space, consistent direction (e.g., A->B)
+    float depth;          // Penetration depth
+
+    vec4 rAWorld;
+    vec4 rBWorld;
+};
+
+layout(std430, binding = 26) buffer ContactManifoldBuffer {
+    ContactManifold manifolds[];
+};
+
+uniform uint pair_count; // Broad phase pairs, the counter is cleared before the dispatch and counts the manifolds
+#ifdef ORDERED_MANIFOLDS
+const uint ordered_manifolds = ORDERED_MANIFOLDS;
+#else
+uniform uint ordered_manifolds; // 1 to write the manifold of each pair at its index (indexA = 0xFFFFFFFF if there is none), for the deterministic mode
+#endif
+
+// Must match C_COOPERATIVE_MAX_VERTICES and C_COOPERATIVE_PAIRS_PER_GROUP in gpu_simulator.h,
+// larger shapes use narrow_working.glsl
+const uint C_MAX_VERTICES = 64;
+const uint C_PAIR_LANES = 16;
+const uint C_PAIRS_PER_GROUP = 4;
+const uint C_NO_AXIS = 0xFFFFFFFFu;
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+shared vec3 verticesA[C_PAIRS_PER_GROUP * C_MAX_VERTICES]; // C_MAX_VERTICES per slot
+shared vec3 verticesB[C_PAIRS_PER_GROUP * C_MAX_VERTICES];
+shared float laneDepths[C_PAIRS_PER_GROUP * C_PAIR_LANES]; // C_PAIR_LANES per slot, -1 if the lane found a separating axis
+shared uint laneAxes[C_PAIRS_PER_GROUP * C_PAIR_LANES]; // C_NO_AXIS if the lane found a separating axis or none
+shared bool slotSeparated[C_PAIRS_PER_GROUP]; // Set by the first lane that finds a separating axis, the others stop at their next axis
+
+// Axis number i: the normals of A, then the normals of B, then the edges of A crossed with the edges of B
+vec3 candidateAxis(uint i, mat4 transformA, mat4 transformB, uint numNormals, uint numEdges) {
+    if (i < numNormals)
+        return normalize((transformA * objectNormals[i]).xyz);
+    if (i < 2 * numNormals)
+        return normalize((transformB * objectNormals[i - numNormals]).xyz);
+
+    uint edge = i - 2 * numNormals;
+    vec3 edgeA = (transformA * objectEdges[edge / numEdges]).xyz;
+    vec3 edgeB = (transformB * objectEdges[edge % numEdges]).xyz;
+    vec3 axis = cross(edgeA, edgeB);
+    return length(axis) < 0.001 ? vec3(0.0) : normalize(axis);
+}
+
+void main() {
+    uint slot = gl_LocalInvocationID.x / C_PAIR_LANES;
+    uint lane = gl_LocalInvocationID.x % C_PAIR_LANES;
+    uint vertexBase = slot * C_MAX_VERTICES;
+    uint laneBase = slot * C_PAIR_LANES;
+    const uint numVertices = min(uint(objectVertices.length()), C_MAX_VERTICES);
+    const uint numNormals = objectNormals.length();
+    const uint numEdges = objectEdges.length();
+    const uint numAxes = 2 * numNormals + numEdges * numEdges;
+
+    // Every invocation of a group runs the same number of batches, so the barriers stay in uniform
+    // control flow; the slots past the pairs only wait at them
+    uint stride = gl_NumWorkGroups.x * C_PAIRS_PER_GROUP;
+    for (uint batch = gl_WorkGroupID.x * C_PAIRS_PER_GROUP; batch < pair_count; batch += stride) {
+        uint pair = batch + slot;
+        ivec2 indices = pair < pair_count ? collisionPairs[pair] : ivec2(-1);
+
+        // The pair sort drops pairs by writing them as (-1, -1)
+        bool valid = indices.x >= 0;
+        mat4 transformA = valid ? transforms[indices.x] : mat4(1.0);
+        mat4 transformB = valid ? transforms[indices.y] : mat4(1.0);
+        for (uint i = lane; valid && i < numVertices; i += C_PAIR_LANES) {
+            verticesA[vertexBase + i] = (transformA * objectVertices[i]).xyz;
+            verticesB[vertexBase + i] = (transformB * objectVertices[i]).xyz;
+        }
+        if (lane == 0)
+            slotSeparated[slot] = false;
+        barrier();
+
+        float bestDepth = 1e10;
+        uint bestAxis = C_NO_AXIS;
+        bool separated = false;
+        for (uint i = lane; valid && i < numAxes && !slotSeparated[slot]; i += C_PAIR_LANES) {
+            vec3 axis = candidateAxis(i, transformA, transformB, numNormals, numEdges);
+            if (axis == vec3(0.0)) continue;
+
+            float minA = dot(axis, verticesA[vertexBase + 0]);
+            float maxA = minA;
+            float minB = dot(axis, verticesB[vertexBase + 0]);
+            float maxB = minB;
+            for (uint v = 1; v < numVertices; v++) {
+                float projA = dot(axis, verticesA[vertexBase + v]);
+                minA = min(minA, projA);
+                maxA = max(maxA, projA);
+                float projB = dot(axis, verticesB[vertexBase + v]);
+                minB = min(minB, projB);
+                maxB = max(maxB, projB);
+            }
+
+            if (!(minA <= maxB && maxA >= minB)) {
+                separated = true;
+                slotSeparated[slot] = true;
+                break;
+            }
+            float depth = min(maxB - minA, maxA - minB);
+            if (depth < bestDepth) {
+                bestDepth = depth;
+                bestAxis = i;
+            }
+        }
+        laneDepths[laneBase + lane] = separated ? -1.0 : bestDepth;
+        laneAxes[laneBase + lane] = separated ? C_NO_AXIS : bestAxis;
+        barrier();
+
+        if (valid && lane == 0) {
+            // Least depth of the lanes, the first axis on ties. Every axis may be degenerate, the
+            // test then finds no separation along (0, 0, 0)
+            bool colliding = true;
+            float depth = 1e10;
+            uint best = C_NO_AXIS;
+            for (uint l = 0; l < C_PAIR_LANES; l++) {
+                float laneDepth = laneDepths[laneBase + l];
+                uint laneAxis = laneAxes[laneBase + l];
+                colliding = colliding && laneDepth >= 0.0;
+                if (laneAxis != C_NO_AXIS && (laneDepth < depth || (laneDepth == depth && laneAxis < best))) {
+                    depth = laneDepth;
+                    best = laneAxis;
+                }
+            }
+
+            vec3 axis = best != C_NO_AXIS ? candidateAxis(best, transformA, transformB, numNormals, numEdges) : vec3(0.0);
+            vec3 posA = transformA[3].xyz;
+            vec3 posB = transformB[3].xyz;
+            axis = dot(axis, posB - posA) < 0.0 ? -axis : axis;
+
+            if (colliding) {
+                ContactManifold contact;
+                contact.indexA = indices.x;
+                contact.indexB = indices.y;
+                contact.normal.xyz = axis;
+                contact.depth = depth;
+
+                if (ordered_manifolds != 0) {
+                    manifolds[pair] = contact;
+                }
+                else {
+                    uint index = atomicAdd(collisionCount, 1);
+                    if (index < manifolds.length())
+                        manifolds[index] = contact;
+                }
+            }
+            else if (ordered_manifolds != 0) {
+                manifolds[pair].indexA = C_NO_AXIS;
+            }
+        }
+        else if (!valid && lane == 0 && pair < pair_count && ordered_manifolds != 0) {
+            manifolds[pair].indexA = C_NO_AXIS;
+        }
+        // The next batch overwrites the shared vertices and results
+        barrier();
+    }
+}
@@ -22,6 +22,12 @@ layout(std430, binding = 22) buffer SecondResultsBuffer {
     int secondResults[];
 };
 
+#ifdef SHAPE_VERTICES
+// Shape baked in by the simulator, the loops over it get constant bounds
+const vec4 objectVertices[] = vec4[](SHAPE_VERTICES);
+const vec4 objectNormals[] = vec4[](SHAPE_NORMALS);
+const vec4 objectEdges[] = vec4[](SHAPE_EDGES);
+#else
 layout(std430, binding = 23) buffer ObjectVerticesBuffer {
     vec4 objectVertices[];
 };
@@ -33,6 +39,7 @@ layout(std430, binding = 24) buffer ObjectNormalsBuffer {
 layout(std430, binding = 25) buffer ObjectEdgesBuffer {
     vec4 objectEdges[];
 };
+#endif
 
 
 // The ContactManifold struct definition remains the same
@@ -51,8 +58,18 @@ layout(std430, binding = 26) buffer ContactManifoldBuffer {
     ContactManifold manifolds[];
 };
 
+uniform uint pair_count; // Broad phase pairs, the counter is cleared before the dispatch and counts the manifolds
+#ifdef ORDERED_MANIFOLDS
+const uint ordered_manifolds = ORDERED_MANIFOLDS;
+#else
+uniform uint ordered_manifolds; // 1 to write the manifold of each pair at its index (indexA = 0xFFFFFFFF if there is none), for the deterministic mode
+#endif
 
-layout(local_size_x = 512, local_size_y = 1, local_size_z = 1) in;
+
+#ifndef LOCAL_SIZE
+#define LOCAL_SIZE 512
+#endif
+layout(local_size_x = LOCAL_SIZE, local_size_y = 1, local_size_z = 1) in;
 
 struct NarrowObject {
     uint idx;
@@ -90,13 +107,14 @@ Collision checkOverlap(vec3 axis, mat4 transform1, mat4 transform2, uint numVert
 
 void main() {
     uint gid = gl_GlobalInvocationID.x;
-    if (gid >= collisionCount) return;
+    if (gid >= pair_count) return;
 
-    barrier();
-    if(gid == 0){
-        collisionCount = 0;
+    // The pair sort drops pairs by writing them as (-1, -1)
+    if (collisionPairs[gid].x < 0) {
+        if (ordered_manifolds != 0)
+            manifolds[gid].indexA = 0xFFFFFFFFu;
+        return;
     }
-    barrier();
 
     const uint numVertices = objectVertices.length();
     const uint numNormals = objectNormals.length();
@@ -186,9 +204,17 @@ void main() {
         contact.depth = collision.depth;
 
 
-        uint index = atomicAdd(collisionCount, 1);
-        if(index < manifolds.length())
-            manifolds[index] = contact;
+        if (ordered_manifolds != 0) {
+            manifolds[gid] = contact;
+        }
+        else {
+            uint index = atomicAdd(collisionCount, 1);
+            if(index < manifolds.length())
+                manifolds[index] = contact;
+        }
+    }
+    else if (ordered_manifolds != 0) {
+        manifolds[gid].indexA = 0xFFFFFFFFu;
     }
 
     // Mark both objects in the collision pair (for visualization or debugging)
@@ -0,0 +1,30 @@
+#version 430 core
+
+// Gathers the elements of a per body buffer into the order of a body reorder. The elements are
+// copied as raw 16 byte words, so the same shader moves transforms, properties, spheres and colors
+
+layout(std430, binding = 16) buffer ReorderBuffer {
+    uint order[]; // Old index of the body that goes to each new index
+};
+
+layout(std430, binding = 17) buffer SourceBuffer {
+    uvec4 source[];
+};
+
+layout(std430, binding = 18) buffer DestinationBuffer {
+    uvec4 destination[];
+};
+
+uniform uint object_count; // Bodies to move
+uniform uint element_size; // 16 byte words per element
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+void main() {
+    uint gid = gl_GlobalInvocationID.x;
+    if (gid >= object_count * element_size) return;
+
+    uint body = gid / element_size;
+    uint word = gid - body * element_size;
+    destination[gid] = source[order[body] * element_size + word];
+}
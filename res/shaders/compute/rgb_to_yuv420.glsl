@@ -0,0 +1,72 @@
+#version 440 core
+
+// Converts a captured frame to planar YUV 4:2:0 (BT.709, limited range) for the Y4M writer.
+// The frame comes bottom row first, as OpenGL stores it, and the planes are written top row
+// first. Every invocation covers 8x2 pixels: two words of luma per row and one word of each
+// chroma plane, so no two invocations write the same word.
+
+layout(rgba8, binding = 0) uniform readonly image2D frame;
+
+layout(std430, binding = 2) writeonly buffer YuvBuffer {
+    uint yuv[];
+};
+
+uniform uint frame_width;
+uniform uint frame_height;
+uniform uint luma_stride;   // Bytes per luma row (the width rounded up to 8)
+uniform uint chroma_rows;   // Rows of the chroma planes, luma has twice as many
+uniform uint chroma_offset; // Byte offset of the U plane
+uniform uint chroma_plane;  // Bytes of each chroma plane, V follows U
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+vec3 fetch(ivec2 pixel){
+    // The padding repeats the last column and row
+    pixel = min(pixel, ivec2(frame_width, frame_height) - 1);
+    return imageLoad(frame, ivec2(pixel.x, int(frame_height) - 1 - pixel.y)).rgb;
+}
+
+uint luma(vec3 color){
+    return uint(16.0 + 219.0 * dot(color, vec3(0.2126, 0.7152, 0.0722)) + 0.5);
+}
+
+void main(){
+    uvec2 block = gl_GlobalInvocationID.xy;
+    if (block.x * 8u >= luma_stride || block.y >= chroma_rows)
+        return;
+
+    ivec2 origin = ivec2(block.x * 8u, block.y * 2u);
+    uint luma_words[4] = uint[4](0u, 0u, 0u, 0u); // Row 0 left and right, row 1 left and right
+    uint u_word = 0u;
+    uint v_word = 0u;
+
+    for (int quad = 0; quad < 4; quad++){
+        vec3 sum = vec3(0.0);
+        for (int dy = 0; dy < 2; dy++){
+            for (int dx = 0; dx < 2; dx++){
+                int x = quad * 2 + dx;
+                vec3 color = fetch(origin + ivec2(x, dy));
+                sum += color;
+                luma_words[dy * 2 + x / 4] |= luma(color) << (8 * (x % 4));
+            }
+        }
+
+        // Chroma of the average of the 2x2 pixels
+        vec3 color = sum * 0.25;
+        uint u = uint(128.0 + 224.0 * dot(color, vec3(-0.1146, -0.3854, 0.5)) + 0.5);
+        uint v = uint(128.0 + 224.0 * dot(color, vec3(0.5, -0.4542, -0.0458)) + 0.5);
+        u_word |= u << (8 * quad);
+        v_word |= v << (8 * quad);
+    }
+
+    uint row = (uint(origin.y) * luma_stride) / 4u + block.x * 2u;
+    yuv[row] = luma_words[0];
+    yuv[row + 1u] = luma_words[1];
+    row += luma_stride / 4u;
+    yuv[row] = luma_words[2];
+    yuv[row + 1u] = luma_words[3];
+
+    uint chroma = (chroma_offset + block.y * (luma_stride / 2u)) / 4u + block.x;
+    yuv[chroma] = u_word;
+    yuv[chroma + chroma_plane / 4u] = v_word;
+}
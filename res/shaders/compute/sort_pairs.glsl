@@ -0,0 +1,160 @@
+#version 430 core
+
+// One stage of a pass of the pair sort. A pass moves the elements of the source buffer into the
+// destination one grouped by a small key (bucket), keeping their order within each bucket:
+//  stage 0: every work group counts the elements of each bucket it holds
+//  stage 1: a single work group turns the counts into the first destination of each bucket and
+//           work group (all of bucket 0 first, then bucket 1, ...)
+//  stage 2: every element is written to the first destination of its bucket and work group plus
+//           the elements of the same bucket before it in the work group
+// The modes give the key of each pass:
+//  0: a 4 bit digit of one of the body indices of a pair. One pass per digit, first the second
+//     index then the first one, leaves the pairs sorted by (indexA, indexB)
+//  1: 1 for the pairs to drop, the sorted pairs whose bodies are both static and the repeated
+//     ones. The dropped pairs are written as (-1, -1) after the kept ones
+//  2: 1 for the manifolds the ordered narrow phase left empty (indexA == 0xFFFFFFFF). The number
+//     of kept manifolds goes to the collision count
+
+#include "common_structs.glsl"
+
+layout(std430, binding = 5) buffer PropertiesBuffer {
+    PropertiesStruct properties[];
+};
+
+layout(std430, binding = 6) buffer SourceBuffer {
+    uint source[];
+};
+
+layout(std430, binding = 8) buffer DestinationBuffer {
+    uint destination[];
+};
+
+layout(std430, binding = 9) buffer GroupCountsBuffer {
+    uint groupCounts[]; // bucket * group_count + group
+};
+
+layout(std430, binding = 21) buffer CollisionCountBuffer {
+    uint collisionCount;
+};
+
+uniform uint stage;
+uniform uint mode;
+uniform uint count;         // Elements to move
+uniform uint element_size;  // 4 byte words per element
+uniform uint group_count;   // Work groups of stages 0 and 2
+uniform uint component;     // Mode 0: 0 for indexA, 1 for indexB
+uniform uint shift;         // Mode 0: first bit of the digit
+
+const uint C_RADIX = 16;
+const uint C_GROUP_SIZE = 256;
+const uint C_EMPTY = 0xFFFFFFFFu;
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+shared uint localCounts[C_RADIX];
+shared uint localBuckets[C_GROUP_SIZE];
+shared uint localSums[C_GROUP_SIZE];
+
+uint bucketCount() {
+    return mode == 0 ? C_RADIX : 2;
+}
+
+uint bucketOf(uint i) {
+    uint first = i * element_size;
+    if (mode == 0)
+        return (source[first + component] >> shift) & (C_RADIX - 1);
+
+    if (mode == 2)
+        return source[first] == C_EMPTY ? 1 : 0;
+
+    uint a = source[first];
+    uint b = source[first + 1];
+    if (properties[a].inverseMass == 0.0 && properties[b].inverseMass == 0.0)
+        return 1;
+    // The pairs are sorted, so the repeated ones are next to each other
+    return i > 0 && source[first - 2] == a && source[first - 1] == b ? 1 : 0;
+}
+
+void countBuckets() {
+    uint lid = gl_LocalInvocationID.x;
+    uint i = gl_GlobalInvocationID.x;
+    if (lid < C_RADIX)
+        localCounts[lid] = 0;
+    barrier();
+
+    if (i < count)
+        atomicAdd(localCounts[bucketOf(i)], 1);
+    barrier();
+
+    if (lid < bucketCount())
+        groupCounts[lid * group_count + gl_WorkGroupID.x] = localCounts[lid];
+}
+
+void scanCounts() {
+    // Every invocation scans a consecutive chunk of the counts
+    uint lid = gl_LocalInvocationID.x;
+    uint total = bucketCount() * group_count;
+    uint chunk = (total + C_GROUP_SIZE - 1) / C_GROUP_SIZE;
+    uint first = min(lid * chunk, total);
+    uint last = min(first + chunk, total);
+
+    uint sum = 0;
+    for (uint i = first; i < last; i++)
+        sum += groupCounts[i];
+    localSums[lid] = sum;
+    barrier();
+
+    if (lid == 0) {
+        uint running = 0;
+        for (uint i = 0; i < C_GROUP_SIZE; i++) {
+            uint value = localSums[i];
+            localSums[i] = running;
+            running += value;
+        }
+    }
+    barrier();
+
+    uint running = localSums[lid];
+    for (uint i = first; i < last; i++) {
+        // The first destination of bucket 1 is the number of kept elements
+        if (mode == 2 && i == group_count)
+            collisionCount = running;
+        uint value = groupCounts[i];
+        groupCounts[i] = running;
+        running += value;
+    }
+}
+
+void scatter() {
+    uint lid = gl_LocalInvocationID.x;
+    uint i = gl_GlobalInvocationID.x;
+    uint bucket = i < count ? bucketOf(i) : C_EMPTY;
+    localBuckets[lid] = bucket;
+    barrier();
+    if (bucket == C_EMPTY) return;
+
+    uint rank = 0;
+    for (uint j = 0; j < lid; j++)
+        rank += localBuckets[j] == bucket ? 1 : 0;
+
+    uint target = (groupCounts[bucket * group_count + gl_WorkGroupID.x] + rank) * element_size;
+    if (mode == 1 && bucket == 1) {
+        destination[target] = C_EMPTY;
+        destination[target + 1] = C_EMPTY;
+        return;
+    }
+    if (mode == 2 && bucket == 1) return;
+
+    uint first = i * element_size;
+    for (uint word = 0; word < element_size; word++)
+        destination[target + word] = source[first + word];
+}
+
+void main() {
+    if (stage == 0)
+        countBuckets();
+    else if (stage == 1)
+        scanCounts();
+    else
+        scatter();
+}
@@ -26,8 +26,18 @@ layout(std430, binding = 30) buffer DeltaWBuffer {
     vec4 deltaWs[];
 };
 
+layout(std430, binding = 13) buffer BodyWorldBuffer {
+    uint body_worlds[];
+};
+
+layout(std430, binding = 15) buffer WorldParamsBuffer {
+    vec4 world_params[]; // xyz gravity, w restitution
+};
+
 uniform float delta_time;
+uniform uint object_count; // Live objects (the buffers may be larger)
 uniform vec3 gravity = vec3(0.0f, -0.1f, 0.0f);
+uniform uint world_count = 0; // Independent worlds, 0 for a single world that uses gravity
 uniform float linearFriction = 0.00f;   // coefficient [1/s]
 uniform float angularFriction = 0.00f;  // coefficient [1/s]
 
@@ -54,7 +64,7 @@ mat3 updateRotation(mat3 R, vec3 omega, float dt) {
 
 void main() {
     uint gid = gl_GlobalInvocationID.x;
-    if (gid >= transforms.length()) return;
+    if (gid >= object_count) return;
 
     results[gid] = 0;
 
@@ -66,7 +76,8 @@ void main() {
 
     // Integrate linear
     if (prop.inverseMass != 0.0) {
-        velocity += gravity * delta_time;
+        vec3 body_gravity = world_count > 0 ? world_params[body_worlds[gid]].xyz : gravity;
+        velocity += body_gravity * delta_time;
         // apply linear air friction: F_drag = -c * v
         float linFactor = 1.0 - linearFriction * delta_time;
         linFactor = max(linFactor, 0.0);
@@ -9,6 +9,11 @@ layout(std430, binding = 1) buffer TransformBuffer {
     mat4 transforms[];
 };
 
+// Transforms of the previous physics step, for interpolation
+layout(std430, binding = 12) buffer PreviousTransformBuffer {
+    mat4 previous_transforms[];
+};
+
 layout(std430, binding = 4) buffer ResultsBuffer {
     int results[];
 };
@@ -29,6 +34,7 @@ layout(std430, binding = 22) buffer SecondResultsBuffer {
 };
 
 uniform mat4 u_cam_matrix;
+uniform float u_alpha = 1.0; // Position between the previous (0) and current (1) physics step
 
 out vec3 v_normal;
 out vec3 v_position;
@@ -38,6 +44,17 @@ out vec2 v_texCoord;
 void main() {
     // Cache the transform matrix - read once
     mat4 transform = transforms[gl_InstanceID];
+
+    // Blend towards the previous step (the rotation change of one step is small enough for a linear blend)
+    if (u_alpha < 1.0) {
+        mat4 previous = previous_transforms[gl_InstanceID];
+        transform = mat4(
+            mix(previous[0], transform[0], u_alpha),
+            mix(previous[1], transform[1], u_alpha),
+            mix(previous[2], transform[2], u_alpha),
+            mix(previous[3], transform[3], u_alpha)
+        );
+    }
     
     // Calculate world position once
     vec4 worldPos = transform * vec4(position, 1.0);
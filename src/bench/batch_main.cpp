@@ -0,0 +1,548 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "scenarios.h"
+#include "../simulators/simulator.h"
+#include "../jobs/job_system.h"
+#include "../recording/trajectory_writer.h"
+
+#ifdef PHYSICS_GPU
+#include <GL/glew.h>
+
+#include "headless_context.h"
+#include "../simulators/gpu_simulator.h"
+#endif
+
+/**
+ * Batch dataset generator. Runs a list of clips (a scenario with its size, seed and duration)
+ * concurrently without a window and writes the trajectory of each one, so thousands of clips
+ * can be generated unattended:
+ *
+ *  physics_batch --spec file [--output folder] [--jobs n] [--threads n] [--report seconds]
+ *
+ * Every line of the spec is a clip made of key=value fields, '#' starts a comment:
+ *
+ *  scenario=complex_3 scale=0.5 seed=7 steps=600 warmup=0 dt=0.0166667 time_factor=1 engine=cpu name=clip
+ *
+ * Only scenario is required. seed=a-b expands the line into one clip per seed, the name (by
+ * default the scenario) gets _<seed> appended. time_factor is the simulated time between two
+ * frames over dt: 2 plays the clip at double speed, 0.5 in slow motion. A step never exceeds dt,
+ * larger factors take several steps per frame.
+ *
+ * Clips on the cpu engine run on --jobs workers, each with a job system of --threads threads.
+ * Clips on the gpu engine share one headless context on a worker of their own, a gpu is already
+ * busy with one simulation and contexts on the same display cannot be torn down separately (the
+ * jacobi shaders skip steps shorter than 10 ms, keep dt * time_factor above that on the gpu).
+ * Every finished clip is appended to progress.txt in the output folder once its trajectory is
+ * complete, so running the same spec again skips it and an interrupted batch resumes.
+ */
+
+namespace{
+
+    using Clock = std::chrono::steady_clock;
+
+    const char* const C_PROGRESS_FILE = "progress.txt";
+
+    /**
+     * @brief Command line options
+     */
+    struct Options{
+        std::string spec;
+        std::string output = "batch";
+        unsigned int jobs = 0; /* Clips run at once on the cpu engine, 0 uses every hardware thread */
+        unsigned int threads = 1; /* Job system threads of each cpu clip */
+        float report = 10.0f; /* Seconds between progress lines */
+    };
+
+    /**
+     * @brief Scenario run of the spec, recorded into one trajectory
+     */
+    struct Clip{
+        std::string name;
+        const bench::Scenario* scenario = nullptr;
+        bench::Engine engine = bench::Engine::Cpu;
+        float scale = 1.0f;
+        unsigned int seed = bench::C_DEFAULT_SEED;
+        unsigned int steps = 600; /* Recorded frames */
+        unsigned int warmup = 0; /* Frames simulated before recording */
+        float delta_time = 1.0f / 60.0f; /* Time between frames when played back */
+        float time_factor = 1.0f; /* Simulated time between frames over delta_time */
+    };
+
+    /**
+     * @brief State shared by the workers
+     */
+    struct Batch{
+        Options options;
+        std::vector<Clip> cpu_clips;
+        std::vector<Clip> gpu_clips;
+        std::atomic<size_t> next_cpu{0};
+
+        std::mutex build_mutex; /* The scenarios seed std::rand */
+        std::mutex progress_mutex;
+        std::ofstream progress;
+
+        std::atomic<uint64_t> frames{0}; /* Frames recorded so far */
+        std::atomic<uint64_t> body_steps{0}; /* Bodies times steps simulated so far */
+        std::atomic<unsigned int> clips_done{0};
+        std::atomic<unsigned int> clips_failed{0};
+        std::atomic<unsigned int> workers_running{0};
+        std::mutex done_mutex;
+        std::condition_variable done;
+    };
+
+    /**
+     * @brief Trims spaces at both ends
+     */
+    std::string trim(const std::string& text){
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+            return std::string();
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    /**
+     * @brief Parses a line of the spec into one clip per seed
+     * @return false if a field is unknown or invalid, the reason is in error
+     */
+    bool parseClipLine(const std::string& line, std::vector<Clip>& clips, std::string& error){
+        Clip clip;
+        std::string name;
+        unsigned int first_seed = bench::C_DEFAULT_SEED;
+        unsigned int last_seed = bench::C_DEFAULT_SEED;
+        bool seed_range = false;
+
+        std::stringstream fields(line);
+        std::string field;
+        try {
+            while (fields >> field){
+                size_t equal = field.find('=');
+                if (equal == std::string::npos){
+                    error = "expected key=value, found " + field;
+                    return false;
+                }
+                std::string key = field.substr(0, equal);
+                std::string value = field.substr(equal + 1);
+
+                if (key == "scenario"){
+                    clip.scenario = bench::findScenario(value);
+                    if (!clip.scenario){
+                        error = "unknown scenario " + value;
+                        return false;
+                    }
+                }
+                else if (key == "name")
+                    name = value;
+                else if (key == "scale")
+                    clip.scale = std::stof(value);
+                else if (key == "steps")
+                    clip.steps = static_cast<unsigned int>(std::stoul(value));
+                else if (key == "warmup")
+                    clip.warmup = static_cast<unsigned int>(std::stoul(value));
+                else if (key == "dt")
+                    clip.delta_time = std::stof(value);
+                else if (key == "time_factor")
+                    clip.time_factor = std::stof(value);
+                else if (key == "seed"){
+                    size_t dash = value.find('-');
+                    first_seed = static_cast<unsigned int>(std::stoul(value.substr(0, dash)));
+                    last_seed = dash == std::string::npos ? first_seed : static_cast<unsigned int>(std::stoul(value.substr(dash + 1)));
+                    seed_range = dash != std::string::npos;
+                }
+                else if (key == "engine"){
+                    if (!bench::parseEngine(value, clip.engine) || clip.engine == bench::Engine::Collision){
+                        error = "engine must be cpu or gpu, found " + value;
+                        return false;
+                    }
+                }
+                else{
+                    error = "unknown field " + key;
+                    return false;
+                }
+            }
+        } catch (std::exception&) {
+            error = "invalid number in " + field;
+            return false;
+        }
+
+        if (!clip.scenario){
+            error = "missing scenario";
+            return false;
+        }
+        if (clip.scale <= 0.0f || clip.steps == 0 || clip.delta_time <= 0.0f || clip.time_factor <= 0.0f || last_seed < first_seed){
+            error = "scale, steps, dt and time_factor must be positive and the seeds a-b with a <= b";
+            return false;
+        }
+        if (name.empty())
+            name = clip.scenario->name;
+
+        for (unsigned int seed = first_seed; ; seed++){
+            clip.seed = seed;
+            clip.name = seed_range ? name + "_" + std::to_string(seed) : name;
+            clips.push_back(clip);
+            if (seed == last_seed)
+                break;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads the clips of the spec file
+     * @return false if the file could not be read or a line is invalid
+     */
+    bool readSpec(const std::string& path, std::vector<Clip>& clips){
+        std::ifstream file(path);
+        if (!file.is_open()){
+            std::cerr << "Error: could not open " << path << std::endl;
+            return false;
+        }
+
+        std::string line;
+        unsigned int line_number = 0;
+        while (std::getline(file, line)){
+            line_number++;
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+
+            std::string error;
+            if (!parseClipLine(line, clips, error)){
+                std::cerr << "Error: " << path << ":" << line_number << ": " << error << std::endl;
+                return false;
+            }
+        }
+
+        //Names are file names and progress entries
+        std::unordered_set<std::string> names;
+        for (const Clip& clip : clips){
+            if (!names.insert(clip.name).second){
+                std::cerr << "Error: clip " << clip.name << " appears twice in " << path << ", give the lines a name" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads the names of the clips finished by previous runs
+     */
+    std::unordered_set<std::string> readProgress(const std::filesystem::path& path){
+        std::unordered_set<std::string> finished;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)){
+            std::stringstream fields(line);
+            std::string name;
+            if (fields >> name)
+                finished.insert(name);
+        }
+        return finished;
+    }
+
+    /**
+     * @brief Steps a clip and records every frame
+     * @param read gets the transforms of the current frame, given a vector to copy them into if they are not in the scene
+     * @return false if the trajectory could not be written
+     */
+    template<typename T, typename Read>
+    bool recordClip(T& simulator, bench::Scene& scene, const Clip& clip, const std::filesystem::path& path, Batch& batch, Read read){
+        //Several steps per frame if the frame covers more than dt
+        unsigned int substeps = std::max(1u, static_cast<unsigned int>(std::ceil(clip.time_factor)));
+        float step = clip.delta_time * clip.time_factor / substeps;
+
+        for (unsigned int i = 0; i < clip.warmup * substeps; i++)
+            simulator.update(step, scene.gravity);
+
+        recording::TrajectoryWriter writer;
+        float duration = step * substeps * clip.steps;
+        if (!writer.open(path.string(), bench::describeTrajectory(scene, clip.delta_time, duration)))
+            return false;
+
+        std::vector<glm::mat4> transforms;
+        for (unsigned int frame = 0; frame < clip.steps; frame++){
+            for (unsigned int i = 0; i < substeps; i++)
+                simulator.update(step, scene.gravity);
+            if (!writer.pushFrame(read(transforms)))
+                break;
+            batch.frames.fetch_add(1, std::memory_order_relaxed);
+            batch.body_steps.fetch_add(static_cast<uint64_t>(scene.transforms.size()) * substeps, std::memory_order_relaxed);
+        }
+        return writer.close();
+    }
+
+    /**
+     * @brief Builds, runs and records a clip, then marks it as finished
+     * @param job_system job system of the cpu engine (null for the gpu engine)
+     */
+    void runClip(const Clip& clip, Batch& batch, jobs::JobSystem* job_system){
+        Clock::time_point begin = Clock::now();
+        std::filesystem::path folder(batch.options.output);
+        std::filesystem::path path = folder / (clip.name + ".traj");
+        //Written under another name until complete, a crash never leaves a clip that looks finished
+        std::filesystem::path partial = folder / (clip.name + ".traj.part");
+
+        bench::Scene scene;
+        {
+            std::lock_guard<std::mutex> lock(batch.build_mutex);
+            clip.scenario->build(scene, clip.scale, clip.seed);
+        }
+
+        bool ok = false;
+        std::string error;
+        if (clip.engine == bench::Engine::Cpu){
+            Simulator simulator(&scene.transforms, &scene.vertices, &scene.indices, &scene.object_vertices,
+                                &scene.object_normals, &scene.object_edges, &scene.properties, job_system);
+            ok = recordClip(simulator, scene, clip, partial, batch, [&](std::vector<glm::mat4>&) -> const std::vector<glm::mat4>& { return scene.transforms; });
+        }
+#ifdef PHYSICS_GPU
+        else{
+            GpuSimulator simulator(&scene.transforms, &scene.vertices, &scene.indices, &scene.object_vertices,
+                                   &scene.object_normals, &scene.object_edges, &scene.properties);
+            ok = recordClip(simulator, scene, clip, partial, batch, [&](std::vector<glm::mat4>& transforms) -> const std::vector<glm::mat4>& {
+                simulator.readTransforms(transforms);
+                return transforms;
+            });
+        }
+#endif
+        if (!ok)
+            error = "could not write " + partial.string();
+
+        std::error_code code;
+        if (ok){
+            std::filesystem::rename(partial, path, code);
+            if (code){
+                ok = false;
+                error = "could not rename " + partial.string() + ": " + code.message();
+            }
+        }
+        if (!ok){
+            std::filesystem::remove(partial, code);
+            batch.clips_failed.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << clip.name << ": failed, " << error << std::endl;
+            return;
+        }
+
+        double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        {
+            std::lock_guard<std::mutex> lock(batch.progress_mutex);
+            batch.progress << clip.name << " " << clip.steps << " " << scene.transforms.size() << " " << seconds << std::endl;
+        }
+        batch.clips_done.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Tells the main thread that a worker has finished
+     */
+    void finishWorker(Batch& batch){
+        {
+            std::lock_guard<std::mutex> lock(batch.done_mutex);
+            batch.workers_running--;
+        }
+        batch.done.notify_all();
+    }
+
+    /**
+     * @brief Loop of the cpu workers, takes clips until there are none left
+     */
+    void cpuWorker(Batch& batch){
+        jobs::JobSystem job_system(batch.options.threads);
+        while (true){
+            size_t index = batch.next_cpu.fetch_add(1, std::memory_order_relaxed);
+            if (index >= batch.cpu_clips.size())
+                break;
+            runClip(batch.cpu_clips[index], batch, &job_system);
+        }
+        finishWorker(batch);
+    }
+
+    /**
+     * @brief Loop of the gpu worker, runs every gpu clip on a context of its own
+     */
+    void gpuWorker(Batch& batch){
+#ifdef PHYSICS_GPU
+        bench::HeadlessContext context;
+        std::string error;
+        if (context.create(error)){
+            for (const Clip& clip : batch.gpu_clips)
+                runClip(clip, batch, nullptr);
+        }
+        else{
+            std::cerr << "Error: " << error << ", skipping the gpu clips" << std::endl;
+            batch.clips_failed.fetch_add(static_cast<unsigned int>(batch.gpu_clips.size()), std::memory_order_relaxed);
+        }
+#else
+        std::cerr << "Error: built without the gpu engine, skipping the gpu clips" << std::endl;
+        batch.clips_failed.fetch_add(static_cast<unsigned int>(batch.gpu_clips.size()), std::memory_order_relaxed);
+#endif
+        finishWorker(batch);
+    }
+
+    /**
+     * @brief Formats seconds as hh:mm:ss
+     */
+    std::string formatDuration(double seconds){
+        long long total = static_cast<long long>(std::max(0.0, seconds));
+        std::ostringstream text;
+        text << std::setfill('0') << std::setw(2) << total / 3600 << ":" << std::setw(2) << (total / 60) % 60 << ":" << std::setw(2) << total % 60;
+        return text.str();
+    }
+
+    /**
+     * @brief Prints the clips done, the throughput and the time left
+     */
+    void printProgress(const Batch& batch, size_t clips, uint64_t total_frames, Clock::time_point start){
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        uint64_t frames = batch.frames.load(std::memory_order_relaxed);
+        double frames_per_second = seconds > 0.0 ? frames / seconds : 0.0;
+        double body_steps_per_second = seconds > 0.0 ? batch.body_steps.load(std::memory_order_relaxed) / seconds : 0.0;
+
+        std::cerr << "[" << batch.clips_done.load() << "/" << clips << " clips";
+        if (batch.clips_failed.load() > 0)
+            std::cerr << ", " << batch.clips_failed.load() << " failed";
+        std::cerr << "] " << std::fixed << std::setprecision(1) << frames_per_second << " frames/s, "
+                  << body_steps_per_second / 1.0e6 << "M body-steps/s, elapsed " << formatDuration(seconds);
+        if (frames_per_second > 0.0 && total_frames > frames)
+            std::cerr << ", eta " << formatDuration((total_frames - frames) / frames_per_second);
+        std::cerr << std::defaultfloat << std::endl;
+    }
+
+    void printUsage(){
+        std::cout << "Usage: physics_batch --spec file [options]\n"
+                  << "  --spec file        clips to generate, one per line:\n"
+                  << "                     scenario=name [scale=s] [seed=n|a-b] [steps=n] [warmup=n] [dt=seconds]\n"
+                  << "                     [time_factor=f] [engine=cpu|gpu] [name=clip]\n"
+                  << "  --output folder    trajectories and progress.txt (default batch)\n"
+                  << "  --jobs n           cpu clips run at once (default all hardware threads)\n"
+                  << "  --threads n        job system threads of each cpu clip (default 1)\n"
+                  << "  --report seconds   time between progress lines (default 10)\n";
+    }
+
+    /**
+     * @brief Parses the command line
+     * @return false if the program should exit (bad arguments or --help)
+     */
+    bool parseOptions(int argc, char* argv[], Options& options, int& exit_code){
+        exit_code = 0;
+        for (int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h"){
+                printUsage();
+                return false;
+            }
+            if (i + 1 >= argc){
+                std::cerr << "Error: unknown option or missing value: " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+
+            std::string value = argv[++i];
+            if (arg == "--spec")
+                options.spec = value;
+            else if (arg == "--output")
+                options.output = value;
+            else if (arg == "--jobs")
+                options.jobs = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--threads")
+                options.threads = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--report")
+                options.report = std::stof(value);
+            else{
+                std::cerr << "Error: unknown option " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+        }
+
+        if (options.spec.empty() || options.report <= 0.0f){
+            std::cerr << "Error: --spec is required and --report must be positive" << std::endl;
+            printUsage();
+            exit_code = 1;
+            return false;
+        }
+        if (options.jobs == 0)
+            options.jobs = std::max(1u, std::thread::hardware_concurrency());
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]){
+    Batch batch;
+    int exit_code = 0;
+    try {
+        if (!parseOptions(argc, argv, batch.options, exit_code))
+            return exit_code;
+    } catch (std::exception&) {
+        std::cerr << "Error: invalid number in the arguments" << std::endl;
+        return 1;
+    }
+
+    std::vector<Clip> clips;
+    if (!readSpec(batch.options.spec, clips))
+        return 1;
+
+    std::filesystem::path folder(batch.options.output);
+    std::error_code code;
+    std::filesystem::create_directories(folder, code);
+    if (code){
+        std::cerr << "Error: could not create " << folder.string() << ": " << code.message() << std::endl;
+        return 1;
+    }
+
+    //Clips finished by a previous run are skipped
+    std::filesystem::path progress_path = folder / C_PROGRESS_FILE;
+    std::unordered_set<std::string> finished = readProgress(progress_path);
+    uint64_t total_frames = 0;
+    for (const Clip& clip : clips){
+        if (finished.count(clip.name))
+            continue;
+        (clip.engine == bench::Engine::Cpu ? batch.cpu_clips : batch.gpu_clips).push_back(clip);
+        total_frames += clip.steps;
+    }
+    size_t pending = batch.cpu_clips.size() + batch.gpu_clips.size();
+    std::cerr << clips.size() << " clips, " << clips.size() - pending << " already finished, " << pending << " to generate" << std::endl;
+    if (pending == 0)
+        return 0;
+
+    batch.progress.open(progress_path, std::ios::app);
+    if (!batch.progress.is_open()){
+        std::cerr << "Error: could not open " << progress_path.string() << std::endl;
+        return 1;
+    }
+
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> workers;
+    unsigned int cpu_workers = static_cast<unsigned int>(std::min<size_t>(batch.options.jobs, batch.cpu_clips.size()));
+    batch.workers_running = cpu_workers + (batch.gpu_clips.empty() ? 0 : 1);
+    for (unsigned int i = 0; i < cpu_workers; i++)
+        workers.emplace_back(cpuWorker, std::ref(batch));
+    if (!batch.gpu_clips.empty())
+        workers.emplace_back(gpuWorker, std::ref(batch));
+
+    {
+        std::unique_lock<std::mutex> lock(batch.done_mutex);
+        auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(batch.options.report));
+        while (!batch.done.wait_for(lock, interval, [&]{ return batch.workers_running == 0; }))
+            printProgress(batch, pending, total_frames, start);
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+
+    printProgress(batch, pending, total_frames, start);
+    return batch.clips_failed.load() > 0 ? 1 : 0;
+}
@@ -0,0 +1,812 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "scenarios.h"
+#include "../simulators/simulator.h"
+#include "../simulators/world_batch.h"
+#include "../jobs/job_system.h"
+#include "../recording/trajectory_writer.h"
+#include "../recording/state_publisher.h"
+#include "../memory/allocation_counter.h"
+
+#ifdef PHYSICS_GPU
+#include <GL/glew.h>
+
+#include "headless_context.h"
+#include "../simulators/gpu_simulator.h"
+#include "../simulators/collision_detector.h"
+#include "../profiling/gpu_profiler.h"
+#endif
+
+/**
+ * Headless benchmark runner. Steps the canonical scenarios (copies of the interactive tests) a
+ * fixed number of times without opening a window and writes the timings as JSON, so runs on
+ * different commits or machines can be compared:
+ *
+ *  physics_bench [--scenario all|name[,name...]] [--scale s] [--steps n] [--warmup n]
+ *                [--dt seconds] [--engine gpu|collision|cpu] [--threads n] [--output file]
+ *                [--record file] [--save-checkpoint file] [--load-checkpoint file] [--worlds n]
+ *                [--publish name] [--deterministic] [--reorder n] [--shuffle]
+ *                [--sort-pairs] [--cooperative-narrow] [--specialize] [--list]
+ *
+ * A checkpoint saved after the warmup holds the settled scene, loading it skips both the build of
+ * the bodies and the warmup steps that settle them.
+ *
+ * --worlds n builds n copies of each scenario (seeds 42 to 42 + n - 1) and steps them together
+ * as independent worlds of one simulator, the workload of parameter sweeps and training data.
+ *
+ * --publish name publishes every measured step into shared memory, where physics_state_reader
+ * (or any other StateReader) follows the run from another process.
+ *
+ * --deterministic measures the cpu and gpu simulators in their reproducible mode (see physics_hash).
+ *
+ * --shuffle puts the bodies of each scene in a random order, like a scene whose bodies scattered
+ * long ago, and --reorder n sorts them by Morton code every n steps; together they measure what
+ * the reorder gains on scattered scenes.
+ *
+ * --sort-pairs sorts the broad phase pairs of the gpu simulator before its narrow phase; compare
+ * the "narrow" phase with and without it, like --cooperative-narrow, which runs that phase with
+ * several invocations per pair, and --specialize, which compiles it for the shape of the bodies.
+ *
+ * Built without PHYSICS_GPU (physics core only) every scenario has to run with --engine cpu.
+ */
+
+namespace{
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Command line options
+     */
+    struct Options{
+        std::vector<const bench::Scenario*> scenarios;
+        float scale = 1.0f; /* Multiplies the number of bodies of every scenario */
+        unsigned int steps = 300;
+        unsigned int warmup = 30; /* Steps run before measuring (shader compilation, first uploads) */
+        float delta_time = 1.0f / 60.0f;
+        bool force_engine = false; /* Run every scenario on engine instead of the one of its test */
+        bench::Engine engine = bench::Engine::Gpu;
+        unsigned int threads = 0; /* Job system threads of the cpu engine, 0 uses every hardware thread */
+        std::string output = "bench_results.json";
+        std::string record; /* Trajectory of the measured steps, empty to not record */
+        std::string save_checkpoint; /* State after the warmup, empty to not save it */
+        std::string load_checkpoint; /* State that replaces the built bodies, empty to keep them */
+        unsigned int worlds = 1; /* Copies of each scenario stepped together as independent worlds */
+        std::string publish; /* Shared memory block the measured steps are published to, empty to not publish */
+        bool deterministic = false; /* Steps independent of the threads and of the order of the gpu atomics */
+        unsigned int reorder = 0; /* Steps between two Morton reorders of the bodies, 0 to never reorder */
+        bool shuffle = false; /* Shuffle the bodies of the built scenes */
+        bool sort_pairs = false; /* Sort the broad phase pairs of the gpu simulator */
+        bool cooperative_narrow = false; /* Narrow phase of the gpu simulator with several invocations per pair */
+        bool specialize = false; /* Narrow phase of the gpu simulator compiled for the shape of the bodies */
+    };
+
+    /**
+     * @brief Summary of a set of samples
+     */
+    struct Stats{
+        float min = 0.0f;
+        float avg = 0.0f;
+        float p95 = 0.0f;
+        float max = 0.0f;
+        unsigned int samples = 0;
+    };
+
+    /**
+     * @brief Statistics of a phase of the step, in milliseconds
+     */
+    struct PhaseResult{
+        std::string name;
+        Stats stats;
+    };
+
+    /**
+     * @brief Measurements of one scenario
+     */
+    struct Result{
+        const bench::Scenario* scenario;
+        bench::Engine engine;
+        size_t bodies = 0;
+        unsigned int threads = 0;
+        double total_ms = 0.0; /* Wall time of the measured steps */
+        double load_ms = -1.0; /* Wall time of loading the checkpoint, negative if none was loaded */
+        Stats step_ms; /* Wall time of each step */
+        Stats pairs;
+        Stats contacts;
+        std::vector<PhaseResult> phases; /* Gpu time of each phase (gpu engines) or wall time of each task (cpu) */
+        double allocations_per_step = -1.0; /* Heap allocations of the measured steps (cpu), negative if not counted */
+        size_t arena_high_water = 0; /* Largest transient memory of a step (cpu) */
+        size_t arena_capacity = 0; /* Memory reserved by the arenas after the measured steps (cpu) */
+        std::string error; /* Empty if the scenario ran */
+    };
+
+    /**
+     * @brief Computes min, average, 95th percentile and max of the samples (sorts them)
+     */
+    Stats summarize(std::vector<float>& samples){
+        Stats stats;
+        stats.samples = static_cast<unsigned int>(samples.size());
+        if (samples.empty())
+            return stats;
+
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for (float sample : samples)
+            sum += sample;
+
+        size_t p95 = static_cast<size_t>(std::ceil(0.95 * samples.size())) - 1;
+        stats.min = samples.front();
+        stats.max = samples.back();
+        stats.avg = static_cast<float>(sum / samples.size());
+        stats.p95 = samples[p95];
+        return stats;
+    }
+
+    float elapsedMs(Clock::time_point begin, Clock::time_point end){
+        return std::chrono::duration<float, std::milli>(end - begin).count();
+    }
+
+    /**
+     * @brief Gets the trajectory or checkpoint file of a scenario, the scenario name is appended if several run
+     */
+    std::string getScenarioPath(const std::string& path, const Options& options, const bench::Scenario& scenario){
+        if (options.scenarios.size() <= 1)
+            return path;
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            dot = path.size();
+        return path.substr(0, dot) + "_" + scenario.name + path.substr(dot);
+    }
+
+    /**
+     * @brief Opens the trajectory of a scenario (every body has the mesh of the scene)
+     * @return false if the file could not be created, the error is stored in the result
+     */
+    bool openRecording(recording::TrajectoryWriter& writer, const bench::Scene& scene, const Options& options, Result& result){
+        //Room for the bodies to fall for the whole run
+        recording::TrajectoryDesc desc = bench::describeTrajectory(scene, options.delta_time, options.delta_time * (options.warmup + options.steps));
+
+        std::string path = getScenarioPath(options.record, options, *result.scenario);
+        if (!writer.open(path, desc)){
+            result.error = "could not create the trajectory " + path;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Creates the shared memory block of --publish
+     * @return false if the block could not be created, the error is stored in the result
+     */
+    bool openPublisher(recording::StatePublisher& publisher, const Options& options, Result& result){
+        if (!publisher.open(options.publish, static_cast<unsigned int>(result.bodies))){
+            result.error = "could not create the shared memory block " + options.publish;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Replaces the built bodies with the ones of --load-checkpoint
+     * @return false if the checkpoint could not be loaded, the error is stored in the result
+     */
+    template<typename T>
+    bool loadState(T& simulator, const Options& options, Result& result){
+        if (options.load_checkpoint.empty())
+            return true;
+
+        std::string path = getScenarioPath(options.load_checkpoint, options, *result.scenario);
+        Clock::time_point begin = Clock::now();
+        if (!simulator.loadCheckpoint(path)){
+            result.error = "could not load the checkpoint " + path;
+            return false;
+        }
+        result.load_ms = elapsedMs(begin, Clock::now());
+        return true;
+    }
+
+    /**
+     * @brief Saves the settled state to --save-checkpoint
+     * @return false if the checkpoint could not be written, the error is stored in the result
+     */
+    template<typename T>
+    bool saveState(T& simulator, const Options& options, Result& result){
+        if (options.save_checkpoint.empty())
+            return true;
+
+        std::string path = getScenarioPath(options.save_checkpoint, options, *result.scenario);
+        if (!simulator.saveCheckpoint(path)){
+            result.error = "could not write the checkpoint " + path;
+            return false;
+        }
+        return true;
+    }
+
+#ifdef PHYSICS_GPU
+    /**
+     * @brief Runs a scenario on one of the gpu engines (GpuSimulator or CollisionDetector)
+     */
+    template<typename T>
+    void runOnGpu(bench::Scene& scene, const physics::WorldLayout& worlds, const Options& options, Result& result){
+        std::unique_ptr<T> instance;
+        if constexpr (std::is_same_v<T, GpuSimulator>){
+            instance = std::make_unique<T>(&scene.transforms, &scene.vertices, &scene.indices, &scene.object_vertices,
+                                           &scene.object_normals, &scene.object_edges, &scene.properties, &worlds);
+        }
+        else{
+            instance = std::make_unique<T>(&scene.transforms, &scene.vertices, &scene.indices, &scene.object_vertices,
+                                           &scene.object_normals, &scene.object_edges, &scene.properties);
+        }
+        T& simulator = *instance;
+
+        if constexpr (std::is_same_v<T, GpuSimulator>){
+            simulator.setDeterministic(options.deterministic);
+            simulator.setReorderInterval(options.reorder);
+            simulator.setSortPairs(options.sort_pairs);
+            simulator.setCooperativeNarrowPhase(options.cooperative_narrow);
+            simulator.setSpecializedShaders(options.specialize);
+            if (!loadState(simulator, options, result))
+                return;
+            //The recording takes the bounds and scales of the loaded bodies
+            if (result.load_ms >= 0.0)
+                simulator.readTransforms(scene.transforms);
+            result.bodies = simulator.getBodyCount();
+        }
+
+        recording::TrajectoryWriter writer;
+        recording::StatePublisher publisher;
+        std::vector<glm::mat4> transforms;
+        if (!options.record.empty() && !openRecording(writer, scene, options, result))
+            return;
+        if (!options.publish.empty() && !openPublisher(publisher, options, result))
+            return;
+
+        for (unsigned int i = 0; i < options.warmup; i++){
+            simulator.update(options.delta_time, scene.gravity);
+            simulator.getContactCount();
+        }
+        glFinish();
+
+        if constexpr (std::is_same_v<T, GpuSimulator>){
+            if (!saveState(simulator, options, result))
+                return;
+        }
+        simulator.getProfiler().reset();
+
+        std::vector<float> step_ms, pairs, contacts;
+        step_ms.reserve(options.steps);
+        pairs.reserve(options.steps);
+        contacts.reserve(options.steps);
+
+        Clock::time_point start = Clock::now();
+        for (unsigned int i = 0; i < options.steps; i++){
+            Clock::time_point begin = Clock::now();
+            simulator.update(options.delta_time, scene.gravity);
+            //Reading the contact count waits for the step, so every sample covers exactly one step
+            contacts.push_back(static_cast<float>(simulator.getContactCount()));
+            step_ms.push_back(elapsedMs(begin, Clock::now()));
+            pairs.push_back(static_cast<float>(simulator.getPairCount()));
+
+            if constexpr (std::is_same_v<T, GpuSimulator>){
+                if (writer.isOpen() || publisher.isOpen())
+                    simulator.readTransforms(transforms);
+                if (writer.isOpen())
+                    writer.pushFrame(transforms);
+                if (publisher.isOpen())
+                    publisher.publish(options.warmup + i + 1, options.delta_time * (options.warmup + i + 1.0), transforms);
+            }
+        }
+        glFinish();
+        result.total_ms = elapsedMs(start, Clock::now());
+
+        if (writer.isOpen() && !writer.close())
+            result.error = "could not write the trajectory";
+
+        //An empty frame harvests the timestamps of the last steps
+        profiling::GpuProfiler& profiler = simulator.getProfiler();
+        profiler.beginFrame();
+        profiler.endFrame();
+        for (unsigned int phase = 0; phase < profiler.getPhaseCount(); phase++){
+            profiling::PhaseStats stats = profiler.getStats(phase);
+            result.phases.push_back(PhaseResult{ profiler.getPhaseName(phase), Stats{ stats.min, stats.avg, stats.p95, stats.max, stats.samples } });
+        }
+
+        result.step_ms = summarize(step_ms);
+        result.pairs = summarize(pairs);
+        result.contacts = summarize(contacts);
+    }
+#endif
+
+    /**
+     * @brief Runs a scenario on the cpu simulator
+     */
+    void runOnCpu(bench::Scene& scene, const physics::WorldLayout& worlds, const Options& options, Result& result){
+        jobs::JobSystem job_system(options.threads);
+        Simulator simulator(
+            &scene.transforms,
+            &scene.vertices,
+            &scene.indices,
+            &scene.object_vertices,
+            &scene.object_normals,
+            &scene.object_edges,
+            &scene.properties,
+            &job_system
+        );
+        result.threads = job_system.getThreadCount();
+        simulator.setWorlds(worlds);
+        simulator.setDeterministic(options.deterministic);
+        simulator.setReorderInterval(options.reorder);
+
+        if (!loadState(simulator, options, result))
+            return;
+        result.bodies = scene.transforms.size();
+
+        recording::TrajectoryWriter writer;
+        recording::StatePublisher publisher;
+        if (!options.record.empty() && !openRecording(writer, scene, options, result))
+            return;
+        if (!options.publish.empty() && !openPublisher(publisher, options, result))
+            return;
+
+        for (unsigned int i = 0; i < options.warmup; i++)
+            simulator.update(options.delta_time, scene.gravity);
+
+        if (!saveState(simulator, options, result))
+            return;
+
+        const jobs::TaskGraph& graph = simulator.getStepGraph();
+        std::vector<std::vector<float>> task_ms(graph.size());
+        std::vector<float> step_ms, pairs, contacts;
+        step_ms.reserve(options.steps);
+        pairs.reserve(options.steps);
+        contacts.reserve(options.steps);
+        for (auto& samples : task_ms)
+            samples.reserve(options.steps);
+
+        // Only the allocations of the steps count, not the ones of the recording
+        size_t allocations = 0;
+        Clock::time_point start = Clock::now();
+        for (unsigned int i = 0; i < options.steps; i++){
+            size_t allocations_before = memory::getAllocationCount();
+            Clock::time_point begin = Clock::now();
+            simulator.update(options.delta_time, scene.gravity);
+            step_ms.push_back(elapsedMs(begin, Clock::now()));
+            allocations += memory::getAllocationCount() - allocations_before;
+            pairs.push_back(static_cast<float>(simulator.getPairCount()));
+            contacts.push_back(static_cast<float>(simulator.getContactCount()));
+            for (jobs::TaskGraph::TaskId id = 0; id < graph.size(); id++)
+                task_ms[id].push_back(graph.getDuration(id));
+
+            if (writer.isOpen())
+                writer.pushFrame(scene.transforms);
+            if (publisher.isOpen())
+                publisher.publish(options.warmup + i + 1, options.delta_time * (options.warmup + i + 1.0), scene.transforms);
+        }
+        result.total_ms = elapsedMs(start, Clock::now());
+        result.arena_high_water = simulator.getArenaHighWaterMark();
+        result.arena_capacity = simulator.getArenaCapacity();
+        if (memory::isCountingAllocations() && options.steps > 0)
+            result.allocations_per_step = static_cast<double>(allocations) / options.steps;
+
+        if (writer.isOpen() && !writer.close())
+            result.error = "could not write the trajectory";
+
+        for (jobs::TaskGraph::TaskId id = 0; id < graph.size(); id++)
+            result.phases.push_back(PhaseResult{ graph.getName(id), summarize(task_ms[id]) });
+
+        result.step_ms = summarize(step_ms);
+        result.pairs = summarize(pairs);
+        result.contacts = summarize(contacts);
+    }
+
+    /**
+     * @brief Puts the bodies of a scene in a random order (the same one for the same seed)
+     */
+    void shuffleScene(bench::Scene& scene, unsigned int seed){
+        std::vector<uint32_t> order(scene.transforms.size());
+        for (uint32_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+
+        std::vector<glm::mat4> transforms(order.size());
+        std::vector<physics::Properties> properties(order.size());
+        for (size_t i = 0; i < order.size(); i++){
+            transforms[i] = scene.transforms[order[i]];
+            properties[i] = scene.properties[order[i]];
+        }
+        scene.transforms = std::move(transforms);
+        scene.properties = std::move(properties);
+    }
+
+    /**
+     * @brief Builds and runs a scenario
+     */
+    Result runScenario(const bench::Scenario& scenario, const Options& options, [[maybe_unused]] bool has_context){
+        Result result;
+        result.scenario = &scenario;
+        result.engine = options.force_engine ? options.engine : scenario.engine;
+
+        bench::Scene scene;
+        scenario.build(scene, options.scale, bench::C_DEFAULT_SEED);
+        if (options.shuffle)
+            shuffleScene(scene, bench::C_DEFAULT_SEED);
+
+        //The other worlds are the same scenario with the next seeds, all of them share the mesh
+        physics::WorldBatch batch;
+        if (options.worlds > 1){
+            batch.reserve(options.worlds, scene.transforms.size() * options.worlds);
+            batch.addWorld(scene.transforms, scene.properties, physics::WorldParams{ scene.gravity });
+            for (unsigned int w = 1; w < options.worlds; w++){
+                bench::Scene copy;
+                scenario.build(copy, options.scale, bench::C_DEFAULT_SEED + w);
+                if (options.shuffle)
+                    shuffleScene(copy, bench::C_DEFAULT_SEED + w);
+                batch.addWorld(copy.transforms, copy.properties, physics::WorldParams{ copy.gravity });
+            }
+            //The scene takes the bodies of every world, the batch keeps their layout
+            scene.transforms = std::move(batch.getTransforms());
+            scene.properties = std::move(batch.getProperties());
+        }
+        result.bodies = scene.transforms.size();
+
+        if (result.engine == bench::Engine::Cpu){
+            if (options.sort_pairs)
+                result.error = "only the gpu engine sorts its pairs";
+            else if (options.cooperative_narrow)
+                result.error = "only the gpu engine has a cooperative narrow phase";
+            else if (options.specialize)
+                result.error = "only the gpu engine specializes its shaders";
+            else
+                runOnCpu(scene, batch.getLayout(), options, result);
+            return result;
+        }
+
+#ifdef PHYSICS_GPU
+        if (!has_context){
+            result.error = "no OpenGL context";
+            return result;
+        }
+
+        if (result.engine == bench::Engine::Gpu){
+            //GpuSimulator keeps room for every possible pair (bodies^2 manifolds)
+            GLint64 max_block = 0;
+            glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &max_block);
+            uint64_t pairs = batch.getLayout().getPairBound(result.bodies);
+            if (pairs > UINT32_MAX || pairs * sizeof(physics::ContactManifold) > static_cast<uint64_t>(max_block)){
+                result.error = "too many bodies for the pair buffers of GpuSimulator, use a smaller --scale";
+                return result;
+            }
+            runOnGpu<GpuSimulator>(scene, batch.getLayout(), options, result);
+        }
+        else if (!options.record.empty() || !options.publish.empty())
+            result.error = "the collision engine does not move the bodies, nothing to record or publish";
+        else if (!options.save_checkpoint.empty() || !options.load_checkpoint.empty())
+            result.error = "the collision engine has no state to checkpoint";
+        else if (options.worlds > 1)
+            result.error = "the collision engine has no worlds";
+        else if (options.deterministic)
+            result.error = "the collision engine has no deterministic mode";
+        else if (options.reorder > 0)
+            result.error = "the collision engine does not reorder its bodies";
+        else if (options.sort_pairs)
+            result.error = "only the gpu engine sorts its pairs";
+        else if (options.cooperative_narrow)
+            result.error = "only the gpu engine has a cooperative narrow phase";
+        else if (options.specialize)
+            result.error = "only the gpu engine specializes its shaders";
+        else
+            runOnGpu<CollisionDetector>(scene, batch.getLayout(), options, result);
+#else
+        result.error = "built without the gpu engines, use --engine cpu";
+#endif
+        return result;
+    }
+
+    /**
+     * @brief Writes a string as a JSON string
+     */
+    void writeString(std::ostream& out, const std::string& text){
+        out << '"';
+        for (char c : text){
+            if (c == '"' || c == '\\')
+                out << '\\';
+            out << c;
+        }
+        out << '"';
+    }
+
+    void writeStats(std::ostream& out, const Stats& stats, const char* suffix){
+        out << "{\"samples\": " << stats.samples
+            << ", \"min" << suffix << "\": " << stats.min << ", \"avg" << suffix << "\": " << stats.avg
+            << ", \"p95" << suffix << "\": " << stats.p95 << ", \"max" << suffix << "\": " << stats.max << "}";
+    }
+
+    /**
+     * @brief Writes the report of every scenario
+     */
+    bool writeReport(const std::string& path, const Options& options, const std::string& renderer,
+                     const std::string& version, const std::vector<Result>& results){
+        std::ofstream file(path);
+        if (!file.is_open()){
+            std::cerr << "Error: could not open " << path << std::endl;
+            return false;
+        }
+
+        file << "{\n  \"renderer\": ";
+        writeString(file, renderer);
+        file << ",\n  \"version\": ";
+        writeString(file, version);
+        file << ",\n  \"scale\": " << options.scale << ",\n  \"steps\": " << options.steps
+             << ",\n  \"warmup\": " << options.warmup << ",\n  \"delta_time\": " << options.delta_time
+             << ",\n  \"worlds\": " << options.worlds
+             << ",\n  \"deterministic\": " << (options.deterministic ? "true" : "false")
+             << ",\n  \"reorder\": " << options.reorder
+             << ",\n  \"shuffle\": " << (options.shuffle ? "true" : "false")
+             << ",\n  \"sort_pairs\": " << (options.sort_pairs ? "true" : "false")
+             << ",\n  \"cooperative_narrow\": " << (options.cooperative_narrow ? "true" : "false")
+             << ",\n  \"specialize\": " << (options.specialize ? "true" : "false")
+             << ",\n  \"results\": [";
+
+        for (size_t i = 0; i < results.size(); i++){
+            const Result& result = results[i];
+            file << (i == 0 ? "\n" : ",\n") << "    {\"scenario\": ";
+            writeString(file, result.scenario->name);
+            file << ", \"engine\": \"" << bench::getEngineName(result.engine) << "\", \"bodies\": " << result.bodies;
+            if (result.engine == bench::Engine::Cpu)
+                file << ", \"threads\": " << result.threads;
+
+            if (!result.error.empty()){
+                file << ", \"error\": ";
+                writeString(file, result.error);
+                file << "}";
+                continue;
+            }
+
+            double steps_per_second = result.total_ms > 0.0 ? options.steps * 1000.0 / result.total_ms : 0.0;
+            file << ", \"total_ms\": " << result.total_ms << ", \"steps_per_second\": " << steps_per_second;
+            if (result.load_ms >= 0.0)
+                file << ", \"checkpoint_load_ms\": " << result.load_ms;
+            if (result.engine == bench::Engine::Cpu){
+                file << ", \"arena_high_water\": " << result.arena_high_water << ", \"arena_capacity\": " << result.arena_capacity;
+                if (result.allocations_per_step >= 0.0)
+                    file << ", \"allocations_per_step\": " << result.allocations_per_step;
+            }
+            file << ",\n     \"step\": ";
+            writeStats(file, result.step_ms, "_ms");
+            file << ",\n     \"pairs\": ";
+            writeStats(file, result.pairs, "");
+            file << ",\n     \"contacts\": ";
+            writeStats(file, result.contacts, "");
+            file << ",\n     \"phases\": [";
+            for (size_t phase = 0; phase < result.phases.size(); phase++){
+                const Stats& stats = result.phases[phase].stats;
+                file << (phase == 0 ? "\n" : ",\n") << "       {\"name\": ";
+                writeString(file, result.phases[phase].name);
+                file << ", \"samples\": " << stats.samples << ", \"min_ms\": " << stats.min << ", \"avg_ms\": " << stats.avg
+                     << ", \"p95_ms\": " << stats.p95 << ", \"max_ms\": " << stats.max << "}";
+            }
+            file << "\n     ]}";
+        }
+        file << "\n  ]\n}\n";
+        return true;
+    }
+
+    void printUsage(){
+        std::cout << "Usage: physics_bench [options]\n"
+                  << "  --scenario all|name[,name...]  scenarios to run (default all)\n"
+                  << "  --scale s                      multiplies the number of bodies (default 1)\n"
+                  << "  --steps n                      measured steps (default 300)\n"
+                  << "  --warmup n                     steps run before measuring (default 30)\n"
+                  << "  --dt seconds                   time step (default 1/60)\n"
+                  << "  --engine gpu|collision|cpu     run every scenario on this engine\n"
+                  << "  --threads n                    job system threads of the cpu engine (default all)\n"
+                  << "  --output file                  JSON report (default bench_results.json)\n"
+                  << "  --record file                  writes a trajectory of the measured steps (slows the steps down)\n"
+                  << "  --save-checkpoint file         saves the state reached after the warmup\n"
+                  << "  --load-checkpoint file         starts from a saved state instead of the built bodies\n"
+                  << "  --worlds n                     steps n copies of each scenario as independent worlds (default 1)\n"
+                  << "  --publish name                 publishes the measured steps into shared memory (see physics_state_reader)\n"
+                  << "  --deterministic                steps the simulators in their reproducible mode\n"
+                  << "  --reorder n                    sorts the bodies by Morton code every n steps (default 0, never)\n"
+                  << "  --shuffle                      puts the bodies of the built scenes in a random order\n"
+                  << "  --sort-pairs                   sorts the broad phase pairs of the gpu simulator\n"
+                  << "  --cooperative-narrow           runs the narrow phase of the gpu simulator with 16 invocations per pair (experimental)\n"
+                  << "  --specialize                   compiles the narrow phase of the gpu simulator for the shape of the bodies\n"
+                  << "  --list                         print the scenarios and exit\n";
+    }
+
+    void printScenarios(){
+        for (const bench::Scenario& scenario : bench::getScenarios())
+            std::cout << scenario.name << " (" << bench::getEngineName(scenario.engine) << "): " << scenario.description << "\n";
+    }
+
+    /**
+     * @brief Parses the command line
+     * @return false if the program should exit (bad arguments, --help or --list)
+     */
+    bool parseOptions(int argc, char* argv[], Options& options, int& exit_code){
+        std::string scenarios = "all";
+        exit_code = 0;
+
+        for (int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h"){
+                printUsage();
+                return false;
+            }
+            if (arg == "--list"){
+                printScenarios();
+                return false;
+            }
+            if (arg == "--deterministic"){
+                options.deterministic = true;
+                continue;
+            }
+            if (arg == "--shuffle"){
+                options.shuffle = true;
+                continue;
+            }
+            if (arg == "--sort-pairs"){
+                options.sort_pairs = true;
+                continue;
+            }
+            if (arg == "--cooperative-narrow"){
+                options.cooperative_narrow = true;
+                continue;
+            }
+            if (arg == "--specialize"){
+                options.specialize = true;
+                continue;
+            }
+            if (i + 1 >= argc){
+                std::cerr << "Error: unknown option or missing value: " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+
+            std::string value = argv[++i];
+            if (arg == "--scenario")
+                scenarios = value;
+            else if (arg == "--scale")
+                options.scale = std::stof(value);
+            else if (arg == "--steps")
+                options.steps = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--warmup")
+                options.warmup = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--dt")
+                options.delta_time = std::stof(value);
+            else if (arg == "--threads")
+                options.threads = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--output")
+                options.output = value;
+            else if (arg == "--record")
+                options.record = value;
+            else if (arg == "--save-checkpoint")
+                options.save_checkpoint = value;
+            else if (arg == "--load-checkpoint")
+                options.load_checkpoint = value;
+            else if (arg == "--worlds")
+                options.worlds = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--publish")
+                options.publish = value;
+            else if (arg == "--reorder")
+                options.reorder = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--engine"){
+                options.force_engine = true;
+                if (!bench::parseEngine(value, options.engine)){
+                    std::cerr << "Error: unknown engine " << value << std::endl;
+                    exit_code = 1;
+                    return false;
+                }
+            }
+            else{
+                std::cerr << "Error: unknown option " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+        }
+
+        if (options.scale <= 0.0f || options.steps == 0 || options.worlds == 0){
+            std::cerr << "Error: --scale, --steps and --worlds must be positive" << std::endl;
+            exit_code = 1;
+            return false;
+        }
+
+        //The trajectory and the published state need every body to keep its index
+        if (options.reorder > 0 && (!options.record.empty() || !options.publish.empty())){
+            std::cerr << "Error: --reorder moves the bodies to other indices, it cannot be combined with --record or --publish" << std::endl;
+            exit_code = 1;
+            return false;
+        }
+
+        if (scenarios == "all"){
+            for (const bench::Scenario& scenario : bench::getScenarios())
+                options.scenarios.push_back(&scenario);
+            return true;
+        }
+
+        std::stringstream names(scenarios);
+        std::string name;
+        while (std::getline(names, name, ',')){
+            const bench::Scenario* scenario = bench::findScenario(name);
+            if (!scenario){
+                std::cerr << "Error: unknown scenario " << name << " (see --list)" << std::endl;
+                exit_code = 1;
+                return false;
+            }
+            options.scenarios.push_back(scenario);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]){
+    Options options;
+    int exit_code = 0;
+    try {
+        if (!parseOptions(argc, argv, options, exit_code))
+            return exit_code;
+    } catch (std::exception&) {
+        std::cerr << "Error: invalid number in the arguments" << std::endl;
+        return 1;
+    }
+
+    bool has_context = false;
+    std::string renderer, version;
+#ifdef PHYSICS_GPU
+    //Only the gpu engines need a context
+    bool needs_context = std::any_of(options.scenarios.begin(), options.scenarios.end(), [&](const bench::Scenario* scenario){
+        return (options.force_engine ? options.engine : scenario->engine) != bench::Engine::Cpu;
+    });
+
+    bench::HeadlessContext context;
+    if (needs_context){
+        std::string error;
+        has_context = context.create(error);
+        if (has_context){
+            renderer = context.getRenderer();
+            version = context.getVersion();
+        }
+        else
+            std::cerr << "Error: " << error << ", skipping the gpu scenarios" << std::endl;
+    }
+#endif
+
+    std::vector<Result> results;
+    for (const bench::Scenario* scenario : options.scenarios){
+        results.push_back(runScenario(*scenario, options, has_context));
+
+        const Result& result = results.back();
+        std::cerr << scenario->name << " (" << bench::getEngineName(result.engine) << ", " << result.bodies << " bodies): ";
+        if (!result.error.empty()){
+            std::cerr << "failed, " << result.error << std::endl;
+            exit_code = 1;
+        }
+        else
+            std::cerr << options.steps * 1000.0 / result.total_ms << " steps/s, " << result.step_ms.avg << " ms/step"
+                      << (result.load_ms >= 0.0 ? ", checkpoint loaded in " + std::to_string(result.load_ms) + " ms" : std::string()) << std::endl;
+
+        // After the warmup the steps must run on the memory they already have
+        if (result.error.empty() && result.allocations_per_step > 0.0){
+            std::cerr << scenario->name << ": " << result.allocations_per_step << " heap allocations per step after the warmup" << std::endl;
+            exit_code = 1;
+        }
+    }
+
+    if (!writeReport(options.output, options, renderer, version, results))
+        return 1;
+    return exit_code;
+}
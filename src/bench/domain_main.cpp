@@ -0,0 +1,414 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "scenarios.h"
+#include "../simulators/simulator.h"
+#include "../jobs/job_system.h"
+#include "../distributed/domain_exchange.h"
+#include "../distributed/domain_worker.h"
+
+/**
+ * Spatial domain decomposition over local processes, a stand-in for the nodes of a cluster. The
+ * scene is split in slabs along one axis and each rank, a process of its own, steps the bodies of
+ * its slab plus the ghosts mirrored from the neighbouring ones. The ranks exchange the bodies
+ * through shared memory (see domain_exchange.h), ownership moves with the bodies across the
+ * planes and the planes move every few steps so each rank keeps the same number of bodies:
+ *
+ *  physics_domain [--scenario name] [--scale s] [--seed n] [--ranks n] [--steps n] [--dt seconds]
+ *                 [--axis x|y|z] [--margin m] [--rebalance n] [--threads n] [--name block]
+ *                 [--verify] [--tolerance t]
+ *
+ * --verify steps the same scene in this process afterwards and prints how far the bodies ended
+ * from the decomposed run; with --tolerance the exit code fails above it. The ghosts lack their
+ * own neighbours from other slabs, so the result only matches the single process one when the
+ * margin covers as many layers of contacts as the solver iterations, which on small scenes is the
+ * whole scene. A rank with more ghosts than owned bodies gets a warning. The ranks are started
+ * by the coordinator (fork on POSIX, the same executable with --worker on Windows).
+ */
+
+namespace{
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Command line options
+     */
+    struct Options{
+        const bench::Scenario* scenario = nullptr;
+        float scale = 1.0f;
+        unsigned int seed = bench::C_DEFAULT_SEED;
+        unsigned int steps = 300;
+        float delta_time = 1.0f / 60.0f;
+        unsigned int threads = 1; /* Job system threads of each rank */
+        std::string name = "physics_domain";
+        distributed::DomainDesc desc;
+        bool verify = false;
+        float tolerance = 0.0f; /* Largest distance a body may end from the single process run, 0 to only report it */
+        int worker = -1; /* Rank of a worker process, -1 for the coordinator */
+    };
+
+    double elapsedMs(Clock::time_point begin, Clock::time_point end){
+        return std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+
+    /**
+     * @brief Runs one rank until the last step
+     * @return exit code of the rank
+     */
+    int runWorker(const Options& options, unsigned int rank, const bench::Scene& scene){
+        distributed::DomainExchange exchange;
+        if (!exchange.open(options.name))
+            return 1;
+
+        jobs::JobSystem job_system(options.threads);
+        distributed::DomainWorker worker(exchange, rank, &scene.vertices, &scene.indices, &scene.object_vertices,
+                                         &scene.object_normals, &scene.object_edges, &job_system);
+        for (unsigned int i = 0; i < options.steps; i++){
+            if (!worker.step(options.delta_time, scene.gravity)){
+                std::cerr << "Rank " << rank << ": aborted at step " << i << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Margin past the reach of the owned bodies (see DomainWorker::step), for the motion
+     * during the step: half the radius of a typical dynamic body. A few large bodies do not widen
+     * every slab, the ranks owning them already reach further
+     */
+    float getAutomaticMargin(const bench::Scene& scene){
+        float base_radius = utils::calculateRadius(scene.vertices);
+        std::vector<float> radii;
+        for (size_t i = 0; i < scene.transforms.size(); i++){
+            if (scene.properties[i].inverseMass == 0.0f)
+                continue;
+            glm::vec3 scale = utils::scaleFromTransform(scene.transforms[i]);
+            radii.push_back(base_radius * std::max(scale.x, std::max(scale.y, scale.z)));
+        }
+        if (radii.empty())
+            return 0.0f;
+
+        std::nth_element(radii.begin(), radii.begin() + radii.size() / 2, radii.end());
+        return 0.5f * radii[radii.size() / 2];
+    }
+
+#ifdef _WIN32
+    /**
+     * @brief Process of a rank
+     */
+    using Process = HANDLE;
+
+    /**
+     * @brief Starts this executable again as one of the ranks, it builds the same scene from the same options
+     */
+    bool startRank(const Options& options, unsigned int rank, const bench::Scene&, Process& process){
+        char path[MAX_PATH];
+        if (GetModuleFileNameA(nullptr, path, MAX_PATH) == 0)
+            return false;
+
+        //The settings of the decomposition are in the block, the rank only needs the scene
+        std::string command = "\\"" + std::string(path) + "\\" --worker " + std::to_string(rank) + " --name " + options.name
+            + " --scenario " + options.scenario->name + " --scale " + std::to_string(options.scale)
+            + " --seed " + std::to_string(options.seed) + " --steps " + std::to_string(options.steps)
+            + " --dt " + std::to_string(options.delta_time) + " --threads " + std::to_string(options.threads);
+
+        STARTUPINFOA startup = {};
+        startup.cb = sizeof(startup);
+        PROCESS_INFORMATION info = {};
+        if (!CreateProcessA(nullptr, command.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &info))
+            return false;
+        CloseHandle(info.hThread);
+        process = info.hProcess;
+        return true;
+    }
+
+    /**
+     * @brief Waits for every rank, the first one that fails aborts the others
+     * @return false if a rank failed
+     */
+    bool waitRanks(std::vector<Process>& processes, distributed::DomainExchange& exchange){
+        bool success = true;
+        std::vector<HANDLE> pending = processes;
+        while (!pending.empty()){
+            DWORD index = WaitForMultipleObjects(static_cast<DWORD>(pending.size()), pending.data(), FALSE, INFINITE) - WAIT_OBJECT_0;
+            if (index >= pending.size())
+                return false;
+            DWORD code = 1;
+            GetExitCodeProcess(pending[index], &code);
+            CloseHandle(pending[index]);
+            if (code != 0 && success){
+                success = false;
+                exchange.abort();
+            }
+            pending.erase(pending.begin() + index);
+        }
+        return success;
+    }
+#else
+    /**
+     * @brief Process of a rank
+     */
+    using Process = pid_t;
+
+    /**
+     * @brief Forks one of the ranks, it steps the scene the coordinator already built
+     */
+    bool startRank(const Options& options, unsigned int rank, const bench::Scene& scene, Process& process){
+        //Whatever is buffered would be written by both processes
+        std::cout.flush();
+        std::cerr.flush();
+
+        pid_t pid = fork();
+        if (pid < 0)
+            return false;
+        if (pid == 0){
+            //The copy of the coordinator must not run its destructors (they would remove the block)
+            int code = runWorker(options, rank, scene);
+            std::cout.flush();
+            std::cerr.flush();
+            std::_Exit(code);
+        }
+        process = pid;
+        return true;
+    }
+
+    /**
+     * @brief Waits for every rank, the first one that fails aborts the others
+     * @return false if a rank failed
+     */
+    bool waitRanks(std::vector<Process>& processes, distributed::DomainExchange& exchange){
+        bool success = true;
+        for (size_t pending = processes.size(); pending > 0; pending--){
+            int status = 0;
+            pid_t pid = waitpid(-1, &status, 0);
+            if (pid < 0)
+                return false;
+            if ((!WIFEXITED(status) || WEXITSTATUS(status) != 0) && success){
+                success = false;
+                exchange.abort();
+            }
+        }
+        return success;
+    }
+#endif
+
+    /**
+     * @brief Steps the scene in this process and compares the bodies with the decomposed run
+     * @return largest distance between the positions of a body in both runs
+     */
+    float verify(const Options& options, bench::Scene scene, const glm::mat4* decomposed){
+        jobs::JobSystem job_system(options.threads);
+        Simulator simulator(&scene.transforms, &scene.vertices, &scene.indices, &scene.object_vertices,
+                            &scene.object_normals, &scene.object_edges, &scene.properties, &job_system);
+        for (unsigned int i = 0; i < options.steps; i++)
+            simulator.update(options.delta_time, scene.gravity);
+
+        float max_error = 0.0f;
+        double total_error = 0.0;
+        for (size_t i = 0; i < scene.transforms.size(); i++){
+            float error = glm::length(glm::vec3(scene.transforms[i][3]) - glm::vec3(decomposed[i][3]));
+            max_error = std::max(max_error, error);
+            total_error += error;
+        }
+        std::cout << "Single process: max distance " << max_error << ", average "
+                  << total_error / std::max<size_t>(scene.transforms.size(), 1) << std::endl;
+        return max_error;
+    }
+
+    /**
+     * @brief Prints what each rank did
+     */
+    void printRanks(const Options& options, const distributed::DomainExchange& exchange){
+        double max_ratio = 0.0;
+        for (unsigned int r = 0; r < options.desc.rank_count; r++){
+            const distributed::DomainRankStats& stats = exchange.getRankStats(r);
+            double steps = std::max<uint64_t>(stats.steps, 1);
+            double ratio = static_cast<double>(stats.ghosts) / std::max<uint32_t>(stats.owned, 1);
+            max_ratio = std::max(max_ratio, ratio);
+            std::cout << "rank " << r << ": slab [" << stats.lower << ", " << stats.upper << "), " << stats.owned << " owned, "
+                      << stats.ghosts << " ghosts (" << std::setprecision(3) << ratio << " per owned), " << stats.migrated
+                      << " migrated in, " << stats.step_ms / steps << " ms/step, " << stats.wait_ms / steps << " ms/step waiting" << std::endl;
+        }
+
+        //Past one ghost per owned body a rank steps more than twice its share, the slabs are too thin
+        if (max_ratio > 1.0)
+            std::cerr << "Warning: up to " << std::setprecision(3) << max_ratio << " ghosts per owned body, the slabs are "
+                      << "thinner than the reach of the ghosts (use fewer ranks or a smaller --margin)" << std::endl;
+    }
+
+    void printUsage(){
+        std::cout << "Usage: physics_domain [options]\n"
+                  << "  --scenario name   scenario to split (default complex_3)\n"
+                  << "  --scale s         multiplies the number of bodies (default 1)\n"
+                  << "  --seed n          seed of the scene (default 42)\n"
+                  << "  --ranks n         processes, one slab each (default 2)\n"
+                  << "  --steps n         steps (default 300)\n"
+                  << "  --dt seconds      time step (default 1/60)\n"
+                  << "  --axis x|y|z      axis the slabs are stacked along (default x)\n"
+                  << "  --margin m        ghost margin past the reach of the owned bodies (default half the median dynamic body radius)\n"
+                  << "  --rebalance n     steps between two moves of the planes, 0 to keep the first ones (default 30)\n"
+                  << "  --threads n       job system threads of each rank (default 1)\n"
+                  << "  --name block      name of the shared memory block (default physics_domain)\n"
+                  << "  --verify          compares the result with a single process run\n"
+                  << "  --tolerance t     with --verify, fails if a body ends farther than t\n";
+    }
+
+    /**
+     * @brief Parses the command line
+     * @return false if the program should exit (bad arguments or --help)
+     */
+    bool parseOptions(int argc, char* argv[], Options& options, int& exit_code){
+        std::string scenario = "complex_3";
+        bool automatic_margin = true;
+        exit_code = 0;
+
+        for (int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h"){
+                printUsage();
+                return false;
+            }
+            if (arg == "--verify"){
+                options.verify = true;
+                continue;
+            }
+            if (i + 1 >= argc){
+                std::cerr << "Error: unknown option or missing value: " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+
+            std::string value = argv[++i];
+            if (arg == "--scenario")
+                scenario = value;
+            else if (arg == "--scale")
+                options.scale = std::stof(value);
+            else if (arg == "--seed")
+                options.seed = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--ranks")
+                options.desc.rank_count = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--steps")
+                options.steps = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--dt")
+                options.delta_time = std::stof(value);
+            else if (arg == "--margin"){
+                options.desc.margin = std::stof(value);
+                automatic_margin = false;
+            }
+            else if (arg == "--rebalance")
+                options.desc.rebalance_interval = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--threads")
+                options.threads = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--name")
+                options.name = value;
+            else if (arg == "--tolerance")
+                options.tolerance = std::stof(value);
+            else if (arg == "--worker")
+                options.worker = std::stoi(value);
+            else if (arg == "--axis"){
+                if (value != "x" && value != "y" && value != "z"){
+                    std::cerr << "Error: unknown axis " << value << std::endl;
+                    exit_code = 1;
+                    return false;
+                }
+                options.desc.axis = static_cast<uint32_t>(value[0] - 'x');
+            }
+            else{
+                std::cerr << "Error: unknown option: " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+        }
+
+        options.scenario = bench::findScenario(scenario);
+        if (!options.scenario){
+            std::cerr << "Error: unknown scenario " << scenario << " (see physics_bench --list)" << std::endl;
+            exit_code = 1;
+            return false;
+        }
+        if (options.scale <= 0.0f || options.steps == 0 || options.desc.rank_count == 0){
+            std::cerr << "Error: scale, steps and ranks must be positive" << std::endl;
+            exit_code = 1;
+            return false;
+        }
+        //Negative margins mean the automatic one
+        if (automatic_margin)
+            options.desc.margin = -1.0f;
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]){
+    Options options;
+    int exit_code = 0;
+    try {
+        if (!parseOptions(argc, argv, options, exit_code))
+            return exit_code;
+    } catch (std::exception&) {
+        std::cerr << "Error: invalid number in the arguments" << std::endl;
+        return 1;
+    }
+
+    bench::Scene scene;
+    options.scenario->build(scene, options.scale, options.seed);
+    if (options.worker >= 0)
+        return runWorker(options, static_cast<unsigned int>(options.worker), scene);
+
+    if (options.desc.margin < 0.0f)
+        options.desc.margin = getAutomaticMargin(scene);
+
+    distributed::DomainExchange exchange;
+    if (!exchange.create(options.name, options.desc, scene.transforms, scene.properties))
+        return 1;
+    std::cout << options.scenario->name << ": " << scene.transforms.size() << " bodies over " << options.desc.rank_count
+              << " ranks, margin " << options.desc.margin << std::endl;
+
+    Clock::time_point start = Clock::now();
+    std::vector<Process> processes;
+    for (unsigned int r = 0; r < options.desc.rank_count; r++){
+        Process process;
+        if (!startRank(options, r, scene, process)){
+            std::cerr << "Error: could not start rank " << r << std::endl;
+            exchange.abort();
+            waitRanks(processes, exchange);
+            return 1;
+        }
+        processes.push_back(process);
+    }
+    if (!waitRanks(processes, exchange)){
+        std::cerr << "Error: a rank failed" << std::endl;
+        return 1;
+    }
+    double total_ms = elapsedMs(start, Clock::now());
+
+    printRanks(options, exchange);
+    std::cout << std::setprecision(4) << options.steps * 1000.0 / total_ms << " steps/s, "
+              << total_ms / options.steps << " ms/step" << std::endl;
+
+    if (options.verify){
+        float max_error = verify(options, scene, exchange.getTransforms(options.steps));
+        if (options.tolerance > 0.0f && max_error > options.tolerance){
+            std::cerr << "Error: the decomposed run differs by more than " << options.tolerance << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "scenarios.h"
+#include "../simulators/simulator.h"
+#include "../jobs/job_system.h"
+
+#ifdef PHYSICS_GPU
+#include <GL/glew.h>
+
+#include "headless_context.h"
+#include "../simulators/gpu_simulator.h"
+#endif
+
+/**
+ * Reproducibility check. Steps a scenario several times and hashes the transforms of every body
+ * after each step, then reports the first step where two runs differ:
+ *
+ *  physics_hash [--scenario name] [--scale s] [--seed n] [--steps n] [--dt seconds]
+ *               [--engine cpu|gpu] [--threads n[,n...]] [--runs n] [--nondeterministic]
+ *               [--output file] [--compare file]
+ *
+ * The cpu engine runs once per thread count of --threads, the gpu engine --runs times. Both run in
+ * the deterministic mode unless --nondeterministic is given, which shows what that mode fixes.
+ * --output writes the hashes of the first run ("step hash" per line) and --compare checks the
+ * first run against such a file, from another commit, build or machine. The exit code is 1 if any
+ * run differs.
+ */
+
+namespace{
+
+    constexpr uint64_t C_FNV_OFFSET = 14695981039346656037ull;
+    constexpr uint64_t C_FNV_PRIME = 1099511628211ull;
+
+    /**
+     * @brief Command line options
+     */
+    struct Options{
+        const bench::Scenario* scenario = nullptr;
+        float scale = 0.3f;
+        unsigned int seed = bench::C_DEFAULT_SEED;
+        unsigned int steps = 300;
+        float delta_time = 1.0f / 60.0f;
+        bench::Engine engine = bench::Engine::Cpu;
+        std::vector<unsigned int> threads = { 1, 2, 4 }; /* Job system threads of each cpu run */
+        unsigned int runs = 2; /* Runs of the gpu engine */
+        bool deterministic = true;
+        std::string output; /* Hashes of the first run, empty to not write them */
+        std::string compare; /* Hashes to check the first run against, empty to not compare */
+    };
+
+    /**
+     * @brief Hashes of one run, one per step
+     */
+    struct Run{
+        std::string name;
+        std::vector<uint64_t> hashes;
+    };
+
+    /**
+     * @brief FNV-1a of the transforms of every body. Only the transforms are hashed, the properties
+     * have padding that is never written
+     */
+    uint64_t hashTransforms(const std::vector<glm::mat4>& transforms){
+        uint64_t hash = C_FNV_OFFSET;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(transforms.data());
+        size_t size = transforms.size() * sizeof(glm::mat4);
+        for (size_t i = 0; i < size; i++){
+            hash ^= bytes[i];
+            hash *= C_FNV_PRIME;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Steps the scene on the cpu simulator
+     */
+    Run runOnCpu(const Options& options, unsigned int threads){
+        bench::Scene scene;
+        options.scenario->build(scene, options.scale, options.seed);
+
+        jobs::JobSystem job_system(threads);
+        Simulator simulator(&scene.transforms, &scene.vertices, &scene.indices, &scene.object_vertices,
+                            &scene.object_normals, &scene.object_edges, &scene.properties, &job_system);
+        simulator.setDeterministic(options.deterministic);
+
+        Run run;
+        run.name = "cpu, " + std::to_string(job_system.getThreadCount()) + " threads";
+        run.hashes.reserve(options.steps);
+        for (unsigned int i = 0; i < options.steps; i++){
+            simulator.update(options.delta_time, scene.gravity);
+            run.hashes.push_back(hashTransforms(scene.transforms));
+        }
+        return run;
+    }
+
+#ifdef PHYSICS_GPU
+    /**
+     * @brief Steps the scene on the gpu simulator, reading the transforms back after each step
+     */
+    Run runOnGpu(const Options& options, unsigned int index){
+        bench::Scene scene;
+        options.scenario->build(scene, options.scale, options.seed);
+
+        GpuSimulator simulator(&scene.transforms, &scene.vertices, &scene.indices, &scene.object_vertices,
+                               &scene.object_normals, &scene.object_edges, &scene.properties);
+        simulator.setDeterministic(options.deterministic);
+        simulator.getProfiler().setEnabled(false);
+
+        Run run;
+        run.name = "gpu, run " + std::to_string(index + 1);
+        run.hashes.reserve(options.steps);
+        std::vector<glm::mat4> transforms;
+        for (unsigned int i = 0; i < options.steps; i++){
+            simulator.update(options.delta_time, scene.gravity);
+            simulator.readTransforms(transforms);
+            run.hashes.push_back(hashTransforms(transforms));
+        }
+        glFinish();
+        return run;
+    }
+#endif
+
+    /**
+     * @brief Writes one "step hash" line per step
+     */
+    bool writeHashes(const std::string& path, const Run& run){
+        std::ofstream file(path);
+        if (!file.is_open()){
+            std::cerr << "Error: could not open " << path << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < run.hashes.size(); i++)
+            file << i + 1 << " " << std::hex << std::setw(16) << std::setfill('0') << run.hashes[i] << std::dec << "\n";
+        return true;
+    }
+
+    /**
+     * @brief Reads the hashes written by writeHashes
+     */
+    bool readHashes(const std::string& path, Run& run){
+        std::ifstream file(path);
+        if (!file.is_open()){
+            std::cerr << "Error: could not open " << path << std::endl;
+            return false;
+        }
+        run.name = path;
+        std::string line;
+        while (std::getline(file, line)){
+            std::istringstream fields(line);
+            unsigned int step;
+            uint64_t hash;
+            if (!(fields >> step >> std::hex >> hash) || step != run.hashes.size() + 1){
+                std::cerr << "Error: bad line " << run.hashes.size() + 1 << " in " << path << std::endl;
+                return false;
+            }
+            run.hashes.push_back(hash);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Prints whether a run matches the reference one, and where it starts to differ
+     * @return false if they differ
+     */
+    bool compareRuns(const Run& reference, const Run& run){
+        size_t steps = std::min(reference.hashes.size(), run.hashes.size());
+        for (size_t i = 0; i < steps; i++){
+            if (reference.hashes[i] != run.hashes[i]){
+                std::cout << run.name << ": differs from " << reference.name << " at step " << i + 1 << std::endl;
+                return false;
+            }
+        }
+        if (reference.hashes.size() != run.hashes.size()){
+            std::cout << run.name << ": same " << steps << " steps as " << reference.name << ", but " << run.hashes.size()
+                      << " steps instead of " << reference.hashes.size() << std::endl;
+            return false;
+        }
+        std::cout << run.name << ": identical to " << reference.name << " (" << steps << " steps, last hash "
+                  << std::hex << std::setw(16) << std::setfill('0') << run.hashes.back() << std::dec << ")" << std::endl;
+        return true;
+    }
+
+    void printUsage(){
+        std::cout << "Usage: physics_hash [options]\n"
+                  << "  --scenario name        scenario to step (default complex_3)\n"
+                  << "  --scale s              multiplies the number of bodies (default 0.3)\n"
+                  << "  --seed n               seed of the scene (default 42)\n"
+                  << "  --steps n              steps of each run (default 300)\n"
+                  << "  --dt seconds           time step (default 1/60)\n"
+                  << "  --engine cpu|gpu       engine to check (default cpu)\n"
+                  << "  --threads n[,n...]     thread counts of the cpu runs, one run each (default 1,2,4)\n"
+                  << "  --runs n               runs of the gpu engine (default 2)\n"
+                  << "  --nondeterministic     runs without the deterministic mode\n"
+                  << "  --output file          writes the hashes of the first run\n"
+                  << "  --compare file         checks the first run against hashes written by --output\n";
+    }
+
+    /**
+     * @brief Parses the command line
+     * @return false if the program should exit (bad arguments or --help)
+     */
+    bool parseOptions(int argc, char* argv[], Options& options, int& exit_code){
+        std::string scenario = "complex_3";
+        exit_code = 0;
+
+        for (int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h"){
+                printUsage();
+                return false;
+            }
+            if (arg == "--nondeterministic"){
+                options.deterministic = false;
+                continue;
+            }
+            if (i + 1 >= argc){
+                std::cerr << "Error: unknown option or missing value: " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+
+            std::string value = argv[++i];
+            if (arg == "--scenario")
+                scenario = value;
+            else if (arg == "--scale")
+                options.scale = std::stof(value);
+            else if (arg == "--seed")
+                options.seed = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--steps")
+                options.steps = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--dt")
+                options.delta_time = std::stof(value);
+            else if (arg == "--runs")
+                options.runs = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--output")
+                options.output = value;
+            else if (arg == "--compare")
+                options.compare = value;
+            else if (arg == "--threads"){
+                options.threads.clear();
+                std::stringstream counts(value);
+                std::string count;
+                while (std::getline(counts, count, ','))
+                    options.threads.push_back(static_cast<unsigned int>(std::stoul(count)));
+            }
+            else if (arg == "--engine"){
+                if (!bench::parseEngine(value, options.engine) || options.engine == bench::Engine::Collision){
+                    std::cerr << "Error: the engine must be cpu or gpu" << std::endl;
+                    exit_code = 1;
+                    return false;
+                }
+            }
+            else{
+                std::cerr << "Error: unknown option " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+        }
+
+        if (options.scale <= 0.0f || options.steps == 0 || options.runs == 0 || options.threads.empty()){
+            std::cerr << "Error: --scale, --steps, --runs and --threads must be positive" << std::endl;
+            exit_code = 1;
+            return false;
+        }
+
+        options.scenario = bench::findScenario(scenario);
+        if (!options.scenario){
+            std::cerr << "Error: unknown scenario " << scenario << " (see physics_bench --list)" << std::endl;
+            exit_code = 1;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]){
+    Options options;
+    int exit_code = 0;
+    try {
+        if (!parseOptions(argc, argv, options, exit_code))
+            return exit_code;
+    } catch (std::exception&) {
+        std::cerr << "Error: invalid number in the arguments" << std::endl;
+        return 1;
+    }
+
+    std::vector<Run> runs;
+    if (options.engine == bench::Engine::Cpu){
+        for (unsigned int threads : options.threads)
+            runs.push_back(runOnCpu(options, threads));
+    }
+    else{
+#ifdef PHYSICS_GPU
+        bench::HeadlessContext context;
+        std::string error;
+        if (!context.create(error)){
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Renderer: " << context.getRenderer() << std::endl;
+        for (unsigned int i = 0; i < options.runs; i++)
+            runs.push_back(runOnGpu(options, i));
+#else
+        std::cerr << "Error: built without the gpu engines, use --engine cpu" << std::endl;
+        return 1;
+#endif
+    }
+
+    std::cout << options.scenario->name << ", " << options.steps << " steps"
+              << (options.deterministic ? "" : ", not deterministic") << std::endl;
+    bool identical = true;
+    for (size_t i = 1; i < runs.size(); i++)
+        identical = compareRuns(runs[0], runs[i]) && identical;
+
+    if (!options.compare.empty()){
+        Run reference;
+        if (!readHashes(options.compare, reference))
+            return 1;
+        identical = compareRuns(reference, runs[0]) && identical;
+    }
+
+    if (!options.output.empty() && !writeHashes(options.output, runs[0]))
+        return 1;
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#include "headless_context.h"
+
+#include <GL/glew.h>
+
+#ifdef _WIN32
+#include <GLFW/glfw3.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace bench{
+
+    namespace{
+
+        /**
+         * @brief Loads the GL functions of the current context
+         */
+        bool loadFunctions(std::string& error){
+            glewExperimental = GL_TRUE; //Core profile, load every entry point
+            GLenum code = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+            //GLEW built for GLX loads the core functions and then fails looking for a X display
+            if (code == GLEW_ERROR_NO_GLX_DISPLAY)
+                code = GLEW_OK;
+#endif
+            if (code != GLEW_OK){
+                error = "glewInit failed: " + std::string((const char*)glewGetErrorString(code));
+                return false;
+            }
+            return true;
+        }
+
+        std::string getString(GLenum name){
+            const GLubyte* value = glGetString(name);
+            return value ? std::string((const char*)value) : std::string();
+        }
+    }
+
+#ifdef _WIN32
+
+    HeadlessContext::~HeadlessContext(){
+        if (m_context){
+            glfwDestroyWindow(static_cast<GLFWwindow*>(m_context));
+            glfwTerminate();
+        }
+    }
+
+    bool HeadlessContext::create(std::string& error){
+        if (!glfwInit()){
+            error = "glfwInit failed";
+            return false;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(16, 16, "physics_bench", nullptr, nullptr);
+        if (!window){
+            error = "could not create a hidden OpenGL 4.4 window";
+            glfwTerminate();
+            return false;
+        }
+
+        m_context = window;
+        glfwMakeContextCurrent(window);
+        return loadFunctions(error);
+    }
+
+#else
+
+    HeadlessContext::~HeadlessContext(){
+        if (m_display){
+            EGLDisplay display = static_cast<EGLDisplay>(m_display);
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (m_context)
+                eglDestroyContext(display, static_cast<EGLContext>(m_context));
+            eglTerminate(display);
+        }
+    }
+
+    bool HeadlessContext::create(std::string& error){
+        //Surfaceless platform first (no display server at all), then the default display
+        EGLDisplay display = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+#endif
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)){
+            error = "could not initialize an EGL display";
+            return false;
+        }
+        m_display = display;
+
+        if (!eglBindAPI(EGL_OPENGL_API)){
+            error = "EGL does not support desktop OpenGL";
+            return false;
+        }
+
+        //No surface is ever drawn to, so no config is needed (EGL_KHR_no_config_context)
+        const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 4,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        if (context == EGL_NO_CONTEXT){
+            error = "could not create an OpenGL 4.4 core context";
+            return false;
+        }
+        m_context = context;
+
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)){
+            error = "could not make the context current without a surface";
+            return false;
+        }
+        return loadFunctions(error);
+    }
+
+#endif
+
+    std::string HeadlessContext::getRenderer() const{
+        return getString(GL_RENDERER);
+    }
+
+    std::string HeadlessContext::getVersion() const{
+        return getString(GL_VERSION);
+    }
+}
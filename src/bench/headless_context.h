@@ -0,0 +1,56 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#pragma once
+
+#include <string>
+
+namespace bench{
+
+    /**
+     * @brief OpenGL 4.4 core context without a visible window, to run the compute shaders
+     * on machines without a display (CI, servers). Uses a surfaceless EGL display where
+     * available (Mesa, NVIDIA) and a hidden GLFW window on Windows
+     */
+    class HeadlessContext{
+    private:
+        void* m_display = nullptr; /* EGLDisplay */
+        void* m_context = nullptr; /* EGLContext, or the hidden GLFWwindow */
+
+    public:
+        HeadlessContext() = default;
+
+        /**
+         * @brief Destructor, destroys the context
+         */
+        ~HeadlessContext();
+
+        HeadlessContext(const HeadlessContext&) = delete;
+        HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+        /**
+         * @brief Creates the context, makes it current on the calling thread and loads the GL functions
+         * @param error reason of the failure
+         * @return false if no context could be created
+         */
+        bool create(std::string& error);
+
+        /**
+         * @brief Tells whether the context was created
+         */
+        inline bool isValid() const { return m_context != nullptr; }
+
+        /**
+         * @brief Gets the GL_RENDERER string of the context
+         */
+        std::string getRenderer() const;
+
+        /**
+         * @brief Gets the GL_VERSION string of the context
+         */
+        std::string getVersion() const;
+    };
+}
+
+
+#endif // HEADLESS_CONTEXT_H
@@ -0,0 +1,324 @@
+#include "scenarios.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/random.hpp"
+#include "glm/gtx/norm.hpp"
+
+#include "constants.h"
+
+namespace bench{
+
+    namespace{
+
+        /**
+         * @brief Copies a mesh of constants.h and its collision shape into the scene
+         */
+        template<size_t V, size_t I>
+        void setMesh(Scene& scene, const SimpleVertex (&vertices)[V], const unsigned int (&indices)[I]){
+            scene.vertices.assign(std::begin(vertices), std::end(vertices));
+            scene.indices.assign(std::begin(indices), std::end(indices));
+            scene.object_vertices = utils::extractPositions(vertices, V);
+            scene.object_normals = utils::extractNormals(vertices, V);
+            scene.object_edges = utils::extractEdges(vertices, indices, I);
+        }
+
+        /**
+         * @brief Scales a grid so it holds about scale times as many bodies (at least one per axis)
+         */
+        glm::ivec3 scaleGrid(glm::ivec3 grid, float scale){
+            float factor = std::cbrt(scale);
+            return glm::max(glm::ivec3(glm::round(glm::vec3(grid) * factor)), glm::ivec3(1));
+        }
+
+        /**
+         * @brief Places a grid of bodies centered at the origin, same layout as the tests
+         */
+        void addGrid(Scene& scene, glm::ivec3 grid, float spacing){
+            glm::vec3 center_offset = glm::vec3((grid.x - 1) * 0.5f * spacing,
+                                                (grid.y - 1) * 0.5f * spacing,
+                                                -(grid.z - 1) * 0.5f * spacing);
+
+            size_t first = scene.transforms.size();
+            scene.transforms.resize(first + static_cast<size_t>(grid.x) * grid.y * grid.z);
+            for (int x = 0; x < grid.x; x++){
+                for (int y = 0; y < grid.y; y++){
+                    for (int z = 0; z < grid.z; z++){
+                        glm::vec3 position = glm::vec3(x * spacing, y * spacing, -z * spacing) - center_offset;
+                        scene.transforms[first + x * grid.y * grid.z + y * grid.z + z] = glm::translate(glm::mat4(1.0f), position);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Adds a body with a uniform scale
+         */
+        void addBody(Scene& scene, glm::vec3 position, float scale){
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+            scene.transforms.push_back(glm::scale(model, glm::vec3(scale)));
+        }
+
+        /**
+         * @brief Gives every body the properties of a unit cube of mass 1 at rest
+         */
+        void setUnitBodies(Scene& scene){
+            float inertia = (1.0f / 6.0f);
+            glm::mat3 inverseTensor = glm::mat3(1.0f / inertia);
+
+            scene.properties.resize(scene.transforms.size());
+            for (physics::Properties& body : scene.properties){
+                body.velocity = glm::vec3(0.0f);
+                body.acceleration = glm::vec3(0.0f);
+                body.angular_velocity = glm::vec3(0.0f);
+                body.angular_acceleration = glm::vec3(0.0f);
+                body.inverseMass = 1.0f;
+                body.setInverseInertiaTensor(inverseTensor);
+                body.friction = 0.0f;
+            }
+        }
+
+        /**
+         * @brief Makes a body static (infinite mass)
+         */
+        void setStatic(physics::Properties& body){
+            body.velocity = glm::vec3(0.0f);
+            body.angular_velocity = glm::vec3(0.0f);
+            body.inverseMass = 0.0f;
+            body.setInverseInertiaTensor(glm::mat3(0.0f));
+        }
+
+        /**
+         * @brief Makes a body a heavy projectile that does not rotate on impact
+         */
+        void setProjectile(physics::Properties& body, glm::vec3 velocity){
+            body.velocity = velocity;
+            body.inverseMass = 1.0f / 1000.0f;
+            body.setInverseInertiaTensor(glm::mat3(0.0f));
+        }
+
+        //TestRender: large dodecahedron grid with a projectile and a static body at the end
+        void buildRender(Scene& scene, float scale, unsigned int seed){
+            setMesh(scene, CONSTANTS::DODECAHEDRON_MESH_SIMPLE_VERTICES, CONSTANTS::DODECAHEDRON_MESH_INDICES);
+            addGrid(scene, scaleGrid(glm::ivec3(100, 200, 200), scale), 4.0f);
+            setUnitBodies(scene);
+
+            std::srand(seed);
+            for (physics::Properties& body : scene.properties)
+                body.angular_velocity = glm::linearRand(glm::vec3(-0.2f), glm::vec3(0.2f));
+
+            size_t n = scene.properties.size();
+            if (n >= 2){
+                setProjectile(scene.properties[n - 2], glm::vec3(5.0f, 0.0f, 0.0f));
+                scene.properties[n - 2].angular_velocity = glm::vec3(0.0f, 0.3f, 0.0f);
+                setStatic(scene.properties[n - 1]);
+            }
+            scene.gravity = glm::vec3(0.0f, -0.1f, 0.0f);
+        }
+
+        //TestFreeCollisions: dodecahedra drifting slowly, no gravity
+        void buildFreeCollisions(Scene& scene, float scale, unsigned int seed){
+            setMesh(scene, CONSTANTS::DODECAHEDRON_MESH_SIMPLE_VERTICES, CONSTANTS::DODECAHEDRON_MESH_INDICES);
+            addGrid(scene, scaleGrid(glm::ivec3(40, 40, 40), scale), 5.0f);
+            setUnitBodies(scene);
+
+            std::srand(seed);
+            for (physics::Properties& body : scene.properties){
+                body.velocity = glm::linearRand(glm::vec3(-0.05f), glm::vec3(0.05f));
+                body.angular_velocity = glm::linearRand(glm::vec3(-0.1f), glm::vec3(0.1f));
+            }
+        }
+
+        //TestComputeShader: column of slowly spinning cubes falling on a static floor
+        void buildComputeShader(Scene& scene, float scale, unsigned int seed){
+            setMesh(scene, CONSTANTS::CUBE_MESH_SIMPLE_VERTICES, CONSTANTS::CUBE_MESH_INDICES);
+            addGrid(scene, scaleGrid(glm::ivec3(10, 40, 10), scale), 2.0f);
+            addBody(scene, glm::vec3(0.0f, -75.0f, 0.0f), 50.0f);
+            setUnitBodies(scene);
+
+            std::srand(seed);
+            for (physics::Properties& body : scene.properties)
+                body.angular_velocity = glm::linearRand(glm::vec3(-0.2f), glm::vec3(0.2f));
+
+            setStatic(scene.properties.back());
+            scene.gravity = glm::vec3(0.0f, -0.1f, 0.0f);
+        }
+
+        //TestRotation: spinning icosahedra above a static floor, no gravity
+        void buildRotation(Scene& scene, float scale, unsigned int seed){
+            setMesh(scene, CONSTANTS::ICOSAHEDRON_MESH_SIMPLE_VERTICES, CONSTANTS::ICOSAHEDRON_MESH_INDICES);
+            addGrid(scene, scaleGrid(glm::ivec3(10, 10, 10), scale), 2.0f);
+            addBody(scene, glm::vec3(0.0f, -70.0f, 0.0f), 50.0f);
+            setUnitBodies(scene);
+
+            std::srand(seed);
+            for (physics::Properties& body : scene.properties)
+                body.angular_velocity = glm::linearRand(glm::vec3(-0.2f), glm::vec3(0.2f));
+
+            setStatic(scene.properties.back());
+        }
+
+        //TestComplex: packed tower of cubes hit by a projectile, standing on a static floor
+        void buildComplex(Scene& scene, float scale, unsigned int seed){
+            setMesh(scene, CONSTANTS::CUBE_MESH_SIMPLE_VERTICES, CONSTANTS::CUBE_MESH_INDICES);
+            addGrid(scene, scaleGrid(glm::ivec3(5, 30, 5), scale), 1.0f);
+            addBody(scene, glm::vec3(-60.0f, 0.0f, 0.0f), 5.0f);
+            addBody(scene, glm::vec3(0.0f, -40.0f, 0.0f), 50.0f);
+            setUnitBodies(scene);
+
+            std::srand(seed);
+            size_t n = scene.properties.size();
+            setProjectile(scene.properties[n - 2], glm::vec3(5.0f, 0.0f, 0.0f));
+            scene.properties[n - 2].angular_velocity = glm::linearRand(glm::vec3(-0.3f), glm::vec3(0.3f));
+            setStatic(scene.properties[n - 1]);
+            scene.gravity = glm::vec3(0.0f, -0.1f, 0.0f);
+        }
+
+        //TestComplex2: two blobs of octahedra flying into each other
+        void buildComplex2(Scene& scene, float scale, unsigned int seed){
+            setMesh(scene, CONSTANTS::OCTAHEDRON_MESH_SIMPLE_VERTICES, CONSTANTS::OCTAHEDRON_MESH_INDICES);
+
+            int count = std::max(2, static_cast<int>(std::round(1000 * scale)));
+            int half = count / 2;
+            float blob_radius = 50.0f * std::cbrt(scale); //Same density at every scale
+            float min_spacing = 2.5f;
+            glm::vec3 left_center = glm::vec3(-60.0f, 0.0f, 0.0f) * std::max(1.0f, std::cbrt(scale));
+            glm::vec3 right_center = -left_center;
+            float approach_speed = 10.0f;
+
+            std::mt19937 gen(seed);
+            std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+            auto randomInSphere = [&](float radius){
+                glm::vec3 p;
+                do {
+                    p = glm::vec3(dist(gen), dist(gen), dist(gen));
+                } while (glm::length2(p) > 1.0f);
+                return p * radius;
+            };
+
+            //Rejection sampling with a minimum distance between centers, like the test
+            auto scatter = [&](glm::vec3 center, int bodies){
+                std::vector<glm::vec3> placed;
+                placed.reserve(bodies);
+                for (int i = 0; i < bodies; i++){
+                    glm::vec3 candidate;
+                    do {
+                        candidate = center + randomInSphere(blob_radius);
+                    } while (std::any_of(placed.begin(), placed.end(), [&](const glm::vec3& other){
+                        return glm::distance2(candidate, other) < min_spacing * min_spacing;
+                    }));
+                    placed.push_back(candidate);
+                    addBody(scene, candidate, 1.0f);
+                }
+            };
+            scatter(left_center, half);
+            scatter(right_center, count - half);
+            setUnitBodies(scene);
+
+            std::srand(seed);
+            glm::vec3 direction = glm::normalize(right_center - left_center);
+            for (int i = 0; i < count; i++){
+                scene.properties[i].angular_velocity = glm::linearRand(glm::vec3(-0.2f), glm::vec3(0.2f));
+                scene.properties[i].velocity = (i < half ? direction : -direction) * approach_speed;
+            }
+            scene.gravity = glm::vec3(0.0f, -0.1f, 0.0f);
+        }
+
+        //TestComplex3: touching cube grid hit by a projectile, no gravity
+        void buildComplex3(Scene& scene, float scale, unsigned int seed){
+            setMesh(scene, CONSTANTS::CUBE_MESH_SIMPLE_VERTICES, CONSTANTS::CUBE_MESH_INDICES);
+            addGrid(scene, scaleGrid(glm::ivec3(10, 10, 10), scale), 1.0f);
+            addBody(scene, glm::vec3(-20.0f, 0.0f, 0.0f), 5.0f);
+            setUnitBodies(scene);
+
+            std::srand(seed);
+            for (physics::Properties& body : scene.properties)
+                body.angular_velocity = glm::linearRand(glm::vec3(-0.2f), glm::vec3(0.2f));
+
+            setProjectile(scene.properties.back(), glm::vec3(5.0f, 0.0f, 0.0f));
+        }
+
+        //TestCpuSimulator: grid of slowly spinning cubes falling on a static floor
+        void buildCpuSimulator(Scene& scene, float scale, unsigned int seed){
+            setMesh(scene, CONSTANTS::CUBE_MESH_SIMPLE_VERTICES, CONSTANTS::CUBE_MESH_INDICES);
+            glm::ivec3 grid = scaleGrid(glm::ivec3(10, 10, 10), scale);
+            float spacing = 1.5f;
+            addGrid(scene, grid, spacing);
+            addBody(scene, glm::vec3(0.0f, -(grid.y * spacing * 0.5f) - 25.5f, 0.0f), 50.0f);
+            setUnitBodies(scene);
+
+            std::srand(seed);
+            for (physics::Properties& body : scene.properties)
+                body.angular_velocity = glm::linearRand(glm::vec3(-0.2f), glm::vec3(0.2f));
+
+            setStatic(scene.properties.back());
+            scene.gravity = glm::vec3(0.0f, -1.0f, 0.0f);
+        }
+    }
+
+    const std::vector<Scenario>& getScenarios(){
+        static const std::vector<Scenario> scenarios = {
+            { "render",          "TestRender grid (100x200x200 dodecahedra)",          Engine::Gpu,       &buildRender },
+            { "free_collisions", "TestFreeCollisions grid (40x40x40 dodecahedra)",     Engine::Collision, &buildFreeCollisions },
+            { "compute_shader",  "TestComputeShader grid (10x40x10 cubes) and floor",  Engine::Gpu,       &buildComputeShader },
+            { "rotation",        "TestRotation grid (10x10x10 icosahedra) and floor",  Engine::Gpu,       &buildRotation },
+            { "complex",         "TestComplex tower (5x30x5 cubes), projectile, floor", Engine::Gpu,      &buildComplex },
+            { "complex_2",       "TestComplex2 colliding blobs (1000 octahedra)",       Engine::Gpu,       &buildComplex2 },
+            { "complex_3",       "TestComplex3 grid (10x10x10 cubes) and projectile",   Engine::Gpu,       &buildComplex3 },
+            { "cpu_simulator",   "TestCpuSimulator grid (10x10x10 cubes) and floor",    Engine::Cpu,       &buildCpuSimulator },
+        };
+        return scenarios;
+    }
+
+    const Scenario* findScenario(const std::string& name){
+        for (const Scenario& scenario : getScenarios()){
+            if (name == scenario.name)
+                return &scenario;
+        }
+        return nullptr;
+    }
+
+    recording::TrajectoryDesc describeTrajectory(const Scene& scene, float delta_time, float duration){
+        recording::TrajectoryDesc desc;
+        recording::Shape shape;
+        for (const SimpleVertex& vertex : scene.vertices)
+            shape.vertices.push_back(glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]));
+        shape.indices.assign(scene.indices.begin(), scene.indices.end());
+        desc.shapes.push_back(std::move(shape));
+        desc.body_shapes.assign(scene.transforms.size(), 0);
+        desc.body_scales = recording::extractScales(scene.transforms);
+        desc.delta_time = delta_time;
+
+        glm::vec3 bound_min, bound_max;
+        recording::computeBounds(scene.transforms, 0.0f, bound_min, bound_max);
+        float fall = 0.5f * glm::length(scene.gravity) * duration * duration;
+        float margin = 10.0f + 0.5f * glm::max(bound_max.x - bound_min.x, glm::max(bound_max.y - bound_min.y, bound_max.z - bound_min.z));
+        desc.bound_min = bound_min - glm::vec3(margin + fall);
+        desc.bound_max = bound_max + glm::vec3(margin + fall);
+        return desc;
+    }
+
+    const char* getEngineName(Engine engine){
+        switch (engine){
+            case Engine::Gpu: return "gpu";
+            case Engine::Collision: return "collision";
+            case Engine::Cpu: return "cpu";
+        }
+        return "?";
+    }
+
+    bool parseEngine(const std::string& name, Engine& engine){
+        for (Engine candidate : { Engine::Gpu, Engine::Collision, Engine::Cpu }){
+            if (name == getEngineName(candidate)){
+                engine = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+}
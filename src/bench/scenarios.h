@@ -0,0 +1,85 @@
+#ifndef SCENARIOS_H
+#define SCENARIOS_H
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "../vertex.h"
+
+#include "utils.h"
+#include "../recording/trajectory.h"
+
+namespace bench{
+
+    /**
+     * @brief Simulator that steps a scenario
+     */
+    enum class Engine{
+        Gpu,       /* GpuSimulator */
+        Collision, /* CollisionDetector (detection only, no response) */
+        Cpu        /* Simulator on the job system */
+    };
+
+    /**
+     * @brief Bodies and parameters of a scenario, everything the simulators need
+     */
+    struct Scene{
+        std::vector<SimpleVertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<glm::vec4> object_vertices;
+        std::vector<glm::vec4> object_normals;
+        std::vector<glm::vec4> object_edges;
+        std::vector<glm::mat4> transforms;
+        std::vector<physics::Properties> properties;
+        glm::vec3 gravity = glm::vec3(0.0f);
+    };
+
+    constexpr unsigned int C_DEFAULT_SEED = 42; /* Seed of the interactive tests */
+
+    /**
+     * @brief Canonical scenario, a copy of the setup of one of the interactive tests
+     * @note build seeds std::rand, so scenes cannot be built on several threads at once
+     */
+    struct Scenario{
+        const char* name;
+        const char* description;
+        Engine engine; /* Engine the test uses */
+        void (*build)(Scene& scene, float scale, unsigned int seed); /* Fills the scene, scale multiplies the number of bodies and seed picks the random velocities and placements */
+    };
+
+    /**
+     * @brief Gets every scenario of the suite
+     */
+    const std::vector<Scenario>& getScenarios();
+
+    /**
+     * @brief Finds a scenario by name
+     * @return null if there is no scenario with that name
+     */
+    const Scenario* findScenario(const std::string& name);
+
+    /**
+     * @brief Gets the name of an engine as used in the command line and the reports
+     */
+    const char* getEngineName(Engine engine);
+
+    /**
+     * @brief Describes the trajectory of a scene: its mesh for every body, their scales and
+     * bounds with room for the bodies to fall for the whole run
+     * @param delta_time time between the recorded frames
+     * @param duration simulated seconds of the run
+     */
+    recording::TrajectoryDesc describeTrajectory(const Scene& scene, float delta_time, float duration);
+
+    /**
+     * @brief Parses the name of an engine
+     * @return false if the name is not gpu, collision or cpu
+     */
+    bool parseEngine(const std::string& name, Engine& engine);
+}
+
+
+#endif // SCENARIOS_H
@@ -0,0 +1,161 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "../recording/state_reader.h"
+
+/**
+ * Example consumer of the state a simulator publishes in shared memory (physics_bench --publish
+ * or the cpu test with "Publish state"). Runs as a separate process, maps the block read only and
+ * polls it without locks, printing once per second what it received:
+ *
+ *  physics_state_reader [--name name] [--body i] [--seconds s] [--poll-us us]
+ *
+ * It waits for the block to exist, so it can be started before the publisher, and exits once the
+ * publisher closes the block or after --seconds.
+ */
+
+namespace{
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Command line options
+     */
+    struct Options{
+        std::string name = "physics_state";
+        unsigned int body = 0; /* Body whose position and orientation are printed */
+        double seconds = 0.0; /* Time to follow the publisher, 0 until it closes */
+        unsigned int poll_us = 200; /* Sleep between polls without a new state */
+    };
+
+    void printUsage(){
+        std::cout << "Usage: physics_state_reader [options]\n"
+                  << "  --name name        shared memory block to follow (default physics_state)\n"
+                  << "  --body i           body printed every second (default 0)\n"
+                  << "  --seconds s        stop after s seconds (default 0: until the publisher closes)\n"
+                  << "  --poll-us us       sleep between polls without a new state (default 200)\n";
+    }
+
+    /**
+     * @brief Parses the command line
+     * @return false if the program should exit (bad arguments or --help)
+     */
+    bool parseOptions(int argc, char* argv[], Options& options, int& exit_code){
+        exit_code = 0;
+        for (int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h"){
+                printUsage();
+                return false;
+            }
+            if (i + 1 >= argc){
+                std::cerr << "Error: unknown option or missing value: " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+
+            std::string value = argv[++i];
+            if (arg == "--name")
+                options.name = value;
+            else if (arg == "--body")
+                options.body = static_cast<unsigned int>(std::stoul(value));
+            else if (arg == "--seconds")
+                options.seconds = std::stod(value);
+            else if (arg == "--poll-us")
+                options.poll_us = static_cast<unsigned int>(std::stoul(value));
+            else{
+                std::cerr << "Error: unknown option: " << arg << std::endl;
+                exit_code = 1;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Prints what was received since the last report
+     */
+    void printReport(const recording::StateSnapshot& state, const Options& options, uint64_t received, uint64_t skipped,
+                     uint64_t torn, double seconds){
+        std::cout << std::fixed << std::setprecision(3) << "step " << state.step << " t=" << state.time << "s bodies "
+                  << state.body_count << " | " << std::setprecision(1) << received / seconds << " states/s, " << skipped
+                  << " skipped, " << torn << " torn";
+        if (options.body < state.body_count){
+            using recording::StateArray;
+            unsigned int b = options.body;
+            std::cout << std::setprecision(3) << " | body " << b << " p=(" << state.get(StateArray::PositionX)[b] << ", "
+                      << state.get(StateArray::PositionY)[b] << ", " << state.get(StateArray::PositionZ)[b] << ") q=("
+                      << state.get(StateArray::OrientationX)[b] << ", " << state.get(StateArray::OrientationY)[b] << ", "
+                      << state.get(StateArray::OrientationZ)[b] << ", " << state.get(StateArray::OrientationW)[b] << ")";
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]){
+    Options options;
+    int exit_code = 0;
+    try {
+        if (!parseOptions(argc, argv, options, exit_code))
+            return exit_code;
+    } catch (std::exception&) {
+        std::cerr << "Error: invalid number in the arguments" << std::endl;
+        return 1;
+    }
+
+    Clock::time_point start = Clock::now();
+    auto expired = [&](){
+        return options.seconds > 0.0 && std::chrono::duration<double>(Clock::now() - start).count() >= options.seconds;
+    };
+
+    //The publisher may not have started yet
+    recording::StateReader reader;
+    std::cerr << "Waiting for " << options.name << "..." << std::endl;
+    while (!reader.open(options.name)){
+        if (expired())
+            return 1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    std::cerr << "Following " << options.name << " (" << reader.getMaxBodies() << " bodies per state)" << std::endl;
+
+    recording::StateSnapshot state;
+    uint64_t last_published = reader.getPublishedCount();
+    uint64_t received = 0, skipped = 0, total = 0, total_skipped = 0;
+    uint64_t reported_torn = 0;
+    Clock::time_point last_report = Clock::now();
+
+    while (!expired()){
+        uint64_t published = reader.getPublishedCount();
+        if (published != last_published){
+            if (reader.copyLatest(state)){
+                //Publications between two polls are never seen, the reader only wants the newest
+                skipped += published - last_published - 1;
+                total_skipped += published - last_published - 1;
+                received++;
+                total++;
+            }
+            last_published = published;
+        }
+        else if (reader.isPublisherClosed())
+            break;
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(options.poll_us));
+
+        Clock::time_point now = Clock::now();
+        double seconds = std::chrono::duration<double>(now - last_report).count();
+        if (seconds >= 1.0 && received > 0){
+            printReport(state, options, received, skipped, reader.getTornReads() - reported_torn, seconds);
+            reported_torn = reader.getTornReads();
+            received = skipped = 0;
+            last_report = now;
+        }
+    }
+
+    std::cerr << total << " states read, " << total_skipped << " skipped, " << reader.getTornReads() << " torn reads" << std::endl;
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "shader_storage_buffer.h"
-#include "../renderer.h"
+#include "../gl_check.h"
 
+#include <algorithm>
 #include <iostream>
 
 std:: unordered_set<unsigned int> ShaderStorageBuffer::taken_binding_points;
@@ -10,6 +11,10 @@ ShaderStorageBuffer::ShaderStorageBuffer(const void *data, unsigned int size, co
 }
 
 ShaderStorageBuffer::~ShaderStorageBuffer(){
+    //Free the binding point so the next test can take it
+    if (m_binding_point != 0)
+        ShaderStorageBuffer::taken_binding_points.erase(m_binding_point);
+
     GLCall(glDeleteBuffers(1, &m_renderer_id)); //Delete buffer
 }
 
@@ -34,9 +39,61 @@ void ShaderStorageBuffer::setBuffer(const void* data, unsigned int size, const u
     }
 
     m_usage = usage;
+    m_size = size;
     GLCall(glGenBuffers(1, &m_renderer_id)); //Generate buffer
     GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_renderer_id)); //Bind (select) buffer
     GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, m_usage)); //Fill buffer with data
+
+    //A new buffer replaces the old one on its binding point
+    if (m_binding_point != 0){
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_binding_point, m_renderer_id));
+    }
+}
+
+void ShaderStorageBuffer::clearData(){
+    GLCall(glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr)); //A null value clears to zero
+}
+
+void ShaderStorageBuffer::clearData(unsigned int offset, unsigned int size){
+    GLCall(glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, offset, size, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+}
+
+void ShaderStorageBuffer::resize(unsigned int size){
+    unsigned int old_id = m_renderer_id;
+    unsigned int old_size = m_size;
+
+    m_size = size;
+    GLCall(glGenBuffers(1, &m_renderer_id)); //Generate the new buffer
+    GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_renderer_id));
+    GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, m_usage));
+
+    if (old_id != 0){
+        //Copy the old contents on the gpu
+        GLCall(glBindBuffer(GL_COPY_READ_BUFFER, old_id));
+        GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_SHADER_STORAGE_BUFFER, 0, 0, std::min(old_size, size)));
+        GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+        GLCall(glDeleteBuffers(1, &old_id));
+    }
+
+    if (m_binding_point != 0){
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_binding_point, m_renderer_id));
+    }
+}
+
+void ShaderStorageBuffer::copyData(unsigned int read_offset, unsigned int write_offset, unsigned int size){
+    GLCall(glBindBuffer(GL_COPY_READ_BUFFER, m_renderer_id));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_renderer_id));
+    GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, read_offset, write_offset, size));
+    GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void ShaderStorageBuffer::copyFrom(const ShaderStorageBuffer& source, unsigned int size){
+    GLCall(glBindBuffer(GL_COPY_READ_BUFFER, source.m_renderer_id));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_renderer_id));
+    GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size));
+    GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
 }
 
 bool ShaderStorageBuffer::bindToBindingPoint(unsigned int binding_point){
@@ -53,6 +110,10 @@ bool ShaderStorageBuffer::bindToBindingPoint(unsigned int binding_point){
     return result.second;
 }
 
+void ShaderStorageBuffer::attachToBindingPoint(unsigned int binding_point) const{
+    GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding_point, m_renderer_id));
+}
+
 void ShaderStorageBuffer::unbindFromBindingPoint(){
     ShaderStorageBuffer::taken_binding_points.erase(m_binding_point);
 
@@ -15,9 +15,10 @@ private:
     unsigned int m_renderer_id; //ID of the buffer
     unsigned int m_usage; //Usage of the buffer
     unsigned int m_binding_point;
+    unsigned int m_size; //Size of the buffer in bytes
 
 public:
-    ShaderStorageBuffer() : m_renderer_id(0), m_binding_point(0) {};
+    ShaderStorageBuffer() : m_renderer_id(0), m_binding_point(0), m_size(0) {};
 
     /**
      * @brief Creates a vertex buffer
@@ -51,13 +52,54 @@ public:
     void updateData(const void* data, unsigned int size, unsigned int offset = 0);
 
     /**
-     * @brief Sets the buffer data
+     * @brief Sets the buffer data. The buffer is recreated, so it is binded again to its binding point
      * @param data the data to be stored in the buffer
      * @param size the size of the data
      * @param usage the usage of the buffer
      */
     void setBuffer(const void* data, unsigned int size, const unsigned int usage = GL_STATIC_DRAW);
 
+    /**
+     * @brief Fills the whole buffer with zeros on the gpu (no host copy needed)
+     * @note The buffer must be binded before clearing it (buffer.bind())
+     */
+    void clearData();
+
+    /**
+     * @brief Fills a range of the buffer with zeros on the gpu
+     * @param offset start of the range (multiple of 4)
+     * @param size the size of the range (multiple of 4)
+     * @note The buffer must be binded before clearing it (buffer.bind())
+     */
+    void clearData(unsigned int offset, unsigned int size);
+
+    /**
+     * @brief Changes the size of the buffer keeping its contents (up to the smaller size).
+     * The buffer is recreated, so it is binded again to its binding point
+     * @param size the new size of the buffer
+     */
+    void resize(unsigned int size);
+
+    /**
+     * @brief Copies a range of the buffer to another position of the same buffer (on the gpu)
+     * @param read_offset start of the source range
+     * @param write_offset start of the destination range (must not overlap the source)
+     * @param size the size of the range
+     */
+    void copyData(unsigned int read_offset, unsigned int write_offset, unsigned int size);
+
+    /**
+     * @brief Copies the start of another buffer into the start of this one (on the gpu)
+     * @param source the buffer to copy from
+     * @param size the number of bytes to copy
+     */
+    void copyFrom(const ShaderStorageBuffer& source, unsigned int size);
+
+    /**
+     * @brief Gets the size of the buffer in bytes
+     */
+    inline unsigned int getSize() const { return m_size; }
+
     /**
      * @brief Binds the SSBO to a binding point
      * @param binding_point The point to which the SSBO will bet binded
@@ -65,6 +107,13 @@ public:
      */
     bool bindToBindingPoint(unsigned int binding_point);
 
+    /**
+     * @brief Binds the SSBO to a binding point for the next draws and dispatches without taking it,
+     * so several buffers can take turns on a point owned by another SSBO
+     * @param binding_point The point to which the SSBO will be binded
+     */
+    void attachToBindingPoint(unsigned int binding_point) const;
+
     /**
      * @brief Unbinds the SSBO from its binding point
      */
@@ -6,21 +6,7 @@
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 
-struct Vertex{
-public:
-    // glm::vec3 position;
-    // glm::vec4 color;
-    // glm::vec3 normal;
-    float position[3];
-    float color[4];
-    float normal[3];
-};
-
-struct SimpleVertex{
-public:
-    float position[3];
-    float normal[3];
-};
+#include "../vertex.h"
        
     
 
@@ -50,37 +50,7 @@ public:
      */
     template<typename T>
     void push(unsigned int count){
-        static_assert(false);
-    }
-
-    /**
-     * @brief Pushes a float into the buffer
-     * @param count the number of floats
-     */
-    template<>
-    void push<float>(unsigned int count){
-        m_elements.push_back({GL_FLOAT, count, GL_FALSE});
-        m_stride += VertexBufferElement::getSizeOfType(GL_FLOAT) * count;
-    }
-
-    /**
-     * @brief Pushes an unsigned int into the buffer
-     * @param count the number of unsigned ints
-     */
-    template<>
-    void push<unsigned int>(unsigned int count){
-        m_elements.push_back({GL_UNSIGNED_INT, count, GL_FALSE});
-        m_stride += VertexBufferElement::getSizeOfType(GL_UNSIGNED_INT) * count;
-    }
-
-    /**
-     * @brief Pushes an unsigned char into the buffer
-     * @param count the number of unsigned chars
-     */
-    template<>
-    void push<unsigned char>(unsigned int count){
-        m_elements.push_back({GL_UNSIGNED_BYTE, count, GL_TRUE});
-        m_stride += VertexBufferElement::getSizeOfType(GL_UNSIGNED_BYTE) * count;
+        static_assert(sizeof(T) == 0, "Unsupported vertex attribute type"); //Only the specializations below exist
     }
 
     /**
@@ -100,5 +70,37 @@ public:
     inline bool isInstanced() const { return m_is_instanced; }
 };
 
+//Explicit specializations must live at namespace scope (MSVC also accepts them inside the class, GCC and Clang do not)
+
+/**
+ * @brief Pushes a float into the buffer
+ * @param count the number of floats
+ */
+template<>
+inline void VertexBufferLayout::push<float>(unsigned int count){
+    m_elements.push_back({GL_FLOAT, count, GL_FALSE});
+    m_stride += VertexBufferElement::getSizeOfType(GL_FLOAT) * count;
+}
+
+/**
+ * @brief Pushes an unsigned int into the buffer
+ * @param count the number of unsigned ints
+ */
+template<>
+inline void VertexBufferLayout::push<unsigned int>(unsigned int count){
+    m_elements.push_back({GL_UNSIGNED_INT, count, GL_FALSE});
+    m_stride += VertexBufferElement::getSizeOfType(GL_UNSIGNED_INT) * count;
+}
+
+/**
+ * @brief Pushes an unsigned char into the buffer
+ * @param count the number of unsigned chars
+ */
+template<>
+inline void VertexBufferLayout::push<unsigned char>(unsigned int count){
+    m_elements.push_back({GL_UNSIGNED_BYTE, count, GL_TRUE});
+    m_stride += VertexBufferElement::getSizeOfType(GL_UNSIGNED_BYTE) * count;
+}
+
 
 #endif //VERTEX_BUFFER_LAYOUT_H
\ No newline at end of file
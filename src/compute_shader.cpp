@@ -5,15 +5,17 @@
 #include <string>
 #include <sstream>
 #include <filesystem>
+#include <vector>
 
-#include "renderer.h" // Assuming this includes your OpenGL calls and GLCall macro
+#include "gl_check.h"
+#include "profiling/cpu_profiler.h"
 
 ComputeShader::ComputeShader()
-    : m_renderer_id(0), m_file_path(""), m_timer(false) {
+    : m_renderer_id(0), m_file_path("") {
 }
 
 ComputeShader::ComputeShader(const std::string& filename)
-    : m_renderer_id(0), m_timer(false) {
+    : m_renderer_id(0) {
     // Get the path of the file
     m_file_path = __FILE__;
     m_file_path = m_file_path.substr(0, m_file_path.find_last_of("\\/"));
@@ -22,15 +24,15 @@ ComputeShader::ComputeShader(const std::string& filename)
     // Read the shader file and create the shader
     std::string source = this->readComputeShader(m_file_path);
     m_renderer_id = this->createComputeShader(source);
-
-    this->m_timer = time;
 }
 
 ComputeShader::~ComputeShader() {
-    if(m_timer)
-        GLCall(glDeleteQueries(2, m_timer_queries))
-    
-    GLCall(glDeleteProgram(m_renderer_id));
+    if (m_programs.empty()) {
+        GLCall(glDeleteProgram(m_renderer_id));
+    }
+    for (const auto& program : m_programs) {
+        GLCall(glDeleteProgram(program.second));
+    }
 }
 
 void ComputeShader::bind() const {
@@ -43,9 +45,6 @@ void ComputeShader::unbind() const {
 }
 
 void ComputeShader::dispatch(unsigned int num_groups_x, unsigned int num_groups_y, unsigned int num_groups_z) const {
-    if (m_timer){
-        GLCall(glBeginQuery(GL_TIME_ELAPSED, m_timer_queries[0]));
-    }
     GLCall(glDispatchCompute(num_groups_x, num_groups_y, num_groups_z));
 }
 
@@ -53,34 +52,18 @@ void ComputeShader::use() const {
     GLCall(glUseProgram(m_renderer_id));
 }
 
-void ComputeShader::useTimer(bool time){
-    if(!time && m_timer){
-        GLCall(glDeleteQueries(2, m_timer_queries));
-    }
-    else if (time){
-        m_timer = time;
-        GLCall(glGenQueries(2, m_timer_queries));
-    } 
-}
-
-unsigned int ComputeShader::waitForCompletion(unsigned int barrier) const {
+void ComputeShader::waitForCompletion(unsigned int barrier) const {
     GLCall(glMemoryBarrier(barrier));
-
-    unsigned long long time_elapsed = 0;
-
-    if(m_timer){
-        GLCall(glEndQuery(GL_TIME_ELAPSED));
-        GLCall(glGetQueryObjectui64v(m_timer_queries[0], GL_QUERY_RESULT, &time_elapsed));
-        return static_cast<unsigned int>(time_elapsed);
-    }
-
-    return 0;
 }
 
 void ComputeShader::setUniform1i(const std::string& name, int v0) {
     GLCall(glUniform1i(getUniformLocation(name), v0));
 }
 
+void ComputeShader::setUniform1ui(const std::string& name, unsigned int v0) {
+    GLCall(glUniform1ui(getUniformLocation(name), v0));
+}
+
 void ComputeShader::setUniform1f(const std::string& name, float v0) {
     GLCall(glUniform1f(getUniformLocation(name), v0));
 }
@@ -113,10 +96,32 @@ void ComputeShader::bindSSBO(unsigned int ssbo, unsigned int binding) const {
     GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, ssbo));
 }
 
-void ComputeShader::setShader(const std::string& filename) {
-    // Delete the current shader if it exists
-    if (m_renderer_id != 0)
-        GLCall(glDeleteProgram(m_renderer_id));
+void ComputeShader::setShader(const std::string& filename, const Defines& defines) {
+    std::string key;
+    for (const auto& define : defines)
+        key += define.first + "=" + define.second + "\n";
+
+    // Another file drops the programs of the current one
+    if (filename != m_filename) {
+        if (m_programs.empty() && m_renderer_id != 0) {
+            GLCall(glDeleteProgram(m_renderer_id));
+        }
+        for (const auto& program : m_programs) {
+            GLCall(glDeleteProgram(program.second));
+        }
+        m_programs.clear();
+        m_filename = filename;
+    }
+
+    // The uniform locations belong to the program
+    auto cached = m_programs.find(key);
+    if (cached != m_programs.end()) {
+        if (cached->second != m_renderer_id)
+            m_uniform_location_cache.clear();
+        m_renderer_id = cached->second;
+        return;
+    }
+    m_uniform_location_cache.clear();
 
     // Get the path of the file
     m_file_path = __FILE__;
@@ -124,8 +129,9 @@ void ComputeShader::setShader(const std::string& filename) {
     m_file_path += "/../res/shaders/compute/" + filename;
 
     // Read the shader file and create the shader
-    std::string source = this->readComputeShader(m_file_path);
+    std::string source = this->readComputeShader(m_file_path, defines);
     m_renderer_id = this->createComputeShader(source);
+    m_programs[key] = m_renderer_id;
 
     GLint status;
     GLCall(glGetProgramiv(m_renderer_id, GL_LINK_STATUS, &status));
@@ -158,12 +164,12 @@ void ComputeShader::setShader(const std::string& filename) {
 
 //     return ss.str();
 // }
-std::string ComputeShader::readComputeShader(const std::string& file) {
+std::string ComputeShader::readComputeShader(const std::string& file, const Defines& defines) {
     std::unordered_set<std::string> includedFiles;
-    return this->processShaderIncludes(file, includedFiles);
+    return this->processShaderIncludes(file, includedFiles, &defines);
 }
 
-std::string ComputeShader::processShaderIncludes(const std::string& file, std::unordered_set<std::string>& includedFiles) {
+std::string ComputeShader::processShaderIncludes(const std::string& file, std::unordered_set<std::string>& includedFiles, const Defines* defines) {
     if (includedFiles.find(file) != includedFiles.end()) {
         return "";
     }
@@ -192,6 +198,11 @@ std::string ComputeShader::processShaderIncludes(const std::string& file, std::u
             } else {
                 std::cerr << "Error: Malformed #include directive in " << file << ": " << line << std::endl;
             }
+        } else if (defines && line.rfind("#version", 0) == 0) {
+            // The defines go right after #version, the only line that has to come before them
+            shaderCode << line << "\n";
+            for (const auto& define : *defines)
+                shaderCode << "#define " << define.first << " " << define.second << "\n";
         } else {
             shaderCode << line << "\n";
         }
@@ -215,6 +226,8 @@ unsigned int ComputeShader::compileComputeShader(const std::string& source) {
 }
 
 unsigned int ComputeShader::createComputeShader(const std::string& compute_shader) {
+    PROFILE_ZONE("compile compute shader");
+
     // Create a program
     unsigned int program = glCreateProgram();
     
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -14,14 +15,20 @@
  * @brief A class to handle compute shaders
  */
 class ComputeShader {
+public:
+    /**
+     * @brief Macros defined at the top of a shader (name, value), ordered so the same set always
+     * gives the same program
+     */
+    using Defines = std::map<std::string, std::string>;
+
 private:
     unsigned int m_renderer_id; // Shader program id
     std::string m_file_path; // File path of the shader
+    std::string m_filename; // File given to setShader, the cached programs are built from it
+    std::unordered_map<std::string, unsigned int> m_programs; // Program of each define set of m_filename
     std::unordered_map<std::string, int> m_uniform_location_cache; // Cache for uniform locations
 
-    bool m_timer;
-    GLuint m_timer_queries[2]; // Correct type for timer queries
-
 public:
     /**
      * @brief Default constructor
@@ -63,16 +70,11 @@ public:
     void use() const;
 
     /**
-     * @brief Sets the timing of the shader operation
-     * @param time if true, the shader will time each execution
-     */
-    void useTimer(bool time);
-
-    /**
-     * @brief Waits for compute shader to finish
+     * @brief Makes the writes of the dispatch visible to the next commands (does not block the cpu,
+     * use a profiling::GpuProfiler to time the dispatches)
      * @param barrier barrier to wait for
      */
-    unsigned int waitForCompletion(unsigned int barrier) const;
+    void waitForCompletion(unsigned int barrier) const;
 
     /**
      * @brief Sets a uniform of type int
@@ -81,6 +83,13 @@ public:
      */
     void setUniform1i(const std::string& name, int v0);
 
+    /**
+     * @brief Sets a uniform of type unsigned int
+     * @param name the name of the uniform
+     * @param v0 the value of the uniform
+     */
+    void setUniform1ui(const std::string& name, unsigned int v0);
+
     /**
      * @brief Sets a uniform of type float
      * @param name the name of the uniform
@@ -141,10 +150,12 @@ public:
     void bindSSBO(unsigned int ssbo, unsigned int binding) const;
 
     /**
-     * @brief Sets a compute shader
+     * @brief Sets a compute shader. Every define set gets its own program, built once and kept
+     * until the shader is set from another file, so switching between sets does not recompile
      * @param filename the name of the file containing the shader
+     * @param defines macros defined right after the #version line
      */
-    void setShader(const std::string& filename);
+    void setShader(const std::string& filename, const Defines& defines = {});
 
 private:
     /**
@@ -152,8 +163,8 @@ private:
      * @param file The name of the file we want to read (it's path)
      * @return std::string containing the compute shader source
      */
-    std::string readComputeShader(const std::string& file);
-    std::string processShaderIncludes(const std::string& file, std::unordered_set<std::string>& includedFiles);
+    std::string readComputeShader(const std::string& file, const Defines& defines = {});
+    std::string processShaderIncludes(const std::string& file, std::unordered_set<std::string>& includedFiles, const Defines* defines = nullptr);
 
     /**
      * @brief Compiles a compute shader and returns its id
@@ -4,7 +4,7 @@
 #pragma once
 
 #include <vector>
-#include "vertex_buffer.h"
+#include "vertex.h"
 
 namespace CONSTANTS{
     constexpr Vertex CUBE_MESH_VERTICES[] = {
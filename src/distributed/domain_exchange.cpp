@@ -0,0 +1,118 @@
+#include "domain_exchange.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace distributed{
+
+    namespace{
+        constexpr unsigned int C_SPINS_BEFORE_SLEEP = 1000; /* Yields in the barrier before sleeping between checks */
+
+        uint64_t align(uint64_t bytes){
+            return (bytes + C_DOMAIN_ALIGNMENT - 1) / C_DOMAIN_ALIGNMENT * C_DOMAIN_ALIGNMENT;
+        }
+
+        /**
+         * @brief Bytes of one state buffer
+         */
+        uint64_t getBufferSize(uint64_t bodies){
+            return align(bodies * sizeof(glm::mat4) + bodies * sizeof(physics::Properties));
+        }
+    }
+
+    bool DomainExchange::create(const std::string& name, const DomainDesc& desc, const std::vector<glm::mat4>& transforms,
+                                const std::vector<physics::Properties>& properties){
+        close();
+        if (transforms.size() != properties.size() || desc.rank_count == 0){
+            std::cerr << "DomainExchange: invalid bodies or ranks" << std::endl;
+            return false;
+        }
+
+        uint64_t bodies = transforms.size();
+        uint64_t stats_offset = align(sizeof(DomainHeader));
+        uint64_t state_offset = stats_offset + desc.rank_count * C_DOMAIN_ALIGNMENT;
+        uint64_t size = state_offset + 2 * getBufferSize(bodies);
+        if (!m_memory.create(name, size))
+            return false;
+
+        //The block starts zero filled, the magic goes last so the ranks never see a partial header
+        DomainHeader* header = reinterpret_cast<DomainHeader*>(m_memory.getData());
+        header->version = C_DOMAIN_VERSION;
+        header->desc = desc;
+        header->body_count = static_cast<uint32_t>(bodies);
+        header->stats_offset = stats_offset;
+        header->state_offset[0] = state_offset;
+        header->state_offset[1] = state_offset + getBufferSize(bodies);
+        m_header = header;
+
+        std::memcpy(getTransforms(0), transforms.data(), bodies * sizeof(glm::mat4));
+        std::memcpy(getProperties(0), properties.data(), bodies * sizeof(physics::Properties));
+        header->magic.store(C_DOMAIN_MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    bool DomainExchange::open(const std::string& name){
+        close();
+        if (!m_memory.open(name, true))
+            return false;
+
+        DomainHeader* header = reinterpret_cast<DomainHeader*>(m_memory.getData());
+        bool valid = m_memory.getSize() >= sizeof(DomainHeader)
+            && header->magic.load(std::memory_order_acquire) == C_DOMAIN_MAGIC
+            && header->version == C_DOMAIN_VERSION
+            && header->state_offset[1] + getBufferSize(header->body_count) <= m_memory.getSize();
+        if (!valid){
+            std::cerr << "DomainExchange: " << name << " is not a domain block" << std::endl;
+            m_memory.close();
+            return false;
+        }
+
+        m_header = header;
+        return true;
+    }
+
+    void DomainExchange::close(){
+        m_header = nullptr;
+        m_memory.close();
+    }
+
+    bool DomainExchange::barrier(){
+        uint32_t generation = m_header->generation.load(std::memory_order_acquire);
+        if (m_header->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == m_header->desc.rank_count){
+            //Last one in: the next barrier starts from zero before anybody can reach it
+            m_header->arrived.store(0, std::memory_order_relaxed);
+            m_header->generation.store(generation + 1, std::memory_order_release);
+            return !isAborted();
+        }
+
+        for (unsigned int spin = 0; m_header->generation.load(std::memory_order_acquire) == generation; spin++){
+            if (isAborted())
+                return false;
+            if (spin < C_SPINS_BEFORE_SLEEP)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        return !isAborted();
+    }
+
+    void DomainExchange::abort(){
+        if (m_header)
+            m_header->aborted.store(1, std::memory_order_release);
+    }
+
+    glm::mat4* DomainExchange::getTransforms(unsigned int buffer) const{
+        return reinterpret_cast<glm::mat4*>(m_memory.getData() + m_header->state_offset[buffer & 1]);
+    }
+
+    physics::Properties* DomainExchange::getProperties(unsigned int buffer) const{
+        return reinterpret_cast<physics::Properties*>(m_memory.getData() + m_header->state_offset[buffer & 1]
+                                                      + m_header->body_count * sizeof(glm::mat4));
+    }
+
+    DomainRankStats& DomainExchange::getRankStats(unsigned int rank) const{
+        return *reinterpret_cast<DomainRankStats*>(m_memory.getData() + m_header->stats_offset + rank * C_DOMAIN_ALIGNMENT);
+    }
+}
@@ -0,0 +1,159 @@
+#ifndef DOMAIN_EXCHANGE_H
+#define DOMAIN_EXCHANGE_H
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "../physics.h"
+#include "../recording/shared_memory.h"
+
+/**
+ * Shared memory block through which the ranks of a domain decomposition exchange the bodies.
+ *
+ *  DomainHeader                                  at 0
+ *  DomainRankStats of each rank                  at stats_offset + r * 64 (a cache line each)
+ *  transforms of buffer 0, then its properties   at state_offset[0]
+ *  transforms of buffer 1, then its properties   at state_offset[1]
+ *
+ * Step s reads buffer s % 2 and writes buffer (s + 1) % 2. Every rank reads the whole state, keeps
+ * the bodies it owns plus the ones that reach its slab (ghosts), steps them and writes back only
+ * the ones it owns; the owners follow from the positions, so each body is written by exactly one
+ * rank. A barrier closes each step, after it the buffers swap.
+ */
+
+namespace distributed{
+
+    constexpr uint32_t C_DOMAIN_MAGIC = 0x4d4f4450; /* "PDOM" */
+    constexpr uint32_t C_DOMAIN_VERSION = 1;
+    constexpr size_t C_DOMAIN_ALIGNMENT = 64;
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "The barrier of the domain must be lock free to work across processes");
+
+    /**
+     * @brief Settings of a decomposition, fixed when the block is created
+     */
+    struct DomainDesc{
+        uint32_t rank_count = 2;
+        uint32_t axis = 0; /* Axis the slabs are stacked along */
+        float margin = 1.0f; /* Distance past the spheres of the owned bodies up to which a body is mirrored as a ghost */
+        uint32_t rebalance_interval = 30; /* Steps between two moves of the planes, 0 to keep the first ones */
+    };
+
+    struct DomainHeader{
+        std::atomic<uint32_t> magic; /* Stored last by the creator */
+        uint32_t version;
+        DomainDesc desc;
+        uint32_t body_count;
+        uint32_t padding;
+        uint64_t stats_offset;
+        uint64_t state_offset[2];
+        std::atomic<uint32_t> arrived; /* Ranks waiting in the barrier */
+        std::atomic<uint32_t> generation; /* Barriers completed */
+        std::atomic<uint32_t> aborted; /* 1 once a rank failed, nobody waits anymore */
+    };
+
+    /**
+     * @brief What a rank did, written by the rank and read by the coordinator
+     */
+    struct DomainRankStats{
+        uint64_t steps;
+        uint32_t owned; /* Bodies owned in the last step */
+        uint32_t ghosts; /* Bodies mirrored from other ranks in the last step */
+        uint64_t migrated; /* Bodies that became owned by this rank, in total */
+        double step_ms; /* Time stepping the local bodies, in total */
+        double wait_ms; /* Time waiting for the other ranks, in total */
+        float lower; /* Slab of the last step */
+        float upper;
+    };
+
+    static_assert(sizeof(DomainRankStats) <= C_DOMAIN_ALIGNMENT, "The statistics of a rank must fit in a cache line");
+
+    /**
+     * @brief Shared state of a domain decomposition, created by the coordinator and opened
+     * writable by every rank
+     */
+    class DomainExchange{
+    private:
+        recording::SharedMemory m_memory;
+        DomainHeader* m_header = nullptr;
+
+    public:
+        DomainExchange() = default;
+
+        DomainExchange(const DomainExchange&) = delete;
+        DomainExchange& operator=(const DomainExchange&) = delete;
+
+        /**
+         * @brief Creates the block with the initial state in buffer 0
+         * @return false if the block could not be created
+         */
+        bool create(const std::string& name, const DomainDesc& desc, const std::vector<glm::mat4>& transforms,
+                    const std::vector<physics::Properties>& properties);
+
+        /**
+         * @brief Opens the block of a coordinator as one of its ranks
+         * @return false if there is no valid block with that name
+         */
+        bool open(const std::string& name);
+
+        /**
+         * @brief Unmaps the block (the coordinator also removes it)
+         */
+        void close();
+
+        /**
+         * @brief Waits until every rank reaches the barrier
+         * @return false if the decomposition was aborted
+         */
+        bool barrier();
+
+        /**
+         * @brief Wakes every rank up with a failure, called when a rank dies
+         */
+        void abort();
+
+        /**
+         * @brief Tells whether the decomposition was aborted
+         */
+        inline bool isAborted() const { return m_header && m_header->aborted.load(std::memory_order_acquire) != 0; }
+
+        /**
+         * @brief Tells whether the block is open
+         */
+        inline bool isOpen() const { return m_header != nullptr; }
+
+        /**
+         * @brief Gets the settings of the decomposition
+         */
+        inline const DomainDesc& getDesc() const { return m_header->desc; }
+
+        /**
+         * @brief Gets the number of bodies
+         */
+        inline uint32_t getBodyCount() const { return m_header->body_count; }
+
+        /**
+         * @brief Gets the transforms of one of the state buffers
+         */
+        glm::mat4* getTransforms(unsigned int buffer) const;
+
+        /**
+         * @brief Gets the properties of one of the state buffers
+         */
+        physics::Properties* getProperties(unsigned int buffer) const;
+
+        /**
+         * @brief Gets the statistics of a rank
+         */
+        DomainRankStats& getRankStats(unsigned int rank) const;
+    };
+}
+
+
+#endif // DOMAIN_EXCHANGE_H
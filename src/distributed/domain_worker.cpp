@@ -0,0 +1,122 @@
+#include "domain_worker.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "../profiling/cpu_profiler.h"
+
+namespace distributed{
+
+    namespace{
+        using Clock = std::chrono::steady_clock;
+
+        double elapsedMs(Clock::time_point begin, Clock::time_point end){
+            return std::chrono::duration<double, std::milli>(end - begin).count();
+        }
+    }
+
+    DomainWorker::DomainWorker(
+        DomainExchange& exchange,
+        unsigned int rank,
+        const std::vector<SimpleVertex>* static_vertices,
+        const std::vector<unsigned int>* static_indices,
+        const std::vector<glm::vec4>* object_vertices,
+        const std::vector<glm::vec4>* object_normals,
+        const std::vector<glm::vec4>* object_edges,
+        jobs::JobSystem* job_system
+    ) : m_exchange(exchange),
+        m_rank(rank),
+        m_partition(exchange.getDesc().rank_count, exchange.getDesc().axis),
+        m_base_radius(utils::calculateRadius(*static_vertices)),
+        m_owned_step(exchange.getBodyCount(), UINT64_MAX),
+        m_simulator(&m_transforms, static_vertices, static_indices, object_vertices, object_normals, object_edges, &m_properties, job_system) {}
+
+    bool DomainWorker::step(float delta_time, glm::vec3 gravity){
+        PROFILE_ZONE("domain step");
+        const DomainDesc& desc = m_exchange.getDesc();
+        uint32_t bodies = m_exchange.getBodyCount();
+        const glm::mat4* transforms = m_exchange.getTransforms(static_cast<unsigned int>(m_step));
+        const physics::Properties* properties = m_exchange.getProperties(static_cast<unsigned int>(m_step));
+        DomainRankStats& stats = m_exchange.getRankStats(m_rank);
+
+        //Every rank reads the same state, so all of them move the planes to the same place
+        if (m_step == 0 || (desc.rebalance_interval > 0 && m_step % desc.rebalance_interval == 0))
+            m_partition.rebalance(transforms, bodies);
+
+        //A ghost only matters if it can touch an owned body, so the slab is widened on each side by
+        //how far the spheres of the owned bodies stick out of it (plus the margin for the motion
+        //during the step), not by the largest body of the scene
+        m_radii.resize(bodies);
+        float lower = m_partition.getLower(m_rank);
+        float upper = m_partition.getUpper(m_rank);
+        float lower_reach = 0.0f;
+        float upper_reach = 0.0f;
+        unsigned int axis = m_partition.getAxis();
+        for (uint32_t i = 0; i < bodies; i++){
+            glm::vec3 position = glm::vec3(transforms[i][3]);
+            glm::vec3 scale = utils::scaleFromTransform(transforms[i]);
+            m_radii[i] = m_base_radius * glm::max(scale.x, glm::max(scale.y, scale.z));
+            if (m_partition.getRank(position) != m_rank)
+                continue;
+            lower_reach = std::max(lower_reach, lower - (position[axis] - m_radii[i]));
+            upper_reach = std::max(upper_reach, position[axis] + m_radii[i] - upper);
+        }
+
+        //Owned bodies and ghosts. Handing them sorted by the lower x of their sphere keeps the sort of the broad phase cheap
+        m_order.clear();
+        for (uint32_t i = 0; i < bodies; i++){
+            glm::vec3 position = glm::vec3(transforms[i][3]);
+            if (m_partition.getRank(position) == m_rank ||
+                m_partition.reaches(m_rank, position, m_radii[i], lower_reach + desc.margin, upper_reach + desc.margin))
+                m_order.emplace_back(position.x - m_radii[i], i);
+        }
+        std::sort(m_order.begin(), m_order.end());
+
+        m_transforms.resize(m_order.size());
+        m_properties.resize(m_order.size());
+        m_bodies.resize(m_order.size());
+        m_owned_count = 0;
+        for (size_t k = 0; k < m_order.size(); k++){
+            uint32_t i = m_order[k].second;
+            m_transforms[k] = transforms[i];
+            m_properties[k] = properties[i];
+            m_bodies[k] = i;
+        }
+
+        Clock::time_point begin = Clock::now();
+        m_simulator.resetBodies();
+        m_simulator.update(delta_time, gravity);
+        Clock::time_point end = Clock::now();
+
+        //Only the owner writes a body, the ghosts were stepped to push on the owned bodies and are dropped
+        glm::mat4* next_transforms = m_exchange.getTransforms(static_cast<unsigned int>(m_step + 1));
+        physics::Properties* next_properties = m_exchange.getProperties(static_cast<unsigned int>(m_step + 1));
+        uint64_t migrated = 0;
+        for (size_t k = 0; k < m_bodies.size(); k++){
+            uint32_t i = m_bodies[k];
+            if (m_partition.getRank(glm::vec3(transforms[i][3])) != m_rank)
+                continue;
+
+            next_transforms[i] = m_transforms[k];
+            next_properties[i] = m_properties[k];
+            m_owned_count++;
+            if (m_step > 0 && m_owned_step[i] + 1 != m_step)
+                migrated++;
+            m_owned_step[i] = m_step;
+        }
+
+        stats.steps = m_step + 1;
+        stats.owned = m_owned_count;
+        stats.ghosts = getGhostCount();
+        stats.migrated += migrated;
+        stats.step_ms += elapsedMs(begin, end);
+        stats.lower = m_partition.getLower(m_rank);
+        stats.upper = m_partition.getUpper(m_rank);
+
+        m_step++;
+        Clock::time_point wait = Clock::now();
+        bool running = m_exchange.barrier();
+        stats.wait_ms += elapsedMs(wait, Clock::now());
+        return running;
+    }
+}
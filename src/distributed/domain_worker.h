@@ -0,0 +1,93 @@
+#ifndef DOMAIN_WORKER_H
+#define DOMAIN_WORKER_H
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "../vertex.h"
+
+#include "domain_exchange.h"
+#include "slab_partition.h"
+#include "../simulators/simulator.h"
+
+namespace distributed{
+
+    /**
+     * @brief One rank of a domain decomposition. Each step it takes the bodies of its slab plus the
+     * ghosts that reach it from the neighbouring slabs out of the shared state, steps them with its
+     * own Simulator and writes back the ones it owns. A body that crosses a plane is owned by the
+     * next slab from the following step on; every rank moves the planes the same way, so ownership
+     * needs no messages
+     * @note Every body must have the same mesh
+     */
+    class DomainWorker{
+    private:
+        DomainExchange& m_exchange;
+        unsigned int m_rank;
+        SlabPartition m_partition;
+        float m_base_radius; /* Bounding sphere of the mesh without scale */
+
+        //Local bodies, owned and ghosts, sorted by the lower x of their sphere
+        std::vector<glm::mat4> m_transforms;
+        std::vector<physics::Properties> m_properties;
+        std::vector<uint32_t> m_bodies; /* Index of each local body in the shared state */
+        std::vector<std::pair<float, uint32_t>> m_order; /* Scratch memory of the sort */
+        std::vector<float> m_radii; /* Bounding sphere of each body of the shared state, scratch memory of step */
+        std::vector<uint64_t> m_owned_step; /* Last step each body of the shared state was owned in */
+        uint32_t m_owned_count = 0;
+
+        Simulator m_simulator;
+        uint64_t m_step = 0;
+
+    public:
+        /**
+         * @brief Constructor, the mesh is the one of every body (see Simulator)
+         * @param exchange open block of the decomposition
+         * @param rank rank of this worker (below the rank count of the block)
+         * @param job_system job system of the simulator (if null, the simulator creates one)
+         */
+        DomainWorker(
+            DomainExchange& exchange,
+            unsigned int rank,
+            const std::vector<SimpleVertex>* static_vertices,
+            const std::vector<unsigned int>* static_indices,
+            const std::vector<glm::vec4>* object_vertices,
+            const std::vector<glm::vec4>* object_normals,
+            const std::vector<glm::vec4>* object_edges,
+            jobs::JobSystem* job_system = nullptr
+        );
+
+        /**
+         * @brief Takes a step and waits for the other ranks to finish theirs
+         * @return false if the decomposition was aborted
+         */
+        bool step(float delta_time, glm::vec3 gravity);
+
+        /**
+         * @brief Gets the number of steps taken
+         */
+        inline uint64_t getStep() const { return m_step; }
+
+        /**
+         * @brief Gets the slabs of the last step
+         */
+        inline const SlabPartition& getPartition() const { return m_partition; }
+
+        /**
+         * @brief Gets the number of bodies owned in the last step
+         */
+        inline uint32_t getOwnedCount() const { return m_owned_count; }
+
+        /**
+         * @brief Gets the number of ghosts of the last step
+         */
+        inline uint32_t getGhostCount() const { return static_cast<uint32_t>(m_bodies.size()) - m_owned_count; }
+    };
+}
+
+
+#endif // DOMAIN_WORKER_H
@@ -0,0 +1,43 @@
+#include "slab_partition.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace distributed{
+
+    SlabPartition::SlabPartition(unsigned int ranks, unsigned int axis)
+        : m_rank_count(std::max(ranks, 1u)),
+        m_axis(std::min(axis, 2u)),
+        m_planes(m_rank_count - 1, 0.0f) {}
+
+    void SlabPartition::rebalance(const glm::mat4* transforms, size_t count){
+        if (count == 0 || m_planes.empty())
+            return;
+
+        m_coordinates.resize(count);
+        for (size_t i = 0; i < count; i++)
+            m_coordinates[i] = transforms[i][3][m_axis];
+        std::sort(m_coordinates.begin(), m_coordinates.end());
+
+        //The body at each quantile starts the next slab
+        for (unsigned int p = 0; p < m_planes.size(); p++)
+            m_planes[p] = m_coordinates[(p + 1) * count / m_rank_count];
+    }
+
+    unsigned int SlabPartition::getRank(const glm::vec3& position) const{
+        return static_cast<unsigned int>(std::upper_bound(m_planes.begin(), m_planes.end(), position[m_axis]) - m_planes.begin());
+    }
+
+    bool SlabPartition::reaches(unsigned int rank, const glm::vec3& center, float radius, float lower_margin, float upper_margin) const{
+        float coordinate = center[m_axis];
+        return coordinate + radius >= getLower(rank) - lower_margin && coordinate - radius < getUpper(rank) + upper_margin;
+    }
+
+    float SlabPartition::getLower(unsigned int rank) const{
+        return rank == 0 ? -std::numeric_limits<float>::infinity() : m_planes[rank - 1];
+    }
+
+    float SlabPartition::getUpper(unsigned int rank) const{
+        return rank + 1 >= m_rank_count ? std::numeric_limits<float>::infinity() : m_planes[rank];
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef SLAB_PARTITION_H
+#define SLAB_PARTITION_H
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace distributed{
+
+    /**
+     * @brief Splits space in slabs along one axis, one per rank. Rank r owns the bodies whose
+     * center lies in [plane r - 1, plane r), the first and last slabs reach to infinity
+     */
+    class SlabPartition{
+    private:
+        unsigned int m_rank_count;
+        unsigned int m_axis;
+        std::vector<float> m_planes; /* rank_count - 1 planes, sorted */
+        std::vector<float> m_coordinates; /* Scratch memory of rebalance */
+
+    public:
+        /**
+         * @brief Constructor, every plane starts at 0 until the first rebalance
+         * @param ranks number of slabs
+         * @param axis axis the slabs are stacked along (0 x, 1 y, 2 z)
+         */
+        explicit SlabPartition(unsigned int ranks = 1, unsigned int axis = 0);
+
+        /**
+         * @brief Moves the planes so every slab owns the same number of bodies. The result only
+         * depends on the positions, so every process computes the same planes from the same state
+         * @param transforms transform of each body
+         * @param count number of bodies
+         */
+        void rebalance(const glm::mat4* transforms, size_t count);
+
+        /**
+         * @brief Gets the rank owning a position
+         */
+        unsigned int getRank(const glm::vec3& position) const;
+
+        /**
+         * @brief Tells whether a sphere reaches the slab of a rank widened by a margin on each side,
+         * the bodies of other ranks that do are mirrored into it as ghosts
+         */
+        bool reaches(unsigned int rank, const glm::vec3& center, float radius, float lower_margin, float upper_margin) const;
+
+        /**
+         * @brief Gets the lower plane of a rank (-infinity for the first one)
+         */
+        float getLower(unsigned int rank) const;
+
+        /**
+         * @brief Gets the upper plane of a rank (infinity for the last one)
+         */
+        float getUpper(unsigned int rank) const;
+
+        /**
+         * @brief Gets the number of slabs
+         */
+        inline unsigned int getRankCount() const { return m_rank_count; }
+
+        /**
+         * @brief Gets the axis the slabs are stacked along
+         */
+        inline unsigned int getAxis() const { return m_axis; }
+
+        /**
+         * @brief Gets the planes between the slabs
+         */
+        inline const std::vector<float>& getPlanes() const { return m_planes; }
+    };
+}
+
+
+#endif // SLAB_PARTITION_H
@@ -0,0 +1,20 @@
+#include "gl_check.h"
+
+#include <iostream>
+#include <string>
+
+#include <GL/glew.h>
+
+void GLClearError(){
+    while (glGetError() != GL_NO_ERROR);
+}
+
+bool GLLogCall(const char* function, const char* file, int line){
+    while (GLenum error = glGetError()){
+        std::string fileStr(file);
+        std::string filename = fileStr.substr(fileStr.find_last_of("\\/") + 1);
+        std::cerr << "[OpenGL Error] (" << error << "): " << function << " " << filename << ":" << line << std::endl;
+        return false;
+    }
+    return true;
+}
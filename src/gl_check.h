@@ -0,0 +1,36 @@
+#ifndef GL_CHECK_H
+#define GL_CHECK_H
+
+#pragma once
+
+#ifndef ASSERT
+#ifdef _MSC_VER
+#define ASSERT(x) if (!(x)) __debugbreak();
+#else
+#define ASSERT(x) if (!(x)) __builtin_trap();
+#endif
+#endif
+
+#ifndef GLCall
+    #define GLCall(x) GLClearError();\
+    x;\
+    ASSERT(GLLogCall(#x, __FILE__, __LINE__))
+#endif
+
+
+/**
+ * @brief Clears the OpenGL error buffer
+ */
+void GLClearError();
+
+/**
+ * @brief Logs an OpenGL call
+ * @param function the function that was called
+ * @param file the file where the function was called
+ * @param line the line where the function was called
+ * @return true if there was no error, false otherwise
+ */
+bool GLLogCall(const char* function, const char* file, int line);
+
+
+#endif // GL_CHECK_H
@@ -17,6 +17,12 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 // ------------------------------------------------
+#elif defined(__linux__)
+//------------------------------------------------
+// Includes en Linux (GLEW y GLFW instalados con el gestor de paquetes)
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+// ------------------------------------------------
 #else
 // Emitir error por sistema operativo no soportado
 #error "No puedo determinar el sistema operativo, o no esta soportado"
@@ -0,0 +1,126 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace jobs{
+
+    /**
+     * @brief Lock-free bounded queue for any number of producers and consumers. Each cell of a
+     * fixed ring carries a sequence number telling whether it is free for the push of a given
+     * position or holds the value for its pop, so producers and consumers only race on their own
+     * cursor with a compare and swap and never block each other. The memory is allocated once.
+     * @note Neither side waits: a push on a full queue or a pop on an empty one returns false
+     */
+    template<typename T>
+    class BoundedQueue{
+    private:
+        /**
+         * @brief Slot of the ring
+         */
+        struct Cell{
+            std::atomic<size_t> sequence; /* Position the cell can be pushed at, or that position + 1 once it holds a value */
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> m_cells;
+        size_t m_capacity;
+        alignas(64) std::atomic<size_t> m_push_position; /* Next position to push, owned by the producers */
+        alignas(64) std::atomic<size_t> m_pop_position; /* Next position to pop, owned by the consumers */
+
+    public:
+        /**
+         * @brief Constructor
+         * @param capacity number of values the queue holds (at least 1)
+         */
+        explicit BoundedQueue(size_t capacity)
+            : m_cells(new Cell[capacity > 0 ? capacity : 1]),
+            m_capacity(capacity > 0 ? capacity : 1),
+            m_push_position(0),
+            m_pop_position(0){
+
+            for (size_t i = 0; i < m_capacity; i++)
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        /**
+         * @brief Pushes a value if there is room
+         * @return false if the queue is full (the value is not moved from)
+         */
+        bool tryPush(T&& value){
+            size_t position = m_push_position.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true){
+                cell = &m_cells[position % m_capacity];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+                if (difference == 0){
+                    if (m_push_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0)
+                    return false; //The cell still holds the value of the previous lap
+                else
+                    position = m_push_position.load(std::memory_order_relaxed);
+            }
+
+            cell->value = std::move(value);
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Pops the oldest value if there is one
+         * @return false if the queue is empty
+         */
+        bool tryPop(T& value){
+            size_t position = m_pop_position.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true){
+                cell = &m_cells[position % m_capacity];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+                if (difference == 0){
+                    if (m_pop_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0)
+                    return false; //The push of this position has not finished
+                else
+                    position = m_pop_position.load(std::memory_order_relaxed);
+            }
+
+            value = std::move(cell->value);
+            cell->sequence.store(position + m_capacity, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Gets the number of values in the queue (a snapshot, others may be pushing or popping)
+         */
+        size_t size() const{
+            size_t pop = m_pop_position.load(std::memory_order_relaxed);
+            size_t push = m_push_position.load(std::memory_order_relaxed);
+            return push > pop ? push - pop : 0;
+        }
+
+        /**
+         * @brief Gets the number of values the queue holds
+         */
+        inline size_t capacity() const { return m_capacity; }
+    };
+}
+
+
+#endif // BOUNDED_QUEUE_H
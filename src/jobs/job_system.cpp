@@ -0,0 +1,174 @@
+#include "job_system.h"
+
+#include "../profiling/cpu_profiler.h"
+
+namespace jobs{
+
+    namespace{
+        /**
+         * @brief Identifies the job system and deque owned by the current thread
+         */
+        struct ThreadSlot{
+            const JobSystem* system = nullptr;
+            unsigned int index = 0;
+        };
+
+        thread_local ThreadSlot t_slot;
+
+        constexpr int C_SPINS_BEFORE_SLEEP = 64; /* Failed job searches before a worker sleeps */
+    }
+
+    JobSystem::JobSystem(unsigned int threads)
+        : m_thread_count(threads), m_running(true), m_queued_jobs(0), m_sleeping_workers(0){
+        if (m_thread_count == 0)
+            m_thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        m_queues.reserve(m_thread_count);
+        for (unsigned int i = 0; i < m_thread_count; i++)
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+
+        //The caller takes part through wait(), so one thread less is spawned
+        m_workers.reserve(m_thread_count - 1);
+        for (unsigned int i = 1; i < m_thread_count; i++)
+            m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    JobSystem::~JobSystem(){
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            m_running = false;
+        }
+        m_sleep_cv.notify_all();
+
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    unsigned int JobSystem::getThreadIndex() const{
+        return t_slot.system == this ? t_slot.index : 0;
+    }
+
+    void JobSystem::submit(const Job& job){
+        if (!tryPush(getThreadIndex(), job)){
+            execute(job);
+            return;
+        }
+
+        //Wake a sleeping worker, the lock avoids missing a worker about to sleep
+        if (m_sleeping_workers.load() > 0){
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            m_sleep_cv.notify_one();
+        }
+    }
+
+    void JobSystem::wait(const JobCounter& counter){
+        unsigned int index = getThreadIndex();
+        Job job;
+
+        while (counter.load(std::memory_order_acquire) > 0){
+            if (tryGetJob(index, job))
+                execute(job);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::runRange(const Job& job){
+        const RangeContext& context = *static_cast<const RangeContext*>(job.context);
+        size_t begin = job.begin;
+        size_t end = job.end;
+
+        //Queue the upper half until the range is small enough
+        while (end - begin > context.grain){
+            size_t middle = begin + (end - begin) / 2;
+
+            job.counter->fetch_add(1, std::memory_order_relaxed);
+            context.system->submit(Job{ &runRange, job.context, middle, end, job.counter });
+            end = middle;
+        }
+
+        context.invoke(context.function, begin, end);
+    }
+
+    void JobSystem::workerLoop(unsigned int index){
+        t_slot.system = this;
+        t_slot.index = index;
+        PROFILE_THREAD_NAME("job worker");
+
+        Job job;
+        int spins = 0;
+
+        while (m_running.load(std::memory_order_acquire)){
+            if (tryGetJob(index, job)){
+                execute(job);
+                spins = 0;
+                continue;
+            }
+
+            if (++spins < C_SPINS_BEFORE_SLEEP){
+                std::this_thread::yield();
+                continue;
+            }
+
+            //Nothing to do for a while, sleep until a job is submitted
+            std::unique_lock<std::mutex> lock(m_sleep_mutex);
+            m_sleeping_workers.fetch_add(1);
+            m_sleep_cv.wait(lock, [this]{
+                return m_queued_jobs.load() > 0 || !m_running.load();
+            });
+            m_sleeping_workers.fetch_sub(1, std::memory_order_release);
+            spins = 0;
+        }
+    }
+
+    bool JobSystem::tryGetJob(unsigned int index, Job& job){
+        if (m_queued_jobs.load(std::memory_order_acquire) <= 0)
+            return false;
+
+        //Own deque first (newest job, still hot in cache)
+        {
+            WorkerQueue& queue = *m_queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.head != queue.tail){
+                queue.tail--;
+                job = queue.jobs[queue.tail % C_QUEUE_CAPACITY];
+                m_queued_jobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        //Steal the oldest job from the other deques
+        for (unsigned int i = 1; i < m_thread_count; i++){
+            WorkerQueue& queue = *m_queues[(index + i) % m_thread_count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.head != queue.tail){
+                job = queue.jobs[queue.head % C_QUEUE_CAPACITY];
+                queue.head++;
+                m_queued_jobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool JobSystem::tryPush(unsigned int index, const Job& job){
+        WorkerQueue& queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tail - queue.head == C_QUEUE_CAPACITY)
+            return false;
+
+        queue.jobs[queue.tail % C_QUEUE_CAPACITY] = job;
+        queue.tail++;
+        m_queued_jobs.fetch_add(1);
+        return true;
+    }
+
+    void JobSystem::execute(const Job& job){
+        job.function(job);
+
+        if (job.counter)
+            job.counter->fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
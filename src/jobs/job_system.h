@@ -0,0 +1,176 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace jobs{
+
+    /**
+     * @brief Counter of unfinished jobs, used to wait for a group of jobs
+     */
+    using JobCounter = std::atomic<int>;
+
+    /**
+     * @brief Unit of work executed by the job system. Jobs are plain data so
+     * they can be queued without allocating
+     */
+    struct Job{
+        void (*function)(const Job& job); /* Entry point of the job */
+        void* context; /* User data passed to the entry point */
+        size_t begin; /* First index of the range handled by the job */
+        size_t end; /* One past the last index of the range handled by the job */
+        JobCounter* counter; /* Decremented once the job has finished (may be null) */
+    };
+
+    /**
+     * @brief Work-stealing scheduler. Every participating thread owns a deque:
+     * it pushes and pops jobs at the back, and idle threads steal from the front
+     */
+    class JobSystem{
+    private:
+        static constexpr size_t C_QUEUE_CAPACITY = 1024; /* Jobs per worker deque */
+        static constexpr size_t C_SPLITS_PER_THREAD = 8; /* Range chunks per thread in parallelFor */
+
+        /**
+         * @brief Fixed capacity deque owned by one thread
+         */
+        struct alignas(64) WorkerQueue{
+            std::mutex mutex;
+            std::array<Job, C_QUEUE_CAPACITY> jobs;
+            size_t head = 0; /* Index of the oldest job (stolen first) */
+            size_t tail = 0; /* One past the newest job (popped first by the owner) */
+        };
+
+        unsigned int m_thread_count; /* Threads taking part, including the caller */
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues; /* Queue 0 belongs to non-worker threads */
+        std::vector<std::thread> m_workers;
+
+        std::atomic<bool> m_running;
+        std::atomic<int> m_queued_jobs; /* Jobs sitting in any of the queues */
+        std::atomic<int> m_sleeping_workers;
+        std::mutex m_sleep_mutex;
+        std::condition_variable m_sleep_cv;
+
+    public:
+        /**
+         * @brief Constructor
+         * @param threads number of threads taking part, including the caller (0 uses all hardware threads)
+         */
+        JobSystem(unsigned int threads = 0);
+
+        /**
+         * @brief Destructor. Waits for the workers to exit (queued jobs are not run)
+         */
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /**
+         * @brief Gets the number of threads that execute jobs, including the caller
+         */
+        inline unsigned int getThreadCount() const { return m_thread_count; }
+
+        /**
+         * @brief Gets the index of the calling thread inside this job system
+         * @return a value in [0, getThreadCount()), 0 for threads that are not workers
+         */
+        unsigned int getThreadIndex() const;
+
+        /**
+         * @brief Queues a job on the calling thread's deque
+         * @note if the deque is full the job is executed immediately
+         */
+        void submit(const Job& job);
+
+        /**
+         * @brief Blocks until the counter reaches zero, executing queued jobs meanwhile
+         */
+        void wait(const JobCounter& counter);
+
+        /**
+         * @brief Calls function(begin, end) over sub-ranges of [0, count) in parallel and waits for them
+         * @param count number of elements
+         * @param function callable taking (size_t begin, size_t end)
+         * @param min_grain smallest range handed to a single call
+         * @note ranges are split lazily in halves: a thread keeps the lower half and queues the
+         * upper one, so stolen work is always the largest pending chunk. The grain adapts to the
+         * element and thread count so each thread gets a few chunks to balance with
+         */
+        template<typename F>
+        void parallelFor(size_t count, F&& function, size_t min_grain = 1){
+            if (count == 0)
+                return;
+
+            size_t grain = std::max<size_t>(std::max<size_t>(min_grain, 1), count / (m_thread_count * C_SPLITS_PER_THREAD));
+            if (m_thread_count == 1 || count <= grain){
+                function(size_t(0), count);
+                return;
+            }
+
+            using Function = std::remove_reference_t<F>;
+            RangeContext context{ this, const_cast<void*>(static_cast<const void*>(&function)), grain, &invokeRange<Function> };
+
+            JobCounter counter(1);
+            execute(Job{ &runRange, &context, 0, count, &counter });
+            wait(counter);
+        }
+
+    private:
+        /**
+         * @brief State shared by every chunk of a parallelFor
+         */
+        struct RangeContext{
+            JobSystem* system;
+            void* function;
+            size_t grain;
+            void (*invoke)(void* function, size_t begin, size_t end);
+        };
+
+        template<typename F>
+        static void invokeRange(void* function, size_t begin, size_t end){
+            (*static_cast<F*>(function))(begin, end);
+        }
+
+        /**
+         * @brief Splits a parallelFor range until it reaches the grain and runs the remainder
+         */
+        static void runRange(const Job& job);
+
+        /**
+         * @brief Worker thread main loop
+         */
+        void workerLoop(unsigned int index);
+
+        /**
+         * @brief Pops a job from the calling thread's deque or steals one from another thread
+         * @return true if a job was found
+         */
+        bool tryGetJob(unsigned int index, Job& job);
+
+        /**
+         * @brief Pushes a job to a deque
+         * @return false if the deque is full
+         */
+        bool tryPush(unsigned int index, const Job& job);
+
+        /**
+         * @brief Runs a job and signals its counter
+         */
+        static void execute(const Job& job);
+    };
+}
+
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,63 @@
+#include "task_graph.h"
+
+#include <cassert>
+#include <chrono>
+
+#include "../profiling/cpu_profiler.h"
+
+namespace jobs{
+
+    TaskGraph::TaskId TaskGraph::addTask(const std::string& name, std::function<void()> function){
+        Task& task = m_tasks.emplace_back();
+        task.name = name;
+        task.function = std::move(function);
+#ifdef PHYSICS_PROFILE
+        task.zone_name = profiling::intern(name);
+#endif
+        return static_cast<TaskId>(m_tasks.size() - 1);
+    }
+
+    void TaskGraph::addDependency(TaskId before, TaskId after){
+        assert(before < m_tasks.size() && after < m_tasks.size() && before != after);
+
+        m_tasks[before].dependents.push_back(after);
+        m_tasks[after].dependencies++;
+    }
+
+    void TaskGraph::run(JobSystem& system){
+        if (m_tasks.empty())
+            return;
+
+        RunContext context{ this, &system };
+        JobCounter counter(static_cast<int>(m_tasks.size()));
+
+        for (auto& task : m_tasks)
+            task.remaining.store(task.dependencies, std::memory_order_relaxed);
+
+        //Start every task without dependencies, the rest are released by runTask
+        for (TaskId id = 0; id < m_tasks.size(); id++){
+            if (m_tasks[id].dependencies == 0)
+                system.submit(Job{ &runTask, &context, id, id + 1, &counter });
+        }
+
+        system.wait(counter);
+    }
+
+    void TaskGraph::runTask(const Job& job){
+        const RunContext& context = *static_cast<const RunContext*>(job.context);
+        Task& task = context.graph->m_tasks[job.begin];
+
+        //Read by the thread that ran the graph once the counter reaches zero
+        auto begin = std::chrono::steady_clock::now();
+        {
+            PROFILE_ZONE(task.zone_name);
+            task.function();
+        }
+        task.duration_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        for (TaskId dependent : task.dependents){
+            if (context.graph->m_tasks[dependent].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                context.system->submit(Job{ &runTask, job.context, dependent, dependent + 1, job.counter });
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "job_system.h"
+
+namespace jobs{
+
+    /**
+     * @brief Set of tasks with dependencies between them. The graph is built once
+     * and can be run any number of times; a task starts as soon as every task it
+     * depends on has finished, so independent branches overlap
+     */
+    class TaskGraph{
+    public:
+        using TaskId = unsigned int;
+
+    private:
+        /**
+         * @brief Node of the graph
+         */
+        struct Task{
+            std::string name; /* Name of the task (for debugging and profiling) */
+            std::function<void()> function; /* Work done by the task */
+            std::vector<TaskId> dependents; /* Tasks waiting for this one */
+            int dependencies = 0; /* Number of tasks this one waits for */
+            std::atomic<int> remaining{0}; /* Dependencies still running in the current run */
+            float duration_ms = 0.0f; /* Wall time of the task in the last run */
+#ifdef PHYSICS_PROFILE
+            const char* zone_name = nullptr; /* Copy of name that outlives the graph (profiler zones) */
+#endif
+        };
+
+        /**
+         * @brief State of the current run, shared by every task job
+         */
+        struct RunContext{
+            TaskGraph* graph;
+            JobSystem* system;
+        };
+
+        std::deque<Task> m_tasks; /* Deque so tasks (and their atomics) never move */
+
+    public:
+        /**
+         * @brief Adds a task to the graph
+         * @param name name of the task
+         * @param function work done by the task (may use parallelFor)
+         * @return the id of the new task
+         */
+        TaskId addTask(const std::string& name, std::function<void()> function);
+
+        /**
+         * @brief Makes a task wait for another one
+         * @param before task that must finish first
+         * @param after task that waits
+         */
+        void addDependency(TaskId before, TaskId after);
+
+        /**
+         * @brief Runs every task respecting the dependencies and waits for all of them
+         * @param system job system executing the tasks
+         */
+        void run(JobSystem& system);
+
+        /**
+         * @brief Gets the number of tasks in the graph
+         */
+        inline size_t size() const { return m_tasks.size(); }
+
+        /**
+         * @brief Gets the name of a task
+         */
+        inline const std::string& getName(TaskId id) const { return m_tasks[id].name; }
+
+        /**
+         * @brief Gets how long a task took in the last run, in milliseconds (including the
+         * parallelFor jobs it waited for)
+         */
+        inline float getDuration(TaskId id) const { return m_tasks[id].duration_ms; }
+
+    private:
+        /**
+         * @brief Job entry point: runs one task and releases its dependents
+         */
+        static void runTask(const Job& job);
+    };
+}
+
+
+#endif // TASK_GRAPH_H
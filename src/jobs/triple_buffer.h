@@ -0,0 +1,72 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace jobs{
+
+    /**
+     * @brief Lock-free single producer / single consumer triple buffer. The producer always has a
+     * slot to write into and the consumer always has a slot to read from, the third one is swapped
+     * between them with an atomic exchange. Neither side ever waits for the other, the consumer
+     * simply skips the states it was too slow to see.
+     */
+    template<typename T>
+    class TripleBuffer{
+    private:
+        static constexpr uint8_t C_INDEX_MASK = 0x3;
+        static constexpr uint8_t C_FRESH = 0x4; /* Set when the shared slot holds a state the consumer has not taken */
+
+        T m_slots[3];
+        alignas(64) std::atomic<uint8_t> m_shared; /* Index of the shared slot (and fresh flag) */
+        alignas(64) uint8_t m_write; /* Owned by the producer */
+        alignas(64) uint8_t m_read; /* Owned by the consumer */
+
+    public:
+        TripleBuffer() : m_shared(1), m_write(0), m_read(2) {}
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        /**
+         * @brief Gets the slot the producer writes the next state into
+         * @note producer only
+         */
+        inline T& getWriteBuffer() { return m_slots[m_write]; }
+
+        /**
+         * @brief Publishes the write slot, the producer gets the previously shared slot back
+         * @note producer only
+         */
+        void publish(){
+            uint8_t previous = m_shared.exchange(static_cast<uint8_t>(m_write | C_FRESH), std::memory_order_acq_rel);
+            m_write = previous & C_INDEX_MASK;
+        }
+
+        /**
+         * @brief Takes the latest published state if there is a new one
+         * @return true if the read slot changed
+         * @note consumer only
+         */
+        bool acquire(){
+            if (!(m_shared.load(std::memory_order_relaxed) & C_FRESH))
+                return false;
+
+            uint8_t previous = m_shared.exchange(m_read, std::memory_order_acq_rel);
+            m_read = previous & C_INDEX_MASK;
+            return true;
+        }
+
+        /**
+         * @brief Gets the state the consumer currently holds
+         * @note consumer only
+         */
+        inline const T& getReadBuffer() const { return m_slots[m_read]; }
+    };
+}
+
+
+#endif // TRIPLE_BUFFER_H
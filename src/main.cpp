@@ -6,14 +6,15 @@
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifdef _WIN32
 #include <direct.h>
+#endif
 #include <sstream>
-#include <thread>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
+#include <iomanip>
+#include <memory>
 #include <vector>
 #include <algorithm>
+#include <cmath>
 
 
 #include "glm/glm.hpp"
@@ -28,6 +29,9 @@
 #include "vertex_array.h"
 #include "vertex_buffer_layout.h"
 #include "shader.h"
+#include "profiling/cpu_profiler.h"
+#include "recording/frame_capture.h"
+#include "recording/video_capture.h"
 
 #include "tests/test_render.h"
 #include "tests/test_free_collisions.h"
@@ -36,9 +40,8 @@
 #include "tests/test_complex.h"
 #include "tests/test_complex_2.h"
 #include "tests/test_complex_3.h"
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include "tests/test_cpu_simulator.h"
+#include "tests/test_replay.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -58,8 +61,16 @@ unsigned int samples = 4; /*Number of samples*/
 
 unsigned int skip_frames = 2;
 
+float physics_hz = 60.0f; /*Frequency of the fixed physics step*/
+int max_substeps = 4; /*Maximum physics steps per frame (the rest of the time is dropped)*/
+
 int test_index = 0; // Update this per test, perhaps when switching tests.
 int frame_index = 0; // Reset this for each test or keep a global count as needed.
+unsigned int encoder_threads = 0; /*PNG encoder threads of the recording (0 uses half of the hardware threads)*/
+unsigned int capture_queue = 16; /*Frames that can wait for an encoder (8 MB each at 1080p)*/
+recording::OverflowPolicy capture_policy = recording::OverflowPolicy::Block; /*What to do with the frames when the encoders fall behind*/
+bool capture_video = false; /*Record a Y4M video per test instead of a PNG per frame*/
+unsigned int capture_fps = 60; /*Frame rate written in the Y4M header (every rendered frame is recorded)*/
 
 
 
@@ -67,76 +78,36 @@ int frame_index = 0; // Reset this for each test or keep a global count as neede
 void createDirectory(const std::string &path) {
     #ifdef _WIN32
         _mkdir(path.c_str());
+    #else
+        mkdir(path.c_str(), 0755);
     #endif
 }
 
-// Define a structure to hold frame data.
-struct FrameData {
-    int test_index;
-    int frame_index;
-    int width;
-    int height;
-    std::vector<unsigned char> pixels;
-};
-
-// Thread-safe queue
-std::queue<FrameData> frameQueue;
-std::mutex queueMutex;
-std::condition_variable queueCV;
-bool recordingActive = true;  // Control flag for background thread
-
-// Background thread function to save frames
-void frameSaver() {
-    while (recordingActive || !frameQueue.empty()) {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        queueCV.wait(lock, [] { return !frameQueue.empty() || !recordingActive; });
-        
-        while (!frameQueue.empty()) {
-            FrameData frame = frameQueue.front();
-            frameQueue.pop();
-            lock.unlock();  // Unlock while doing file I/O
-            
-            // Construct folder path and filename as before
-            std::ostringstream folderStream;
-            folderStream << "E:/datasets/REDS/sim_dataset/videos/" << std::setfill('0') << std::setw(3) << frame.test_index << "/";
-            std::string folderPath = folderStream.str();
-            createDirectory(folderPath);
-            
-            std::ostringstream filenameStream;
-            filenameStream << folderPath << std::setfill('0') << std::setw(8) << frame.frame_index << ".png";
-            std::string filename = filenameStream.str();
-            
-            if (stbi_write_png(filename.c_str(), frame.width, frame.height, 3, frame.pixels.data(), frame.width * 3))
-                std::cout << "Saved frame to " << filename << std::endl;
-            else
-                std::cerr << "Failed to save frame to " << filename << std::endl;
-            
-            lock.lock();
-        }
-    }
+/**
+ * @brief Gets the folder of the recorded frames of a test
+ */
+std::string getCaptureFolder(int test_index) {
+    std::ostringstream folderStream;
+    folderStream << "E:/datasets/REDS/sim_dataset/videos/" << std::setfill('0') << std::setw(3) << test_index << "/";
+    return folderStream.str();
 }
 
-// Modified saveFrame that pushes data to the queue instead of saving directly.
-void saveFrameAsync(int test_index, int frame_index, int width, int height) {
-    std::vector<unsigned char> pixels(width * height * 3);
-    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-    
-    // Optional: flip the image vertically
-    std::vector<unsigned char> flipped(pixels.size());
-    int rowSize = width * 3;
-    for (int y = 0; y < height; ++y) {
-        memcpy(&flipped[y * rowSize], &pixels[(height - 1 - y) * rowSize], rowSize);
-    }
-    
-    // Package the frame data
-    FrameData frame { test_index, frame_index, width, height, flipped };
-    
-    // Push frame to the queue
-    {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        frameQueue.push(frame);
-    }
-    queueCV.notify_one();
+/**
+ * @brief Gets the video recorded for a test
+ */
+std::string getVideoPath(int test_index) {
+    std::ostringstream filenameStream;
+    filenameStream << "E:/datasets/REDS/sim_dataset/videos/" << std::setfill('0') << std::setw(3) << test_index << ".y4m";
+    return filenameStream.str();
+}
+
+/**
+ * @brief Gets the file of a recorded frame
+ */
+std::string getCapturePath(int test_index, int frame_index) {
+    std::ostringstream filenameStream;
+    filenameStream << getCaptureFolder(test_index) << std::setfill('0') << std::setw(8) << frame_index << ".png";
+    return filenameStream.str();
 }
 
 
@@ -214,6 +185,7 @@ void initOpenGL(){
 }
 
 void mainLoop() {
+    PROFILE_THREAD_NAME("main");
     Renderer renderer;
 
     ImGui::CreateContext();
@@ -233,6 +205,8 @@ void mainLoop() {
     test_menu->registerTest<test::TestComplex>("4. Colisiones Complejas");
     test_menu->registerTest<test::TestComplex2>("5. Colisiones Complejas 2");
     test_menu->registerTest<test::TestComplex3>("6. Colisiones Complejas 3");
+    test_menu->registerTest<test::TestCpuSimulator>("7. Simulador CPU (hilo de fisica)");
+    test_menu->registerTest<test::TestReplay>("8. Reproduccion de trayectoria");
     // Variables to handle key press state
     bool r_key_pressed = false;
 
@@ -241,14 +215,20 @@ void mainLoop() {
     const double frame_time = 1.0 / (144.0f / skip_frames);  // Time per frame in seconds
     double last_frame_time = glfwGetTime();
     double delta_time = 0.0f;
+    double accumulator = 0.0f; // Simulation time not yet consumed by fixed steps
 
-    std::thread saverThread(frameSaver);
+    //Frames are read back through pixel pack buffers and written by a pool of PNG encoders
+    auto frame_capture = std::make_unique<recording::FrameCapture>(encoder_threads, capture_queue, capture_policy);
+    //Or converted to YUV on the gpu and appended to a single video
+    auto video_capture = std::make_unique<recording::VideoCapture>();
 
     GLint maxSSBOSize = 0;
     glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxSSBOSize);
     printf("Max SSBO size: %d bytes\n", maxSSBOSize);
     
     while (!terminate_program) {
+        PROFILE_ZONE("frame");
+
         // Calculate frame start time
         double frame_start_time = glfwGetTime();
         
@@ -256,9 +236,7 @@ void mainLoop() {
         delta_time = frame_start_time - last_frame_time;
         last_frame_time = frame_start_time;
 
-        // Cap delta time to prevent large jumps
-        if (delta_time > 0.25f)
-            delta_time = 0.25f;
+        accumulator += delta_time;
 
         // Handle 'R' key press to toggle recording
         if (glfwGetKey(c_window, GLFW_KEY_R) == GLFW_PRESS) {
@@ -271,6 +249,10 @@ void mainLoop() {
                     // If we start recording, reset frame index
                     if (record) {
                         frame_index = 0;
+                        if (capture_video)
+                            record = video_capture->open(getVideoPath(test_index), w_width, w_height, capture_fps);
+                        else
+                            createDirectory(getCaptureFolder(test_index));
                     }
                 }
                 r_key_pressed = true;
@@ -289,8 +271,25 @@ void mainLoop() {
         ImGui::NewFrame();
 
         if (current_test) {
-            current_test->onUpdate(static_cast<float>(delta_time));
-            current_test->onRender();
+            // Fixed physics step, the renderer interpolates between the last two steps
+            const double fixed_delta_time = 1.0 / physics_hz;
+            int substeps = 0;
+            while (accumulator >= fixed_delta_time && substeps < max_substeps) {
+                PROFILE_ZONE("onUpdate");
+                current_test->onUpdate(static_cast<float>(fixed_delta_time));
+                accumulator -= fixed_delta_time;
+                substeps++;
+            }
+
+            // Too slow to keep up, drop the backlog instead of spiraling
+            if (accumulator >= fixed_delta_time)
+                accumulator = std::fmod(accumulator, fixed_delta_time);
+
+            current_test->setInterpolation(static_cast<float>(accumulator / fixed_delta_time));
+            {
+                PROFILE_ZONE("onRender");
+                current_test->onRender();
+            }
             
             ImGui::Begin("Test");
             if (current_test != test_menu && ImGui::Button("<-")) {
@@ -301,7 +300,26 @@ void mainLoop() {
                 }
                 delete current_test;
                 current_test = test_menu;
+                accumulator = 0.0f;
             }
+
+            // The jacobi shaders skip steps shorter than 10 ms, so the frequency stays at or below 100 Hz
+            ImGui::SliderFloat("Physics Hz", &physics_hz, 20.0f, 100.0f);
+            ImGui::SliderInt("Max substeps", &max_substeps, 1, 16);
+
+            const recording::PngEncoderPool& encoders = frame_capture->getEncoders();
+            ImGui::Checkbox("Record Y4M video", &capture_video);
+            ImGui::Text("Capture: %llu written, %llu dropped, queue %zu/%zu (peak %zu)",
+                static_cast<unsigned long long>(encoders.getWrittenCount()),
+                static_cast<unsigned long long>(encoders.getDroppedCount()),
+                encoders.getQueueDepth(), encoders.getQueueCapacity(), encoders.getPeakQueueDepth());
+
+#ifdef PHYSICS_PROFILE
+            if (!profiling::isCapturing() && ImGui::Button("Start CPU trace"))
+                profiling::beginCapture();
+            else if (profiling::isCapturing() && ImGui::Button("Stop CPU trace (cpu_trace.json)"))
+                profiling::endCapture("cpu_trace.json");
+#endif
             
             // Only render ImGui test content if not recording
             if (!record) {
@@ -311,34 +329,46 @@ void mainLoop() {
         }
 
         // Always render ImGui, but if recording, don't display it
-        ImGui::Render();
-        if (!record) {
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            PROFILE_ZONE("ImGui");
+            ImGui::Render();
+            if (!record) {
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            }
         }
 
         // Save the frame if we're recording and not in the test menu
         if (record && current_test != test_menu) {
-            // Make sure the current OpenGL context is ready for frame capture
-            glFinish();
-            saveFrameAsync(test_index, frame_index, w_width, w_height);
+            if (video_capture->isOpen())
+                video_capture->capture();
+            else
+                frame_capture->capture(w_width, w_height, getCapturePath(test_index, frame_index));
             frame_index++;
             if (frame_index >= 1000)
                 record = false;
         }
-
-        glfwSwapBuffers(c_window);
-        glfwPollEvents();
+        frame_capture->poll();
+        video_capture->poll();
+        if (!record && video_capture->isOpen())
+            video_capture->close();
+
+        {
+            PROFILE_ZONE("swap buffers");
+            glfwSwapBuffers(c_window);
+            glfwPollEvents();
+        }
 
         terminate_program = glfwWindowShouldClose(c_window) || terminate_program;
     }
 
-    {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        recordingActive = false;
-    }
+    // Writes the frames still in flight
+    frame_capture.reset();
+    video_capture.reset();
 
-    queueCV.notify_one();
-    saverThread.join();
+#ifdef PHYSICS_PROFILE
+    if (profiling::isCapturing())
+        profiling::endCapture("cpu_trace.json");
+#endif
 
     delete current_test;
     if (current_test != test_menu)
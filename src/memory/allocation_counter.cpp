@@ -0,0 +1,71 @@
+#include "allocation_counter.h"
+
+#ifdef PHYSICS_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace{
+    std::atomic<size_t> s_allocations{ 0 };
+
+    void* countedAllocate(size_t size){
+        s_allocations.fetch_add(1, std::memory_order_relaxed);
+
+        void* memory = std::malloc(size == 0 ? 1 : size);
+        if (!memory)
+            throw std::bad_alloc();
+        return memory;
+    }
+
+    void* countedAllocateAligned(size_t size, std::align_val_t alignment){
+        s_allocations.fetch_add(1, std::memory_order_relaxed);
+
+        //aligned_alloc needs the size to be a multiple of the alignment
+        size_t align = static_cast<size_t>(alignment);
+        size = (size + align - 1) & ~(align - 1);
+#ifdef _MSC_VER
+        void* memory = _aligned_malloc(size == 0 ? align : size, align);
+#else
+        void* memory = std::aligned_alloc(align, size == 0 ? align : size);
+#endif
+        if (!memory)
+            throw std::bad_alloc();
+        return memory;
+    }
+
+    void countedFreeAligned(void* memory){
+#ifdef _MSC_VER
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+}
+
+//Replacements of the global allocation functions, the rest of the overloads forward to these
+void* operator new(size_t size){ return countedAllocate(size); }
+void* operator new[](size_t size){ return countedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment){ return countedAllocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment){ return countedAllocateAligned(size, alignment); }
+
+void operator delete(void* memory) noexcept{ std::free(memory); }
+void operator delete[](void* memory) noexcept{ std::free(memory); }
+void operator delete(void* memory, size_t) noexcept{ std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept{ std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept{ countedFreeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept{ countedFreeAligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept{ countedFreeAligned(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept{ countedFreeAligned(memory); }
+
+namespace memory{
+    size_t getAllocationCount(){ return s_allocations.load(std::memory_order_relaxed); }
+}
+
+#else
+
+namespace memory{
+    size_t getAllocationCount(){ return 0; }
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#pragma once
+
+#include <cstddef>
+
+namespace memory{
+
+    /**
+     * @brief Gets the number of calls to the global operator new since the program started.
+     * Only counted when built with PHYSICS_COUNT_ALLOCATIONS, otherwise it always returns 0
+     */
+    size_t getAllocationCount();
+
+    /**
+     * @brief Tells whether the allocations are being counted in this build
+     */
+    constexpr bool isCountingAllocations(){
+#ifdef PHYSICS_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+}
+
+
+#endif // ALLOCATION_COUNTER_H
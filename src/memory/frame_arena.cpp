@@ -0,0 +1,69 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace memory{
+
+    FrameArena::FrameArena(size_t block_size)
+        : m_offset(0), m_previous_blocks_used(0), m_used(0), m_high_water_mark(0), m_block_size(block_size){
+        m_blocks.reserve(8);
+        m_blocks.push_back(Block{ std::make_unique<std::byte[]>(m_block_size), m_block_size });
+    }
+
+    void* FrameArena::allocate(size_t size, size_t alignment){
+        assert((alignment & (alignment - 1)) == 0);
+
+        Block* block = &m_blocks.back();
+        uintptr_t base = reinterpret_cast<uintptr_t>(block->memory.get());
+        size_t aligned = ((base + m_offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+
+        //Not enough room, open a new block big enough for the request
+        if (aligned + size > block->size){
+            size_t block_size = std::max(m_block_size, size + alignment);
+            m_blocks.push_back(Block{ std::make_unique<std::byte[]>(block_size), block_size });
+
+            block = &m_blocks.back();
+            base = reinterpret_cast<uintptr_t>(block->memory.get());
+            m_previous_blocks_used += m_offset;
+            aligned = ((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        }
+
+        m_offset = aligned + size;
+        m_used = m_previous_blocks_used + m_offset;
+        m_high_water_mark = std::max(m_high_water_mark, m_used);
+
+        return block->memory.get() + aligned;
+    }
+
+    void FrameArena::reset(){
+        //Merge the blocks into one that fits the largest step seen so far (with some slack)
+        if (m_blocks.size() > 1){
+            size_t size = std::max(m_block_size, m_high_water_mark + m_high_water_mark / 8);
+            m_blocks.clear();
+            m_blocks.push_back(Block{ std::make_unique<std::byte[]>(size), size });
+        }
+
+        m_offset = 0;
+        m_previous_blocks_used = 0;
+        m_used = 0;
+    }
+
+    void FrameArena::reserve(size_t bytes){
+        assert(m_used == 0 && m_blocks.size() == 1);
+        if (m_blocks.back().size >= bytes)
+            return;
+
+        size_t size = bytes + bytes / 8;
+        m_blocks.clear();
+        m_blocks.push_back(Block{ std::make_unique<std::byte[]>(size), size });
+    }
+
+    size_t FrameArena::getCapacity() const{
+        size_t capacity = 0;
+        for (const auto& block : m_blocks)
+            capacity += block.size;
+        return capacity;
+    }
+}
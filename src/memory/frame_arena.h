@@ -0,0 +1,178 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace memory{
+
+    /**
+     * @brief Linear (bump) allocator for data that only lives during one simulation step.
+     * Allocations are never freed one by one, the whole arena is reset at the end of the step.
+     * If a step needs more than one block, the blocks are merged into a single one on reset,
+     * so once the arena has seen its largest step it stops touching the heap
+     */
+    class FrameArena{
+    private:
+        /**
+         * @brief Chunk of memory the allocations are carved from
+         */
+        struct Block{
+            std::unique_ptr<std::byte[]> memory;
+            size_t size;
+        };
+
+        std::vector<Block> m_blocks; /* Blocks in use, the last one is the current one */
+        size_t m_offset; /* First free byte of the current block */
+        size_t m_previous_blocks_used; /* Bytes used in the blocks before the current one */
+        size_t m_used; /* Bytes handed out since the last reset (including alignment) */
+        size_t m_high_water_mark; /* Largest m_used seen */
+        size_t m_block_size; /* Minimum size of a new block */
+
+    public:
+        /**
+         * @brief Constructor
+         * @param block_size size of the first block (and minimum size of the following ones)
+         */
+        explicit FrameArena(size_t block_size = 1 << 20);
+
+        FrameArena(FrameArena&&) = default;
+        FrameArena& operator=(FrameArena&&) = default;
+
+        /**
+         * @brief Allocates memory from the arena
+         * @param size number of bytes
+         * @param alignment alignment of the returned pointer (power of two)
+         * @return pointer valid until the next reset
+         */
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        /**
+         * @brief Allocates an uninitialized array from the arena
+         * @param count number of elements
+         */
+        template<typename T>
+        T* allocate(size_t count){
+            static_assert(std::is_trivially_destructible_v<T>, "Arena memory is never destroyed");
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        /**
+         * @brief Releases every allocation at once
+         */
+        void reset();
+
+        /**
+         * @brief Makes the arena hold at least bytes in a single block (with some slack if it grows).
+         * Only valid right after a reset
+         */
+        void reserve(size_t bytes);
+
+        /**
+         * @brief Gets the bytes handed out since the last reset
+         */
+        inline size_t getUsed() const { return m_used; }
+
+        /**
+         * @brief Gets the largest amount of bytes used in a single step
+         */
+        inline size_t getHighWaterMark() const { return m_high_water_mark; }
+
+        /**
+         * @brief Gets the bytes currently reserved by the arena
+         */
+        size_t getCapacity() const;
+    };
+
+    /**
+     * @brief Growable array living in a FrameArena. Growing copies the elements to a new
+     * arena allocation (twice the size), the old one is reclaimed on the next reset.
+     * @note only for trivially copyable types; the array is invalid after the arena is reset
+     */
+    template<typename T>
+    class FrameVector{
+        static_assert(std::is_trivially_copyable_v<T>, "FrameVector copies its elements with memcpy");
+
+    private:
+        FrameArena* m_arena;
+        T* m_data;
+        size_t m_size;
+        size_t m_capacity;
+
+    public:
+        FrameVector() : m_arena(nullptr), m_data(nullptr), m_size(0), m_capacity(0) {}
+
+        /**
+         * @brief Constructor
+         * @param arena arena providing the memory
+         * @param capacity number of elements reserved up front
+         */
+        explicit FrameVector(FrameArena& arena, size_t capacity = 0)
+            : m_arena(&arena), m_data(nullptr), m_size(0), m_capacity(0){
+            reserve(capacity);
+        }
+
+        inline T* data() { return m_data; }
+        inline const T* data() const { return m_data; }
+        inline size_t size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+        inline T* begin() { return m_data; }
+        inline T* end() { return m_data + m_size; }
+        inline const T* begin() const { return m_data; }
+        inline const T* end() const { return m_data + m_size; }
+        inline T& operator[](size_t i) { return m_data[i]; }
+        inline const T& operator[](size_t i) const { return m_data[i]; }
+
+        /**
+         * @brief Makes room for at least capacity elements
+         */
+        void reserve(size_t capacity){
+            if (capacity <= m_capacity)
+                return;
+
+            T* data = m_arena->allocate<T>(capacity);
+            if (m_size > 0)
+                std::memcpy(static_cast<void*>(data), m_data, m_size * sizeof(T));
+
+            m_data = data;
+            m_capacity = capacity;
+        }
+
+        /**
+         * @brief Changes the number of elements (new elements are left uninitialized)
+         */
+        void resize(size_t size){
+            reserve(size);
+            m_size = size;
+        }
+
+        /**
+         * @brief Adds an element at the end
+         */
+        void push_back(const T& value){
+            if (m_size == m_capacity)
+                reserve(m_capacity == 0 ? 16 : m_capacity * 2);
+            m_data[m_size++] = value;
+        }
+
+        /**
+         * @brief Adds count elements at the end
+         */
+        void append(const T* values, size_t count){
+            if (count == 0)
+                return;
+
+            reserve(m_size + count);
+            std::memcpy(static_cast<void*>(m_data + m_size), values, count * sizeof(T));
+            m_size += count;
+        }
+    };
+}
+
+
+#endif // FRAME_ARENA_H
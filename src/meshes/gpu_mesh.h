@@ -53,6 +53,11 @@ public:
      */
     inline const IndexBuffer& getIndexBuffer() const { return m_ib; }
 
+    /**
+     * @brief Get the instance color buffer (binding point 10)
+     */
+    inline ShaderStorageBuffer& getColorBuffer() { return m_color_ssbo; }
+
 
     void generateTextureCoordinates();
     
@@ -7,7 +7,7 @@
 
 #include "glm/glm.hpp"
 
-#include "vertex_buffer.h"
+#include "vertex.h"
 
 namespace physics{
 
@@ -0,0 +1,216 @@
+#include "cpu_profiler.h"
+
+#ifdef PHYSICS_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace profiling{
+
+    namespace{
+
+        constexpr uint32_t C_THREAD_CAPACITY = 1 << 16; /* Events per thread and capture, the rest are dropped */
+
+        /**
+         * @brief Zone or counter sample
+         */
+        struct Event{
+            const char* name;
+            uint64_t begin;
+            uint64_t end;
+            double value;
+            bool is_counter;
+        };
+
+        /**
+         * @brief Events of one thread. Only the owner writes, the events below count are complete
+         * and can be read by endCapture from another thread without locking
+         */
+        struct ThreadBuffer{
+            std::unique_ptr<Event[]> events;
+            std::atomic<uint32_t> count{ 0 };
+            std::atomic<uint32_t> dropped{ 0 };
+            std::atomic<uint64_t> session{ 0 }; /* Capture the events belong to */
+            std::atomic<const char*> name{ nullptr };
+            std::atomic<bool> in_use{ true }; /* False once the thread exited, the buffer is reused */
+            uint32_t tid = 0;
+        };
+
+        /**
+         * @brief Gives the buffer back when the thread exits
+         */
+        struct ThreadHandle{
+            ThreadBuffer* buffer = nullptr;
+
+            ~ThreadHandle(){
+                if (buffer)
+                    buffer->in_use.store(false, std::memory_order_release);
+            }
+        };
+
+        std::atomic<bool> g_capturing{ false };
+        std::atomic<uint64_t> g_session{ 0 };
+        std::atomic<uint64_t> g_capture_start{ 0 };
+
+        //Only locked when a thread records its first event and on endCapture
+        std::mutex g_registry_mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+        std::unordered_set<std::string> g_interned;
+
+        thread_local ThreadHandle t_handle;
+
+        ThreadBuffer& getThreadBuffer(){
+            if (t_handle.buffer)
+                return *t_handle.buffer;
+
+            std::lock_guard<std::mutex> lock(g_registry_mutex);
+            for (auto& buffer : g_buffers){
+                if (!buffer->in_use.load(std::memory_order_acquire)){
+                    buffer->in_use.store(true, std::memory_order_relaxed);
+                    buffer->name.store(nullptr, std::memory_order_relaxed);
+                    t_handle.buffer = buffer.get();
+                    return *t_handle.buffer;
+                }
+            }
+
+            g_buffers.push_back(std::make_unique<ThreadBuffer>());
+            g_buffers.back()->tid = static_cast<uint32_t>(g_buffers.size());
+            t_handle.buffer = g_buffers.back().get();
+            return *t_handle.buffer;
+        }
+
+        void push(const Event& event){
+            ThreadBuffer& buffer = getThreadBuffer();
+
+            //First event of a new capture on this thread, the owner resets its own buffer
+            uint64_t session = g_session.load(std::memory_order_acquire);
+            if (buffer.session.load(std::memory_order_relaxed) != session){
+                if (!buffer.events)
+                    buffer.events = std::make_unique<Event[]>(C_THREAD_CAPACITY);
+                buffer.count.store(0, std::memory_order_relaxed);
+                buffer.dropped.store(0, std::memory_order_relaxed);
+                buffer.session.store(session, std::memory_order_release);
+            }
+
+            uint32_t index = buffer.count.load(std::memory_order_relaxed);
+            if (index >= C_THREAD_CAPACITY){
+                buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            buffer.events[index] = event;
+            buffer.count.store(index + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Writes a name as a JSON string
+         */
+        void writeString(std::FILE* file, const char* text){
+            std::fputc('"', file);
+            for (const char* c = text ? text : "?"; *c; c++){
+                if (*c == '"' || *c == '\\')
+                    std::fputc('\\', file);
+                std::fputc(*c, file);
+            }
+            std::fputc('"', file);
+        }
+    }
+
+    uint64_t now(){
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void beginCapture(){
+        g_capture_start.store(now(), std::memory_order_relaxed);
+        g_session.fetch_add(1, std::memory_order_acq_rel);
+        g_capturing.store(true, std::memory_order_release);
+    }
+
+    bool isCapturing(){
+        return g_capturing.load(std::memory_order_relaxed);
+    }
+
+    const char* intern(const std::string& name){
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        return g_interned.insert(name).first->c_str();
+    }
+
+    void setThreadName(const char* name){
+        getThreadBuffer().name.store(name, std::memory_order_relaxed);
+    }
+
+    void recordZone(const char* name, uint64_t begin, uint64_t end){
+        //The zone started before this capture (or the capture stopped meanwhile)
+        if (!isCapturing() || begin < g_capture_start.load(std::memory_order_relaxed))
+            return;
+
+        push(Event{ name, begin, end, 0.0, false });
+    }
+
+    void recordCounter(const char* name, double value){
+        if (!isCapturing())
+            return;
+
+        push(Event{ name, now(), 0, value, true });
+    }
+
+    bool endCapture(const std::string& path){
+        g_capturing.store(false, std::memory_order_release);
+        uint64_t session = g_session.load(std::memory_order_acquire);
+        uint64_t start = g_capture_start.load(std::memory_order_relaxed);
+
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (!file){
+            std::cerr << "Error: could not open " << path << std::endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        std::fputs("{\"traceEvents\":[\n", file);
+        std::fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"physics\"}}");
+
+        uint64_t dropped = 0;
+        for (auto& buffer : g_buffers){
+            if (buffer->session.load(std::memory_order_acquire) != session)
+                continue;
+
+            const char* name = buffer->name.load(std::memory_order_relaxed);
+            if (name){
+                std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", buffer->tid);
+                writeString(file, name);
+                std::fputs("}}", file);
+            }
+
+            //Events written after this load are simply left out
+            uint32_t count = buffer->count.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; i++){
+                const Event& event = buffer->events[i];
+                double ts = (event.begin - start) / 1000.0;
+
+                std::fputs(",\n{\"name\":", file);
+                writeString(file, event.name);
+                if (event.is_counter)
+                    std::fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%g}}", ts, buffer->tid, event.value);
+                else
+                    std::fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", ts, (event.end - event.begin) / 1000.0, buffer->tid);
+            }
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+
+        std::fputs("\n]}\n", file);
+        std::fclose(file);
+
+        if (dropped > 0)
+            std::cerr << "Warning: " << dropped << " profiler events dropped (thread buffers full)" << std::endl;
+        return true;
+    }
+}
+
+#endif
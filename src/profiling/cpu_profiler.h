@@ -0,0 +1,123 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Cpu instrumentation, only compiled when building with PHYSICS_PROFILE. Otherwise every macro
+ * expands to nothing and its arguments are not evaluated.
+ *
+ *  PROFILE_ZONE("name")          times the enclosing scope (zones nest)
+ *  PROFILE_FUNCTION()            zone named after the enclosing function
+ *  PROFILE_COUNTER("name", v)    samples a value (shown as a graph in the trace)
+ *  PROFILE_THREAD_NAME("name")   names the calling thread in the trace
+ *
+ * Names must outlive the capture (string literals, or profiling::intern for runtime strings).
+ * Events are only recorded between profiling::beginCapture and profiling::endCapture, which
+ * writes them as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+ */
+#ifdef PHYSICS_PROFILE
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) profiling::ScopedZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_COUNTER(name, value) profiling::recordCounter(name, static_cast<double>(value))
+#define PROFILE_THREAD_NAME(name) profiling::setThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+
+#endif
+
+namespace profiling{
+
+    /**
+     * @brief Tells whether the cpu profiler is compiled in this build
+     */
+    constexpr bool isCpuProfilerEnabled(){
+#ifdef PHYSICS_PROFILE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+#ifdef PHYSICS_PROFILE
+
+    /**
+     * @brief Starts recording the events of every thread (discarding the previous capture)
+     */
+    void beginCapture();
+
+    /**
+     * @brief Stops recording and writes the capture as Chrome trace event JSON
+     * @param path file to write
+     * @return false if the file could not be written
+     */
+    bool endCapture(const std::string& path);
+
+    /**
+     * @brief Tells whether a capture is running
+     */
+    bool isCapturing();
+
+    /**
+     * @brief Gets a copy of a string that lives until the program ends (for names built at runtime)
+     * @note Takes a lock, call it once at setup and keep the pointer
+     */
+    const char* intern(const std::string& name);
+
+    /**
+     * @brief Names the calling thread in the trace
+     * @param name name that outlives the capture
+     */
+    void setThreadName(const char* name);
+
+    /**
+     * @brief Gets the profiler clock in nanoseconds
+     */
+    uint64_t now();
+
+    /**
+     * @brief Records a finished zone of the calling thread
+     */
+    void recordZone(const char* name, uint64_t begin, uint64_t end);
+
+    /**
+     * @brief Records a sample of a counter
+     */
+    void recordCounter(const char* name, double value);
+
+    /**
+     * @brief Times its scope, used through PROFILE_ZONE
+     */
+    class ScopedZone{
+    private:
+        const char* m_name;
+        uint64_t m_begin; /* 0 if no capture was running when the zone started */
+
+    public:
+        explicit ScopedZone(const char* name) : m_name(name), m_begin(isCapturing() ? now() : 0) {}
+
+        ~ScopedZone(){
+            if (m_begin != 0)
+                recordZone(m_name, m_begin, now());
+        }
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+    };
+
+#endif
+}
+
+
+#endif // CPU_PROFILER_H
@@ -0,0 +1,246 @@
+#include "gpu_profiler.h"
+#include "../gl_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "imgui.h"
+
+namespace profiling{
+
+    GpuProfiler::~GpuProfiler(){
+        for (FrameSlot& slot : m_slots){
+            if (!slot.queries.empty()){
+                GLCall(glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data()));
+            }
+        }
+    }
+
+    unsigned int GpuProfiler::registerPhase(const std::string& name){
+        for (unsigned int i = 0; i < m_phases.size(); i++){
+            if (m_phases[i].name == name)
+                return i;
+        }
+
+        Phase phase;
+        phase.name = name;
+        phase.samples.resize(C_WINDOW, 0.0f);
+        m_phases.push_back(std::move(phase));
+        m_frame_times.resize(m_phases.size(), 0.0f);
+        return static_cast<unsigned int>(m_phases.size() - 1);
+    }
+
+    void GpuProfiler::beginFrame(){
+        if (!m_enabled)
+            return;
+
+        harvest();
+
+        //The gpu is more than C_FRAMES_IN_FLIGHT frames behind, lose the oldest frame instead of waiting
+        FrameSlot& slot = m_slots[m_frame % C_FRAMES_IN_FLIGHT];
+        if (slot.pending){
+            m_dropped++;
+            m_harvested = m_frame - C_FRAMES_IN_FLIGHT + 1;
+        }
+
+        slot.pending = false;
+        slot.zones.clear();
+        m_in_frame = true;
+    }
+
+    void GpuProfiler::endFrame(){
+        if (!m_in_frame)
+            return;
+
+        //Close the zones left open so every begin query has its end
+        while (!m_open_zones.empty())
+            end();
+
+        FrameSlot& slot = m_slots[m_frame % C_FRAMES_IN_FLIGHT];
+        slot.pending = !slot.zones.empty();
+        m_frame++;
+        m_in_frame = false;
+    }
+
+    void GpuProfiler::begin(unsigned int phase){
+        if (!m_in_frame)
+            return;
+
+        FrameSlot& slot = m_slots[m_frame % C_FRAMES_IN_FLIGHT];
+        unsigned int query = static_cast<unsigned int>(slot.zones.size() * 2);
+
+        //The pool only grows the first frames, then the same queries are reused
+        if (slot.queries.size() < query + 2){
+            size_t old_size = slot.queries.size();
+            slot.queries.resize(query + 2);
+            GLCall(glGenQueries(static_cast<GLsizei>(slot.queries.size() - old_size), slot.queries.data() + old_size));
+        }
+
+        GLCall(glQueryCounter(slot.queries[query], GL_TIMESTAMP));
+        m_open_zones.push_back(static_cast<unsigned int>(slot.zones.size()));
+        slot.zones.push_back(Zone{ phase, query });
+    }
+
+    void GpuProfiler::end(){
+        if (!m_in_frame || m_open_zones.empty())
+            return;
+
+        FrameSlot& slot = m_slots[m_frame % C_FRAMES_IN_FLIGHT];
+        const Zone& zone = slot.zones[m_open_zones.back()];
+        m_open_zones.pop_back();
+
+        GLCall(glQueryCounter(slot.queries[zone.begin_query + 1], GL_TIMESTAMP));
+    }
+
+    void GpuProfiler::harvest(){
+        while (m_harvested < m_frame){
+            FrameSlot& slot = m_slots[m_harvested % C_FRAMES_IN_FLIGHT];
+            if (!slot.pending){
+                m_harvested++;
+                continue;
+            }
+
+            //Only ask for results the gpu already has, so reading them never waits
+            unsigned int query_count = static_cast<unsigned int>(slot.zones.size() * 2);
+            for (unsigned int i = 0; i < query_count; i++){
+                GLuint available = GL_FALSE;
+                GLCall(glGetQueryObjectuiv(slot.queries[i], GL_QUERY_RESULT_AVAILABLE, &available));
+                if (!available)
+                    return;
+            }
+
+            std::fill(m_frame_times.begin(), m_frame_times.end(), -1.0f);
+            for (const Zone& zone : slot.zones){
+                GLuint64 begin = 0, end = 0;
+                GLCall(glGetQueryObjectui64v(slot.queries[zone.begin_query], GL_QUERY_RESULT, &begin));
+                GLCall(glGetQueryObjectui64v(slot.queries[zone.begin_query + 1], GL_QUERY_RESULT, &end));
+
+                float ms = static_cast<float>(end - begin) / 1000000.0f;
+                m_frame_times[zone.phase] = std::max(m_frame_times[zone.phase], 0.0f) + ms;
+            }
+
+            //Phases that did not run this frame (e.g. no collisions) get no sample
+            for (unsigned int phase = 0; phase < m_frame_times.size(); phase++){
+                if (m_frame_times[phase] >= 0.0f)
+                    addSample(phase, m_frame_times[phase]);
+            }
+
+            slot.pending = false;
+            m_harvested++;
+        }
+    }
+
+    void GpuProfiler::addSample(unsigned int phase, float ms){
+        Phase& window = m_phases[phase];
+        window.samples[window.next] = ms;
+        window.next = (window.next + 1) % C_WINDOW;
+        window.count = std::min(window.count + 1, C_WINDOW);
+    }
+
+    void GpuProfiler::reset(){
+        for (FrameSlot& slot : m_slots)
+            slot.pending = false;
+
+        for (Phase& phase : m_phases){
+            phase.next = 0;
+            phase.count = 0;
+        }
+
+        m_harvested = m_frame;
+        m_dropped = 0;
+    }
+
+    PhaseStats GpuProfiler::getStats(unsigned int phase){
+        const Phase& window = m_phases[phase];
+        PhaseStats stats;
+        stats.samples = window.count;
+        if (window.count == 0)
+            return stats;
+
+        m_sorted.assign(window.samples.begin(), window.samples.begin() + window.count);
+        std::sort(m_sorted.begin(), m_sorted.end());
+
+        float sum = 0.0f;
+        for (float sample : m_sorted)
+            sum += sample;
+
+        size_t p95 = static_cast<size_t>(std::ceil(0.95f * m_sorted.size())) - 1;
+        stats.min = m_sorted.front();
+        stats.max = m_sorted.back();
+        stats.avg = sum / m_sorted.size();
+        stats.p95 = m_sorted[p95];
+        return stats;
+    }
+
+    void GpuProfiler::onImGuiRender(const char* title){
+        if (!ImGui::CollapsingHeader(title))
+            return;
+
+        ImGui::Checkbox("Enabled", &m_enabled);
+        ImGui::SameLine();
+        ImGui::Text("Dropped frames: %llu", m_dropped);
+
+        if (ImGui::BeginTable("gpu_phases", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)){
+            ImGui::TableSetupColumn("Phase");
+            ImGui::TableSetupColumn("Min (ms)");
+            ImGui::TableSetupColumn("Avg (ms)");
+            ImGui::TableSetupColumn("P95 (ms)");
+            ImGui::TableSetupColumn("Max (ms)");
+            ImGui::TableHeadersRow();
+
+            for (unsigned int phase = 0; phase < m_phases.size(); phase++){
+                PhaseStats stats = getStats(phase);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(m_phases[phase].name.c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.min);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.avg);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.p95);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.max);
+            }
+            ImGui::EndTable();
+        }
+
+        if (ImGui::Button("Dump CSV"))
+            writeCsv("gpu_profile.csv");
+        ImGui::SameLine();
+        if (ImGui::Button("Dump JSON"))
+            writeJson("gpu_profile.json");
+    }
+
+    bool GpuProfiler::writeCsv(const std::string& path){
+        std::ofstream file(path);
+        if (!file.is_open()){
+            std::cerr << "Error: could not open " << path << std::endl;
+            return false;
+        }
+
+        file << "phase,samples,min_ms,avg_ms,p95_ms,max_ms\n";
+        for (unsigned int phase = 0; phase < m_phases.size(); phase++){
+            PhaseStats stats = getStats(phase);
+            file << m_phases[phase].name << ',' << stats.samples << ',' << stats.min << ',' << stats.avg
+                << ',' << stats.p95 << ',' << stats.max << '\n';
+        }
+        return true;
+    }
+
+    bool GpuProfiler::writeJson(const std::string& path){
+        std::ofstream file(path);
+        if (!file.is_open()){
+            std::cerr << "Error: could not open " << path << std::endl;
+            return false;
+        }
+
+        file << "{\n  \"frames\": " << m_harvested << ",\n  \"dropped\": " << m_dropped << ",\n  \"phases\": [";
+        for (unsigned int phase = 0; phase < m_phases.size(); phase++){
+            PhaseStats stats = getStats(phase);
+            file << (phase == 0 ? "\n" : ",\n")
+                << "    {\"name\": \"" << m_phases[phase].name << "\", \"samples\": " << stats.samples
+                << ", \"min_ms\": " << stats.min << ", \"avg_ms\": " << stats.avg
+                << ", \"p95_ms\": " << stats.p95 << ", \"max_ms\": " << stats.max << "}";
+        }
+        file << "\n  ]\n}\n";
+        return true;
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace profiling{
+
+    /**
+     * @brief Rolling statistics of a phase, in milliseconds of gpu time per frame
+     */
+    struct PhaseStats{
+        float min = 0.0f;
+        float avg = 0.0f;
+        float p95 = 0.0f;
+        float max = 0.0f;
+        unsigned int samples = 0; /* Frames in the window */
+    };
+
+    /**
+     * @brief Measures named gpu phases with timestamp queries without ever waiting for them.
+     * The queries of a frame go into one slot of a ring and are only read once the gpu reports
+     * them available, a few frames later. If a slot is needed again before its results arrived,
+     * that frame is dropped instead of stalling. Phases that run several times in a frame (e.g.
+     * solver iterations) are added up
+     */
+    class GpuProfiler{
+    public:
+        static constexpr unsigned int C_FRAMES_IN_FLIGHT = 4; /* Slots of the query ring */
+        static constexpr unsigned int C_WINDOW = 240; /* Frames kept for the statistics */
+
+    private:
+        /**
+         * @brief Begin and end of one measured phase
+         */
+        struct Zone{
+            unsigned int phase;
+            unsigned int begin_query; /* Index in the slot queries, the end query follows it */
+        };
+
+        /**
+         * @brief Queries of one frame
+         */
+        struct FrameSlot{
+            std::vector<GLuint> queries; /* Pool, grows to the largest frame and is reused */
+            std::vector<Zone> zones;
+            bool pending = false; /* Issued and not harvested yet */
+        };
+
+        /**
+         * @brief Rolling window of a phase
+         */
+        struct Phase{
+            std::string name;
+            std::vector<float> samples; /* Ring of C_WINDOW frame times (ms) */
+            unsigned int next = 0; /* Next sample to overwrite */
+            unsigned int count = 0; /* Valid samples */
+        };
+
+        FrameSlot m_slots[C_FRAMES_IN_FLIGHT];
+        std::vector<Phase> m_phases;
+        std::vector<unsigned int> m_open_zones; /* Zones begun and not ended (stack) */
+        std::vector<float> m_frame_times; /* Per phase totals of the frame being harvested */
+        std::vector<float> m_sorted; /* Scratch memory for the percentile */
+
+        unsigned long long m_frame = 0; /* Frames begun */
+        unsigned long long m_harvested = 0; /* Next frame to harvest */
+        unsigned long long m_dropped = 0; /* Frames lost because their slot was reused */
+        bool m_in_frame = false;
+        bool m_enabled = true;
+
+    public:
+        GpuProfiler() = default;
+
+        /**
+         * @brief Destructor, deletes the queries
+         */
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+        /**
+         * @brief Registers a phase (or gets the existing one with the same name)
+         * @param name name shown in the reports
+         * @return id to use in begin()
+         */
+        unsigned int registerPhase(const std::string& name);
+
+        /**
+         * @brief Starts a frame, harvesting the results of the previous frames that are ready
+         */
+        void beginFrame();
+
+        /**
+         * @brief Ends the frame
+         */
+        void endFrame();
+
+        /**
+         * @brief Starts measuring a phase (phases can be nested)
+         * @param phase id returned by registerPhase()
+         */
+        void begin(unsigned int phase);
+
+        /**
+         * @brief Stops measuring the last phase begun
+         */
+        void end();
+
+        /**
+         * @brief Enables or disables the profiler, disabled it issues no queries
+         */
+        inline void setEnabled(bool enabled) { m_enabled = enabled; }
+
+        /**
+         * @brief Tells whether the profiler issues queries
+         */
+        inline bool isEnabled() const { return m_enabled; }
+
+        /**
+         * @brief Gets the number of phases registered
+         */
+        inline unsigned int getPhaseCount() const { return static_cast<unsigned int>(m_phases.size()); }
+
+        /**
+         * @brief Gets the name of a phase
+         */
+        inline const std::string& getPhaseName(unsigned int phase) const { return m_phases[phase].name; }
+
+        /**
+         * @brief Gets the number of frames whose results were lost
+         */
+        inline unsigned long long getDroppedFrames() const { return m_dropped; }
+
+        /**
+         * @brief Forgets the statistics, the dropped frames and the frames still in flight
+         * (e.g. to leave warm up frames out)
+         */
+        void reset();
+
+        /**
+         * @brief Computes the statistics of a phase over the window
+         */
+        PhaseStats getStats(unsigned int phase);
+
+        /**
+         * @brief Draws the statistics of every phase and the dump buttons (inside the current ImGui window)
+         * @param title header of the section
+         */
+        void onImGuiRender(const char* title = "GPU profiler");
+
+        /**
+         * @brief Writes the statistics as CSV (one row per phase)
+         * @param path file to write
+         * @return false if the file could not be written
+         */
+        bool writeCsv(const std::string& path);
+
+        /**
+         * @brief Writes the statistics as JSON
+         * @param path file to write
+         * @return false if the file could not be written
+         */
+        bool writeJson(const std::string& path);
+
+    private:
+        /**
+         * @brief Reads the finished frames in order, stops at the first one still running (never blocks)
+         */
+        void harvest();
+
+        /**
+         * @brief Adds the sample of a frame to a phase window
+         */
+        void addSample(unsigned int phase, float ms);
+    };
+}
+
+
+#endif // GPU_PROFILER_H
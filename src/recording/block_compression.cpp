@@ -0,0 +1,150 @@
+#include "block_compression.h"
+
+#include <cstring>
+
+namespace recording{
+
+    namespace{
+
+        constexpr size_t C_MIN_MATCH = 4;
+        constexpr size_t C_LAST_LITERALS = 5; /* The block always ends with at least this many literals */
+        constexpr size_t C_MATCH_FIND_LIMIT = 12; /* No match starts in the last bytes of the block */
+        constexpr size_t C_MAX_OFFSET = 65535;
+        constexpr unsigned int C_HASH_BITS = 12;
+
+        inline uint32_t read32(const uint8_t* data){
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        inline uint32_t hash(uint32_t sequence){
+            return (sequence * 2654435761u) >> (32 - C_HASH_BITS);
+        }
+
+        /**
+         * @brief Writes the part of a length that does not fit in its token nibble
+         */
+        void writeLength(size_t length, std::vector<uint8_t>& destination){
+            for (; length >= 255; length -= 255)
+                destination.push_back(255);
+            destination.push_back(static_cast<uint8_t>(length));
+        }
+
+        /**
+         * @brief Writes a token, its literals and (if match_length is not 0) the match
+         */
+        void writeSequence(const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length, std::vector<uint8_t>& destination){
+            size_t match_code = match_length ? match_length - C_MIN_MATCH : 0;
+            uint8_t token = static_cast<uint8_t>((literal_length < 15 ? literal_length : 15) << 4);
+            token |= static_cast<uint8_t>(match_code < 15 ? match_code : 15);
+            destination.push_back(token);
+
+            if (literal_length >= 15)
+                writeLength(literal_length - 15, destination);
+            destination.insert(destination.end(), literals, literals + literal_length);
+
+            if (match_length == 0)
+                return;
+            destination.push_back(static_cast<uint8_t>(offset & 0xFF));
+            destination.push_back(static_cast<uint8_t>(offset >> 8));
+            if (match_code >= 15)
+                writeLength(match_code - 15, destination);
+        }
+
+        /**
+         * @brief Reads the part of a length that did not fit in its token nibble
+         */
+        bool readLength(const uint8_t*& source, const uint8_t* end, size_t& length){
+            uint8_t byte;
+            do {
+                if (source >= end)
+                    return false;
+                byte = *source++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+    }
+
+    void compressBlock(const uint8_t* source, size_t size, std::vector<uint8_t>& destination){
+        destination.clear();
+        destination.reserve(size + size / 255 + 16);
+
+        size_t anchor = 0;
+        if (size > C_MATCH_FIND_LIMIT){
+            //Positions are stored plus one, so 0 means empty
+            std::vector<uint32_t> table(size_t(1) << C_HASH_BITS, 0);
+            const size_t match_start_limit = size - C_MATCH_FIND_LIMIT;
+            const size_t match_end_limit = size - C_LAST_LITERALS;
+
+            size_t position = 0;
+            while (position <= match_start_limit){
+                uint32_t sequence = read32(source + position);
+                uint32_t& slot = table[hash(sequence)];
+                size_t candidate = slot;
+                slot = static_cast<uint32_t>(position + 1);
+
+                if (candidate == 0 || position - (candidate - 1) > C_MAX_OFFSET || read32(source + candidate - 1) != sequence){
+                    position++;
+                    continue;
+                }
+                candidate--;
+
+                size_t length = C_MIN_MATCH;
+                while (position + length < match_end_limit && source[candidate + length] == source[position + length])
+                    length++;
+
+                writeSequence(source + anchor, position - anchor, position - candidate, length, destination);
+                position += length;
+                anchor = position;
+            }
+        }
+
+        writeSequence(source + anchor, size - anchor, 0, 0, destination);
+    }
+
+    bool decompressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t destination_size){
+        const uint8_t* end = source + size;
+        size_t written = 0;
+
+        while (source < end){
+            uint8_t token = *source++;
+
+            size_t literal_length = token >> 4;
+            if (literal_length == 15 && !readLength(source, end, literal_length))
+                return false;
+            if (literal_length > static_cast<size_t>(end - source) || literal_length > destination_size - written)
+                return false;
+            std::memcpy(destination + written, source, literal_length);
+            source += literal_length;
+            written += literal_length;
+
+            //The last sequence only has literals
+            if (source == end)
+                break;
+
+            if (end - source < 2)
+                return false;
+            size_t offset = source[0] | (size_t(source[1]) << 8);
+            source += 2;
+            if (offset == 0 || offset > written)
+                return false;
+
+            size_t match_length = token & 0x0F;
+            if (match_length == 15 && !readLength(source, end, match_length))
+                return false;
+            match_length += C_MIN_MATCH;
+            if (match_length > destination_size - written)
+                return false;
+
+            //Byte by byte, the match may overlap the bytes it produces
+            const uint8_t* match = destination + written - offset;
+            for (size_t i = 0; i < match_length; i++)
+                destination[written + i] = match[i];
+            written += match_length;
+        }
+
+        return written == destination_size;
+    }
+}
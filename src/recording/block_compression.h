@@ -0,0 +1,34 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace recording{
+
+    /**
+     * @brief Compresses a block with a greedy LZ77 in the LZ4 block layout (tokens of literal and
+     * match lengths, 2 byte offsets, minimum match of 4 bytes). Fast rather than small, meant for
+     * the quantised frames of a trajectory, which repeat a lot between bodies
+     * @param source data to compress
+     * @param size size of the data in bytes
+     * @param destination receives the compressed block (replaces its contents)
+     */
+    void compressBlock(const uint8_t* source, size_t size, std::vector<uint8_t>& destination);
+
+    /**
+     * @brief Decompresses a block written by compressBlock
+     * @param source compressed block
+     * @param size size of the compressed block in bytes
+     * @param destination memory for the decompressed data
+     * @param destination_size exact size of the decompressed data
+     * @return false if the block is corrupt or does not decompress to destination_size bytes
+     */
+    bool decompressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t destination_size);
+}
+
+
+#endif // BLOCK_COMPRESSION_H
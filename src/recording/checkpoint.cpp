@@ -0,0 +1,121 @@
+#include "checkpoint.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace recording{
+
+    namespace{
+        uint64_t alignOffset(uint64_t offset){
+            return (offset + C_CHECKPOINT_ALIGNMENT - 1) / C_CHECKPOINT_ALIGNMENT * C_CHECKPOINT_ALIGNMENT;
+        }
+    }
+
+    void CheckpointWriter::addSection(CheckpointSection id, const void* data, size_t element_size, size_t count){
+        CheckpointSectionEntry entry{};
+        entry.id = static_cast<uint32_t>(id);
+        entry.element_size = static_cast<uint32_t>(element_size);
+        entry.count = count;
+        m_sections.push_back(entry);
+        m_data.push_back(data);
+    }
+
+    bool CheckpointWriter::save(const std::string& path, CheckpointHeader header) const{
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()){
+            std::cerr << "CheckpointWriter: could not create " << path << std::endl;
+            return false;
+        }
+
+        header.magic = C_CHECKPOINT_MAGIC;
+        header.version = C_CHECKPOINT_VERSION;
+        header.section_count = static_cast<uint32_t>(m_sections.size());
+
+        //Sections are laid out after the table, aligned so the mapped arrays can be used in place
+        std::vector<CheckpointSectionEntry> sections = m_sections;
+        uint64_t offset = sizeof(CheckpointHeader) + sections.size() * sizeof(CheckpointSectionEntry);
+        for (CheckpointSectionEntry& section : sections){
+            offset = alignOffset(offset);
+            section.offset = offset;
+            offset += section.count * section.element_size;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CheckpointHeader));
+        file.write(reinterpret_cast<const char*>(sections.data()), sections.size() * sizeof(CheckpointSectionEntry));
+
+        const char padding[C_CHECKPOINT_ALIGNMENT] = {};
+        uint64_t written = sizeof(CheckpointHeader) + sections.size() * sizeof(CheckpointSectionEntry);
+        for (size_t i = 0; i < sections.size(); i++){
+            file.write(padding, static_cast<std::streamsize>(sections[i].offset - written));
+            uint64_t size = sections[i].count * sections[i].element_size;
+            if (size > 0)
+                file.write(static_cast<const char*>(m_data[i]), static_cast<std::streamsize>(size));
+            written = sections[i].offset + size;
+        }
+
+        file.close();
+        if (!file){
+            std::cerr << "CheckpointWriter: could not write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool CheckpointReader::open(const std::string& path){
+        close();
+
+        if (!m_file.open(path)){
+            std::cerr << "CheckpointReader: could not open " << path << std::endl;
+            return false;
+        }
+
+        const uint8_t* data = m_file.getData();
+        uint64_t file_size = m_file.getSize();
+
+        bool valid = file_size >= sizeof(CheckpointHeader);
+        if (valid){
+            std::memcpy(&m_header, data, sizeof(CheckpointHeader));
+            valid = m_header.magic == C_CHECKPOINT_MAGIC && m_header.version == C_CHECKPOINT_VERSION
+                && sizeof(CheckpointHeader) + uint64_t(m_header.section_count) * sizeof(CheckpointSectionEntry) <= file_size;
+        }
+        if (valid){
+            m_sections.resize(m_header.section_count);
+            std::memcpy(m_sections.data(), data + sizeof(CheckpointHeader), m_sections.size() * sizeof(CheckpointSectionEntry));
+            for (const CheckpointSectionEntry& section : m_sections){
+                valid = valid && section.offset % C_CHECKPOINT_ALIGNMENT == 0 && section.offset <= file_size
+                    && section.element_size > 0 && section.count <= (file_size - section.offset) / section.element_size;
+            }
+        }
+
+        if (!valid){
+            std::cerr << "CheckpointReader: " << path << " is not a checkpoint of version " << C_CHECKPOINT_VERSION << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void CheckpointReader::close(){
+        m_file.close();
+        m_header = CheckpointHeader{};
+        m_sections.clear();
+    }
+
+    const void* CheckpointReader::getSection(CheckpointSection id, size_t element_size, size_t& count) const{
+        count = 0;
+        for (const CheckpointSectionEntry& section : m_sections){
+            if (section.id != static_cast<uint32_t>(id))
+                continue;
+
+            if (section.element_size != element_size){
+                std::cerr << "CheckpointReader: section " << section.id << " has elements of " << section.element_size
+                          << " bytes, expected " << element_size << std::endl;
+                return nullptr;
+            }
+            count = static_cast<size_t>(section.count);
+            return m_file.getData() + section.offset;
+        }
+        return nullptr;
+    }
+}
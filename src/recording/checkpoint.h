@@ -0,0 +1,159 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+/**
+ * Binary checkpoint format, the complete state of a simulator so a settled scene starts without
+ * building or simulating it again. Every integer and float is little endian.
+ *
+ *  CheckpointHeader
+ *  section table   CheckpointSectionEntry per section
+ *  sections        raw arrays, each one starting at a multiple of C_CHECKPOINT_ALIGNMENT
+ *
+ * The sections hold the arrays exactly as the simulators keep them (the std430 layout of the
+ * shader storage buffers), so a mapped file is uploaded with one glBufferData per buffer and
+ * nothing is converted. Each entry stores the size of its elements, a checkpoint written with
+ * another layout of Properties or ContactManifold is rejected instead of misread.
+ */
+
+namespace recording{
+
+    constexpr uint32_t C_CHECKPOINT_MAGIC = 0x504B4350; /* "PCKP" */
+    constexpr uint32_t C_CHECKPOINT_VERSION = 1;
+    constexpr uint64_t C_CHECKPOINT_ALIGNMENT = 64;
+
+    /**
+     * @brief Contents of a section. The simulators read the ones they use and skip the others,
+     * so a checkpoint of one simulator can start the other one
+     */
+    enum class CheckpointSection : uint32_t{
+        Transforms = 1,    /* glm::mat4 per body */
+        Properties,        /* physics::Properties per body */
+        Spheres,           /* Bounding sphere per body (xyz center, w radius) */
+        Colors,            /* Instance color per body, if the renderer colors were attached */
+        RegistrySlots,     /* Slot table of the body registry (two uint32 per slot) */
+        RegistryDense,     /* Slot of each body (uint32) */
+        SweepOrder,        /* Sweep and prune order of the cpu broad phase (uint32 per body) */
+        Pairs,             /* Broad phase pairs of the last step (glm::ivec2) */
+        Manifolds,         /* Contacts of the last step (physics::ContactManifold) */
+        Results,           /* Broad phase scratch of the gpu (int per body) */
+        SecondResults,     /* Broad phase scratch of the gpu (int per body) */
+        DeltaV,            /* Accumulated linear impulses of the gpu solver (glm::vec4 per body) */
+        DeltaW,            /* Accumulated angular impulses of the gpu solver (glm::vec4 per body) */
+        Lambdas,           /* Gpu solver lambdas (float per body) */
+        NewLambdas         /* Gpu solver lambdas (float per body) */
+    };
+
+    struct CheckpointHeader{
+        uint32_t magic;
+        uint32_t version;
+        uint32_t section_count;
+        uint32_t body_count;
+        uint64_t seed; /* Seed of the random generator the scene was built with, given by the caller */
+        uint32_t pair_count; /* Broad phase pairs of the last step */
+        uint32_t contact_count; /* Contacts of the last step */
+        uint32_t free_slot; /* Head of the free slot list of the body registry */
+        uint32_t reserved[3];
+    };
+
+    struct CheckpointSectionEntry{
+        uint32_t id; /* CheckpointSection */
+        uint32_t element_size; /* sizeof of the elements when written */
+        uint64_t offset; /* From the start of the file */
+        uint64_t count; /* Number of elements */
+    };
+
+    /**
+     * @brief Collects the arrays of a simulator and writes them as a checkpoint
+     */
+    class CheckpointWriter{
+    private:
+        std::vector<CheckpointSectionEntry> m_sections;
+        std::vector<const void*> m_data; /* Memory of each section, owned by the caller */
+
+    public:
+        /**
+         * @brief Adds a section. The array is not copied, it has to live until save returns
+         * @param id contents of the section (added only once)
+         * @param data first element
+         * @param count number of elements
+         */
+        template<typename T>
+        void addSection(CheckpointSection id, const T* data, size_t count){
+            addSection(id, data, sizeof(T), count);
+        }
+
+        /**
+         * @brief Adds a section of elements of any size
+         */
+        void addSection(CheckpointSection id, const void* data, size_t element_size, size_t count);
+
+        /**
+         * @brief Writes the header and every section added
+         * @param header body count, seed and counters (magic, version and section count are filled in)
+         * @return false if the file could not be written
+         */
+        bool save(const std::string& path, CheckpointHeader header) const;
+    };
+
+    /**
+     * @brief Maps a checkpoint and gives pointers to its sections, valid until the reader is closed
+     */
+    class CheckpointReader{
+    private:
+        MappedFile m_file;
+        CheckpointHeader m_header{};
+        std::vector<CheckpointSectionEntry> m_sections;
+
+    public:
+        CheckpointReader() = default;
+
+        /**
+         * @brief Maps a checkpoint and checks its header and section table
+         * @return false if the file is not a checkpoint of this version
+         */
+        bool open(const std::string& path);
+
+        /**
+         * @brief Unmaps the file
+         */
+        void close();
+
+        /**
+         * @brief Tells whether a checkpoint is open
+         */
+        inline bool isOpen() const { return m_file.isOpen(); }
+
+        /**
+         * @brief Gets the header of the checkpoint
+         */
+        inline const CheckpointHeader& getHeader() const { return m_header; }
+
+        /**
+         * @brief Gets a section
+         * @param id contents of the section
+         * @param count receives the number of elements (0 if the section is missing)
+         * @return first element, null if the section is missing or its elements have another size
+         */
+        template<typename T>
+        const T* getSection(CheckpointSection id, size_t& count) const{
+            return static_cast<const T*>(getSection(id, sizeof(T), count));
+        }
+
+        /**
+         * @brief Gets a section of elements of any size
+         */
+        const void* getSection(CheckpointSection id, size_t element_size, size_t& count) const;
+    };
+}
+
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,110 @@
+#include "frame_capture.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "../gl_check.h"
+#include "../profiling/cpu_profiler.h"
+
+namespace recording{
+
+    FrameCapture::FrameCapture(unsigned int encoder_threads, unsigned int max_queued, OverflowPolicy policy)
+        : m_encoders(encoder_threads, max_queued, policy){
+    }
+
+    FrameCapture::~FrameCapture(){
+        flush();
+        for (Slot& slot : m_slots){
+            if (slot.buffer)
+                glDeleteBuffers(1, &slot.buffer);
+        }
+    }
+
+    void FrameCapture::capture(int width, int height, const std::string& path){
+        PROFILE_FUNCTION();
+
+        //The ring is full, the oldest readback has to leave its slot
+        Slot& slot = m_slots[m_next];
+        if (slot.fence)
+            collect(slot, true);
+
+        size_t size = static_cast<size_t>(width) * height * 3;
+        if (size > m_reserved){
+            m_encoders.reserveBuffers(size);
+            m_reserved = size;
+        }
+        if (!slot.buffer){
+            GLCall(glGenBuffers(1, &slot.buffer));
+        }
+        GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+        if (slot.size < size){
+            GLCall(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+            slot.size = size;
+        }
+
+        //Rows of width * 3 bytes without padding, as the PNG writer expects them
+        GLint alignment;
+        glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+        GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        GLCall(glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr));
+        GLCall(glPixelStorei(GL_PACK_ALIGNMENT, alignment));
+        GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.path = path;
+        slot.width = width;
+        slot.height = height;
+        m_next = (m_next + 1) % C_SLOTS;
+    }
+
+    void FrameCapture::poll(){
+        //Oldest first, so the frames reach the encoders in order
+        for (unsigned int i = 0; i < C_SLOTS; i++){
+            Slot& slot = m_slots[(m_next + i) % C_SLOTS];
+            if (slot.fence && !collect(slot, false))
+                break;
+        }
+    }
+
+    void FrameCapture::flush(){
+        for (unsigned int i = 0; i < C_SLOTS; i++){
+            Slot& slot = m_slots[(m_next + i) % C_SLOTS];
+            if (slot.fence)
+                collect(slot, true);
+        }
+        m_encoders.wait();
+    }
+
+    bool FrameCapture::collect(Slot& slot, bool wait){
+        GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return false;
+
+        PROFILE_ZONE("collect frame");
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        if (status == GL_WAIT_FAILED){
+            std::cerr << "FrameCapture: waiting for the readback of " << slot.path << " failed" << std::endl;
+            return true;
+        }
+
+        //The only copy of the frame: from the mapped buffer into the memory the encoder takes
+        size_t size = static_cast<size_t>(slot.width) * slot.height * 3;
+        std::vector<uint8_t> pixels = m_encoders.acquireBuffer(size);
+        GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+        GLCall(const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+        if (data){
+            std::memcpy(pixels.data(), data, size);
+            GLCall(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        }
+        GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+        if (!data){
+            std::cerr << "FrameCapture: could not map the readback of " << slot.path << std::endl;
+            return true;
+        }
+        m_encoders.push(std::move(slot.path), slot.width, slot.height, std::move(pixels));
+        slot.path.clear();
+        return true;
+    }
+}
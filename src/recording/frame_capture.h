@@ -0,0 +1,91 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "png_encoder_pool.h"
+
+namespace recording{
+
+    /**
+     * @brief Saves rendered frames as PNG files without stalling the render thread. glReadPixels
+     * writes into a ring of pixel pack buffers and returns right away, a fence tells when the copy
+     * is done, and only then the pixels are mapped and handed to a pool of PNG encoders.
+     * @note Every method runs on the thread that owns the OpenGL context
+     */
+    class FrameCapture{
+    private:
+        /**
+         * @brief Pixel pack buffer with the readback of one frame
+         */
+        struct Slot{
+            GLuint buffer = 0;
+            size_t size = 0; /* Bytes allocated for the buffer */
+            GLsync fence = nullptr; /* Pending readback, signaled once the pixels are in the buffer */
+            std::string path;
+            int width = 0;
+            int height = 0;
+        };
+
+        static constexpr unsigned int C_SLOTS = 3; /* Frames the gpu can be behind before capture waits */
+
+        Slot m_slots[C_SLOTS];
+        unsigned int m_next = 0; /* Slot of the next capture, the oldest one */
+        size_t m_reserved = 0; /* Bytes per image the encoder buffers were allocated for */
+        PngEncoderPool m_encoders;
+
+    public:
+        /**
+         * @brief Constructor
+         * @param encoder_threads PNG encoder threads (0 uses half of the hardware threads)
+         * @param max_queued frames that can wait for an encoder before the overflow policy applies
+         * @param policy what happens to the frames when the encoders fall behind
+         */
+        explicit FrameCapture(unsigned int encoder_threads = 0, unsigned int max_queued = 16, OverflowPolicy policy = OverflowPolicy::Block);
+
+        /**
+         * @brief Destructor, saves the pending frames and frees the buffers
+         */
+        ~FrameCapture();
+
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+
+        /**
+         * @brief Starts the readback of the read framebuffer (the back buffer before swapping).
+         * Waits only if the readback of C_SLOTS frames ago has not finished yet
+         * @param path PNG file to write (its folder must exist)
+         */
+        void capture(int width, int height, const std::string& path);
+
+        /**
+         * @brief Hands the finished readbacks to the encoders (never waits for the gpu). Call it once per frame
+         */
+        void poll();
+
+        /**
+         * @brief Waits for every pending readback and for the encoders to write them
+         */
+        void flush();
+
+        /**
+         * @brief Gets the encoder pool, for its counters (queue depth, dropped and written frames)
+         */
+        inline const PngEncoderPool& getEncoders() const { return m_encoders; }
+
+    private:
+        /**
+         * @brief Maps the pixels of a slot and queues them for encoding
+         * @param wait if false, returns false without waiting when the readback is not done
+         */
+        bool collect(Slot& slot, bool wait);
+    };
+}
+
+
+#endif // FRAME_CAPTURE_H
@@ -0,0 +1,66 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace recording{
+
+    /**
+     * @brief Read only view of a whole file mapped into memory (mmap, or a file mapping on Windows).
+     * The pages are loaded by the OS when they are first touched, so opening a file of any size is
+     * instant and only the parts that are read cost memory
+     */
+    class MappedFile{
+    private:
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#endif
+
+    public:
+        MappedFile() = default;
+
+        /**
+         * @brief Destructor, unmaps the file
+         */
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * @brief Maps a file
+         * @return false if the file does not exist, is empty or could not be mapped
+         */
+        bool open(const std::string& path);
+
+        /**
+         * @brief Unmaps the file
+         */
+        void close();
+
+        /**
+         * @brief Tells whether a file is mapped
+         */
+        inline bool isOpen() const { return m_data != nullptr; }
+
+        /**
+         * @brief Gets the first byte of the file
+         */
+        inline const uint8_t* getData() const { return m_data; }
+
+        /**
+         * @brief Gets the size of the file in bytes
+         */
+        inline size_t getSize() const { return m_size; }
+    };
+}
+
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,144 @@
+#include "png_encoder_pool.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "../profiling/cpu_profiler.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../stb_image_write.h"
+
+namespace recording{
+
+    namespace{
+        /**
+         * @brief Gets the encoder threads to start, half of the hardware threads if 0 is asked
+         */
+        unsigned int resolveThreadCount(unsigned int threads){
+            return threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency() / 2);
+        }
+    }
+
+    PngEncoderPool::PngEncoderPool(unsigned int threads, unsigned int max_queued, OverflowPolicy policy)
+        : m_queue(max_queued > 0 ? max_queued : 1),
+        //An image can be queued, being written or on its way from the caller (2 at most, with DropOldest)
+        m_free_buffers(m_queue.capacity() + resolveThreadCount(threads) + 2),
+        m_policy(policy){
+
+        threads = resolveThreadCount(threads);
+
+        //The rows come from glReadPixels, the writer flips them instead of a copy on the caller
+        stbi_flip_vertically_on_write(1);
+
+        m_threads.reserve(threads);
+        for (unsigned int i = 0; i < threads; i++)
+            m_threads.emplace_back(&PngEncoderPool::run, this);
+    }
+
+    PngEncoderPool::~PngEncoderPool(){
+        m_stop.store(true, std::memory_order_release);
+        m_pushes.fetch_add(1, std::memory_order_release);
+        m_pushes.notify_all();
+        for (std::thread& thread : m_threads)
+            thread.join();
+    }
+
+    void PngEncoderPool::reserveBuffers(size_t size){
+        while (m_free_buffers.size() < m_free_buffers.capacity()){
+            if (!m_free_buffers.tryPush(std::vector<uint8_t>(size)))
+                break;
+        }
+    }
+
+    std::vector<uint8_t> PngEncoderPool::acquireBuffer(size_t size){
+        std::vector<uint8_t> buffer;
+        m_free_buffers.tryPop(buffer);
+        buffer.resize(size);
+        return buffer;
+    }
+
+    bool PngEncoderPool::push(std::string path, int width, int height, std::vector<uint8_t>&& pixels){
+        Image image{ std::move(path), width, height, std::move(pixels) };
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+
+        while (true){
+            //Read before trying, so a pop between the failed push and the wait still wakes it
+            uint32_t pops = m_pops.load(std::memory_order_acquire);
+            if (m_queue.tryPush(std::move(image)))
+                break;
+
+            if (m_policy == OverflowPolicy::DropNewest){
+                recycle(std::move(image.pixels));
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                finish();
+                return false;
+            }
+            if (m_policy == OverflowPolicy::DropOldest){
+                Image oldest;
+                if (m_queue.tryPop(oldest)){
+                    recycle(std::move(oldest.pixels));
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    finish();
+                }
+                continue;
+            }
+            m_pops.wait(pops, std::memory_order_acquire);
+        }
+
+        size_t depth = m_queue.size();
+        size_t peak = m_peak_depth.load(std::memory_order_relaxed);
+        while (depth > peak && !m_peak_depth.compare_exchange_weak(peak, depth, std::memory_order_relaxed));
+        PROFILE_COUNTER("png queue depth", depth);
+
+        m_pushes.fetch_add(1, std::memory_order_release);
+        m_pushes.notify_one();
+        return true;
+    }
+
+    void PngEncoderPool::wait(){
+        for (uint32_t pending = m_pending.load(std::memory_order_acquire); pending != 0; pending = m_pending.load(std::memory_order_acquire))
+            m_pending.wait(pending, std::memory_order_acquire);
+    }
+
+    void PngEncoderPool::run(){
+        PROFILE_THREAD_NAME("png encoder");
+        while (true){
+            //Read before trying, so a push between the failed pop and the wait still wakes it
+            uint32_t pushes = m_pushes.load(std::memory_order_acquire);
+            Image image;
+            if (!m_queue.tryPop(image)){
+                //Queued images are written before stopping
+                if (m_stop.load(std::memory_order_acquire))
+                    break;
+                m_pushes.wait(pushes, std::memory_order_acquire);
+                continue;
+            }
+            m_pops.fetch_add(1, std::memory_order_release);
+            m_pops.notify_all();
+
+            bool ok;
+            {
+                PROFILE_ZONE("encode png");
+                ok = stbi_write_png(image.path.c_str(), image.width, image.height, 3, image.pixels.data(), image.width * 3) != 0;
+            }
+            if (ok)
+                m_written.fetch_add(1, std::memory_order_relaxed);
+            else{
+                m_failed.fetch_add(1, std::memory_order_relaxed);
+                std::cerr << "PngEncoderPool: could not write " << image.path << std::endl;
+            }
+
+            recycle(std::move(image.pixels));
+            finish();
+        }
+    }
+
+    void PngEncoderPool::recycle(std::vector<uint8_t>&& pixels){
+        m_free_buffers.tryPush(std::move(pixels));
+    }
+
+    void PngEncoderPool::finish(){
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            m_pending.notify_all();
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef PNG_ENCODER_POOL_H
+#define PNG_ENCODER_POOL_H
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../jobs/bounded_queue.h"
+
+namespace recording{
+
+    /**
+     * @brief What push does when the queue of the encoders is full
+     */
+    enum class OverflowPolicy : uint8_t{
+        Block, /* Wait for an encoder to take an image, no frame is lost */
+        DropOldest, /* Discard the image that has waited the most, the recording keeps the latest frames */
+        DropNewest /* Discard the image being pushed, the recording keeps a continuous prefix */
+    };
+
+    /**
+     * @brief Writes RGB images as PNG files on a pool of threads. Images wait in a lock-free
+     * bounded queue, so a slow disk costs at most max_queued images of memory, and the pixel
+     * buffers go back to a lock-free free list once written so a recording does not allocate
+     * once it is running.
+     * @note Images are taken bottom row first, as glReadPixels returns them, and flipped by the
+     * PNG writer (stbi_flip_vertically_on_write, a global setting of stb_image_write)
+     */
+    class PngEncoderPool{
+    private:
+        /**
+         * @brief Image waiting to be written
+         */
+        struct Image{
+            std::string path;
+            int width = 0;
+            int height = 0;
+            std::vector<uint8_t> pixels;
+        };
+
+        std::vector<std::thread> m_threads;
+        jobs::BoundedQueue<Image> m_queue;
+        jobs::BoundedQueue<std::vector<uint8_t>> m_free_buffers; /* Pixels of written or dropped images, reused */
+        OverflowPolicy m_policy;
+
+        std::atomic<uint32_t> m_pushes{0}; /* Bumped on every push, the idle encoders wait on it */
+        std::atomic<uint32_t> m_pops{0}; /* Bumped on every pop, a blocked push waits on it */
+        std::atomic<uint32_t> m_pending{0}; /* Images queued or being written, wait() waits on it */
+        std::atomic<bool> m_stop{false};
+
+        std::atomic<uint64_t> m_written{0};
+        std::atomic<uint64_t> m_failed{0};
+        std::atomic<uint64_t> m_dropped{0};
+        std::atomic<size_t> m_peak_depth{0};
+
+    public:
+        /**
+         * @brief Constructor, starts the threads
+         * @param threads encoder threads (0 uses half of the hardware threads, so the simulation keeps the rest)
+         * @param max_queued images that can wait for a thread before the overflow policy applies
+         * @param policy what push does when max_queued images are already waiting
+         */
+        explicit PngEncoderPool(unsigned int threads = 0, unsigned int max_queued = 16, OverflowPolicy policy = OverflowPolicy::Block);
+
+        /**
+         * @brief Destructor, writes the queued images and stops the threads
+         */
+        ~PngEncoderPool();
+
+        PngEncoderPool(const PngEncoderPool&) = delete;
+        PngEncoderPool& operator=(const PngEncoderPool&) = delete;
+
+        /**
+         * @brief Fills the free list with buffers for every image the pool can hold (queued or
+         * being written), so the first frames of a recording do not allocate either
+         * @param size bytes of an image (width * height * 3)
+         */
+        void reserveBuffers(size_t size);
+
+        /**
+         * @brief Gets a buffer for the pixels of the next image, reusing the one of a written image if possible
+         * @param size bytes of the image (width * height * 3)
+         */
+        std::vector<uint8_t> acquireBuffer(size_t size);
+
+        /**
+         * @brief Queues an image. When max_queued images are already waiting it blocks or drops
+         * an image, as the overflow policy says
+         * @param path PNG file to write (its folder must exist)
+         * @param pixels RGB rows of width * 3 bytes, bottom row first
+         * @return false if the pushed image was dropped
+         */
+        bool push(std::string path, int width, int height, std::vector<uint8_t>&& pixels);
+
+        /**
+         * @brief Waits until every queued image is written
+         */
+        void wait();
+
+        /**
+         * @brief Gets the number of encoder threads
+         */
+        inline unsigned int getThreadCount() const { return static_cast<unsigned int>(m_threads.size()); }
+
+        /**
+         * @brief Gets the overflow policy
+         */
+        inline OverflowPolicy getPolicy() const { return m_policy; }
+
+        /**
+         * @brief Gets the number of images waiting for an encoder right now
+         */
+        inline size_t getQueueDepth() const { return m_queue.size(); }
+
+        /**
+         * @brief Gets the largest number of images that have waited at once
+         */
+        inline size_t getPeakQueueDepth() const { return m_peak_depth.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Gets the number of images the queue holds
+         */
+        inline size_t getQueueCapacity() const { return m_queue.capacity(); }
+
+        /**
+         * @brief Gets the number of images written so far
+         */
+        inline uint64_t getWrittenCount() const { return m_written.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Gets the number of images that could not be written
+         */
+        inline uint64_t getFailedCount() const { return m_failed.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Gets the number of images discarded by the overflow policy
+         */
+        inline uint64_t getDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        /**
+         * @brief Loop of the encoder threads
+         */
+        void run();
+
+        /**
+         * @brief Hands the pixels of an image back to the free list (freed if the list is full)
+         */
+        void recycle(std::vector<uint8_t>&& pixels);
+
+        /**
+         * @brief Counts an image that will not be written and wakes wait() if it was the last one
+         */
+        void finish();
+    };
+}
+
+
+#endif // PNG_ENCODER_POOL_H
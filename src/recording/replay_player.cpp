@@ -0,0 +1,240 @@
+#include "replay_player.h"
+
+#include <cmath>
+#include <iostream>
+
+#include "../gl_check.h"
+#include "../profiling/cpu_profiler.h"
+
+namespace recording{
+
+    ReplayPlayer::~ReplayPlayer(){
+        close();
+    }
+
+    bool ReplayPlayer::open(const std::string& path){
+        close();
+
+        if (!m_reader.open(path))
+            return false;
+        if (m_reader.getFrameCount() == 0){
+            std::cerr << "ReplayPlayer: " << path << " has no frames" << std::endl;
+            m_reader.close();
+            return false;
+        }
+
+        m_desc = m_reader.getDesc();
+        m_frame_count = m_reader.getFrameCount();
+        m_body_count = m_reader.getBodyCount();
+        m_frame_time = m_desc.delta_time > 0.0f ? m_desc.delta_time : 1.0 / 60.0;
+
+        //Written by the worker while the gpu may read other slots, coherent so no flush is needed
+        const GLsizeiptr size = static_cast<GLsizeiptr>(m_body_count) * sizeof(glm::mat4);
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        for (Slot& slot : m_slots){
+            GLCall(glGenBuffers(1, &slot.buffer));
+            GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer));
+            GLCall(glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, flags));
+            GLCall(slot.data = static_cast<glm::mat4*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, size, flags)));
+            if (!slot.data){
+                std::cerr << "ReplayPlayer: could not map " << size << " bytes for the frames" << std::endl;
+                GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+                close();
+                return false;
+            }
+        }
+        GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+
+        //The first frame is decoded here, so there is always a frame to draw
+        if (!m_reader.readFrame(0, m_slots[0].data)){
+            close();
+            return false;
+        }
+        m_slots[0].frame = 0;
+        m_slots[0].state = SlotState::Displayed;
+        m_current = 0;
+
+        m_time = 0.0;
+        m_next_request = 1;
+        m_late_frames = 0;
+        m_stop = false;
+        m_requests.clear();
+        m_decoded.clear();
+        m_worker = std::thread(&ReplayPlayer::run, this);
+        return true;
+    }
+
+    void ReplayPlayer::close(){
+        if (m_worker.joinable()){
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_requested.notify_one();
+            m_worker.join();
+        }
+
+        //Deleting a buffer the gpu still reads is deferred by GL, no need to wait for the fences
+        for (Slot& slot : m_slots){
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            if (slot.buffer){
+                if (slot.data){
+                    GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer));
+                    GLCall(glUnmapBuffer(GL_SHADER_STORAGE_BUFFER));
+                    GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+                }
+                GLCall(glDeleteBuffers(1, &slot.buffer));
+            }
+            slot = Slot();
+        }
+
+        m_reader.close();
+        m_current = -1;
+        m_frame_count = 0;
+        m_body_count = 0;
+    }
+
+    void ReplayPlayer::update(float delta_time){
+        if (!isOpen())
+            return;
+
+        PROFILE_ZONE("replay update");
+
+        if (!m_paused)
+            m_time += static_cast<double>(delta_time) * m_rate;
+
+        double duration = m_frame_count * m_frame_time;
+        if (m_time >= duration){
+            if (m_loop){
+                m_time = std::fmod(m_time, duration);
+                restart(getTargetFrame());
+            }
+            else{
+                m_time = (m_frame_count - 1) * m_frame_time;
+                m_paused = true;
+            }
+        }
+        uint32_t target = getTargetFrame();
+
+        //Frames finished by the worker
+        std::vector<std::pair<unsigned int, bool>> decoded;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            decoded.swap(m_decoded);
+        }
+        for (const auto& [slot, ok] : decoded)
+            m_slots[slot].state = ok ? SlotState::Ready : SlotState::Free;
+
+        //Show the newest decoded frame that is not ahead of the clock
+        int best = -1;
+        for (unsigned int i = 0; i < C_SLOTS; i++)
+            if (m_slots[i].state == SlotState::Ready && m_slots[i].frame <= target && (best < 0 || m_slots[i].frame > m_slots[best].frame))
+                best = static_cast<int>(i);
+
+        if (best >= 0 && (m_current < 0 || m_slots[best].frame > m_slots[m_current].frame || m_slots[m_current].frame > target)){
+            if (m_current >= 0)
+                retire(m_current);
+            m_slots[best].state = SlotState::Displayed;
+            m_current = best;
+        }
+
+        uint32_t shown = getFrame();
+        if (shown != target)
+            m_late_frames++;
+
+        //Frames decoded too late to be shown, and slots the gpu is done with
+        for (Slot& slot : m_slots){
+            if (slot.state == SlotState::Ready && slot.frame < shown)
+                slot.state = SlotState::Free;
+
+            if (slot.state == SlotState::Retiring){
+                GLenum status = glClientWaitSync(slot.fence, 0, 0);
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED){
+                    glDeleteSync(slot.fence);
+                    slot.fence = nullptr;
+                    slot.state = SlotState::Free;
+                }
+            }
+        }
+
+        //Never ask for frames the clock already passed
+        uint32_t first = shown == target ? target + 1 : target;
+        if (m_next_request < first)
+            m_next_request = first;
+
+        bool requested = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (unsigned int i = 0; i < C_SLOTS && m_next_request < m_frame_count; i++){
+                if (m_slots[i].state != SlotState::Free)
+                    continue;
+                m_slots[i].state = SlotState::Decoding;
+                m_slots[i].frame = m_next_request++;
+                m_requests.emplace_back(i, m_slots[i].frame);
+                requested = true;
+            }
+        }
+        if (requested)
+            m_requested.notify_one();
+    }
+
+    void ReplayPlayer::bindRenderState() const{
+        if (m_current < 0)
+            return;
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_slots[m_current].buffer));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, m_slots[m_current].buffer));
+    }
+
+    void ReplayPlayer::seek(uint32_t frame){
+        if (!isOpen())
+            return;
+        if (frame >= m_frame_count)
+            frame = m_frame_count - 1;
+        m_time = frame * m_frame_time;
+        restart(frame);
+    }
+
+    void ReplayPlayer::run(){
+        PROFILE_THREAD_NAME("replay decoder");
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true){
+            m_requested.wait(lock, [this]{ return m_stop || !m_requests.empty(); });
+            if (m_stop)
+                break;
+
+            auto [slot, frame] = m_requests.front();
+            m_requests.pop_front();
+            glm::mat4* data = m_slots[slot].data;
+            lock.unlock(); //Unlock while decoding
+
+            bool ok;
+            {
+                PROFILE_ZONE("decode replay frame");
+                ok = m_reader.readFrame(frame, data);
+            }
+
+            lock.lock();
+            m_decoded.emplace_back(slot, ok);
+        }
+    }
+
+    uint32_t ReplayPlayer::getTargetFrame() const{
+        double frame = std::floor(m_time / m_frame_time);
+        if (frame <= 0.0)
+            return 0;
+        return frame >= m_frame_count - 1 ? m_frame_count - 1 : static_cast<uint32_t>(frame);
+    }
+
+    void ReplayPlayer::restart(uint32_t frame){
+        for (Slot& slot : m_slots)
+            if (slot.state == SlotState::Ready)
+                slot.state = SlotState::Free;
+        m_next_request = frame;
+    }
+
+    void ReplayPlayer::retire(unsigned int slot){
+        m_slots[slot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_slots[slot].state = SlotState::Retiring;
+    }
+}
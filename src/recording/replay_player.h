@@ -0,0 +1,196 @@
+#ifndef REPLAY_PLAYER_H
+#define REPLAY_PLAYER_H
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+#include "trajectory.h"
+#include "trajectory_reader.h"
+
+namespace recording{
+
+    /**
+     * @brief Plays a recorded trajectory into the transform buffer of the renderer (binding point 1)
+     * without simulating. The file is memory mapped and a worker thread decodes the next frames
+     * straight into a ring of persistently mapped buffers, so the render thread only binds the
+     * newest decoded frame. Playback runs on the clock of update(), whatever the simulation cost
+     * of the recording was.
+     * @note Every method runs on the thread that owns the OpenGL context
+     */
+    class ReplayPlayer{
+    private:
+        enum class SlotState{
+            Free,      /* Can receive a frame */
+            Decoding,  /* Being written by the worker */
+            Ready,     /* Holds a decoded frame */
+            Displayed, /* Bound for drawing */
+            Retiring   /* Was displayed, waits for the draws that read it */
+        };
+
+        /**
+         * @brief Buffer with the transforms of one frame
+         */
+        struct Slot{
+            GLuint buffer = 0;
+            glm::mat4* data = nullptr; /* Persistent coherent mapping of the buffer */
+            GLsync fence = nullptr; /* Retiring: signaled once the gpu is done with the slot */
+            uint32_t frame = 0;
+            SlotState state = SlotState::Free;
+        };
+
+        static constexpr unsigned int C_SLOTS = 4; /* Displayed, retiring and two being decoded ahead */
+
+        TrajectoryReader m_reader; /* Used by the worker once playing */
+        TrajectoryDesc m_desc;
+        Slot m_slots[C_SLOTS];
+        int m_current = -1; /* Displayed slot */
+
+        std::thread m_worker;
+        std::mutex m_mutex;
+        std::condition_variable m_requested;
+        std::deque<std::pair<unsigned int, uint32_t>> m_requests; /* Slot and frame to decode */
+        std::vector<std::pair<unsigned int, bool>> m_decoded; /* Slot and whether it decoded */
+        bool m_stop = false;
+
+        //Playback
+        uint32_t m_frame_count = 0;
+        uint32_t m_body_count = 0;
+        double m_frame_time = 1.0 / 60.0; /* Recorded time between frames */
+        double m_time = 0.0; /* Position in the recording, in seconds */
+        float m_rate = 1.0f;
+        bool m_paused = false;
+        bool m_loop = true;
+        uint32_t m_next_request = 0; /* Next frame to give to the worker */
+        uint64_t m_late_frames = 0; /* Updates that could not show the frame of the clock yet */
+
+    public:
+        ReplayPlayer() = default;
+
+        /**
+         * @brief Destructor, stops the worker and frees the buffers
+         */
+        ~ReplayPlayer();
+
+        ReplayPlayer(const ReplayPlayer&) = delete;
+        ReplayPlayer& operator=(const ReplayPlayer&) = delete;
+
+        /**
+         * @brief Opens a trajectory, shows its first frame and starts decoding the next ones
+         * @return false if the file is not a valid trajectory or the buffers could not be mapped
+         */
+        bool open(const std::string& path);
+
+        /**
+         * @brief Stops the worker, frees the buffers and closes the file
+         */
+        void close();
+
+        /**
+         * @brief Advances the playback clock, shows the newest decoded frame up to the clock and
+         * hands free buffers to the worker (never waits for the worker or the gpu)
+         * @param delta_time wall time since the last update, in seconds
+         */
+        void update(float delta_time);
+
+        /**
+         * @brief Binds the displayed frame to binding point 1 (and 12, the previous step of the
+         * interpolating shaders, so they draw it as it is)
+         */
+        void bindRenderState() const;
+
+        /**
+         * @brief Jumps to a frame. The current frame stays on screen until the new one is decoded
+         */
+        void seek(uint32_t frame);
+
+        /**
+         * @brief Tells whether a trajectory is playing
+         */
+        inline bool isOpen() const { return m_worker.joinable(); }
+
+        /**
+         * @brief Sets the playback speed (1 is the recorded speed)
+         */
+        inline void setRate(float rate) { m_rate = rate > 0.0f ? rate : 0.0f; }
+
+        /**
+         * @brief Gets the playback speed
+         */
+        inline float getRate() const { return m_rate; }
+
+        /**
+         * @brief Stops or resumes the playback clock
+         */
+        inline void setPaused(bool paused) { m_paused = paused; }
+
+        /**
+         * @brief Tells whether the playback clock is stopped
+         */
+        inline bool isPaused() const { return m_paused; }
+
+        /**
+         * @brief If true playback starts over at the end, otherwise it pauses on the last frame
+         */
+        inline void setLoop(bool loop) { m_loop = loop; }
+
+        /**
+         * @brief Gets the frame on screen
+         */
+        inline uint32_t getFrame() const { return m_current >= 0 ? m_slots[m_current].frame : 0; }
+
+        /**
+         * @brief Gets the number of frames of the trajectory
+         */
+        inline uint32_t getFrameCount() const { return m_frame_count; }
+
+        /**
+         * @brief Gets the number of bodies (instances to draw)
+         */
+        inline uint32_t getBodyCount() const { return m_body_count; }
+
+        /**
+         * @brief Gets the shapes, bodies and settings of the trajectory
+         */
+        inline const TrajectoryDesc& getDesc() const { return m_desc; }
+
+        /**
+         * @brief Gets the number of updates that showed an older frame than the clock asked for
+         */
+        inline uint64_t getLateFrames() const { return m_late_frames; }
+
+    private:
+        /**
+         * @brief Loop of the worker thread
+         */
+        void run();
+
+        /**
+         * @brief Gets the frame of the playback clock
+         */
+        uint32_t getTargetFrame() const;
+
+        /**
+         * @brief Drops the frames decoded ahead and requests frames from a new position
+         */
+        void restart(uint32_t frame);
+
+        /**
+         * @brief Fences a slot that stops being displayed, it is freed once the gpu passes the fence
+         */
+        void retire(unsigned int slot);
+    };
+}
+
+
+#endif // REPLAY_PLAYER_H
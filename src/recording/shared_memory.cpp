@@ -0,0 +1,187 @@
+#include "shared_memory.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace recording{
+
+    SharedMemory::~SharedMemory(){
+        close();
+    }
+
+#ifdef _WIN32
+
+    namespace{
+        /**
+         * @brief Name of the mapping in the session namespace
+         */
+        std::string getMappingName(const std::string& name){
+            return "Local\\" + name;
+        }
+    }
+
+    bool SharedMemory::create(const std::string& name, size_t size){
+        close();
+
+        //Pages of the page file start zero filled. A mapping left by another process that is still
+        //running is reused, there is no way to remove its name
+        uint64_t bytes = size;
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                            static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), getMappingName(name).c_str());
+        if (!mapping){
+            std::cerr << "SharedMemory: could not create " << name << std::endl;
+            return false;
+        }
+        if (GetLastError() == ERROR_ALREADY_EXISTS){
+            std::cerr << "SharedMemory: " << name << " is still open in another process" << std::endl;
+            CloseHandle(mapping);
+            return false;
+        }
+
+        void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if (!data){
+            std::cerr << "SharedMemory: could not map " << name << std::endl;
+            CloseHandle(mapping);
+            return false;
+        }
+
+        m_mapping = mapping;
+        m_data = static_cast<uint8_t*>(data);
+        m_size = size;
+        m_name = name;
+        m_owner = true;
+        return true;
+    }
+
+    bool SharedMemory::open(const std::string& name, bool writable){
+        close();
+
+        DWORD access = writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ;
+        HANDLE mapping = OpenFileMappingA(access, FALSE, getMappingName(name).c_str());
+        if (!mapping)
+            return false;
+
+        void* data = MapViewOfFile(mapping, access, 0, 0, 0);
+        MEMORY_BASIC_INFORMATION info;
+        if (!data || VirtualQuery(data, &info, sizeof(info)) == 0){
+            if (data)
+                UnmapViewOfFile(data);
+            CloseHandle(mapping);
+            return false;
+        }
+
+        m_mapping = mapping;
+        m_data = static_cast<uint8_t*>(data);
+        m_size = info.RegionSize;
+        m_name = name;
+        m_owner = false;
+        return true;
+    }
+
+    void SharedMemory::close(){
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        m_data = nullptr;
+        m_mapping = nullptr;
+        m_size = 0;
+        m_owner = false;
+    }
+
+#else
+
+    namespace{
+        /**
+         * @brief Name of the object for shm_open, which wants a leading slash
+         */
+        std::string getObjectName(const std::string& name){
+            return "/" + name;
+        }
+    }
+
+    bool SharedMemory::create(const std::string& name, size_t size){
+        close();
+
+        //A block with this name was left by a process that did not close it, start a new one.
+        //Readers that still map the old one keep it until they reopen
+        std::string object = getObjectName(name);
+        shm_unlink(object.c_str());
+
+        int file = shm_open(object.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (file < 0){
+            std::cerr << "SharedMemory: could not create " << name << std::endl;
+            return false;
+        }
+
+        //ftruncate fills the new pages with zeros
+        if (ftruncate(file, static_cast<off_t>(size)) != 0){
+            std::cerr << "SharedMemory: could not allocate " << size << " bytes for " << name << std::endl;
+            ::close(file);
+            shm_unlink(object.c_str());
+            return false;
+        }
+
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        ::close(file);
+        if (data == MAP_FAILED){
+            std::cerr << "SharedMemory: could not map " << name << std::endl;
+            shm_unlink(object.c_str());
+            return false;
+        }
+
+        m_data = static_cast<uint8_t*>(data);
+        m_size = size;
+        m_name = name;
+        m_owner = true;
+        return true;
+    }
+
+    bool SharedMemory::open(const std::string& name, bool writable){
+        close();
+
+        int file = shm_open(getObjectName(name).c_str(), writable ? O_RDWR : O_RDONLY, 0);
+        if (file < 0)
+            return false;
+
+        struct stat info;
+        if (fstat(file, &info) != 0 || info.st_size == 0){
+            ::close(file);
+            return false;
+        }
+
+        //The mapping keeps the object alive, the descriptor is not needed anymore
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+        ::close(file);
+        if (data == MAP_FAILED)
+            return false;
+
+        m_data = static_cast<uint8_t*>(data);
+        m_size = static_cast<size_t>(info.st_size);
+        m_name = name;
+        m_owner = false;
+        return true;
+    }
+
+    void SharedMemory::close(){
+        if (m_data)
+            munmap(m_data, m_size);
+        if (m_owner)
+            shm_unlink(getObjectName(m_name).c_str());
+        m_data = nullptr;
+        m_size = 0;
+        m_owner = false;
+    }
+
+#endif
+}
@@ -0,0 +1,82 @@
+#ifndef SHARED_MEMORY_H
+#define SHARED_MEMORY_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace recording{
+
+    /**
+     * @brief Named block of memory shared between processes (POSIX shm_open, or a named file
+     * mapping backed by the page file on Windows). One process creates it, the others open it by
+     * its name, read only unless they also write to it
+     */
+    class SharedMemory{
+    private:
+        uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+        std::string m_name; /* Name given to create or open, without the platform prefix */
+        bool m_owner = false; /* Created by this process, the name is removed on close */
+#ifdef _WIN32
+        void* m_mapping = nullptr;
+#endif
+
+    public:
+        SharedMemory() = default;
+
+        /**
+         * @brief Destructor, unmaps the memory (and removes the name if this process created it)
+         */
+        ~SharedMemory();
+
+        SharedMemory(const SharedMemory&) = delete;
+        SharedMemory& operator=(const SharedMemory&) = delete;
+
+        /**
+         * @brief Creates a zero filled block, replacing a block with the same name left by a process that died
+         * @param name name of the block (letters, digits, '_' and '-')
+         * @param size bytes of the block
+         * @return false if the block could not be created or mapped
+         */
+        bool create(const std::string& name, size_t size);
+
+        /**
+         * @brief Maps a block created by another process
+         * @param writable map it for writing too (read only otherwise)
+         * @return false if there is no block with that name or it could not be mapped
+         */
+        bool open(const std::string& name, bool writable = false);
+
+        /**
+         * @brief Unmaps the block. The creator also removes its name, the processes that still
+         * have it mapped keep their view
+         */
+        void close();
+
+        /**
+         * @brief Tells whether a block is mapped
+         */
+        inline bool isOpen() const { return m_data != nullptr; }
+
+        /**
+         * @brief Gets the first byte of the block (only writable if this process created it or opened it writable)
+         */
+        inline uint8_t* getData() const { return m_data; }
+
+        /**
+         * @brief Gets the size of the block in bytes
+         */
+        inline size_t getSize() const { return m_size; }
+
+        /**
+         * @brief Gets the name of the block
+         */
+        inline const std::string& getName() const { return m_name; }
+    };
+}
+
+
+#endif // SHARED_MEMORY_H
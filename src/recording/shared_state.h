@@ -0,0 +1,103 @@
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Layout of the shared memory block where a simulator publishes the state of its bodies after
+ * every step, for other processes to read without copies through files or sockets.
+ *
+ *  SharedStateHeader                         at 0
+ *  slot 0, slot 1 ... slot slot_count - 1    at slot_offset + i * slot_stride
+ *
+ * A slot is a SharedStateSlot followed by C_STATE_ARRAY_COUNT arrays of max_bodies floats (SoA),
+ * the first at C_SHARED_STATE_ALIGNMENT from the start of the slot and the next ones array_stride
+ * bytes apart. The publisher fills the slots round robin, publication p (counting from 1) lives in
+ * slot (p - 1) % slot_count.
+ *
+ * Each slot is guarded by a sequence lock: its sequence is odd while the publisher writes it and
+ * even once it is complete. A reader loads the sequence, reads the slot and loads the sequence
+ * again; the read is valid if both are equal and even. The publisher never waits for readers and
+ * readers never write, so the block is mapped read only by them.
+ */
+
+namespace recording{
+
+    constexpr uint32_t C_SHARED_STATE_MAGIC = 0x54534850; /* "PHST" */
+    constexpr uint32_t C_SHARED_STATE_VERSION = 1;
+    constexpr size_t C_SHARED_STATE_ALIGNMENT = 64; /* Cache line, every slot and array starts at a multiple of it */
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "The counters of the shared state must be lock free to work across processes");
+
+    /**
+     * @brief Arrays of a slot, one float per body each
+     */
+    enum class StateArray : uint32_t{
+        PositionX = 0,
+        PositionY,
+        PositionZ,
+        OrientationX, /* Unit quaternion, without the scale of the body */
+        OrientationY,
+        OrientationZ,
+        OrientationW,
+        Count
+    };
+
+    constexpr uint32_t C_STATE_ARRAY_COUNT = static_cast<uint32_t>(StateArray::Count);
+
+    struct SharedStateHeader{
+        std::atomic<uint32_t> magic; /* Stored last by the publisher, readers wait for it */
+        uint32_t version;
+        uint32_t slot_count;
+        uint32_t max_bodies; /* Bodies that fit in a slot */
+        uint64_t slot_offset; /* Bytes from the start of the block to the first slot */
+        uint64_t slot_stride; /* Bytes between two slots */
+        uint64_t array_stride; /* Bytes between two arrays of a slot */
+        std::atomic<uint64_t> published; /* Publications so far, the newest one is complete */
+        std::atomic<uint32_t> closed; /* 1 once the publisher is gone, nothing else is published */
+        uint32_t padding;
+    };
+
+    struct SharedStateSlot{
+        std::atomic<uint64_t> sequence; /* Odd while the publisher writes the slot */
+        uint64_t step; /* Step of the simulator the state belongs to */
+        double time; /* Simulated seconds at the end of the step */
+        uint32_t body_count;
+        uint32_t padding;
+    };
+
+    static_assert(sizeof(SharedStateHeader) <= C_SHARED_STATE_ALIGNMENT && sizeof(SharedStateSlot) <= C_SHARED_STATE_ALIGNMENT,
+                  "The headers of the shared state must fit in a cache line");
+
+    /**
+     * @brief Sizes of a block for a number of bodies and slots
+     */
+    struct SharedStateLayout{
+        uint64_t slot_offset;
+        uint64_t slot_stride;
+        uint64_t array_stride;
+        uint64_t size; /* Bytes of the whole block */
+    };
+
+    /**
+     * @brief Computes where the slots and arrays of a block go
+     */
+    inline SharedStateLayout computeSharedStateLayout(uint32_t max_bodies, uint32_t slot_count){
+        auto align = [](uint64_t bytes){ return (bytes + C_SHARED_STATE_ALIGNMENT - 1) / C_SHARED_STATE_ALIGNMENT * C_SHARED_STATE_ALIGNMENT; };
+
+        SharedStateLayout layout;
+        layout.slot_offset = C_SHARED_STATE_ALIGNMENT;
+        layout.array_stride = align(static_cast<uint64_t>(max_bodies) * sizeof(float));
+        layout.slot_stride = C_SHARED_STATE_ALIGNMENT + C_STATE_ARRAY_COUNT * layout.array_stride;
+        layout.size = layout.slot_offset + slot_count * layout.slot_stride;
+        return layout;
+    }
+}
+
+
+#endif // SHARED_STATE_H
@@ -0,0 +1,98 @@
+#include "state_publisher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "glm/gtc/quaternion.hpp"
+#include "../profiling/cpu_profiler.h"
+
+namespace recording{
+
+    StatePublisher::~StatePublisher(){
+        close();
+    }
+
+    bool StatePublisher::open(const std::string& name, unsigned int max_bodies, unsigned int slots){
+        close();
+
+        slots = std::max(slots, 1u);
+        SharedStateLayout layout = computeSharedStateLayout(max_bodies, slots);
+        if (!m_memory.create(name, layout.size))
+            return false;
+
+        //The block starts zero filled, the magic goes last so readers never see a partial header
+        SharedStateHeader* header = reinterpret_cast<SharedStateHeader*>(m_memory.getData());
+        header->version = C_SHARED_STATE_VERSION;
+        header->slot_count = slots;
+        header->max_bodies = max_bodies;
+        header->slot_offset = layout.slot_offset;
+        header->slot_stride = layout.slot_stride;
+        header->array_stride = layout.array_stride;
+        header->published.store(0, std::memory_order_relaxed);
+        header->closed.store(0, std::memory_order_relaxed);
+        header->magic.store(C_SHARED_STATE_MAGIC, std::memory_order_release);
+
+        m_header = header;
+        m_published = 0;
+        m_truncated = false;
+        return true;
+    }
+
+    void StatePublisher::close(){
+        if (m_header)
+            m_header->closed.store(1, std::memory_order_release);
+        m_header = nullptr;
+        m_memory.close();
+    }
+
+    void StatePublisher::publish(uint64_t step, double time, const std::vector<glm::mat4>& transforms){
+        if (!m_header)
+            return;
+
+        PROFILE_ZONE("publish shared state");
+        uint32_t count = static_cast<uint32_t>(std::min<size_t>(transforms.size(), m_header->max_bodies));
+        if (count < transforms.size() && !m_truncated){
+            std::cerr << "StatePublisher: " << transforms.size() << " bodies do not fit in " << getName()
+                      << ", only the first " << count << " are published" << std::endl;
+            m_truncated = true;
+        }
+
+        uint8_t* slot_data = m_memory.getData() + m_header->slot_offset + (m_published % m_header->slot_count) * m_header->slot_stride;
+        SharedStateSlot* slot = reinterpret_cast<SharedStateSlot*>(slot_data);
+        auto array = [&](StateArray id){
+            return reinterpret_cast<float*>(slot_data + C_SHARED_STATE_ALIGNMENT + static_cast<uint32_t>(id) * m_header->array_stride);
+        };
+        float* position_x = array(StateArray::PositionX);
+        float* position_y = array(StateArray::PositionY);
+        float* position_z = array(StateArray::PositionZ);
+        float* orientation_x = array(StateArray::OrientationX);
+        float* orientation_y = array(StateArray::OrientationY);
+        float* orientation_z = array(StateArray::OrientationZ);
+        float* orientation_w = array(StateArray::OrientationW);
+
+        //Odd sequence: readers that catch the slot now discard what they read
+        uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot->step = step;
+        slot->time = time;
+        slot->body_count = count;
+        for (uint32_t i = 0; i < count; i++){
+            const glm::mat4& transform = transforms[i];
+            position_x[i] = transform[3].x;
+            position_y[i] = transform[3].y;
+            position_z[i] = transform[3].z;
+
+            glm::mat3 rotation(glm::normalize(glm::vec3(transform[0])), glm::normalize(glm::vec3(transform[1])), glm::normalize(glm::vec3(transform[2])));
+            glm::quat quaternion = glm::normalize(glm::quat_cast(rotation));
+            orientation_x[i] = quaternion.x;
+            orientation_y[i] = quaternion.y;
+            orientation_z[i] = quaternion.z;
+            orientation_w[i] = quaternion.w;
+        }
+
+        slot->sequence.store(sequence + 2, std::memory_order_release);
+        m_header->published.store(++m_published, std::memory_order_release);
+    }
+}
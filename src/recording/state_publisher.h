@@ -0,0 +1,89 @@
+#ifndef STATE_PUBLISHER_H
+#define STATE_PUBLISHER_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "shared_memory.h"
+#include "shared_state.h"
+
+namespace recording{
+
+    /**
+     * @brief Publishes the positions and orientations of the bodies after every step into a ring
+     * of slots in shared memory (see shared_state.h), where StateReader picks them up from other
+     * processes. Publishing never waits for the readers
+     * @note Every method runs on the thread that steps the simulator
+     */
+    class StatePublisher{
+    private:
+        static constexpr uint32_t C_DEFAULT_SLOTS = 4;
+
+        SharedMemory m_memory;
+        SharedStateHeader* m_header = nullptr;
+        uint64_t m_published = 0;
+        bool m_truncated = false; /* A step had more bodies than fit, reported once */
+
+    public:
+        StatePublisher() = default;
+
+        /**
+         * @brief Destructor, closes the block
+         */
+        ~StatePublisher();
+
+        StatePublisher(const StatePublisher&) = delete;
+        StatePublisher& operator=(const StatePublisher&) = delete;
+
+        /**
+         * @brief Creates the shared memory block
+         * @param name name the readers open it by
+         * @param max_bodies bodies that fit in a slot, the rest of a larger step is not published
+         * @param slots publications kept at once, more give slow readers more time to copy a slot
+         * @return false if the block could not be created
+         */
+        bool open(const std::string& name, unsigned int max_bodies, unsigned int slots = C_DEFAULT_SLOTS);
+
+        /**
+         * @brief Tells the readers nothing else is coming and removes the block (readers keep their mapping)
+         */
+        void close();
+
+        /**
+         * @brief Tells whether the block is open
+         */
+        inline bool isOpen() const { return m_header != nullptr; }
+
+        /**
+         * @brief Publishes the state of the bodies after a step, straight into the next slot
+         * @param step step of the simulator
+         * @param time simulated seconds at the end of the step
+         * @param transforms transform of each body (may have a scale)
+         */
+        void publish(uint64_t step, double time, const std::vector<glm::mat4>& transforms);
+
+        /**
+         * @brief Gets the number of publications so far
+         */
+        inline uint64_t getPublishedCount() const { return m_published; }
+
+        /**
+         * @brief Gets the name of the block
+         */
+        inline const std::string& getName() const { return m_memory.getName(); }
+
+        /**
+         * @brief Gets the number of bodies that fit in a slot
+         */
+        inline unsigned int getMaxBodies() const { return m_header ? m_header->max_bodies : 0; }
+    };
+}
+
+
+#endif // STATE_PUBLISHER_H
@@ -0,0 +1,50 @@
+#include "state_reader.h"
+
+#include <cstring>
+
+namespace recording{
+
+    bool StateReader::open(const std::string& name){
+        close();
+        if (!m_memory.open(name))
+            return false;
+
+        //A block still being set up has no magic yet, the caller tries again later
+        const SharedStateHeader* header = reinterpret_cast<const SharedStateHeader*>(m_memory.getData());
+        bool valid = m_memory.getSize() >= sizeof(SharedStateHeader)
+            && header->magic.load(std::memory_order_acquire) == C_SHARED_STATE_MAGIC
+            && header->version == C_SHARED_STATE_VERSION
+            && header->slot_count > 0;
+        if (valid){
+            SharedStateLayout layout = computeSharedStateLayout(header->max_bodies, header->slot_count);
+            valid = header->slot_offset == layout.slot_offset && header->slot_stride == layout.slot_stride
+                && header->array_stride == layout.array_stride && m_memory.getSize() >= layout.size;
+        }
+
+        if (!valid){
+            m_memory.close();
+            return false;
+        }
+
+        m_header = header;
+        m_torn_reads = 0;
+        return true;
+    }
+
+    void StateReader::close(){
+        m_header = nullptr;
+        m_memory.close();
+    }
+
+    bool StateReader::copyLatest(StateSnapshot& snapshot){
+        return readLatest([&snapshot](const StateView& view){
+            snapshot.step = view.step;
+            snapshot.time = view.time;
+            snapshot.body_count = view.body_count;
+            for (uint32_t a = 0; a < C_STATE_ARRAY_COUNT; a++){
+                snapshot.arrays[a].resize(view.body_count);
+                std::memcpy(snapshot.arrays[a].data(), view.arrays[a], view.body_count * sizeof(float));
+            }
+        });
+    }
+}
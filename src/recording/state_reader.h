@@ -0,0 +1,162 @@
+#ifndef STATE_READER_H
+#define STATE_READER_H
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "shared_memory.h"
+#include "shared_state.h"
+
+namespace recording{
+
+    /**
+     * @brief View of a published state, straight into the shared memory
+     */
+    struct StateView{
+        uint64_t step = 0;
+        double time = 0.0;
+        uint32_t body_count = 0;
+        const float* arrays[C_STATE_ARRAY_COUNT] = {}; /* body_count floats each, indexed by StateArray */
+
+        /**
+         * @brief Gets one of the arrays
+         */
+        inline const float* get(StateArray id) const { return arrays[static_cast<uint32_t>(id)]; }
+    };
+
+    /**
+     * @brief Copy of a published state
+     */
+    struct StateSnapshot{
+        uint64_t step = 0;
+        double time = 0.0;
+        uint32_t body_count = 0;
+        std::vector<float> arrays[C_STATE_ARRAY_COUNT]; /* body_count floats each, indexed by StateArray */
+
+        /**
+         * @brief Gets one of the arrays
+         */
+        inline const std::vector<float>& get(StateArray id) const { return arrays[static_cast<uint32_t>(id)]; }
+    };
+
+    /**
+     * @brief Reads the states a StatePublisher of another process publishes in shared memory. The
+     * block is mapped read only and polled without locks: a read that overlaps the publisher
+     * rewriting the slot is detected by the sequence of the slot and tried again on the newest one
+     * @note Not thread safe, use one reader per thread
+     */
+    class StateReader{
+    private:
+        static constexpr unsigned int C_READ_ATTEMPTS = 8; /* Torn reads in a row before giving up until the next poll */
+
+        SharedMemory m_memory;
+        const SharedStateHeader* m_header = nullptr;
+        uint64_t m_torn_reads = 0;
+
+    public:
+        StateReader() = default;
+
+        StateReader(const StateReader&) = delete;
+        StateReader& operator=(const StateReader&) = delete;
+
+        /**
+         * @brief Maps the block of a publisher
+         * @return false if there is no block with that name yet or it is not a valid state block
+         */
+        bool open(const std::string& name);
+
+        /**
+         * @brief Unmaps the block
+         */
+        void close();
+
+        /**
+         * @brief Tells whether a block is mapped
+         */
+        inline bool isOpen() const { return m_header != nullptr; }
+
+        /**
+         * @brief Gets the number of states published so far (a new state is there when it grows)
+         */
+        inline uint64_t getPublishedCount() const { return m_header ? m_header->published.load(std::memory_order_acquire) : 0; }
+
+        /**
+         * @brief Tells whether the publisher closed the block, nothing else will be published.
+         * A publisher that restarts creates a new block, open it again to follow it
+         */
+        inline bool isPublisherClosed() const { return m_header && m_header->closed.load(std::memory_order_acquire) != 0; }
+
+        /**
+         * @brief Gets the number of bodies that fit in a slot
+         */
+        inline unsigned int getMaxBodies() const { return m_header ? m_header->max_bodies : 0; }
+
+        /**
+         * @brief Gets the number of reads discarded because the publisher was rewriting the slot
+         */
+        inline uint64_t getTornReads() const { return m_torn_reads; }
+
+        /**
+         * @brief Reads the newest state without copying it. The visitor gets a view into the shared
+         * memory and must only copy from it: if the publisher rewrote the slot meanwhile, whatever it
+         * took is garbage, the visitor is called again on the newest state and only the last call counts
+         * @param visit callable taking a const StateView&
+         * @return false if nothing was published yet or every attempt was torn
+         */
+        template<typename F>
+        bool readLatest(F&& visit){
+            if (!m_header)
+                return false;
+
+            for (unsigned int attempt = 0; attempt < C_READ_ATTEMPTS; attempt++){
+                uint64_t published = m_header->published.load(std::memory_order_acquire);
+                if (published == 0)
+                    return false;
+
+                const uint8_t* slot_data = getSlotData(published - 1);
+                const SharedStateSlot* slot = reinterpret_cast<const SharedStateSlot*>(slot_data);
+                uint64_t before = slot->sequence.load(std::memory_order_acquire);
+                if (before % 2 == 0){
+                    StateView view;
+                    view.step = slot->step;
+                    view.time = slot->time;
+                    view.body_count = std::min(slot->body_count, m_header->max_bodies);
+                    for (uint32_t a = 0; a < C_STATE_ARRAY_COUNT; a++)
+                        view.arrays[a] = reinterpret_cast<const float*>(slot_data + C_SHARED_STATE_ALIGNMENT + a * m_header->array_stride);
+                    visit(static_cast<const StateView&>(view));
+
+                    //The reads of the visitor happen before the second load of the sequence
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (slot->sequence.load(std::memory_order_relaxed) == before)
+                        return true;
+                }
+                m_torn_reads++;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Copies the newest state
+         * @param snapshot receives the state (its vectors keep their capacity between calls)
+         * @return false if nothing was published yet or every attempt was torn
+         */
+        bool copyLatest(StateSnapshot& snapshot);
+
+    private:
+        /**
+         * @brief Gets the slot of a publication (counting from 0)
+         */
+        inline const uint8_t* getSlotData(uint64_t publication) const{
+            return m_memory.getData() + m_header->slot_offset + (publication % m_header->slot_count) * m_header->slot_stride;
+        }
+    };
+}
+
+
+#endif // STATE_READER_H
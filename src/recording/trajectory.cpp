@@ -0,0 +1,275 @@
+#include "trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "glm/gtc/quaternion.hpp"
+
+#include "block_compression.h"
+
+namespace recording{
+
+    namespace{
+
+        constexpr float C_SQRT_2 = 1.41421356f;
+
+        inline uint32_t zigzag(int32_t value){
+            return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+        }
+
+        inline int32_t unzigzag(uint32_t value){
+            return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1u)));
+        }
+
+        inline void writeVarint(uint32_t value, std::vector<uint8_t>& out){
+            while (value >= 0x80){
+                out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        inline bool readVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value){
+            value = 0;
+            for (unsigned int shift = 0; shift < 35; shift += 7){
+                if (data >= end)
+                    return false;
+                uint8_t byte = *data++;
+                value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        inline void append(std::vector<uint8_t>& out, const void* data, size_t size){
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            out.insert(out.end(), bytes, bytes + size);
+        }
+
+        /**
+         * @brief Reads consecutive values out of a block, failing once the block ends
+         */
+        struct Cursor{
+            const uint8_t* data;
+            size_t size;
+
+            bool read(void* value, size_t bytes){
+                if (bytes > size)
+                    return false;
+                std::memcpy(value, data, bytes);
+                data += bytes;
+                size -= bytes;
+                return true;
+            }
+        };
+    }
+
+    void TrajectoryCodec::setup(const TrajectoryDesc& desc){
+        m_bound_min = desc.bound_min;
+        m_bound_size = glm::max(desc.bound_max - desc.bound_min, glm::vec3(1e-6f));
+        m_position_steps = static_cast<float>((1u << desc.position_bits) - 1u);
+        m_rotation_steps = static_cast<float>((1u << desc.rotation_bits) - 1u);
+        m_scales = desc.body_scales;
+    }
+
+    QuantizedBody TrajectoryCodec::quantize(const glm::mat4& transform, unsigned int body, bool& clamped) const{
+        QuantizedBody state;
+
+        glm::vec3 position = (glm::vec3(transform[3]) - m_bound_min) / m_bound_size;
+        for (int axis = 0; axis < 3; axis++){
+            float value = position[axis];
+            if (!(value >= 0.0f && value <= 1.0f)){
+                clamped = true;
+                value = value > 1.0f ? 1.0f : 0.0f;
+            }
+            state.position[axis] = static_cast<int32_t>(std::lround(value * m_position_steps));
+        }
+
+        glm::vec3 scale = m_scales[body];
+        glm::mat3 rotation(
+            glm::vec3(transform[0]) / (scale.x != 0.0f ? scale.x : 1.0f),
+            glm::vec3(transform[1]) / (scale.y != 0.0f ? scale.y : 1.0f),
+            glm::vec3(transform[2]) / (scale.z != 0.0f ? scale.z : 1.0f)
+        );
+        glm::quat quaternion = glm::normalize(glm::quat_cast(rotation));
+        float components[4] = { quaternion.x, quaternion.y, quaternion.z, quaternion.w };
+
+        int largest = 0;
+        for (int i = 1; i < 4; i++)
+            if (std::fabs(components[i]) > std::fabs(components[largest]))
+                largest = i;
+
+        //q and -q are the same rotation, keep the dropped component positive
+        float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+        for (int i = 0, kept = 0; i < 4; i++){
+            if (i == largest)
+                continue;
+            float value = glm::clamp((components[i] * sign * C_SQRT_2 + 1.0f) * 0.5f, 0.0f, 1.0f);
+            state.rotation[kept++] = static_cast<int32_t>(std::lround(value * m_rotation_steps));
+        }
+        state.rotation[0] = (state.rotation[0] << 2) | largest;
+        return state;
+    }
+
+    glm::mat4 TrajectoryCodec::dequantize(const QuantizedBody& state, unsigned int body) const{
+        int largest = state.rotation[0] & 3;
+        int32_t quantized[3] = { state.rotation[0] >> 2, state.rotation[1], state.rotation[2] };
+
+        float components[4];
+        float sum = 0.0f;
+        for (int i = 0, kept = 0; i < 4; i++){
+            if (i == largest)
+                continue;
+            float value = (quantized[kept++] / m_rotation_steps * 2.0f - 1.0f) / C_SQRT_2;
+            components[i] = value;
+            sum += value * value;
+        }
+        components[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+
+        glm::quat quaternion(components[3], components[0], components[1], components[2]);
+        glm::mat4 transform = glm::mat4_cast(glm::normalize(quaternion));
+
+        glm::vec3 scale = m_scales[body];
+        transform[0] *= scale.x;
+        transform[1] *= scale.y;
+        transform[2] *= scale.z;
+
+        glm::vec3 position(state.position[0], state.position[1], state.position[2]);
+        transform[3] = glm::vec4(m_bound_min + position / m_position_steps * m_bound_size, 1.0f);
+        return transform;
+    }
+
+    void TrajectoryCodec::encodeFrame(const QuantizedBody* frame, const QuantizedBody* base, size_t count, std::vector<uint8_t>& out){
+        for (size_t i = 0; i < count; i++){
+            for (int j = 0; j < 3; j++)
+                writeVarint(zigzag(frame[i].position[j] - (base ? base[i].position[j] : 0)), out);
+            for (int j = 0; j < 3; j++)
+                writeVarint(zigzag(frame[i].rotation[j] - (base ? base[i].rotation[j] : 0)), out);
+        }
+    }
+
+    bool TrajectoryCodec::decodeFrame(const uint8_t* data, size_t size, const QuantizedBody* base, size_t count, QuantizedBody* frame){
+        const uint8_t* end = data + size;
+        uint32_t value;
+        for (size_t i = 0; i < count; i++){
+            for (int j = 0; j < 3; j++){
+                if (!readVarint(data, end, value))
+                    return false;
+                frame[i].position[j] = unzigzag(value) + (base ? base[i].position[j] : 0);
+            }
+            for (int j = 0; j < 3; j++){
+                if (!readVarint(data, end, value))
+                    return false;
+                frame[i].rotation[j] = unzigzag(value) + (base ? base[i].rotation[j] : 0);
+            }
+        }
+        return true;
+    }
+
+    void serializeTables(const TrajectoryDesc& desc, std::vector<uint8_t>& out){
+        for (const Shape& shape : desc.shapes){
+            uint32_t counts[2] = { static_cast<uint32_t>(shape.vertices.size()), static_cast<uint32_t>(shape.indices.size()) };
+            append(out, counts, sizeof(counts));
+            append(out, shape.vertices.data(), shape.vertices.size() * sizeof(glm::vec3));
+            append(out, shape.indices.data(), shape.indices.size() * sizeof(uint32_t));
+        }
+        for (size_t i = 0; i < desc.body_shapes.size(); i++){
+            append(out, &desc.body_shapes[i], sizeof(uint32_t));
+            append(out, &desc.body_scales[i], sizeof(glm::vec3));
+        }
+    }
+
+    bool parseTables(const uint8_t* data, size_t size, const FileHeader& header, TrajectoryDesc& desc){
+        Cursor cursor{ data, size };
+
+        desc.shapes.assign(header.shape_count, Shape());
+        for (Shape& shape : desc.shapes){
+            uint32_t counts[2];
+            if (!cursor.read(counts, sizeof(counts)))
+                return false;
+            //Check the sizes before allocating, a corrupt count must not allocate gigabytes
+            if (uint64_t(counts[0]) * sizeof(glm::vec3) + uint64_t(counts[1]) * sizeof(uint32_t) > cursor.size)
+                return false;
+            shape.vertices.resize(counts[0]);
+            shape.indices.resize(counts[1]);
+            cursor.read(shape.vertices.data(), counts[0] * sizeof(glm::vec3));
+            cursor.read(shape.indices.data(), counts[1] * sizeof(uint32_t));
+        }
+
+        if (uint64_t(header.body_count) * (sizeof(uint32_t) + sizeof(glm::vec3)) > cursor.size)
+            return false;
+        desc.body_shapes.resize(header.body_count);
+        desc.body_scales.resize(header.body_count);
+        for (uint32_t i = 0; i < header.body_count; i++){
+            cursor.read(&desc.body_shapes[i], sizeof(uint32_t));
+            cursor.read(&desc.body_scales[i], sizeof(glm::vec3));
+            if (desc.body_shapes[i] >= header.shape_count)
+                return false;
+        }
+
+        desc.bound_min = glm::vec3(header.bound_min[0], header.bound_min[1], header.bound_min[2]);
+        desc.bound_max = glm::vec3(header.bound_max[0], header.bound_max[1], header.bound_max[2]);
+        desc.delta_time = header.delta_time;
+        desc.keyframe_interval = header.keyframe_interval;
+        desc.position_bits = header.position_bits;
+        desc.rotation_bits = header.rotation_bits;
+        desc.compress = (header.flags & C_TRAJECTORY_COMPRESSED) != 0;
+        return true;
+    }
+
+    bool isValidHeader(const FileHeader& header){
+        return header.magic == C_TRAJECTORY_MAGIC && header.version == C_TRAJECTORY_VERSION
+            && header.keyframe_interval > 0
+            && header.position_bits >= 1 && header.position_bits <= 30
+            && header.rotation_bits >= 1 && header.rotation_bits <= 28
+            && header.chunks_offset >= sizeof(FileHeader);
+    }
+
+    bool unpackChunk(const ChunkHeader& chunk, const uint8_t* payload, std::vector<uint8_t>& raw){
+        raw.resize(chunk.raw_size);
+        if (chunk.stored_size == chunk.raw_size){
+            std::memcpy(raw.data(), payload, chunk.raw_size);
+            return true;
+        }
+        return decompressBlock(payload, chunk.stored_size, raw.data(), raw.size());
+    }
+
+    bool decodeChunkFrame(const uint8_t* raw, size_t raw_size, const ChunkHeader& chunk, uint32_t frame,
+                          const QuantizedBody* key, size_t count, QuantizedBody* out){
+        size_t table_size = size_t(chunk.frame_count) * sizeof(uint32_t);
+        if (frame >= chunk.frame_count || raw_size < table_size)
+            return false;
+
+        uint32_t begin, end = static_cast<uint32_t>(raw_size);
+        std::memcpy(&begin, raw + frame * sizeof(uint32_t), sizeof(uint32_t));
+        if (frame + 1 < chunk.frame_count)
+            std::memcpy(&end, raw + (frame + 1) * sizeof(uint32_t), sizeof(uint32_t));
+        if (begin < table_size || begin > end || end > raw_size)
+            return false;
+
+        return TrajectoryCodec::decodeFrame(raw + begin, end - begin, frame == 0 ? nullptr : key, count, out);
+    }
+
+    std::vector<glm::vec3> extractScales(const std::vector<glm::mat4>& transforms){
+        std::vector<glm::vec3> scales(transforms.size());
+        for (size_t i = 0; i < transforms.size(); i++)
+            scales[i] = glm::vec3(glm::length(glm::vec3(transforms[i][0])),
+                                  glm::length(glm::vec3(transforms[i][1])),
+                                  glm::length(glm::vec3(transforms[i][2])));
+        return scales;
+    }
+
+    void computeBounds(const std::vector<glm::mat4>& transforms, float margin, glm::vec3& bound_min, glm::vec3& bound_max){
+        bound_min = glm::vec3(0.0f);
+        bound_max = glm::vec3(0.0f);
+        for (size_t i = 0; i < transforms.size(); i++){
+            glm::vec3 position(transforms[i][3]);
+            bound_min = i == 0 ? position : glm::min(bound_min, position);
+            bound_max = i == 0 ? position : glm::max(bound_max, position);
+        }
+        bound_min -= glm::vec3(margin);
+        bound_max += glm::vec3(margin);
+    }
+}
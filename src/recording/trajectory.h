@@ -0,0 +1,209 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+/**
+ * Binary trajectory format, the states of every body of a run at 4 to 8 bytes per body and frame
+ * instead of the 64 of a mat4. Every integer and float is little endian.
+ *
+ *  FileHeader
+ *  shape table     per shape: vertex count, index count, vertices (3 floats), indices (uint32)
+ *  body table      per body: shape (uint32) and scale (3 floats)
+ *  chunks          ChunkHeader + payload (LZ4 style block if stored_size != raw_size)
+ *  chunk index     ChunkEntry per chunk
+ *  FileTrailer
+ *
+ * A chunk holds up to keyframe_interval frames. Its payload starts with the offset of each frame
+ * (uint32) followed by the frames. The first frame is the keyframe, the rest are deltas against it,
+ * so any frame decodes from two frames of its chunk and the chunk index gives random access.
+ *
+ * A frame stores six integers per body as zigzag varints:
+ *  - the position quantised to position_bits per axis inside the scene bound (clamped outside it)
+ *  - the orientation with the smallest three encoding: the largest quaternion component is dropped
+ *    (its sign is made positive) and the other three, in [-1/sqrt(2), 1/sqrt(2)], are quantised to
+ *    rotation_bits. The index of the dropped component goes in the two low bits of the first one
+ * The scale of a body never changes during a run, so it lives in the body table.
+ */
+
+namespace recording{
+
+    constexpr uint32_t C_TRAJECTORY_MAGIC = 0x4A525450; /* "PTRJ" */
+    constexpr uint32_t C_TRAJECTORY_INDEX_MAGIC = 0x58525450; /* "PTRX" */
+    constexpr uint32_t C_TRAJECTORY_VERSION = 1;
+    constexpr uint32_t C_TRAJECTORY_COMPRESSED = 1; /* FileHeader::flags, chunks may be compressed */
+
+    /**
+     * @brief Collision shape of some of the bodies, so a trajectory can be drawn on its own
+     */
+    struct Shape{
+        std::vector<glm::vec3> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    /**
+     * @brief Contents and settings of a trajectory
+     */
+    struct TrajectoryDesc{
+        std::vector<Shape> shapes;
+        std::vector<uint32_t> body_shapes; /* Shape of each body, its size is the number of bodies */
+        std::vector<glm::vec3> body_scales; /* Scale of each body, taken out of its transforms (see extractScales) */
+        glm::vec3 bound_min = glm::vec3(-100.0f); /* Box the positions are quantised in (see computeBounds) */
+        glm::vec3 bound_max = glm::vec3(100.0f);
+        float delta_time = 1.0f / 60.0f; /* Simulated time between frames */
+        uint32_t keyframe_interval = 30; /* Frames per chunk */
+        uint32_t position_bits = 20; /* Bits per axis, 1 to 30 */
+        uint32_t rotation_bits = 14; /* Bits per quaternion component, 1 to 28 */
+        bool compress = true;
+    };
+
+    struct FileHeader{
+        uint32_t magic;
+        uint32_t version;
+        uint32_t flags;
+        uint32_t body_count;
+        uint32_t shape_count;
+        uint32_t frame_count; /* Written when the file is closed */
+        uint32_t keyframe_interval;
+        uint32_t position_bits;
+        uint32_t rotation_bits;
+        float delta_time;
+        float bound_min[3];
+        float bound_max[3];
+        uint64_t chunks_offset; /* End of the shape and body tables, start of the first chunk */
+    };
+
+    struct ChunkHeader{
+        uint32_t first_frame;
+        uint32_t frame_count;
+        uint32_t raw_size; /* Size of the payload once decompressed */
+        uint32_t stored_size; /* Size of the payload in the file */
+    };
+
+    struct ChunkEntry{
+        uint64_t offset; /* Position of the ChunkHeader in the file */
+        uint32_t first_frame;
+        uint32_t frame_count;
+    };
+
+    struct FileTrailer{
+        uint64_t index_offset; /* Position of the first ChunkEntry in the file */
+        uint32_t chunk_count;
+        uint32_t magic;
+    };
+
+    /**
+     * @brief State of a body once quantised
+     */
+    struct QuantizedBody{
+        int32_t position[3];
+        int32_t rotation[3]; /* rotation[0] keeps the index of the dropped component in its two low bits */
+    };
+
+    /**
+     * @brief Converts between transforms and quantised frames with the settings of a trajectory
+     */
+    class TrajectoryCodec{
+    private:
+        glm::vec3 m_bound_min;
+        glm::vec3 m_bound_size;
+        float m_position_steps; /* Largest quantised position */
+        float m_rotation_steps; /* Largest quantised component */
+        std::vector<glm::vec3> m_scales;
+
+    public:
+        /**
+         * @brief Takes the bound, bits and body scales of a trajectory
+         */
+        void setup(const TrajectoryDesc& desc);
+
+        /**
+         * @brief Quantises the transform of a body
+         * @param transform transform of the body (translation, rotation and the scale of the body)
+         * @param body index of the body
+         * @param clamped set to true if the position was outside the bound
+         */
+        QuantizedBody quantize(const glm::mat4& transform, unsigned int body, bool& clamped) const;
+
+        /**
+         * @brief Rebuilds the transform of a body
+         */
+        glm::mat4 dequantize(const QuantizedBody& state, unsigned int body) const;
+
+        /**
+         * @brief Appends a frame as varints of its difference with a base frame
+         * @param frame state of every body
+         * @param base keyframe, or null to write the frame as it is
+         * @param count number of bodies
+         */
+        static void encodeFrame(const QuantizedBody* frame, const QuantizedBody* base, size_t count, std::vector<uint8_t>& out);
+
+        /**
+         * @brief Reads a frame written by encodeFrame
+         * @return false if the data ends before every body is read
+         */
+        static bool decodeFrame(const uint8_t* data, size_t size, const QuantizedBody* base, size_t count, QuantizedBody* frame);
+    };
+
+    /**
+     * @brief Writes the shape and body tables
+     */
+    void serializeTables(const TrajectoryDesc& desc, std::vector<uint8_t>& out);
+
+    /**
+     * @brief Reads the shape and body tables
+     * @param data start of the shape table
+     * @param size bytes up to the first chunk
+     * @param header header of the file (gives the number of shapes and bodies)
+     * @param desc receives the tables and the settings of the header
+     * @return false if the tables do not fit in size or a body refers to a missing shape
+     */
+    bool parseTables(const uint8_t* data, size_t size, const FileHeader& header, TrajectoryDesc& desc);
+
+    /**
+     * @brief Checks the magic, version and settings of a header
+     */
+    bool isValidHeader(const FileHeader& header);
+
+    /**
+     * @brief Gets the decompressed payload of a chunk
+     * @param chunk header of the chunk
+     * @param payload stored payload (stored_size bytes after the header)
+     * @param raw receives raw_size bytes
+     * @return false if the payload is corrupt
+     */
+    bool unpackChunk(const ChunkHeader& chunk, const uint8_t* payload, std::vector<uint8_t>& raw);
+
+    /**
+     * @brief Decodes a frame of an unpacked chunk
+     * @param raw payload of the chunk (unpackChunk)
+     * @param raw_size size of the payload (raw_size of the chunk)
+     * @param chunk header of the chunk
+     * @param frame frame within the chunk
+     * @param key keyframe of the chunk (frame 0, decoded with a null key). Ignored for frame 0
+     * @param count number of bodies
+     * @param out receives count bodies
+     */
+    bool decodeChunkFrame(const uint8_t* raw, size_t raw_size, const ChunkHeader& chunk, uint32_t frame,
+                          const QuantizedBody* key, size_t count, QuantizedBody* out);
+
+    /**
+     * @brief Gets the scale of each transform (length of its basis vectors)
+     */
+    std::vector<glm::vec3> extractScales(const std::vector<glm::mat4>& transforms);
+
+    /**
+     * @brief Computes a box around the positions of the transforms
+     * @param margin distance added on every side (room for the bodies to move)
+     */
+    void computeBounds(const std::vector<glm::mat4>& transforms, float margin, glm::vec3& bound_min, glm::vec3& bound_max);
+}
+
+
+#endif // TRAJECTORY_H
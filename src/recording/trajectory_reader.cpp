@@ -0,0 +1,126 @@
+#include "trajectory_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace recording{
+
+    bool TrajectoryReader::open(const std::string& path){
+        close();
+
+        if (!m_file.open(path)){
+            std::cerr << "TrajectoryReader: could not open " << path << std::endl;
+            return false;
+        }
+
+        const uint8_t* data = m_file.getData();
+        uint64_t file_size = m_file.getSize();
+
+        bool valid = file_size >= sizeof(FileHeader) + sizeof(FileTrailer);
+        if (valid){
+            std::memcpy(&m_header, data, sizeof(FileHeader));
+            valid = isValidHeader(m_header) && m_header.chunks_offset <= file_size;
+        }
+
+        //Shape and body tables
+        if (valid)
+            valid = parseTables(data + sizeof(FileHeader), m_header.chunks_offset - sizeof(FileHeader), m_header, m_desc);
+
+        //Chunk index, at the end of the file
+        FileTrailer trailer{};
+        if (valid){
+            std::memcpy(&trailer, data + file_size - sizeof(FileTrailer), sizeof(FileTrailer));
+            valid = trailer.magic == C_TRAJECTORY_INDEX_MAGIC
+                && trailer.index_offset + uint64_t(trailer.chunk_count) * sizeof(ChunkEntry) + sizeof(FileTrailer) == file_size;
+        }
+        if (valid){
+            m_index.resize(trailer.chunk_count);
+            std::memcpy(m_index.data(), data + trailer.index_offset, m_index.size() * sizeof(ChunkEntry));
+            for (const ChunkEntry& chunk : m_index)
+                valid = valid && chunk.offset + sizeof(ChunkHeader) <= trailer.index_offset;
+        }
+
+        if (!valid){
+            std::cerr << "TrajectoryReader: " << path << " is not a trajectory or was not closed" << std::endl;
+            close();
+            return false;
+        }
+
+        m_codec.setup(m_desc);
+        m_key.resize(m_header.body_count);
+        m_frame.resize(m_header.body_count);
+        return true;
+    }
+
+    void TrajectoryReader::close(){
+        m_file.close();
+        m_header = FileHeader{};
+        m_desc = TrajectoryDesc{};
+        m_index.clear();
+        m_chunk = -1;
+        m_raw = nullptr;
+    }
+
+    bool TrajectoryReader::readFrame(uint32_t frame, std::vector<glm::mat4>& transforms){
+        transforms.resize(m_header.body_count);
+        return readFrame(frame, transforms.data());
+    }
+
+    bool TrajectoryReader::readFrame(uint32_t frame, glm::mat4* transforms){
+        if (!isOpen() || frame >= m_header.frame_count)
+            return false;
+
+        //Last chunk starting at or before the frame
+        auto entry = std::upper_bound(m_index.begin(), m_index.end(), frame, [](uint32_t value, const ChunkEntry& chunk){
+            return value < chunk.first_frame;
+        });
+        if (entry == m_index.begin())
+            return false;
+        size_t chunk = static_cast<size_t>(entry - m_index.begin()) - 1;
+        if (frame - m_index[chunk].first_frame >= m_index[chunk].frame_count)
+            return false;
+
+        if (static_cast<int64_t>(chunk) != m_chunk && !loadChunk(chunk)){
+            m_chunk = -1;
+            std::cerr << "TrajectoryReader: chunk " << chunk << " is corrupt" << std::endl;
+            return false;
+        }
+
+        uint32_t local = frame - m_chunk_header.first_frame;
+        const std::vector<QuantizedBody>* state = &m_key;
+        if (local > 0){
+            if (!decodeChunkFrame(m_raw, m_chunk_header.raw_size, m_chunk_header, local, m_key.data(), m_frame.size(), m_frame.data()))
+                return false;
+            state = &m_frame;
+        }
+
+        for (uint32_t i = 0; i < m_header.body_count; i++)
+            transforms[i] = m_codec.dequantize((*state)[i], i);
+        return true;
+    }
+
+    bool TrajectoryReader::loadChunk(size_t chunk){
+        const ChunkEntry& entry = m_index[chunk];
+        std::memcpy(&m_chunk_header, m_file.getData() + entry.offset, sizeof(ChunkHeader));
+        if (m_chunk_header.first_frame != entry.first_frame || m_chunk_header.frame_count != entry.frame_count
+            || m_chunk_header.stored_size > m_chunk_header.raw_size
+            || entry.offset + sizeof(ChunkHeader) + m_chunk_header.stored_size > m_file.getSize())
+            return false;
+
+        //Stored chunks are read straight from the mapping, compressed ones are unpacked
+        const uint8_t* payload = m_file.getData() + entry.offset + sizeof(ChunkHeader);
+        if (m_chunk_header.stored_size == m_chunk_header.raw_size)
+            m_raw = payload;
+        else if (unpackChunk(m_chunk_header, payload, m_unpacked))
+            m_raw = m_unpacked.data();
+        else
+            return false;
+
+        if (!decodeChunkFrame(m_raw, m_chunk_header.raw_size, m_chunk_header, 0, nullptr, m_key.size(), m_key.data()))
+            return false;
+
+        m_chunk = static_cast<int64_t>(chunk);
+        return true;
+    }
+}
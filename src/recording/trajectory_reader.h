@@ -0,0 +1,96 @@
+#ifndef TRAJECTORY_READER_H
+#define TRAJECTORY_READER_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "trajectory.h"
+#include "mapped_file.h"
+
+namespace recording{
+
+    /**
+     * @brief Reads any frame of a trajectory file. The file is memory mapped, only the chunk of
+     * the frame is touched and decompressed (found through the chunk index), and it is kept for
+     * the next frames.
+     * @note Not thread safe, use one reader per thread
+     */
+    class TrajectoryReader{
+    private:
+        MappedFile m_file;
+        FileHeader m_header;
+        TrajectoryDesc m_desc;
+        TrajectoryCodec m_codec;
+        std::vector<ChunkEntry> m_index;
+
+        //Chunk of the last frame read
+        int64_t m_chunk = -1;
+        ChunkHeader m_chunk_header;
+        const uint8_t* m_raw = nullptr; /* Payload of the chunk, in the mapping or in m_unpacked */
+        std::vector<uint8_t> m_unpacked; /* Decompressed payload */
+        std::vector<QuantizedBody> m_key;
+        std::vector<QuantizedBody> m_frame;
+
+    public:
+        TrajectoryReader() = default;
+
+        /**
+         * @brief Opens a trajectory and reads its header, tables and chunk index
+         * @return false if the file is missing, not a trajectory or was not closed by the writer
+         */
+        bool open(const std::string& path);
+
+        /**
+         * @brief Closes the file
+         */
+        void close();
+
+        /**
+         * @brief Decodes the transforms of every body at a frame
+         * @param frame frame to read, from 0 to getFrameCount() - 1
+         * @param transforms receives one transform per body
+         * @return false if the frame does not exist or its chunk is corrupt
+         */
+        bool readFrame(uint32_t frame, std::vector<glm::mat4>& transforms);
+
+        /**
+         * @brief Decodes the transforms of every body at a frame into any memory (e.g. a mapped buffer)
+         * @param transforms receives getBodyCount() transforms
+         */
+        bool readFrame(uint32_t frame, glm::mat4* transforms);
+
+        /**
+         * @brief Tells whether a trajectory is open
+         */
+        inline bool isOpen() const { return m_file.isOpen(); }
+
+        /**
+         * @brief Gets the number of frames
+         */
+        inline uint32_t getFrameCount() const { return m_header.frame_count; }
+
+        /**
+         * @brief Gets the number of bodies
+         */
+        inline uint32_t getBodyCount() const { return m_header.body_count; }
+
+        /**
+         * @brief Gets the shapes, bodies and settings of the trajectory
+         */
+        inline const TrajectoryDesc& getDesc() const { return m_desc; }
+
+    private:
+        /**
+         * @brief Reads and decompresses a chunk, and decodes its keyframe
+         */
+        bool loadChunk(size_t chunk);
+    };
+}
+
+
+#endif // TRAJECTORY_READER_H
@@ -0,0 +1,221 @@
+#include "trajectory_writer.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "block_compression.h"
+#include "../profiling/cpu_profiler.h"
+
+namespace recording{
+
+    TrajectoryWriter::~TrajectoryWriter(){
+        if (isOpen())
+            close();
+    }
+
+    bool TrajectoryWriter::open(const std::string& path, const TrajectoryDesc& desc, unsigned int max_queued){
+        if (isOpen()){
+            std::cerr << "TrajectoryWriter: already writing a file" << std::endl;
+            return false;
+        }
+
+        bool valid = !desc.body_shapes.empty() && desc.body_shapes.size() == desc.body_scales.size()
+            && desc.keyframe_interval > 0
+            && desc.position_bits >= 1 && desc.position_bits <= 30
+            && desc.rotation_bits >= 1 && desc.rotation_bits <= 28;
+        for (uint32_t shape : desc.body_shapes)
+            valid = valid && shape < desc.shapes.size();
+        if (!valid){
+            std::cerr << "TrajectoryWriter: invalid bodies, shapes or quantisation settings" << std::endl;
+            return false;
+        }
+
+        m_file.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open()){
+            std::cerr << "TrajectoryWriter: could not create " << path << std::endl;
+            return false;
+        }
+
+        std::vector<uint8_t> tables;
+        serializeTables(desc, tables);
+
+        m_header = FileHeader{};
+        m_header.magic = C_TRAJECTORY_MAGIC;
+        m_header.version = C_TRAJECTORY_VERSION;
+        m_header.flags = desc.compress ? C_TRAJECTORY_COMPRESSED : 0;
+        m_header.body_count = static_cast<uint32_t>(desc.body_shapes.size());
+        m_header.shape_count = static_cast<uint32_t>(desc.shapes.size());
+        m_header.keyframe_interval = desc.keyframe_interval;
+        m_header.position_bits = desc.position_bits;
+        m_header.rotation_bits = desc.rotation_bits;
+        m_header.delta_time = desc.delta_time;
+        for (int axis = 0; axis < 3; axis++){
+            m_header.bound_min[axis] = desc.bound_min[axis];
+            m_header.bound_max[axis] = desc.bound_max[axis];
+        }
+        m_header.chunks_offset = sizeof(FileHeader) + tables.size();
+
+        m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(FileHeader));
+        m_file.write(reinterpret_cast<const char*>(tables.data()), tables.size());
+
+        m_codec.setup(desc);
+        m_index.clear();
+        m_key.resize(m_header.body_count);
+        m_frame.resize(m_header.body_count);
+        m_frame_offsets.clear();
+        m_frames_data.clear();
+        m_chunk_first = 0;
+        m_frames_written = 0;
+        m_frames_pushed = 0;
+        m_clamped = 0;
+        m_max_queued = max_queued > 0 ? max_queued : 1;
+        m_closing = false;
+        m_failed = !m_file.good();
+
+        m_thread = std::thread(&TrajectoryWriter::run, this);
+        return true;
+    }
+
+    bool TrajectoryWriter::pushFrame(const std::vector<glm::mat4>& transforms){
+        if (!isOpen() || m_failed.load(std::memory_order_relaxed))
+            return false;
+        if (transforms.size() != m_header.body_count){
+            std::cerr << "TrajectoryWriter: frame with " << transforms.size() << " bodies, the trajectory has " << m_header.body_count << std::endl;
+            return false;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_popped.wait(lock, [this]{ return m_queue.size() < m_max_queued; });
+
+            std::vector<glm::mat4> frame;
+            if (!m_free_frames.empty()){
+                frame = std::move(m_free_frames.back());
+                m_free_frames.pop_back();
+            }
+            frame.assign(transforms.begin(), transforms.end());
+            m_queue.push_back(std::move(frame));
+        }
+        m_pushed.notify_one();
+        m_frames_pushed++;
+        return true;
+    }
+
+    bool TrajectoryWriter::close(){
+        if (!isOpen())
+            return false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closing = true;
+        }
+        m_pushed.notify_one();
+        m_thread.join();
+
+        //The writer thread is gone, the rest is written from here
+        if (!m_failed)
+            flushChunk();
+
+        FileTrailer trailer{};
+        trailer.index_offset = static_cast<uint64_t>(m_file.tellp());
+        trailer.chunk_count = static_cast<uint32_t>(m_index.size());
+        trailer.magic = C_TRAJECTORY_INDEX_MAGIC;
+        m_file.write(reinterpret_cast<const char*>(m_index.data()), m_index.size() * sizeof(ChunkEntry));
+        m_file.write(reinterpret_cast<const char*>(&trailer), sizeof(FileTrailer));
+
+        m_header.frame_count = m_frames_written;
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(FileHeader));
+
+        bool ok = !m_failed && m_file.good();
+        m_file.close();
+        m_queue.clear();
+        m_free_frames.clear();
+
+        if (m_clamped > 0)
+            std::cerr << "TrajectoryWriter: " << m_clamped << " positions were outside the bound and were clamped" << std::endl;
+        if (!ok)
+            std::cerr << "TrajectoryWriter: error writing the trajectory" << std::endl;
+        return ok;
+    }
+
+    void TrajectoryWriter::run(){
+        PROFILE_THREAD_NAME("trajectory writer");
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true){
+            m_pushed.wait(lock, [this]{ return !m_queue.empty() || m_closing; });
+            if (m_queue.empty())
+                break;
+
+            std::vector<glm::mat4> frame = std::move(m_queue.front());
+            m_queue.pop_front();
+            lock.unlock(); //Unlock while encoding and writing
+            m_popped.notify_one();
+
+            if (!m_failed.load(std::memory_order_relaxed))
+                encodeFrame(frame);
+
+            lock.lock();
+            m_free_frames.push_back(std::move(frame));
+        }
+    }
+
+    void TrajectoryWriter::encodeFrame(const std::vector<glm::mat4>& transforms){
+        PROFILE_ZONE("encode trajectory frame");
+        for (uint32_t i = 0; i < m_header.body_count; i++){
+            bool clamped = false;
+            m_frame[i] = m_codec.quantize(transforms[i], i, clamped);
+            m_clamped += clamped ? 1 : 0;
+        }
+
+        m_frame_offsets.push_back(static_cast<uint32_t>(m_frames_data.size()));
+        if (m_frames_written == m_chunk_first){
+            m_key.swap(m_frame);
+            TrajectoryCodec::encodeFrame(m_key.data(), nullptr, m_key.size(), m_frames_data);
+        }
+        else
+            TrajectoryCodec::encodeFrame(m_frame.data(), m_key.data(), m_frame.size(), m_frames_data);
+
+        m_frames_written++;
+        if (m_frames_written - m_chunk_first == m_header.keyframe_interval)
+            flushChunk();
+    }
+
+    void TrajectoryWriter::flushChunk(){
+        uint32_t frame_count = m_frames_written - m_chunk_first;
+        if (frame_count == 0)
+            return;
+
+        PROFILE_ZONE("write trajectory chunk");
+
+        //Frame offsets (from the start of the payload) followed by the frames
+        uint32_t table_size = frame_count * sizeof(uint32_t);
+        m_raw_chunk.resize(table_size);
+        for (uint32_t i = 0; i < frame_count; i++){
+            uint32_t offset = m_frame_offsets[i] + table_size;
+            std::memcpy(m_raw_chunk.data() + i * sizeof(uint32_t), &offset, sizeof(uint32_t));
+        }
+        m_raw_chunk.insert(m_raw_chunk.end(), m_frames_data.begin(), m_frames_data.end());
+
+        ChunkHeader chunk{ m_chunk_first, frame_count, static_cast<uint32_t>(m_raw_chunk.size()), static_cast<uint32_t>(m_raw_chunk.size()) };
+        const std::vector<uint8_t>* payload = &m_raw_chunk;
+        if (m_header.flags & C_TRAJECTORY_COMPRESSED){
+            compressBlock(m_raw_chunk.data(), m_raw_chunk.size(), m_stored_chunk);
+            //Stored as it is if compressing does not help (stored_size == raw_size)
+            if (m_stored_chunk.size() < m_raw_chunk.size()){
+                payload = &m_stored_chunk;
+                chunk.stored_size = static_cast<uint32_t>(m_stored_chunk.size());
+            }
+        }
+
+        m_index.push_back(ChunkEntry{ static_cast<uint64_t>(m_file.tellp()), m_chunk_first, frame_count });
+        m_file.write(reinterpret_cast<const char*>(&chunk), sizeof(ChunkHeader));
+        m_file.write(reinterpret_cast<const char*>(payload->data()), payload->size());
+        if (!m_file.good())
+            m_failed = true;
+
+        m_frame_offsets.clear();
+        m_frames_data.clear();
+        m_chunk_first = m_frames_written;
+    }
+}
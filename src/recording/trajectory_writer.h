@@ -0,0 +1,120 @@
+#ifndef TRAJECTORY_WRITER_H
+#define TRAJECTORY_WRITER_H
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "trajectory.h"
+
+namespace recording{
+
+    /**
+     * @brief Streams the states of a run into a trajectory file. The caller only copies the
+     * transforms of each frame, the quantisation, delta coding, compression and file writes
+     * happen on a background thread.
+     * @note The set of bodies is fixed when the file is opened
+     */
+    class TrajectoryWriter{
+    private:
+        std::ofstream m_file;
+        FileHeader m_header;
+        TrajectoryCodec m_codec;
+        std::vector<ChunkEntry> m_index;
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_pushed; /* A frame was queued or the writer is closing */
+        std::condition_variable m_popped; /* A frame was taken by the writer thread */
+        std::deque<std::vector<glm::mat4>> m_queue;
+        std::vector<std::vector<glm::mat4>> m_free_frames; /* Frames already written, reused to avoid allocations */
+        unsigned int m_max_queued;
+        bool m_closing = false;
+        std::atomic<bool> m_failed{false};
+        uint32_t m_frames_pushed = 0;
+
+        //Writer thread only
+        std::vector<QuantizedBody> m_key; /* Keyframe of the chunk being built */
+        std::vector<QuantizedBody> m_frame;
+        std::vector<uint32_t> m_frame_offsets;
+        std::vector<uint8_t> m_frames_data; /* Encoded frames of the chunk being built */
+        std::vector<uint8_t> m_raw_chunk;
+        std::vector<uint8_t> m_stored_chunk;
+        uint32_t m_chunk_first = 0;
+        uint32_t m_frames_written = 0;
+        uint64_t m_clamped = 0; /* Positions clamped to the bound */
+
+    public:
+        TrajectoryWriter() = default;
+
+        /**
+         * @brief Destructor, closes the file
+         */
+        ~TrajectoryWriter();
+
+        TrajectoryWriter(const TrajectoryWriter&) = delete;
+        TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+        /**
+         * @brief Creates the file, writes the header and tables and starts the writer thread
+         * @param path file to write
+         * @param desc bodies, shapes and settings of the trajectory
+         * @param max_queued frames that can wait for the writer thread before pushFrame blocks
+         * @return false if the settings are invalid or the file could not be created
+         */
+        bool open(const std::string& path, const TrajectoryDesc& desc, unsigned int max_queued = 8);
+
+        /**
+         * @brief Queues the state of every body for the next frame. Blocks if the writer thread
+         * is max_queued frames behind
+         * @param transforms transform of each body, in the order of the body table
+         * @return false if the writer is not open, the number of bodies differs or a write failed
+         */
+        bool pushFrame(const std::vector<glm::mat4>& transforms);
+
+        /**
+         * @brief Writes the queued frames, the chunk index and the frame count, and closes the file
+         * @return false if any write failed
+         */
+        bool close();
+
+        /**
+         * @brief Tells whether the file is open
+         */
+        inline bool isOpen() const { return m_thread.joinable(); }
+
+        /**
+         * @brief Gets the number of frames pushed so far
+         */
+        inline uint32_t getFrameCount() const { return m_frames_pushed; }
+
+    private:
+        /**
+         * @brief Loop of the writer thread
+         */
+        void run();
+
+        /**
+         * @brief Quantises and encodes a frame into the chunk being built
+         */
+        void encodeFrame(const std::vector<glm::mat4>& transforms);
+
+        /**
+         * @brief Compresses and writes the chunk being built
+         */
+        void flushChunk();
+    };
+}
+
+
+#endif // TRAJECTORY_WRITER_H
@@ -0,0 +1,181 @@
+#include "video_capture.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "../gl_check.h"
+#include "../profiling/cpu_profiler.h"
+
+namespace recording{
+
+    VideoCapture::~VideoCapture(){
+        close();
+    }
+
+    bool VideoCapture::open(const std::string& path, int width, int height, unsigned int fps){
+        if (isOpen())
+            close();
+
+        if (!m_shader_loaded){
+            m_shader.setShader("rgb_to_yuv420.glsl");
+            m_shader_loaded = true;
+        }
+
+        if (!m_writer.open(path, width, height, fps))
+            return false;
+
+        m_width = width;
+        m_height = height;
+        m_luma_stride = (static_cast<unsigned int>(width) + 7u) & ~7u;
+        m_chroma_rows = (static_cast<unsigned int>(height) + 1u) / 2u;
+        m_chroma_offset = static_cast<size_t>(m_luma_stride) * m_chroma_rows * 2;
+        m_chroma_plane = static_cast<size_t>(m_luma_stride / 2) * m_chroma_rows;
+        size_t buffer_size = m_chroma_offset + 2 * m_chroma_plane;
+
+        GLCall(glGenTextures(1, &m_texture));
+        GLCall(glBindTexture(GL_TEXTURE_2D, m_texture));
+        GLCall(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height));
+        GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+
+        GLint draw_framebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+        GLCall(glGenFramebuffers(1, &m_framebuffer));
+        GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer));
+        GLCall(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0));
+        GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer));
+
+        GLCall(glGenBuffers(C_SLOTS, m_buffers));
+        for (GLuint buffer : m_buffers){
+            GLCall(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+            GLCall(glBufferData(GL_COPY_READ_BUFFER, buffer_size, nullptr, GL_STREAM_READ));
+        }
+        GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+        m_next = 0;
+        return true;
+    }
+
+    void VideoCapture::capture(){
+        PROFILE_FUNCTION();
+        if (!isOpen())
+            return;
+
+        //The ring is full, the oldest conversion has to leave its slot
+        unsigned int slot = m_next;
+        if (m_fences[slot])
+            collect(slot, true);
+
+        //The blit resolves a multisampled back buffer, which the shader could not read
+        GLint draw_framebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+        GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer));
+        GLCall(glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer));
+
+        m_shader.use();
+        m_shader.setUniform1ui("frame_width", m_width);
+        m_shader.setUniform1ui("frame_height", m_height);
+        m_shader.setUniform1ui("luma_stride", m_luma_stride);
+        m_shader.setUniform1ui("chroma_rows", m_chroma_rows);
+        m_shader.setUniform1ui("chroma_offset", static_cast<unsigned int>(m_chroma_offset));
+        m_shader.setUniform1ui("chroma_plane", static_cast<unsigned int>(m_chroma_plane));
+        GLCall(glBindImageTexture(0, m_texture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8));
+        m_shader.bindSSBO(m_buffers[slot], C_BINDING);
+        m_shader.dispatch((m_luma_stride / 8 + 7) / 8, (m_chroma_rows + 7) / 8, 1);
+        //The planes are read with glMapBufferRange
+        m_shader.waitForCompletion(GL_BUFFER_UPDATE_BARRIER_BIT);
+        m_shader.unbind();
+
+        m_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_next = (m_next + 1) % C_SLOTS;
+    }
+
+    void VideoCapture::poll(){
+        //Oldest first, so the frames reach the writer in order
+        for (unsigned int i = 0; i < C_SLOTS; i++){
+            unsigned int slot = (m_next + i) % C_SLOTS;
+            if (m_fences[slot] && !collect(slot, false))
+                break;
+        }
+    }
+
+    bool VideoCapture::close(){
+        if (!isOpen())
+            return true;
+
+        for (unsigned int i = 0; i < C_SLOTS; i++){
+            unsigned int slot = (m_next + i) % C_SLOTS;
+            if (m_fences[slot])
+                collect(slot, true);
+        }
+        release();
+        return m_writer.close();
+    }
+
+    bool VideoCapture::collect(unsigned int slot, bool wait){
+        GLenum status = glClientWaitSync(m_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return false;
+
+        PROFILE_ZONE("collect video frame");
+        glDeleteSync(m_fences[slot]);
+        m_fences[slot] = nullptr;
+        if (status == GL_WAIT_FAILED){
+            std::cerr << "VideoCapture: waiting for the conversion of a frame failed" << std::endl;
+            return true;
+        }
+
+        size_t size = m_chroma_offset + 2 * m_chroma_plane;
+        std::vector<uint8_t> frame = m_writer.acquireFrame();
+        GLCall(glBindBuffer(GL_COPY_READ_BUFFER, m_buffers[slot]));
+        GLCall(const uint8_t* data = static_cast<const uint8_t*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, GL_MAP_READ_BIT)));
+        if (data){
+            size_t width = static_cast<size_t>(m_width);
+            size_t chroma_width = (width + 1) / 2;
+            size_t luma_size = width * m_height;
+            size_t chroma_size = chroma_width * m_chroma_rows;
+            if (m_luma_stride == width && m_height % 2 == 0)
+                std::memcpy(frame.data(), data, frame.size()); //Without padding the planes are already contiguous
+            else{
+                uint8_t* out = frame.data();
+                for (int y = 0; y < m_height; y++)
+                    std::memcpy(out + y * width, data + static_cast<size_t>(y) * m_luma_stride, width);
+                for (unsigned int y = 0; y < m_chroma_rows; y++){
+                    const uint8_t* row = data + m_chroma_offset + static_cast<size_t>(y) * (m_luma_stride / 2);
+                    std::memcpy(out + luma_size + y * chroma_width, row, chroma_width);
+                    std::memcpy(out + luma_size + chroma_size + y * chroma_width, row + m_chroma_plane, chroma_width);
+                }
+            }
+            GLCall(glUnmapBuffer(GL_COPY_READ_BUFFER));
+        }
+        GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+
+        if (!data){
+            std::cerr << "VideoCapture: could not map the planes of a frame" << std::endl;
+            return true;
+        }
+        m_writer.pushFrame(std::move(frame));
+        return true;
+    }
+
+    void VideoCapture::release(){
+        for (GLsync& fence : m_fences){
+            if (fence){
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+        if (m_buffers[0]){
+            glDeleteBuffers(C_SLOTS, m_buffers);
+            for (GLuint& buffer : m_buffers)
+                buffer = 0;
+        }
+        if (m_framebuffer){
+            glDeleteFramebuffers(1, &m_framebuffer);
+            m_framebuffer = 0;
+        }
+        if (m_texture){
+            glDeleteTextures(1, &m_texture);
+            m_texture = 0;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef VIDEO_CAPTURE_H
+#define VIDEO_CAPTURE_H
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "../compute_shader.h"
+#include "y4m_writer.h"
+
+namespace recording{
+
+    /**
+     * @brief Records rendered frames into one Y4M video instead of a PNG per frame. The frame is
+     * resolved into a texture, a compute shader converts it to YUV 4:2:0 (half the bytes of RGB)
+     * into a ring of buffers, and once a fence tells the conversion is done the planes are mapped
+     * and handed to a Y4mWriter, which appends them to the file on its own thread.
+     * @note Every method runs on the thread that owns the OpenGL context
+     */
+    class VideoCapture{
+    private:
+        static constexpr unsigned int C_SLOTS = 3; /* Frames the gpu can be behind before capture waits */
+        static constexpr unsigned int C_BINDING = 2; /* Binding point of the YUV buffer */
+
+        GLuint m_buffers[C_SLOTS] = {}; /* YUV planes of a frame, padded to the stride of the shader */
+        GLsync m_fences[C_SLOTS] = {}; /* Pending conversion, signaled once the planes are in the buffer */
+        unsigned int m_next = 0; /* Slot of the next capture, the oldest one */
+        GLuint m_texture = 0; /* Single sampled copy of the frame the shader reads */
+        GLuint m_framebuffer = 0;
+        ComputeShader m_shader;
+        bool m_shader_loaded = false;
+        Y4mWriter m_writer;
+
+        int m_width = 0;
+        int m_height = 0;
+        unsigned int m_luma_stride = 0; /* Bytes per luma row in the buffers, the width rounded up to 8 */
+        unsigned int m_chroma_rows = 0;
+        size_t m_chroma_offset = 0; /* Byte offset of the U plane in the buffers */
+        size_t m_chroma_plane = 0; /* Bytes of each padded chroma plane */
+
+    public:
+        VideoCapture() = default;
+
+        /**
+         * @brief Destructor, writes the pending frames and frees the gpu objects
+         */
+        ~VideoCapture();
+
+        VideoCapture(const VideoCapture&) = delete;
+        VideoCapture& operator=(const VideoCapture&) = delete;
+
+        /**
+         * @brief Creates the video and the gpu objects for frames of the given size
+         * @param path Y4M file to write (its folder must exist)
+         * @param fps frame rate written in the header
+         * @return false if the file or the shader could not be created
+         */
+        bool open(const std::string& path, int width, int height, unsigned int fps);
+
+        /**
+         * @brief Converts the read framebuffer (the back buffer before swapping) and queues it.
+         * Waits only if the conversion of C_SLOTS frames ago has not finished yet
+         */
+        void capture();
+
+        /**
+         * @brief Hands the finished conversions to the writer (never waits for the gpu). Call it once per frame
+         */
+        void poll();
+
+        /**
+         * @brief Writes the pending frames and closes the video
+         * @return false if any write failed
+         */
+        bool close();
+
+        /**
+         * @brief Tells whether a video is open
+         */
+        inline bool isOpen() const { return m_writer.isOpen(); }
+
+        /**
+         * @brief Gets the writer, for its counters
+         */
+        inline const Y4mWriter& getWriter() const { return m_writer; }
+
+    private:
+        /**
+         * @brief Copies the planes of a slot without the padding and queues them
+         * @param wait if false, returns false without waiting when the conversion is not done
+         */
+        bool collect(unsigned int slot, bool wait);
+
+        /**
+         * @brief Deletes the buffers, texture and framebuffer
+         */
+        void release();
+    };
+}
+
+
+#endif // VIDEO_CAPTURE_H
@@ -0,0 +1,136 @@
+#include "y4m_writer.h"
+
+#include <iostream>
+#include <sstream>
+
+#include "../profiling/cpu_profiler.h"
+
+namespace recording{
+
+    namespace{
+        constexpr size_t C_FILE_BUFFER_SIZE = 8u << 20; /* Bytes buffered by the stream before writing */
+        const char C_FRAME_HEADER[] = "FRAME\n";
+    }
+
+    Y4mWriter::~Y4mWriter(){
+        close();
+    }
+
+    bool Y4mWriter::open(const std::string& path, int width, int height, unsigned int fps, unsigned int max_queued){
+        if (isOpen())
+            close();
+
+        if (width <= 0 || height <= 0 || fps == 0){
+            std::cerr << "Y4mWriter: invalid size " << width << "x" << height << " at " << fps << " fps" << std::endl;
+            return false;
+        }
+
+        //The buffer has to be set before opening to take effect
+        m_file_buffer.resize(C_FILE_BUFFER_SIZE);
+        m_file.rdbuf()->pubsetbuf(m_file_buffer.data(), static_cast<std::streamsize>(m_file_buffer.size()));
+        m_file.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_file){
+            std::cerr << "Y4mWriter: could not create " << path << std::endl;
+            return false;
+        }
+
+        std::ostringstream header;
+        header << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+        m_file << header.str();
+
+        size_t chroma_plane = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+        m_width = width;
+        m_height = height;
+        m_frame_size = static_cast<size_t>(width) * height + 2 * chroma_plane;
+        m_frames_pushed = 0;
+        m_failed = false;
+        m_closing = false;
+
+        //Every frame can be queued, being written or being filled by the caller
+        unsigned int capacity = max_queued > 0 ? max_queued : 1;
+        m_queue = std::make_unique<jobs::BoundedQueue<std::vector<uint8_t>>>(capacity);
+        m_free_frames = std::make_unique<jobs::BoundedQueue<std::vector<uint8_t>>>(capacity + 2);
+
+        m_thread = std::thread(&Y4mWriter::run, this);
+        return true;
+    }
+
+    std::vector<uint8_t> Y4mWriter::acquireFrame(){
+        std::vector<uint8_t> frame;
+        if (m_free_frames)
+            m_free_frames->tryPop(frame);
+        frame.resize(m_frame_size);
+        return frame;
+    }
+
+    bool Y4mWriter::pushFrame(std::vector<uint8_t>&& frame){
+        PROFILE_FUNCTION();
+        if (!isOpen() || m_failed.load(std::memory_order_relaxed))
+            return false;
+        if (frame.size() != m_frame_size){
+            std::cerr << "Y4mWriter: frame of " << frame.size() << " bytes, expected " << m_frame_size << std::endl;
+            return false;
+        }
+
+        while (true){
+            //Read before trying, so a pop between the failed push and the wait still wakes it
+            uint32_t pops = m_pops.load(std::memory_order_acquire);
+            if (m_queue->tryPush(std::move(frame)))
+                break;
+            m_pops.wait(pops, std::memory_order_acquire);
+        }
+        m_frames_pushed++;
+        m_pushes.fetch_add(1, std::memory_order_release);
+        m_pushes.notify_one();
+        return true;
+    }
+
+    bool Y4mWriter::close(){
+        if (!isOpen())
+            return true;
+
+        m_closing.store(true, std::memory_order_release);
+        m_pushes.fetch_add(1, std::memory_order_release);
+        m_pushes.notify_one();
+        m_thread.join();
+
+        m_file.close();
+        if (!m_file)
+            m_failed = true;
+        m_queue.reset();
+        m_free_frames.reset();
+
+        bool ok = !m_failed.load();
+        if (!ok)
+            std::cerr << "Y4mWriter: the video was not written completely" << std::endl;
+        return ok;
+    }
+
+    void Y4mWriter::run(){
+        PROFILE_THREAD_NAME("y4m writer");
+        std::vector<uint8_t> frame;
+        while (true){
+            //Read before trying, so a push between the failed pop and the wait still wakes it
+            uint32_t pushes = m_pushes.load(std::memory_order_acquire);
+            if (!m_queue->tryPop(frame)){
+                //Queued frames are written before closing
+                if (m_closing.load(std::memory_order_acquire))
+                    break;
+                m_pushes.wait(pushes, std::memory_order_acquire);
+                continue;
+            }
+            m_pops.fetch_add(1, std::memory_order_release);
+            m_pops.notify_one();
+
+            {
+                PROFILE_ZONE("write y4m frame");
+                m_file.write(C_FRAME_HEADER, sizeof(C_FRAME_HEADER) - 1);
+                m_file.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+            }
+            if (!m_file)
+                m_failed = true;
+
+            m_free_frames->tryPush(std::move(frame));
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef Y4M_WRITER_H
+#define Y4M_WRITER_H
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../jobs/bounded_queue.h"
+
+namespace recording{
+
+    /**
+     * @brief Streams planar YUV 4:2:0 frames into a single Y4M file. The caller hands over the
+     * frames by move, a background thread writes them sequentially through a large file buffer
+     * and gives the memory back through acquireFrame, so a recording does not allocate once it
+     * is running.
+     * @note The header says C420jpeg (chroma sited between the 2x2 pixels it averages) and
+     * XCOLORRANGE=LIMITED; the samples are expected to be BT.709, as players assume for HD video
+     */
+    class Y4mWriter{
+    private:
+        std::ofstream m_file;
+        std::vector<char> m_file_buffer; /* Buffer of the stream, several frames are written per system call */
+        std::thread m_thread;
+        std::unique_ptr<jobs::BoundedQueue<std::vector<uint8_t>>> m_queue;
+        std::unique_ptr<jobs::BoundedQueue<std::vector<uint8_t>>> m_free_frames; /* Frames already written, reused */
+
+        std::atomic<uint32_t> m_pushes{0}; /* Bumped on every push, the idle writer thread waits on it */
+        std::atomic<uint32_t> m_pops{0}; /* Bumped on every pop, a blocked push waits on it */
+        std::atomic<bool> m_closing{false};
+        std::atomic<bool> m_failed{false};
+
+        int m_width = 0;
+        int m_height = 0;
+        size_t m_frame_size = 0;
+        uint32_t m_frames_pushed = 0;
+
+    public:
+        Y4mWriter() = default;
+
+        /**
+         * @brief Destructor, closes the file
+         */
+        ~Y4mWriter();
+
+        Y4mWriter(const Y4mWriter&) = delete;
+        Y4mWriter& operator=(const Y4mWriter&) = delete;
+
+        /**
+         * @brief Creates the file, writes the stream header and starts the writer thread
+         * @param path file to write
+         * @param fps frame rate written in the header
+         * @param max_queued frames that can wait for the writer thread before pushFrame blocks
+         * @return false if the size is invalid or the file could not be created
+         */
+        bool open(const std::string& path, int width, int height, unsigned int fps, unsigned int max_queued = 8);
+
+        /**
+         * @brief Gets a buffer of getFrameSize() bytes for the next frame, reusing a written one if possible
+         */
+        std::vector<uint8_t> acquireFrame();
+
+        /**
+         * @brief Queues a frame. Blocks if the writer thread is max_queued frames behind
+         * @param frame Y plane (width * height bytes, top row first) followed by the U and V
+         * planes ((width + 1) / 2 * (height + 1) / 2 bytes each)
+         * @return false if the writer is not open, the size is wrong or a write failed
+         */
+        bool pushFrame(std::vector<uint8_t>&& frame);
+
+        /**
+         * @brief Writes the queued frames and closes the file
+         * @return false if any write failed
+         */
+        bool close();
+
+        /**
+         * @brief Tells whether the file is open
+         */
+        inline bool isOpen() const { return m_thread.joinable(); }
+
+        /**
+         * @brief Gets the bytes of a frame
+         */
+        inline size_t getFrameSize() const { return m_frame_size; }
+
+        /**
+         * @brief Gets the number of frames pushed so far
+         */
+        inline uint32_t getFrameCount() const { return m_frames_pushed; }
+
+        /**
+         * @brief Gets the number of frames waiting for the writer thread right now
+         */
+        inline size_t getQueueDepth() const { return m_queue ? m_queue->size() : 0; }
+
+    private:
+        /**
+         * @brief Loop of the writer thread
+         */
+        void run();
+    };
+}
+
+
+#endif // Y4M_WRITER_H
@@ -5,20 +5,6 @@
 #include "meshes/mesh.h"
 
 
-void GLClearError(){
-    while (glGetError() != GL_NO_ERROR);
-}
-
-bool GLLogCall(const char* function, const char* file, int line){
-    while (GLenum error = glGetError()){
-        std::string fileStr(file);
-        std::string filename = fileStr.substr(fileStr.find_last_of("\\/") + 1);
-        std::cerr << "[OpenGL Error] (" << error << "): " << function << " " << filename << ":" << line << std::endl;
-        return false;
-    }
-    return true;
-}
-
 void Renderer::clear() const{
     GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
@@ -3,20 +3,10 @@
 
 #pragma once
 
-#ifndef ASSERT
-#define ASSERT(x) if (!(x)) __debugbreak();
-#endif
-
-#ifndef GLCall
-    #define GLCall(x) GLClearError();\
-    x;\
-    ASSERT(GLLogCall(#x, __FILE__, __LINE__))
-#endif
-
-
 #include <cassert>
 #include <GL/glew.h>
 
+#include "gl_check.h"
 #include "camera.h"
 #include "meshes/mesh.h"
 #include "meshes/instanced_mesh.h"
@@ -28,21 +18,6 @@ class Shader;
 class Camera;
 
 
-/**
- * @brief Clears the OpenGL error buffer
- */
-void GLClearError();
-
-/**
- * @brief Logs an OpenGL call
- * @param function the function that was called
- * @param file the file where the function was called
- * @param line the line where the function was called
- * @return true if there was no error, false otherwise
- */
-bool GLLogCall(const char* function, const char* file, int line);
-
-
 class Renderer{
 public:
     /**
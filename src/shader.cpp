@@ -7,6 +7,7 @@
 #include <filesystem>
 
 #include "renderer.h"
+#include "profiling/cpu_profiler.h"
 
 Shader::Shader()
     : m_renderer_id(0), m_file_path(""){
@@ -163,6 +164,8 @@ unsigned int Shader::compileShader(unsigned int type, const std::string &source)
 }
 
 unsigned int Shader::createShader(const std::string &vertex_shader, const std::string &fragment_shader){
+    PROFILE_ZONE("compile shader");
+
     // Create a program
     unsigned int program = glCreateProgram();
     
@@ -0,0 +1,89 @@
+#include "body_registry.h"
+
+#include <cassert>
+#include <utility>
+
+namespace physics{
+
+    BodyRegistry::BodyRegistry(uint32_t count){
+        m_slots.reserve(count);
+        m_dense_slots.reserve(count);
+        for (uint32_t i = 0; i < count; i++)
+            create();
+    }
+
+    BodyHandle BodyRegistry::create(){
+        uint32_t index = size();
+        uint32_t slot;
+
+        //Reuse a free slot if there is one, its generation was already incremented
+        if (m_free_slot != UINT32_MAX){
+            slot = m_free_slot;
+            m_free_slot = m_slots[slot].index;
+            m_slots[slot].index = index;
+        }
+        else{
+            slot = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back(Slot{ index, 0 });
+        }
+
+        m_dense_slots.push_back(slot);
+        return BodyHandle{ slot, m_slots[slot].generation };
+    }
+
+    BodyRegistry::Removal BodyRegistry::destroy(BodyHandle handle){
+        assert(isValid(handle));
+
+        uint32_t removed_index = m_slots[handle.slot].index;
+        uint32_t last_index = size() - 1;
+
+        //Move the last body into the hole
+        uint32_t last_slot = m_dense_slots[last_index];
+        m_dense_slots[removed_index] = last_slot;
+        m_slots[last_slot].index = removed_index;
+        m_dense_slots.pop_back();
+
+        //Free the slot, old handles no longer match its generation
+        m_slots[handle.slot].generation++;
+        m_slots[handle.slot].index = m_free_slot;
+        m_free_slot = handle.slot;
+
+        return Removal{ removed_index, last_index };
+    }
+
+    void BodyRegistry::permute(const std::vector<uint32_t>& order){
+        assert(order.size() == m_dense_slots.size());
+
+        std::vector<uint32_t> dense_slots(order.size());
+        for (uint32_t i = 0; i < order.size(); i++){
+            dense_slots[i] = m_dense_slots[order[i]];
+            m_slots[dense_slots[i]].index = i;
+        }
+        m_dense_slots = std::move(dense_slots);
+    }
+
+    bool BodyRegistry::isValid(BodyHandle handle) const{
+        return handle.slot < m_slots.size()
+            && m_slots[handle.slot].generation == handle.generation
+            && m_slots[handle.slot].index < m_dense_slots.size()
+            && m_dense_slots[m_slots[handle.slot].index] == handle.slot;
+    }
+
+    bool BodyRegistry::restore(std::vector<Slot> slots, std::vector<uint32_t> dense_slots, uint32_t free_slot){
+        //Every body has to own its slot, and the free list has to end without cycles
+        for (uint32_t i = 0; i < dense_slots.size(); i++){
+            if (dense_slots[i] >= slots.size() || slots[dense_slots[i]].index != i)
+                return false;
+        }
+        uint32_t free_count = 0;
+        for (uint32_t slot = free_slot; slot != UINT32_MAX; slot = slots[slot].index){
+            if (slot >= slots.size() || ++free_count > slots.size() - dense_slots.size())
+                return false;
+        }
+
+        m_slots = std::move(slots);
+        m_dense_slots = std::move(dense_slots);
+        m_free_slot = free_slot;
+        return true;
+    }
+}
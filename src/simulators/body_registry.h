@@ -0,0 +1,125 @@
+#ifndef BODY_REGISTRY_H
+#define BODY_REGISTRY_H
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace physics{
+
+    /**
+     * @brief Stable reference to a body. The dense index of a body changes when other bodies are
+     * removed, the handle does not. A handle of a removed body is detected by its generation
+     */
+    struct BodyHandle{
+        uint32_t slot = UINT32_MAX; /* Entry in the registry slot table */
+        uint32_t generation = 0; /* Generation of the slot when the handle was created */
+
+        bool operator==(const BodyHandle& other) const { return slot == other.slot && generation == other.generation; }
+        bool operator!=(const BodyHandle& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief Maps handles to the dense indices of the body arrays. Removing a body moves the last
+     * body into its place (swap-remove) so the arrays never have holes
+     */
+    class BodyRegistry{
+    public:
+        /**
+         * @brief Entry of the slot table
+         */
+        struct Slot{
+            uint32_t index; /* Dense index of the body, or next free slot if the slot is free */
+            uint32_t generation; /* Incremented each time the slot is freed */
+        };
+
+    private:
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_dense_slots; /* Slot of each dense index */
+        uint32_t m_free_slot = UINT32_MAX; /* Head of the free slot list */
+
+    public:
+        /**
+         * @brief Result of a removal, the body at moved_from now lives at removed_index
+         * (both are equal if the removed body was the last one)
+         */
+        struct Removal{
+            uint32_t removed_index;
+            uint32_t moved_from;
+        };
+
+        BodyRegistry() = default;
+
+        /**
+         * @brief Constructor
+         * @param count number of bodies created up front (handle i refers to index i)
+         */
+        explicit BodyRegistry(uint32_t count);
+
+        /**
+         * @brief Creates a body at the end of the dense arrays
+         * @return handle of the new body
+         */
+        BodyHandle create();
+
+        /**
+         * @brief Removes a body, the last body is moved into its index
+         * @param handle handle of the body (must be valid)
+         */
+        Removal destroy(BodyHandle handle);
+
+        /**
+         * @brief Moves the bodies to new dense indices, the handles keep referring to the same bodies
+         * @param order old index of the body that goes to each new index (a permutation of every body)
+         */
+        void permute(const std::vector<uint32_t>& order);
+
+        /**
+         * @brief Tells whether the handle refers to a live body
+         */
+        bool isValid(BodyHandle handle) const;
+
+        /**
+         * @brief Gets the dense index of a body (the handle must be valid)
+         */
+        inline uint32_t getIndex(BodyHandle handle) const { return m_slots[handle.slot].index; }
+
+        /**
+         * @brief Gets the handle of the body stored at a dense index
+         */
+        inline BodyHandle getHandle(uint32_t index) const { return BodyHandle{ m_dense_slots[index], m_slots[m_dense_slots[index]].generation }; }
+
+        /**
+         * @brief Gets the number of live bodies
+         */
+        inline uint32_t size() const { return static_cast<uint32_t>(m_dense_slots.size()); }
+
+        /**
+         * @brief Gets the slot table, to save the registry
+         */
+        inline const std::vector<Slot>& getSlots() const { return m_slots; }
+
+        /**
+         * @brief Gets the slot of each dense index, to save the registry
+         */
+        inline const std::vector<uint32_t>& getDenseSlots() const { return m_dense_slots; }
+
+        /**
+         * @brief Gets the head of the free slot list, to save the registry
+         */
+        inline uint32_t getFreeSlot() const { return m_free_slot; }
+
+        /**
+         * @brief Replaces the registry with a saved one, so the handles given before saving stay valid
+         * @param slots slot table
+         * @param dense_slots slot of each dense index
+         * @param free_slot head of the free slot list
+         * @return false (and the registry is left as it was) if the tables are not consistent
+         */
+        bool restore(std::vector<Slot> slots, std::vector<uint32_t> dense_slots, uint32_t free_slot);
+    };
+}
+
+
+#endif // BODY_REGISTRY_H
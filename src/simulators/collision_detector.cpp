@@ -35,30 +35,25 @@ CollisionDetector::CollisionDetector(
     std::cout<<"number of objects: "<<sim_transforms->size()<<std::endl;
     //Transform update shader
     m_transform_shader.setShader("sphere_transforms.glsl");
-    m_transform_shader.useTimer(false);
     m_transform_shader.bind();
     
     //Broad phase shader
     m_broad_phase_shader.setShader("collision_naive.glsl");
-    m_broad_phase_shader.useTimer(true);
     m_broad_phase_shader.bind();
 
     //Narrow phase shader
     // m_narrow_phase_shader.setShader("narrow_working.glsl");
     m_narrow_phase_shader.setShader("narrow_color.glsl");
-    m_narrow_phase_shader.useTimer(true);
     m_narrow_phase_shader.bind();
     
     //Resolution phase shaders
     m_impulse_phase_shader.setShader("jacobi_friction_impulse.glsl");
     // m_impulse_phase_shader.setShader("jacobi_rotation_impulse.glsl");
     // m_impulse_phase_shader.setShader("constraint_rotation.glsl");
-    m_impulse_phase_shader.useTimer(false);
     m_impulse_phase_shader.bind();
     
     m_accumulation_phase_shader.setShader("accumulator.glsl");
     // m_accumulation_phase_shader.setShader("accumulator_rotation.glsl");
-    m_accumulation_phase_shader.useTimer(false);
     m_accumulation_phase_shader.bind();
 
 
@@ -94,12 +89,8 @@ CollisionDetector::CollisionDetector(
     // m_object_edges_ssbo.setBuffer(m_object_edges.data(), m_object_edges.size() * sizeof(unsigned int), GL_STATIC_DRAW);
     m_object_edges_ssbo.unbind();
 
-
-    frames = 0;
-    broad_accumulator = 0;
-    narrow_accumulator = 0;
-    avg_broad_time = 0.0f;
-    avg_narrow_time = 0.0f;
+    m_broad_zone = m_profiler.registerPhase("broad");
+    m_narrow_zone = m_profiler.registerPhase("narrow");
 
 
     m_transform_ssbo.bindToBindingPoint(1);
@@ -123,53 +114,50 @@ CollisionDetector::~CollisionDetector(){
 }
 
 void CollisionDetector::update(float delta_time, glm::vec3 gravity){
+    m_profiler.beginFrame();
+
     //Transform phase
     int work_groups = (sim_transforms->size() + 256 - 1) / 256;
     m_transform_shader.use();
     m_transform_shader.setUniform1f("delta_time", delta_time);
     m_transform_shader.setUniform3f("gravity", gravity.x, gravity.y, gravity.z);
+    m_transform_shader.setUniform1ui("object_count", sim_transforms->size());
     m_transform_shader.dispatch(work_groups, 1, 1);
     m_transform_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
 
-    unsigned int broad_time = 0;
-    unsigned int narrow_time = 0;
     //Broad phase
     work_groups = (sim_transforms->size() + 8 - 1) / 8;
     m_broad_phase_shader.use();
+    m_broad_phase_shader.setUniform1ui("object_count", sim_transforms->size());
+    m_profiler.begin(m_broad_zone);
     m_broad_phase_shader.dispatch(work_groups * 64, 1, 1);
-    broad_time = m_broad_phase_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_profiler.end();
+    m_broad_phase_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
 
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
     m_collision_count_ssbo.bind();
     unsigned int collision_counter = *(unsigned int *)m_collision_count_ssbo.readData();
     m_collision_count_ssbo.unmapBuffer();
+    m_pair_count = collision_counter;
     
     // Narrow phase and resolution
     if(collision_counter > 0){
         work_groups = (collision_counter + 512 - 1) / 512;
         m_narrow_phase_shader.use();
+        m_profiler.begin(m_narrow_zone);
         m_narrow_phase_shader.dispatch(work_groups, 1, 1);
+        m_profiler.end();
         
-        narrow_time = m_narrow_phase_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
+        m_narrow_phase_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
         m_collision_count_ssbo.bind();
         collision_counter = *(unsigned int *)m_collision_count_ssbo.readData();
         // std::cout<<"Max count: "<<sim_spheres.size() * 10 <<" actual count: "<<collision_counter<<" Work Groups: "<<work_groups<<std::endl;
         m_collision_count_ssbo.unmapBuffer();
-        frames++;
-        broad_accumulator += broad_time;
-        narrow_accumulator += narrow_time;
-        
-        // if (frames % 100 == 0){
-        //     avg_broad_time = static_cast<float>(broad_accumulator) / (frames * 1000000);
-        //     avg_narrow_time = static_cast<float>(narrow_accumulator) / (frames * 1000000);
-        //     std::cout<<"Average Broad Time: "<<avg_broad_time<<" ms | Average Narrow Time: "<<avg_narrow_time<<" ms"<<std::endl;
-        //     broad_accumulator = 0;
-        //     narrow_accumulator = 0;
-        //     frames = 0;
-        // }
     }
+    m_contact_count = collision_counter;
 
+    m_profiler.endFrame();
 }
 
 
@@ -6,12 +6,13 @@
 #include <vector>
 
 #include "glm/glm.hpp"
-#include "vertex_buffer.h"
+#include "../vertex.h"
 
 #include "simulators/simulable.h"
 #include "utils.h"
 #include "../buffers/shader_storage_buffer.h"
 #include "compute_shader.h"
+#include "../profiling/gpu_profiler.h"
 
 /**
  * @brief class representation of a simulator running on the cpu
@@ -54,13 +55,13 @@ private:
     ShaderStorageBuffer m_object_normals_ssbo;
     ShaderStorageBuffer m_object_edges_ssbo;
 
-    unsigned int frames = 0;
-    unsigned int broad_accumulator = 0;
-    unsigned int narrow_accumulator = 0;
-    float avg_narrow_time = 0;
-    float avg_broad_time = 0;
+    profiling::GpuProfiler m_profiler; /* Gpu time of the phases, read without stalling */
+    unsigned int m_broad_zone;
+    unsigned int m_narrow_zone;
 
     unsigned int m_zero = 0;
+    unsigned int m_pair_count = 0; /* Broad phase pairs of the last step */
+    unsigned int m_contact_count = 0; /* Narrow phase contacts of the last step */
 
 public:
     /**
@@ -89,6 +90,21 @@ public:
      */
     void update(float delta_time, glm::vec3 gravity = glm::vec3(0.0f, 0.0f, 0.0f)) override;
 
+    /**
+     * @brief Gets the profiler with the gpu time of each phase of the step
+     */
+    inline profiling::GpuProfiler& getProfiler() { return m_profiler; }
+
+    /**
+     * @brief Gets the number of broad phase pairs found in the last step
+     */
+    inline unsigned int getPairCount() const { return m_pair_count; }
+
+    /**
+     * @brief Gets the number of contacts found in the last step
+     */
+    inline unsigned int getContactCount() const { return m_contact_count; }
+
 private:
 
     /**
@@ -1,7 +1,10 @@
 #include "gpu_simulator.h"
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <chrono>
+#include <sstream>
 
 #include "glm/gtc/matrix_transform.hpp" 
 #include "glm/gtx/transform.hpp"
@@ -11,6 +14,51 @@
 #include "glm/gtx/component_wise.hpp"
 #include "../constants.h"
 #include "../utils.h"
+#include "../profiling/cpu_profiler.h"
+#include "../recording/checkpoint.h"
+#include "morton_order.h"
+
+namespace{
+    /**
+     * @brief Copies the start of a buffer into host memory (stalls until the gpu wrote it)
+     */
+    template<typename T>
+    void downloadBuffer(ShaderStorageBuffer& buffer, size_t count, std::vector<T>& data){
+        data.resize(count);
+        if (count == 0)
+            return;
+        buffer.bind();
+        const T* mapped = (const T *)buffer.readData();
+        std::copy(mapped, mapped + count, data.begin());
+        buffer.unmapBuffer();
+    }
+
+    /**
+     * @brief Writes vectors as a GLSL initializer list, with enough digits to give back the same floats
+     */
+    std::string toGlslList(const std::vector<glm::vec4>& vectors){
+        std::ostringstream list;
+        list << std::setprecision(9);
+        for (size_t i = 0; i < vectors.size(); i++){
+            const glm::vec4& v = vectors[i];
+            list << (i > 0 ? ", " : "") << "vec4(" << v.x << ", " << v.y << ", " << v.z << ", " << v.w << ")";
+        }
+        return list.str();
+    }
+
+    /**
+     * @brief Uploads a per body section of a checkpoint, the buffer is cleared if the section is missing
+     */
+    template<typename T>
+    void uploadSection(const recording::CheckpointReader& reader, recording::CheckpointSection id, ShaderStorageBuffer& buffer, unsigned int bodies){
+        size_t count;
+        const T* data = reader.getSection<T>(id, count);
+        bool present = data && count == bodies;
+        buffer.setBuffer(present ? data : nullptr, bodies * sizeof(T), GL_DYNAMIC_DRAW);
+        if (!present)
+            buffer.clearData();
+    }
+}
 
 
 GpuSimulator::GpuSimulator(
@@ -20,7 +68,8 @@ GpuSimulator::GpuSimulator(
     const std::vector<glm::vec4>* object_vertices,
     const std::vector<glm::vec4>* object_normals, 
     const std::vector<glm::vec4>* object_edges,
-    std::vector<physics::Properties>* properties
+    std::vector<physics::Properties>* properties,
+    const physics::WorldLayout* worlds
 ) : sim_transforms(transforms), 
     sim_static_vertices(static_vertices), 
     sim_static_indices(static_indices),
@@ -32,40 +81,72 @@ GpuSimulator::GpuSimulator(
 
     initializeData();
 
+    m_registry = physics::BodyRegistry(static_cast<unsigned int>(sim_transforms->size()));
+    m_body_count = static_cast<unsigned int>(sim_transforms->size());
+    m_pending_peak = m_body_count;
+    m_capacity = m_body_count;
+    //Pairs never cross worlds, so the buffers only need room for the pairs inside each world
+    bool has_worlds = worlds && worlds->isValid(m_body_count);
+    m_pair_capacity = static_cast<unsigned int>(has_worlds ? worlds->getPairBound(m_body_count) : static_cast<uint64_t>(m_body_count) * m_body_count);
+
     std::cout<<"number of objects: "<<sim_transforms->size()<<std::endl;
     //Transform update shader
     m_transform_shader.setShader("sphere_transforms.glsl");
-    m_transform_shader.useTimer(false);
     m_transform_shader.bind();
     
     //Broad phase shader
     m_broad_phase_shader.setShader("collision_naive.glsl");
-    m_broad_phase_shader.useTimer(false);
     m_broad_phase_shader.bind();
 
-    //Narrow phase shader
-    m_narrow_phase_shader.setShader("narrow_working.glsl");
+    //Narrow phase shader. An empty list is not valid GLSL, shapes without edges are never baked
+    if (!m_object_vertices->empty() && !m_object_normals->empty() && !m_object_edges->empty()){
+        m_shape_defines["SHAPE_VERTICES"] = toGlslList(*m_object_vertices);
+        m_shape_defines["SHAPE_NORMALS"] = toGlslList(*m_object_normals);
+        m_shape_defines["SHAPE_EDGES"] = toGlslList(*m_object_edges);
+    }
+    m_narrow_phase_shader.setShader("narrow_working.glsl", getNarrowDefines());
     // m_narrow_phase_shader.setShader("narrow_rotation.glsl");
-    m_narrow_phase_shader.useTimer(false);
     m_narrow_phase_shader.bind();
+
+    m_cooperative_narrow_shader.setShader("narrow_cooperative.glsl", getNarrowDefines());
+    m_cooperative_narrow_shader.bind();
+    selectNarrowShader();
     
     //Resolution phase shaders
     m_impulse_phase_shader.setShader("jacobi_friction_impulse.glsl");
     // m_impulse_phase_shader.setShader("jacobi_rotation_impulse.glsl");
     // m_impulse_phase_shader.setShader("constraint_rotation.glsl");
-    m_impulse_phase_shader.useTimer(false);
     m_impulse_phase_shader.bind();
     
     m_accumulation_phase_shader.setShader("accumulator.glsl");
     // m_accumulation_phase_shader.setShader("accumulator_rotation.glsl");
-    m_accumulation_phase_shader.useTimer(false);
     m_accumulation_phase_shader.bind();
 
+    m_sort_pairs_shader.setShader("sort_pairs.glsl");
+    m_sort_pairs_shader.bind();
+
+    m_permute_shader.setShader("permute_bodies.glsl");
+    m_permute_shader.bind();
+
+    m_step_zone = m_profiler.registerPhase("step");
+    m_transform_zone = m_profiler.registerPhase("transforms");
+    m_broad_zone = m_profiler.registerPhase("broad");
+    m_narrow_zone = m_profiler.registerPhase("narrow");
+    m_impulse_zone = m_profiler.registerPhase("impulse");
+    m_accumulation_zone = m_profiler.registerPhase("accumulation");
+    m_sort_zone = m_profiler.registerPhase("sort");
+    m_publish_zone = m_profiler.registerPhase("render copy");
+
 
     //SSBOs
     m_transform_ssbo.setBuffer(sim_transforms->data(), sim_transforms->size() * sizeof(glm::mat4), GL_DYNAMIC_DRAW);
     m_transform_ssbo.unbind();
 
+    for (ShaderStorageBuffer& slot : m_render_transform_ssbos){
+        slot.setBuffer(sim_transforms->data(), sim_transforms->size() * sizeof(glm::mat4), GL_DYNAMIC_COPY);
+        slot.unbind();
+    }
+
     m_properties_ssbo.setBuffer(sim_properties->data(), sim_properties->size() * sizeof(physics::Properties), GL_DYNAMIC_DRAW);
     m_properties_ssbo.unbind();
 
@@ -75,7 +156,7 @@ GpuSimulator::GpuSimulator(
     m_spheres_ssbo.setBuffer(sim_spheres.data(), sim_spheres.size() * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
     m_spheres_ssbo.unbind();
 
-    m_collision_pair_ssbo.setBuffer(nullptr, sim_spheres.size() * sim_spheres.size() * sizeof(glm::ivec2) , GL_DYNAMIC_DRAW);
+    m_collision_pair_ssbo.setBuffer(nullptr, m_pair_capacity * sizeof(glm::ivec2) , GL_DYNAMIC_DRAW);
     m_collision_pair_ssbo.unbind();
 
     m_collision_count_ssbo.setBuffer(nullptr, sizeof(unsigned int), GL_DYNAMIC_DRAW);
@@ -94,9 +175,10 @@ GpuSimulator::GpuSimulator(
     // m_object_edges_ssbo.setBuffer(m_object_edges.data(), m_object_edges.size() * sizeof(unsigned int), GL_STATIC_DRAW);
     m_object_edges_ssbo.unbind();
 
-    std::vector<physics::ContactManifold> manifolds(sim_spheres.size() * sim_spheres.size(), physics::ContactManifold());
+    //Zero filled buffers are cleared on the gpu instead of uploading a temporary host copy
     std::cout << "sizeof(ContactManifold): " << sizeof(physics::ContactManifold) << std::endl;
-    m_contact_manifolds_ssbo.setBuffer(manifolds.data(), sim_spheres.size() * sim_spheres.size() * sizeof(physics::ContactManifold), GL_DYNAMIC_DRAW);
+    m_contact_manifolds_ssbo.setBuffer(nullptr, m_pair_capacity * sizeof(physics::ContactManifold), GL_DYNAMIC_DRAW);
+    m_contact_manifolds_ssbo.clearData();
     m_contact_manifolds_ssbo.unbind();
     
     // //---------------------------------
@@ -106,20 +188,20 @@ GpuSimulator::GpuSimulator(
     // m_tangent_impulses_ssbo.setBuffer(m_tangent_impulses.data(), sim_spheres.size() * sizeof(glm::vec3) * 2, GL_DYNAMIC_DRAW);
     // m_tangent_impulses_ssbo.unbind();
 
-    std::vector<glm::vec4> deltaV(sim_transforms->size(), glm::vec4(0.0f));
-    m_deltaV_ssbo.setBuffer(deltaV.data(), sim_transforms->size() * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+    m_deltaV_ssbo.setBuffer(nullptr, sim_transforms->size() * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+    m_deltaV_ssbo.clearData();
     m_deltaV_ssbo.unbind();
 
-    std::vector<glm::vec4> deltaW(sim_transforms->size(), glm::vec4(0.0f));
-    m_deltaW_ssbo.setBuffer(deltaW.data(), sim_transforms->size() * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+    m_deltaW_ssbo.setBuffer(nullptr, sim_transforms->size() * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+    m_deltaW_ssbo.clearData();
     m_deltaW_ssbo.unbind();
 
-    std::vector<float> lambdas(sim_transforms->size(), 0.0f);
-    m_lambdas_ssbo.setBuffer(lambdas.data(), sim_transforms->size() * sizeof(float), GL_DYNAMIC_DRAW);
+    m_lambdas_ssbo.setBuffer(nullptr, sim_transforms->size() * sizeof(float), GL_DYNAMIC_DRAW);
+    m_lambdas_ssbo.clearData();
     m_lambdas_ssbo.unbind();
 
-    std::vector<float> new_lambdas(sim_transforms->size(), 0.0f);
-    m_new_lambdas_ssbo.setBuffer(new_lambdas.data(), sim_transforms->size() * sizeof(float), GL_DYNAMIC_DRAW);
+    m_new_lambdas_ssbo.setBuffer(nullptr, sim_transforms->size() * sizeof(float), GL_DYNAMIC_DRAW);
+    m_new_lambdas_ssbo.clearData();
     m_new_lambdas_ssbo.unbind();
 
     // m_delta_angular_impulses_ssbo.setBuffer(m_delta_angular_impulses.data(), sim_transforms->size() * sizeof(glm::vec3), GL_DYNAMIC_DRAW);
@@ -147,28 +229,80 @@ GpuSimulator::GpuSimulator(
     m_deltaW_ssbo.bindToBindingPoint(30);
     m_lambdas_ssbo.bindToBindingPoint(31);
     m_new_lambdas_ssbo.bindToBindingPoint(32);
+
+    m_body_worlds_ssbo.bindToBindingPoint(13);
+    m_world_offsets_ssbo.bindToBindingPoint(14);
+    m_world_params_ssbo.bindToBindingPoint(15);
+
+    //The reorder buffers are created by the first reorder
+    m_reorder_ssbo.setBuffer(nullptr, sizeof(uint32_t), GL_DYNAMIC_DRAW);
+    m_reorder_ssbo.unbind();
+    m_reorder_scratch_ssbo.setBuffer(nullptr, sizeof(glm::vec4), GL_DYNAMIC_COPY);
+    m_reorder_scratch_ssbo.unbind();
+    m_reorder_ssbo.bindToBindingPoint(16);
+    m_reorder_scratch_ssbo.bindToBindingPoint(18);
+
+    //The pair sort buffers grow with the pairs of the first sorted steps
+    m_pair_scratch_ssbo.setBuffer(nullptr, sizeof(glm::ivec2), GL_DYNAMIC_COPY);
+    m_pair_scratch_ssbo.unbind();
+    m_manifold_scratch_ssbo.setBuffer(nullptr, sizeof(physics::ContactManifold), GL_DYNAMIC_COPY);
+    m_manifold_scratch_ssbo.unbind();
+    m_group_counts_ssbo.setBuffer(nullptr, sizeof(uint32_t), GL_DYNAMIC_COPY);
+    m_group_counts_ssbo.unbind();
+    m_group_counts_ssbo.bindToBindingPoint(9);
+    if (!worlds || !setWorlds(*worlds))
+        uploadWorlds();
 }
 
 GpuSimulator::~GpuSimulator(){
     sim_transforms = nullptr;
     sim_static_vertices = nullptr;
     sim_static_indices = nullptr;
+
+    for (GLsync& fence : m_render_fences){
+        if (fence)
+            glDeleteSync(fence);
+    }
 }
 
 void GpuSimulator::update(float delta_time, glm::vec3 gravity){
+    PROFILE_ZONE("gpu step");
+
+    //The renderer may have left a render slot on the transform binding point
+    m_transform_ssbo.attachToBindingPoint(1);
+
+    applyPendingChanges();
+    m_pair_count = 0;
+    if (m_body_count == 0)
+        return;
+
+    if (m_reorder_interval > 0 && ++m_steps_since_reorder >= m_reorder_interval)
+        reorderBodies();
+
+    m_profiler.beginFrame();
+    m_profiler.begin(m_step_zone);
+
     //Transform phase
-    int work_groups = (sim_transforms->size() + 256 - 1) / 256;
+    int work_groups = (m_body_count + 256 - 1) / 256;
     m_transform_shader.use();
     m_transform_shader.setUniform1f("delta_time", delta_time);
     m_transform_shader.setUniform3f("gravity", gravity.x, gravity.y, gravity.z);
+    m_transform_shader.setUniform1ui("object_count", m_body_count);
+    m_transform_shader.setUniform1ui("world_count", m_worlds.getWorldCount());
+    m_profiler.begin(m_transform_zone);
     m_transform_shader.dispatch(work_groups, 1, 1);
+    m_profiler.end();
     m_transform_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
 
     //Broad phase
     // SPLITED LOAD
-    work_groups = (sim_transforms->size() + 8 - 1) / 8;
+    work_groups = (m_body_count + 8 - 1) / 8;
     m_broad_phase_shader.use();
+    m_broad_phase_shader.setUniform1ui("object_count", m_body_count);
+    m_broad_phase_shader.setUniform1ui("world_count", m_worlds.getWorldCount());
+    m_profiler.begin(m_broad_zone);
     m_broad_phase_shader.dispatch(work_groups * 64, 1, 1);
+    m_profiler.end();
     m_broad_phase_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
 
     // SIMPLE LOAD
@@ -177,23 +311,61 @@ void GpuSimulator::update(float delta_time, glm::vec3 gravity){
     // m_broad_phase_shader.dispatch(work_groups, 1, 1);
     // m_broad_phase_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
 
+    //Waits for the gpu to finish the broad phase
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-    m_collision_count_ssbo.bind();
-    unsigned int collision_counter = *(unsigned int *)m_collision_count_ssbo.readData();
-    m_collision_count_ssbo.unmapBuffer();
+    unsigned int collision_counter;
+    {
+        PROFILE_ZONE("collision count readback");
+        m_collision_count_ssbo.bind();
+        collision_counter = *(unsigned int *)m_collision_count_ssbo.readData();
+        m_collision_count_ssbo.unmapBuffer();
+    }
+    PROFILE_COUNTER("gpu pairs", collision_counter);
+    m_pair_count = collision_counter;
+
+    unsigned int pair_count = std::min(collision_counter, m_pair_capacity);
+    if (isSortingPairs() && pair_count > 0)
+        sortPairs(pair_count);
     
     // Narrow phase and resolution
     if(collision_counter > 0){
-        work_groups = (collision_counter + 512 - 1) / 512;
-        m_narrow_phase_shader.use();
-        m_narrow_phase_shader.dispatch(work_groups, 1, 1);
-        
-        m_narrow_phase_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        //The counter goes on with the manifolds. It is cleared here because a clear inside the
+        //shader races with the work groups that already started counting
         m_collision_count_ssbo.bind();
-        collision_counter = *(unsigned int *)m_collision_count_ssbo.readData();
-        // std::cout<<"Max count: "<<sim_spheres.size() * sim_spheres.size() <<" actual count: "<<collision_counter<<" Work Groups: "<<work_groups<<std::endl;
-        m_collision_count_ssbo.unmapBuffer();
+        m_collision_count_ssbo.clearData();
+
+        //The deterministic mode writes the manifold of each pair at its index, so they keep the
+        //order of the sorted pairs, and drops the empty ones afterwards
+        if (m_deterministic){
+            if (m_manifold_scratch_ssbo.getSize() < pair_count * sizeof(physics::ContactManifold))
+                m_manifold_scratch_ssbo.setBuffer(nullptr, pair_count * sizeof(physics::ContactManifold), GL_DYNAMIC_COPY);
+            m_manifold_scratch_ssbo.attachToBindingPoint(26);
+        }
+
+        //The program of the current settings was picked when they changed
+        ComputeShader& narrow_shader = *m_narrow_shader;
+        if (isCooperativeNarrowPhase())
+            work_groups = std::min((pair_count + C_COOPERATIVE_PAIRS_PER_GROUP - 1) / C_COOPERATIVE_PAIRS_PER_GROUP, C_COOPERATIVE_MAX_GROUPS);
+        else
+            work_groups = (collision_counter + C_NARROW_LOCAL_SIZE - 1) / C_NARROW_LOCAL_SIZE;
+        narrow_shader.use();
+        narrow_shader.setUniform1ui("pair_count", pair_count);
+        if (!m_specialize_shaders)
+            narrow_shader.setUniform1ui("ordered_manifolds", m_deterministic ? 1 : 0);
+        m_profiler.begin(m_narrow_zone);
+        narrow_shader.dispatch(work_groups, 1, 1);
+        m_profiler.end();
+        
+        narrow_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        if (m_deterministic){
+            compactManifolds(pair_count);
+            m_contact_manifolds_ssbo.attachToBindingPoint(26);
+        }
+
+        //The narrow phase keeps at most collision_counter manifolds and the impulse shader
+        //bounds itself with the count on the gpu, so the count is not read back again
+        //(a second readback would stall the cpu until the narrow phase finishes)
         
 
         for(int i = 0; i < 10 && collision_counter > 0; i++){
@@ -228,7 +400,12 @@ void GpuSimulator::update(float delta_time, glm::vec3 gravity){
             work_groups = (collision_counter + 256 - 1) / 256;
             m_impulse_phase_shader.use();
             m_impulse_phase_shader.setUniform1f("delta_time", delta_time);
+            m_impulse_phase_shader.setUniform1ui("world_count", m_worlds.getWorldCount());
+            m_impulse_phase_shader.setUniform1ui("deterministic", m_deterministic ? 1 : 0);
+            m_impulse_phase_shader.setUniform1f("fixed_point_scale", C_FIXED_POINT_SCALE);
+            m_profiler.begin(m_impulse_zone);
             m_impulse_phase_shader.dispatch(work_groups, 1, 1);
+            m_profiler.end();
             
             glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT); // Essential for SSBO read-after-write
             
@@ -270,10 +447,15 @@ void GpuSimulator::update(float delta_time, glm::vec3 gravity){
             // // ------------------------------------------------------------------//
 
             
-            work_groups = (sim_transforms->size() + 256 - 1) / 256;
+            work_groups = (m_body_count + 256 - 1) / 256;
             // std::cout<<"Work: "<<work_groups<<" collision: "<<collision_counter<<std::endl;
             m_accumulation_phase_shader.use();
+            m_accumulation_phase_shader.setUniform1ui("object_count", m_body_count);
+            m_accumulation_phase_shader.setUniform1ui("deterministic", m_deterministic ? 1 : 0);
+            m_accumulation_phase_shader.setUniform1f("fixed_point_scale", C_FIXED_POINT_SCALE);
+            m_profiler.begin(m_accumulation_zone);
             m_accumulation_phase_shader.dispatch(work_groups, 1, 1);
+            m_profiler.end();
 
             glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
 
@@ -316,6 +498,53 @@ void GpuSimulator::update(float delta_time, glm::vec3 gravity){
             // //------------------------------------------------------------------//
         }
     }
+
+    m_profiler.begin(m_publish_zone);
+    publishRenderState();
+    m_profiler.end();
+
+    m_profiler.end();
+    m_profiler.endFrame();
+}
+
+void GpuSimulator::publishRenderState(){
+    unsigned int slot = static_cast<unsigned int>(m_render_steps % C_RENDER_SLOTS);
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_render_transform_ssbos[slot].copyFrom(m_transform_ssbo, m_body_count * sizeof(glm::mat4));
+
+    if (m_render_fences[slot])
+        glDeleteSync(m_render_fences[slot]);
+    m_render_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_render_steps++;
+}
+
+bool GpuSimulator::isRenderSlotReady(unsigned int slot){
+    if (!m_render_fences[slot])
+        return true;
+
+    GLenum status = glClientWaitSync(m_render_fences[slot], 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+
+    //Signaled fences stay signaled, drop it so the next frames skip the query
+    glDeleteSync(m_render_fences[slot]);
+    m_render_fences[slot] = nullptr;
+    return true;
+}
+
+void GpuSimulator::bindRenderState(){
+    //Before the first step every slot holds the initial transforms
+    unsigned long long current = m_render_steps > 0 ? m_render_steps - 1 : 0;
+
+    //Draw from the step before if the last one is still running. That slot was fenced a step
+    //earlier, and GL orders the draw after its copy anyway
+    if (current > 0 && !isRenderSlotReady(static_cast<unsigned int>(current % C_RENDER_SLOTS)))
+        current--;
+
+    unsigned long long previous = current > 0 ? current - 1 : 0;
+    m_render_transform_ssbos[current % C_RENDER_SLOTS].attachToBindingPoint(1);
+    m_render_transform_ssbos[previous % C_RENDER_SLOTS].attachToBindingPoint(12);
 }
 
 
@@ -323,6 +552,7 @@ void GpuSimulator::initializeData(){
     //Create AABBs
     float base_radius = utils::calculateRadius(*sim_static_vertices);
     std::cout<<base_radius<<std::endl;
+    m_base_radius = base_radius;
     sim_spheres.resize(sim_transforms->size(), glm::vec4(0.0f, 0.0f, 0.0f, base_radius));
 
 
@@ -367,4 +597,544 @@ void GpuSimulator::initializeData(){
     // m_tangent_impulses.resize(sim_spheres.size() * sim_spheres.size() , glm::vec3(0.0f));
     // m_delta_linear_impulses.resize(sim_transforms->size(), glm::vec3(0.0f));
     // m_delta_angular_impulses.resize(sim_transforms->size(), glm::vec3(0.0f));
-}
\ No newline at end of file
+}
+
+
+physics::BodyHandle GpuSimulator::addBody(const glm::mat4& transform, const physics::Properties& properties, const glm::vec4& color){
+    physics::BodyHandle handle = m_registry.create();
+
+    glm::vec3 scale = utils::scaleFromTransform(transform);
+    glm::vec4 sphere = glm::vec4(glm::vec3(transform[3]), m_base_radius * glm::max(scale.x, glm::max(scale.y, scale.z)));
+
+    m_pending_changes.push_back(BodyChange{ false, m_registry.getIndex(handle), 0, transform, properties, sphere, color });
+    m_pending_peak = std::max(m_pending_peak, m_registry.size());
+    return handle;
+}
+
+bool GpuSimulator::removeBody(physics::BodyHandle handle){
+    if (!m_registry.isValid(handle))
+        return false;
+
+    physics::BodyRegistry::Removal removal = m_registry.destroy(handle);
+
+    //Removing the last body only shrinks the count
+    if (removal.moved_from != removal.removed_index){
+        BodyChange change{};
+        change.is_move = true;
+        change.index = removal.removed_index;
+        change.from = removal.moved_from;
+        m_pending_changes.push_back(change);
+    }
+    return true;
+}
+
+unsigned int GpuSimulator::getContactCount(){
+    //Without pairs the narrow phase did not run and the counter still holds the broad phase count
+    if (m_pair_count == 0)
+        return 0;
+
+    //The narrow phase reuses the counter for the manifolds it writes
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_collision_count_ssbo.bind();
+    unsigned int contacts = *(unsigned int *)m_collision_count_ssbo.readData();
+    m_collision_count_ssbo.unmapBuffer();
+    return contacts;
+}
+
+void GpuSimulator::readTransforms(std::vector<glm::mat4>& transforms){
+    transforms.resize(m_body_count);
+    if (m_body_count == 0)
+        return;
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_transform_ssbo.bind();
+    const glm::mat4* data = (const glm::mat4 *)m_transform_ssbo.readData();
+    std::copy(data, data + m_body_count, transforms.begin());
+    m_transform_ssbo.unmapBuffer();
+}
+
+bool GpuSimulator::saveCheckpoint(const std::string& path, uint64_t seed){
+    PROFILE_ZONE("save checkpoint");
+
+    applyPendingChanges();
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    //The shaders drop the pairs and contacts that do not fit in the buffers
+    unsigned int pairs = std::min(m_pair_count, m_pair_capacity);
+    unsigned int contacts = std::min(getContactCount(), m_pair_capacity);
+
+    std::vector<glm::mat4> transforms;
+    std::vector<physics::Properties> properties;
+    std::vector<glm::vec4> spheres, colors, delta_v, delta_w;
+    std::vector<glm::ivec2> pair_data;
+    std::vector<physics::ContactManifold> manifolds;
+    std::vector<int> results, second_results;
+    std::vector<float> lambdas, new_lambdas;
+    downloadBuffer(m_transform_ssbo, m_body_count, transforms);
+    downloadBuffer(m_properties_ssbo, m_body_count, properties);
+    downloadBuffer(m_spheres_ssbo, m_body_count, spheres);
+    downloadBuffer(m_collision_pair_ssbo, pairs, pair_data);
+    downloadBuffer(m_contact_manifolds_ssbo, contacts, manifolds);
+    downloadBuffer(m_results_ssbo, m_body_count, results);
+    downloadBuffer(m_second_results_ssbo, m_body_count, second_results);
+    downloadBuffer(m_deltaV_ssbo, m_body_count, delta_v);
+    downloadBuffer(m_deltaW_ssbo, m_body_count, delta_w);
+    downloadBuffer(m_lambdas_ssbo, m_body_count, lambdas);
+    downloadBuffer(m_new_lambdas_ssbo, m_body_count, new_lambdas);
+    if (m_color_ssbo)
+        downloadBuffer(*m_color_ssbo, m_body_count, colors);
+    m_transform_ssbo.unbind();
+
+    //The pair sort leaves the pairs it dropped at the end as (-1, -1)
+    while (!pair_data.empty() && pair_data.back().x < 0)
+        pair_data.pop_back();
+    pairs = static_cast<unsigned int>(pair_data.size());
+
+    recording::CheckpointWriter writer;
+    writer.addSection(recording::CheckpointSection::Transforms, transforms.data(), transforms.size());
+    writer.addSection(recording::CheckpointSection::Properties, properties.data(), properties.size());
+    writer.addSection(recording::CheckpointSection::Spheres, spheres.data(), spheres.size());
+    if (m_color_ssbo)
+        writer.addSection(recording::CheckpointSection::Colors, colors.data(), colors.size());
+    writer.addSection(recording::CheckpointSection::RegistrySlots, m_registry.getSlots().data(), m_registry.getSlots().size());
+    writer.addSection(recording::CheckpointSection::RegistryDense, m_registry.getDenseSlots().data(), m_registry.getDenseSlots().size());
+    writer.addSection(recording::CheckpointSection::Pairs, pair_data.data(), pair_data.size());
+    writer.addSection(recording::CheckpointSection::Manifolds, manifolds.data(), manifolds.size());
+    writer.addSection(recording::CheckpointSection::Results, results.data(), results.size());
+    writer.addSection(recording::CheckpointSection::SecondResults, second_results.data(), second_results.size());
+    writer.addSection(recording::CheckpointSection::DeltaV, delta_v.data(), delta_v.size());
+    writer.addSection(recording::CheckpointSection::DeltaW, delta_w.data(), delta_w.size());
+    writer.addSection(recording::CheckpointSection::Lambdas, lambdas.data(), lambdas.size());
+    writer.addSection(recording::CheckpointSection::NewLambdas, new_lambdas.data(), new_lambdas.size());
+
+    recording::CheckpointHeader header{};
+    header.body_count = m_body_count;
+    header.seed = seed;
+    header.pair_count = pairs;
+    header.contact_count = contacts;
+    header.free_slot = m_registry.getFreeSlot();
+    return writer.save(path, header);
+}
+
+bool GpuSimulator::loadCheckpoint(const std::string& path, uint64_t* seed){
+    PROFILE_ZONE("load checkpoint");
+
+    recording::CheckpointReader reader;
+    if (!reader.open(path))
+        return false;
+
+    const recording::CheckpointHeader& header = reader.getHeader();
+    unsigned int bodies = header.body_count;
+
+    size_t transform_count, properties_count, sphere_count;
+    const glm::mat4* transforms = reader.getSection<glm::mat4>(recording::CheckpointSection::Transforms, transform_count);
+    const physics::Properties* properties = reader.getSection<physics::Properties>(recording::CheckpointSection::Properties, properties_count);
+    const glm::vec4* spheres = reader.getSection<glm::vec4>(recording::CheckpointSection::Spheres, sphere_count);
+    if (!transforms || !properties || transform_count != bodies || properties_count != bodies){
+        std::cerr << "GpuSimulator: the bodies of " << path << " do not match its header" << std::endl;
+        return false;
+    }
+
+    //Handles given before saving stay valid. Checkpoints of the cpu simulator have no registry,
+    //their bodies get the handles of their indices
+    physics::BodyRegistry registry(bodies);
+    size_t slot_count, dense_count;
+    const physics::BodyRegistry::Slot* slots = reader.getSection<physics::BodyRegistry::Slot>(recording::CheckpointSection::RegistrySlots, slot_count);
+    const uint32_t* dense = reader.getSection<uint32_t>(recording::CheckpointSection::RegistryDense, dense_count);
+    if (slots && dense && (dense_count != bodies || !registry.restore(
+            std::vector<physics::BodyRegistry::Slot>(slots, slots + slot_count),
+            std::vector<uint32_t>(dense, dense + dense_count), header.free_slot))){
+        std::cerr << "GpuSimulator: the body registry of " << path << " is corrupt" << std::endl;
+        return false;
+    }
+
+    //Checkpoints without spheres get them from the transforms
+    std::vector<glm::vec4> computed_spheres;
+    if (!spheres || sphere_count != bodies){
+        computed_spheres.resize(bodies);
+        for (unsigned int i = 0; i < bodies; i++){
+            glm::vec3 scale = utils::scaleFromTransform(transforms[i]);
+            computed_spheres[i] = glm::vec4(glm::vec3(transforms[i][3]), m_base_radius * glm::max(scale.x, glm::max(scale.y, scale.z)));
+        }
+        spheres = computed_spheres.data();
+    }
+
+    m_pending_changes.clear();
+    m_registry = std::move(registry);
+    m_body_count = bodies;
+    m_pending_peak = bodies;
+    m_capacity = bodies;
+
+    //The worlds are kept if the bodies still fit them
+    if (!m_worlds.isValid(bodies)){
+        std::cerr << "GpuSimulator: " << path << " does not fit the worlds, going back to a single world" << std::endl;
+        m_worlds = physics::WorldLayout();
+    }
+    m_pair_capacity = static_cast<unsigned int>(m_worlds.getPairBound(bodies));
+    m_pair_count = std::min(header.pair_count, m_pair_capacity);
+
+    //Every slot starts with the loaded transforms, as before the first step
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_transform_ssbo.setBuffer(transforms, bodies * sizeof(glm::mat4), GL_DYNAMIC_DRAW);
+    for (unsigned int slot = 0; slot < C_RENDER_SLOTS; slot++){
+        m_render_transform_ssbos[slot].setBuffer(transforms, bodies * sizeof(glm::mat4), GL_DYNAMIC_COPY);
+        if (m_render_fences[slot])
+            glDeleteSync(m_render_fences[slot]);
+        m_render_fences[slot] = nullptr;
+    }
+    m_render_steps = 0;
+
+    m_properties_ssbo.setBuffer(properties, bodies * sizeof(physics::Properties), GL_DYNAMIC_DRAW);
+    m_spheres_ssbo.setBuffer(spheres, bodies * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+    uploadSection<int>(reader, recording::CheckpointSection::Results, m_results_ssbo, bodies);
+    uploadSection<int>(reader, recording::CheckpointSection::SecondResults, m_second_results_ssbo, bodies);
+    uploadSection<glm::vec4>(reader, recording::CheckpointSection::DeltaV, m_deltaV_ssbo, bodies);
+    uploadSection<glm::vec4>(reader, recording::CheckpointSection::DeltaW, m_deltaW_ssbo, bodies);
+    uploadSection<float>(reader, recording::CheckpointSection::Lambdas, m_lambdas_ssbo, bodies);
+    uploadSection<float>(reader, recording::CheckpointSection::NewLambdas, m_new_lambdas_ssbo, bodies);
+
+    //The pair and manifold buffers keep room for every possible pair, only the used part is stored
+    size_t pair_count, manifold_count;
+    const glm::ivec2* pairs = reader.getSection<glm::ivec2>(recording::CheckpointSection::Pairs, pair_count);
+    const physics::ContactManifold* manifolds = reader.getSection<physics::ContactManifold>(recording::CheckpointSection::Manifolds, manifold_count);
+    pair_count = std::min<size_t>(pair_count, m_pair_capacity);
+    manifold_count = std::min<size_t>(manifold_count, m_pair_capacity);
+
+    m_collision_pair_ssbo.setBuffer(nullptr, m_pair_capacity * sizeof(glm::ivec2), GL_DYNAMIC_DRAW);
+    if (pairs && pair_count > 0)
+        m_collision_pair_ssbo.updateData(pairs, pair_count * sizeof(glm::ivec2));
+
+    m_contact_manifolds_ssbo.setBuffer(nullptr, m_pair_capacity * sizeof(physics::ContactManifold), GL_DYNAMIC_DRAW);
+    m_contact_manifolds_ssbo.clearData();
+    if (manifolds && manifold_count > 0)
+        m_contact_manifolds_ssbo.updateData(manifolds, manifold_count * sizeof(physics::ContactManifold));
+
+    //After a step the counter holds the contacts, or the pairs if the narrow phase did not run
+    unsigned int counter = m_pair_count > 0 ? header.contact_count : 0;
+    m_collision_count_ssbo.setBuffer(&counter, sizeof(unsigned int), GL_DYNAMIC_DRAW);
+
+    size_t color_count;
+    const glm::vec4* colors = reader.getSection<glm::vec4>(recording::CheckpointSection::Colors, color_count);
+    if (m_color_ssbo && colors && color_count == bodies)
+        m_color_ssbo->setBuffer(colors, bodies * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+    m_transform_ssbo.unbind();
+    uploadWorlds();
+
+    if (seed)
+        *seed = header.seed;
+    return true;
+}
+
+bool GpuSimulator::setWorlds(const physics::WorldLayout& worlds){
+    applyPendingChanges();
+    if (!worlds.isValid(m_body_count)){
+        std::cerr << "GpuSimulator: the worlds do not cover the " << m_body_count << " bodies" << std::endl;
+        return false;
+    }
+
+    m_worlds = worlds;
+    uploadWorlds();
+    return true;
+}
+
+void GpuSimulator::uploadWorlds(){
+    //The shaders skip the world buffers when world_count is 0, they only need to exist
+    std::vector<unsigned int> body_worlds;
+    m_worlds.getBodyWorlds(body_worlds);
+    if (body_worlds.empty()){
+        m_body_worlds_ssbo.setBuffer(nullptr, sizeof(unsigned int), GL_STATIC_DRAW);
+        m_world_offsets_ssbo.setBuffer(nullptr, sizeof(unsigned int), GL_STATIC_DRAW);
+        m_world_params_ssbo.setBuffer(nullptr, sizeof(physics::WorldParams), GL_STATIC_DRAW);
+    }
+    else{
+        m_body_worlds_ssbo.setBuffer(body_worlds.data(), body_worlds.size() * sizeof(unsigned int), GL_STATIC_DRAW);
+        m_world_offsets_ssbo.setBuffer(m_worlds.offsets.data(), m_worlds.offsets.size() * sizeof(unsigned int), GL_STATIC_DRAW);
+        m_world_params_ssbo.setBuffer(m_worlds.params.data(), m_worlds.params.size() * sizeof(physics::WorldParams), GL_STATIC_DRAW);
+    }
+    m_world_params_ssbo.unbind();
+}
+
+void GpuSimulator::attachColorBuffer(ShaderStorageBuffer* colors){
+    m_color_ssbo = colors;
+}
+
+void GpuSimulator::applyPendingChanges(){
+    if (m_pending_changes.empty() && m_body_count == m_registry.size())
+        return;
+
+    PROFILE_ZONE("apply body changes");
+
+    //Make the writes of the last step visible to the buffer copies
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    if (m_pending_peak > m_capacity)
+        growBodyBuffers(std::max(m_pending_peak, m_capacity * 2));
+
+    //Changes are replayed in the order they were made, so a move always copies the
+    //right body. Consecutive adds are uploaded together
+    unsigned int staged_first = 0;
+    for (const BodyChange& change : m_pending_changes){
+        if (!m_staging_transforms.empty() && (change.is_move || change.index != staged_first + m_staging_transforms.size())){
+            flushStagedBodies(staged_first);
+        }
+
+        if (change.is_move){
+            m_transform_ssbo.copyData(change.from * sizeof(glm::mat4), change.index * sizeof(glm::mat4), sizeof(glm::mat4));
+            m_properties_ssbo.copyData(change.from * sizeof(physics::Properties), change.index * sizeof(physics::Properties), sizeof(physics::Properties));
+            m_spheres_ssbo.copyData(change.from * sizeof(glm::vec4), change.index * sizeof(glm::vec4), sizeof(glm::vec4));
+            if (m_color_ssbo)
+                m_color_ssbo->copyData(change.from * sizeof(glm::vec4), change.index * sizeof(glm::vec4), sizeof(glm::vec4));
+            continue;
+        }
+
+        if (m_staging_transforms.empty())
+            staged_first = change.index;
+
+        m_staging_transforms.push_back(change.transform);
+        m_staging_properties.push_back(change.properties);
+        m_staging_spheres.push_back(change.sphere);
+        m_staging_colors.push_back(change.color);
+    }
+
+    if (!m_staging_transforms.empty())
+        flushStagedBodies(staged_first);
+
+    m_pending_changes.clear();
+    m_body_count = m_registry.size();
+    m_pending_peak = m_body_count;
+
+    if (m_worlds.getWorldCount() > 0){
+        std::cerr << "GpuSimulator: bodies were added or removed, going back to a single world" << std::endl;
+        m_worlds = physics::WorldLayout();
+        uploadWorlds();
+    }
+
+    refreshRenderSlots();
+    growPairBuffers();
+}
+
+void GpuSimulator::refreshRenderSlots(){
+    //The slots the renderer can still pick have the old body order, give them the new one
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    for (unsigned long long step = m_render_steps; step > 0 && step + C_RENDER_SLOTS > m_render_steps + 1; step--)
+        m_render_transform_ssbos[(step - 1) % C_RENDER_SLOTS].copyFrom(m_transform_ssbo, m_body_count * sizeof(glm::mat4));
+}
+
+void GpuSimulator::flushStagedBodies(unsigned int first){
+    unsigned int count = static_cast<unsigned int>(m_staging_transforms.size());
+
+    m_transform_ssbo.bind();
+    m_transform_ssbo.updateData(m_staging_transforms.data(), count * sizeof(glm::mat4), first * sizeof(glm::mat4));
+    m_properties_ssbo.bind();
+    m_properties_ssbo.updateData(m_staging_properties.data(), count * sizeof(physics::Properties), first * sizeof(physics::Properties));
+    m_spheres_ssbo.bind();
+    m_spheres_ssbo.updateData(m_staging_spheres.data(), count * sizeof(glm::vec4), first * sizeof(glm::vec4));
+
+    //The slots may belong to removed bodies, start with empty accumulators
+    m_deltaV_ssbo.bind();
+    m_deltaV_ssbo.clearData(first * sizeof(glm::vec4), count * sizeof(glm::vec4));
+    m_deltaW_ssbo.bind();
+    m_deltaW_ssbo.clearData(first * sizeof(glm::vec4), count * sizeof(glm::vec4));
+
+    if (m_color_ssbo){
+        m_color_ssbo->bind();
+        m_color_ssbo->updateData(m_staging_colors.data(), count * sizeof(glm::vec4), first * sizeof(glm::vec4));
+    }
+    m_deltaW_ssbo.unbind();
+
+    m_staging_transforms.clear();
+    m_staging_properties.clear();
+    m_staging_spheres.clear();
+    m_staging_colors.clear();
+}
+
+void GpuSimulator::growBodyBuffers(unsigned int capacity){
+    m_transform_ssbo.resize(capacity * sizeof(glm::mat4));
+    for (ShaderStorageBuffer& slot : m_render_transform_ssbos)
+        slot.resize(capacity * sizeof(glm::mat4));
+    m_properties_ssbo.resize(capacity * sizeof(physics::Properties));
+    m_results_ssbo.resize(capacity * sizeof(int));
+    m_spheres_ssbo.resize(capacity * sizeof(glm::vec4));
+    m_second_results_ssbo.resize(capacity * sizeof(int));
+    m_lambdas_ssbo.resize(capacity * sizeof(float));
+    m_new_lambdas_ssbo.resize(capacity * sizeof(float));
+    m_deltaV_ssbo.resize(capacity * sizeof(glm::vec4));
+    m_deltaW_ssbo.resize(capacity * sizeof(glm::vec4));
+
+    //The renderer buffer may already be larger
+    if (m_color_ssbo && m_color_ssbo->getSize() < capacity * sizeof(glm::vec4))
+        m_color_ssbo->resize(capacity * sizeof(glm::vec4));
+
+    m_capacity = capacity;
+}
+
+void GpuSimulator::growPairBuffers(){
+    unsigned int pairs = m_body_count * m_body_count;
+    if (pairs <= m_pair_capacity)
+        return;
+
+    m_pair_capacity = std::max(pairs, m_pair_capacity * 2);
+    m_collision_pair_ssbo.resize(m_pair_capacity * sizeof(glm::ivec2));
+    m_contact_manifolds_ssbo.resize(m_pair_capacity * sizeof(physics::ContactManifold));
+    m_contact_manifolds_ssbo.clearData();
+    m_contact_manifolds_ssbo.unbind();
+}
+
+void GpuSimulator::setDeterministic(bool deterministic){
+    m_deterministic = deterministic;
+    selectNarrowShader();
+}
+
+void GpuSimulator::setCooperativeNarrowPhase(bool cooperative){
+    m_cooperative_narrow = cooperative;
+    selectNarrowShader();
+}
+
+void GpuSimulator::setSpecializedShaders(bool specialize){
+    m_specialize_shaders = specialize;
+    selectNarrowShader();
+}
+
+void GpuSimulator::selectNarrowShader(){
+    if (isCooperativeNarrowPhase()){
+        m_cooperative_narrow_shader.setShader("narrow_cooperative.glsl", getNarrowDefines());
+        m_narrow_shader = &m_cooperative_narrow_shader;
+    }
+    else{
+        m_narrow_phase_shader.setShader("narrow_working.glsl", getNarrowDefines());
+        m_narrow_shader = &m_narrow_phase_shader;
+    }
+}
+
+ComputeShader::Defines GpuSimulator::getNarrowDefines() const{
+    //narrow_cooperative.glsl has a fixed group size and ignores LOCAL_SIZE
+    ComputeShader::Defines defines = { { "LOCAL_SIZE", std::to_string(C_NARROW_LOCAL_SIZE) } };
+    if (!m_specialize_shaders)
+        return defines;
+
+    defines.insert(m_shape_defines.begin(), m_shape_defines.end());
+    defines["ORDERED_MANIFOLDS"] = m_deterministic ? "1" : "0";
+    return defines;
+}
+
+void GpuSimulator::sortPairs(unsigned int count){
+    unsigned int bits = 1;
+    while (bits < 32 && (m_body_count - 1) >> bits)
+        bits++;
+
+    if (m_pair_scratch_ssbo.getSize() < count * sizeof(glm::ivec2))
+        m_pair_scratch_ssbo.setBuffer(nullptr, count * sizeof(glm::ivec2), GL_DYNAMIC_COPY);
+
+    //Least significant digit first: the second index, then the first one. Every pass reads one
+    //buffer and writes the other, starting from the broad phase one
+    ShaderStorageBuffer* buffers[2] = { &m_collision_pair_ssbo, &m_pair_scratch_ssbo };
+    unsigned int current = 0;
+    m_profiler.begin(m_sort_zone);
+    for (unsigned int component = 2; component-- > 0;){
+        for (unsigned int shift = 0; shift < bits; shift += 4){
+            buffers[current]->attachToBindingPoint(6);
+            buffers[1 - current]->attachToBindingPoint(8);
+            sortPass(0, count, sizeof(glm::ivec2), component, shift);
+            current = 1 - current;
+        }
+    }
+
+    //The compaction keeps the order and leaves the dropped pairs at the end
+    buffers[current]->attachToBindingPoint(6);
+    buffers[1 - current]->attachToBindingPoint(8);
+    sortPass(1, count, sizeof(glm::ivec2));
+    current = 1 - current;
+    m_profiler.end();
+
+    if (current != 0){
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        m_collision_pair_ssbo.copyFrom(m_pair_scratch_ssbo, count * sizeof(glm::ivec2));
+    }
+    //The sort attaches the pairs to other binding points
+    m_collision_pair_ssbo.attachToBindingPoint(20);
+}
+
+void GpuSimulator::compactManifolds(unsigned int count){
+    m_manifold_scratch_ssbo.attachToBindingPoint(6);
+    m_contact_manifolds_ssbo.attachToBindingPoint(8);
+    m_profiler.begin(m_sort_zone);
+    sortPass(2, count, sizeof(physics::ContactManifold));
+    m_profiler.end();
+}
+
+static_assert(sizeof(physics::ContactManifold) % sizeof(uint32_t) == 0, "sort_pairs.glsl moves the manifolds in 4 byte words");
+
+void GpuSimulator::sortPass(unsigned int mode, unsigned int count, unsigned int element_size, unsigned int component, unsigned int shift){
+    const unsigned int buckets = mode == 0 ? 16 : 2;
+    unsigned int work_groups = (count + 256 - 1) / 256;
+    if (m_group_counts_ssbo.getSize() < buckets * work_groups * sizeof(uint32_t))
+        m_group_counts_ssbo.setBuffer(nullptr, buckets * work_groups * sizeof(uint32_t), GL_DYNAMIC_COPY);
+
+    m_sort_pairs_shader.use();
+    m_sort_pairs_shader.setUniform1ui("mode", mode);
+    m_sort_pairs_shader.setUniform1ui("count", count);
+    m_sort_pairs_shader.setUniform1ui("element_size", element_size / sizeof(uint32_t));
+    m_sort_pairs_shader.setUniform1ui("group_count", work_groups);
+    m_sort_pairs_shader.setUniform1ui("component", component);
+    m_sort_pairs_shader.setUniform1ui("shift", shift);
+
+    m_sort_pairs_shader.setUniform1ui("stage", 0);
+    m_sort_pairs_shader.dispatch(work_groups, 1, 1);
+    m_sort_pairs_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_sort_pairs_shader.setUniform1ui("stage", 1);
+    m_sort_pairs_shader.dispatch(1, 1, 1);
+    m_sort_pairs_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_sort_pairs_shader.setUniform1ui("stage", 2);
+    m_sort_pairs_shader.dispatch(work_groups, 1, 1);
+    m_sort_pairs_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuSimulator::reorderBodies(){
+    PROFILE_ZONE("reorder bodies");
+    applyPendingChanges();
+    m_steps_since_reorder = 0;
+    if (m_body_count == 0)
+        return;
+
+    readTransforms(m_reorder_transforms);
+    physics::computeMortonOrder(m_reorder_transforms.data(), m_body_count, m_worlds, m_reorder, m_reorder_keys);
+
+    if (m_reorder_ssbo.getSize() < m_capacity * sizeof(uint32_t)){
+        m_reorder_ssbo.setBuffer(nullptr, m_capacity * sizeof(uint32_t), GL_DYNAMIC_DRAW);
+        m_reorder_scratch_ssbo.setBuffer(nullptr, m_capacity * std::max(sizeof(glm::mat4), sizeof(physics::Properties)), GL_DYNAMIC_COPY);
+    }
+    m_reorder_ssbo.bind();
+    m_reorder_ssbo.updateData(m_reorder.data(), m_body_count * sizeof(uint32_t));
+
+    //The accumulators are empty between steps and the broad phase results are rebuilt every
+    //step, so only the state of the bodies moves. The worlds keep their ranges
+    permuteBuffer(m_transform_ssbo, sizeof(glm::mat4));
+    permuteBuffer(m_properties_ssbo, sizeof(physics::Properties));
+    permuteBuffer(m_spheres_ssbo, sizeof(glm::vec4));
+    if (m_color_ssbo)
+        permuteBuffer(*m_color_ssbo, sizeof(glm::vec4));
+
+    m_registry.permute(m_reorder);
+    refreshRenderSlots();
+
+    //The pairs and contacts of the last step refer to the old indices
+    m_pair_count = 0;
+    m_reorder_count++;
+}
+
+static_assert(sizeof(physics::Properties) % sizeof(glm::vec4) == 0, "permute_bodies.glsl moves the properties in 16 byte words");
+
+void GpuSimulator::permuteBuffer(ShaderStorageBuffer& buffer, unsigned int element_size){
+    unsigned int words = element_size / sizeof(glm::vec4);
+    int work_groups = (m_body_count * words + 256 - 1) / 256;
+
+    buffer.attachToBindingPoint(17);
+    m_permute_shader.use();
+    m_permute_shader.setUniform1ui("object_count", m_body_count);
+    m_permute_shader.setUniform1ui("element_size", words);
+    m_permute_shader.dispatch(work_groups, 1, 1);
+    m_permute_shader.waitForCompletion(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    buffer.copyFrom(m_reorder_scratch_ssbo, m_body_count * element_size);
+}
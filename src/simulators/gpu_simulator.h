@@ -3,15 +3,20 @@
 
 #pragma once
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
 #include "glm/glm.hpp"
-#include "vertex_buffer.h"
+#include "../vertex.h"
 
 #include "simulators/simulable.h"
 #include "utils.h"
 #include "../buffers/shader_storage_buffer.h"
 #include "compute_shader.h"
+#include "../profiling/gpu_profiler.h"
+#include "body_registry.h"
+#include "world_batch.h"
 
 /**
  * @brief class representation of a simulator running on the cpu
@@ -39,8 +44,11 @@ private:
     ComputeShader m_transform_shader;
     ComputeShader m_broad_phase_shader;
     ComputeShader m_narrow_phase_shader;
+    ComputeShader m_cooperative_narrow_shader;
     ComputeShader m_impulse_phase_shader;
     ComputeShader m_accumulation_phase_shader;
+    ComputeShader m_sort_pairs_shader;
+    ComputeShader m_permute_shader;
 
     ShaderStorageBuffer m_transform_ssbo;
     ShaderStorageBuffer m_aabbs_ssbo;
@@ -62,7 +70,99 @@ private:
     ShaderStorageBuffer m_deltaV_ssbo;
     ShaderStorageBuffer m_deltaW_ssbo;
 
+    //Independent worlds, empty for a single world
+    physics::WorldLayout m_worlds;
+    ShaderStorageBuffer m_body_worlds_ssbo; /* World of each body */
+    ShaderStorageBuffer m_world_offsets_ssbo; /* First body of each world, followed by the number of bodies */
+    ShaderStorageBuffer m_world_params_ssbo; /* Gravity and restitution of each world */
+
     unsigned int m_zero = 0;
+    unsigned int m_pair_count = 0; /* Broad phase pairs of the last step */
+
+    //Deterministic mode. The pairs are sorted, the narrow phase keeps their order for the contacts
+    //and the velocity changes are added as fixed point integers, whose sum does not depend on the
+    //order of the atomics
+    static constexpr float C_FIXED_POINT_SCALE = 65536.0f; /* Fixed point units per m/s */
+    bool m_deterministic = false;
+
+    //Pair sort. The broad phase appends the pairs in whatever order its invocations run, the sort
+    //puts them in (indexA, indexB) order and drops the repeated and static-static ones
+    bool m_sort_pairs = false;
+    ShaderStorageBuffer m_pair_scratch_ssbo; /* Other side of each sort pass */
+    ShaderStorageBuffer m_manifold_scratch_ssbo; /* Manifolds of the ordered narrow phase, before the empty ones are dropped */
+    ShaderStorageBuffer m_group_counts_ssbo; /* Elements of each bucket and work group of a pass */
+
+    //Cooperative narrow phase, several invocations per pair. Its shared memory holds the vertices of
+    //both shapes, so larger shapes stay on the narrow phase with an invocation per pair
+    static constexpr unsigned int C_COOPERATIVE_MAX_VERTICES = 64; /* C_MAX_VERTICES of narrow_cooperative.glsl */
+    static constexpr unsigned int C_COOPERATIVE_PAIRS_PER_GROUP = 4; /* C_PAIRS_PER_GROUP of narrow_cooperative.glsl */
+    static constexpr unsigned int C_COOPERATIVE_MAX_GROUPS = 65535; /* Minimum maximum work group count of GL, the groups loop over the rest */
+    bool m_cooperative_narrow = false;
+
+    //Specialized narrow phase. The shape is baked into the shaders as constant arrays and the
+    //deterministic toggle becomes a constant, one cached program per combination
+    static constexpr unsigned int C_NARROW_LOCAL_SIZE = 512; /* Invocations per work group of narrow_working.glsl */
+    bool m_specialize_shaders = false;
+    ComputeShader* m_narrow_shader = nullptr; /* m_narrow_phase_shader or m_cooperative_narrow_shader, set by selectNarrowShader */
+    ComputeShader::Defines m_shape_defines; /* SHAPE_VERTICES, SHAPE_NORMALS and SHAPE_EDGES, empty if the shape can not be baked */
+
+    //Reordering of the bodies by Morton code, so the ones that touch sit close in memory
+    unsigned int m_reorder_interval = 0; /* Steps between two reorders, 0 to never reorder */
+    unsigned int m_steps_since_reorder = 0;
+    uint64_t m_reorder_count = 0;
+    std::vector<uint32_t> m_reorder; /* Old index of each body after the last reorder */
+    std::vector<glm::mat4> m_reorder_transforms; /* Transforms read back to compute the order */
+    std::vector<uint64_t> m_reorder_keys; /* Morton keys, scratch of computeMortonOrder */
+    ShaderStorageBuffer m_reorder_ssbo; /* m_reorder on the gpu */
+    ShaderStorageBuffer m_reorder_scratch_ssbo; /* Gathered elements before they are copied back */
+
+    profiling::GpuProfiler m_profiler; /* Gpu time of the phases, read without stalling */
+    unsigned int m_step_zone;
+    unsigned int m_transform_zone;
+    unsigned int m_broad_zone;
+    unsigned int m_narrow_zone;
+    unsigned int m_impulse_zone;
+    unsigned int m_accumulation_zone;
+    unsigned int m_sort_zone;
+    unsigned int m_publish_zone;
+
+    //Render state. Every step copies its transforms into the next slot of a ring and fences it,
+    //the renderer draws from the newest completed slot (and interpolates from the one before it)
+    //while the compute shaders keep working on m_transform_ssbo
+    static constexpr unsigned int C_RENDER_SLOTS = 3; /* Previous, current and the one being written */
+    ShaderStorageBuffer m_render_transform_ssbos[C_RENDER_SLOTS];
+    GLsync m_render_fences[C_RENDER_SLOTS] = {}; /* Signaled when the copy into the slot is done */
+    unsigned long long m_render_steps = 0; /* Slots written so far, step k lives in slot k % C_RENDER_SLOTS */
+
+    //Body set. sim_transforms and sim_properties only hold the initial bodies,
+    //the gpu buffers are the reference once the simulation starts
+    /**
+     * @brief Add or move of a body waiting to be applied on the gpu buffers
+     */
+    struct BodyChange{
+        bool is_move; /* Move the body at from into index, otherwise upload the data into index */
+        unsigned int index;
+        unsigned int from;
+        glm::mat4 transform;
+        physics::Properties properties;
+        glm::vec4 sphere;
+        glm::vec4 color;
+    };
+
+    physics::BodyRegistry m_registry;
+    std::vector<BodyChange> m_pending_changes; /* Applied in order at the start of the next step */
+    unsigned int m_pending_peak; /* Largest body count reached by the pending changes */
+    unsigned int m_body_count; /* Bodies in the gpu buffers */
+    unsigned int m_capacity; /* Bodies that fit in the per body buffers */
+    unsigned int m_pair_capacity; /* Pairs that fit in the collision pair and manifold buffers */
+    float m_base_radius; /* Bounding sphere radius of the unscaled mesh */
+    ShaderStorageBuffer* m_color_ssbo = nullptr; /* Instance colors of the renderer, kept in sync */
+
+    //Staging memory for runs of consecutive added bodies
+    std::vector<glm::mat4> m_staging_transforms;
+    std::vector<physics::Properties> m_staging_properties;
+    std::vector<glm::vec4> m_staging_spheres;
+    std::vector<glm::vec4> m_staging_colors;
 
 public:
     /**
@@ -70,6 +170,8 @@ public:
      * @param transforms pointer to the transform matrix of the objects
      * @param static_vertices pointer to the original vertices of the geometry
      * @param static_indices pointer to the order in which each triangle is being drawn
+     * @param worlds independent worlds the bodies are split in (null for a single world). Given
+     * here the pair buffers are only sized for the pairs inside the worlds
      */
     GpuSimulator(
         std::vector<glm::mat4>* transforms, 
@@ -78,7 +180,8 @@ public:
         const std::vector<glm::vec4>* object_vertices,
         const std::vector<glm::vec4>* object_normals, 
         const std::vector<glm::vec4>* object_edges,
-        std::vector<physics::Properties>* properties
+        std::vector<physics::Properties>* properties,
+        const physics::WorldLayout* worlds = nullptr
     );
     
     /**
@@ -91,12 +194,287 @@ public:
      */
     void update(float delta_time, glm::vec3 gravity = glm::vec3(0.0f, 0.0f, 0.0f)) override;
 
+    /**
+     * @brief Splits the bodies in independent worlds that are stepped in the same dispatches. The
+     * broad phase only tests the bodies of the same world, and each world has its own gravity (the
+     * gravity given to update is ignored) and restitution. Pending adds and removes are applied first
+     * @param worlds ranges of the worlds in the body buffers and their parameters (empty for a single world)
+     * @return false (and nothing changes) if the ranges do not cover the bodies
+     * @note Adding or removing bodies afterwards moves them between worlds, so it goes back to a single world
+     */
+    bool setWorlds(const physics::WorldLayout& worlds);
+
+    /**
+     * @brief Gets the worlds the bodies are split in (empty for a single world)
+     */
+    inline const physics::WorldLayout& getWorlds() const { return m_worlds; }
+
+    /**
+     * @brief Adds a body. It is uploaded at the start of the next step, but the handle is valid right away
+     * @param transform transform matrix of the body
+     * @param properties physics properties of the body
+     * @param color instance color (only used if a color buffer is attached)
+     * @return handle of the body
+     */
+    physics::BodyHandle addBody(const glm::mat4& transform, const physics::Properties& properties, const glm::vec4& color = glm::vec4(1.0f));
+
+    /**
+     * @brief Removes a body at the start of the next step. The last body takes its index
+     * @param handle handle of the body
+     * @return false if the handle does not refer to a live body
+     */
+    bool removeBody(physics::BodyHandle handle);
+
+    /**
+     * @brief Tells whether the handle refers to a live body
+     */
+    inline bool isBodyValid(physics::BodyHandle handle) const { return m_registry.isValid(handle); }
+
+    /**
+     * @brief Gets the index of a body in the gpu buffers (valid after the next step if there are pending changes)
+     */
+    inline unsigned int getBodyIndex(physics::BodyHandle handle) const { return m_registry.getIndex(handle); }
+
+    /**
+     * @brief Gets the handle of the body at an index. The initial bodies have the handles of their indices
+     */
+    inline physics::BodyHandle getBodyHandle(unsigned int index) const { return m_registry.getHandle(index); }
+
+    /**
+     * @brief Gets the number of bodies in the gpu buffers (the number of instances to draw)
+     */
+    inline unsigned int getBodyCount() const { return m_body_count; }
+
+    /**
+     * @brief Gets the number of broad phase pairs found in the last step
+     */
+    inline unsigned int getPairCount() const { return m_pair_count; }
+
+    /**
+     * @brief Makes every step give the same result bit for bit: the pairs are sorted (see
+     * setSortPairs), the contacts follow their order and the velocity changes are accumulated in
+     * fixed point. Costs a few sort passes per step
+     */
+    void setDeterministic(bool deterministic);
+
+    /**
+     * @brief Tells whether the steps are reproducible
+     */
+    inline bool isDeterministic() const { return m_deterministic; }
+
+    /**
+     * @brief Sorts the broad phase pairs by their bodies with a radix sort and drops the repeated
+     * ones and the ones between two static bodies before the narrow phase. Its invocations then read
+     * the transforms of neighbouring pairs from the same places. Always on in the deterministic mode
+     */
+    inline void setSortPairs(bool sort) { m_sort_pairs = sort; }
+
+    /**
+     * @brief Tells whether the broad phase pairs are sorted
+     */
+    inline bool isSortingPairs() const { return m_sort_pairs || m_deterministic; }
+
+    /**
+     * @brief Runs the narrow phase with 16 invocations per pair: they load the vertices of both
+     * bodies into shared memory once and split the separating axes. Gives the same contacts.
+     * Experimental: it has only been measured on llvmpipe, where it is 2 to 11 times slower than
+     * an invocation per pair; measure it on the target gpu before turning it on. Ignored if the
+     * shape has more vertices than C_COOPERATIVE_MAX_VERTICES
+     */
+    void setCooperativeNarrowPhase(bool cooperative);
+
+    /**
+     * @brief Tells whether the narrow phase runs several invocations per pair
+     */
+    inline bool isCooperativeNarrowPhase() const { return m_cooperative_narrow && m_object_vertices->size() <= C_COOPERATIVE_MAX_VERTICES; }
+
+    /**
+     * @brief Compiles the narrow phase for the shape of the bodies: the vertices, normals and edges
+     * become constant arrays, so the SAT loops have constant bounds and can unroll, and the
+     * deterministic mode becomes a constant. Gives the same contacts. The programs are cached, so
+     * toggling this or the deterministic mode only compiles the first time
+     */
+    void setSpecializedShaders(bool specialize);
+
+    /**
+     * @brief Tells whether the narrow phase is compiled for the shape of the bodies
+     */
+    inline bool isSpecializingShaders() const { return m_specialize_shaders; }
+
+    /**
+     * @brief Sorts the bodies by the Morton code of their position (each world within its range).
+     * Bodies that touch end up close in the gpu buffers, so the phases read them with far fewer
+     * scattered accesses once a scene has spread out. The handles and the attached color buffer
+     * follow the bodies; pending adds and removes are applied first
+     * @note Reads the transforms back, so it stalls until the gpu finishes the last step
+     */
+    void reorderBodies();
+
+    /**
+     * @brief Reorders the bodies every steps steps, at the start of the step
+     * @param steps steps between two reorders, 0 to never reorder
+     */
+    inline void setReorderInterval(unsigned int steps) { m_reorder_interval = steps; m_steps_since_reorder = 0; }
+
+    /**
+     * @brief Gets the steps between two reorders (0 if they are disabled)
+     */
+    inline unsigned int getReorderInterval() const { return m_reorder_interval; }
+
+    /**
+     * @brief Gets the number of reorders so far, it changes when the bodies move
+     */
+    inline uint64_t getReorderCount() const { return m_reorder_count; }
+
+    /**
+     * @brief Gets the old index of the body at each index after the last reorder, for data kept
+     * per body outside the simulator
+     */
+    inline const std::vector<uint32_t>& getLastReorder() const { return m_reorder; }
+
+    /**
+     * @brief Reads back the number of contacts found in the last step
+     * @note Stalls until the gpu finishes the narrow phase, meant for tools and benchmarks
+     */
+    unsigned int getContactCount();
+
+    /**
+     * @brief Reads back the transforms of every body after the last step
+     * @param transforms receives one transform per body, in the order of the gpu buffers
+     * @note Stalls until the gpu finishes the step, meant for tools and recordings
+     */
+    void readTransforms(std::vector<glm::mat4>& transforms);
+
+    /**
+     * @brief Saves the bodies, the body registry, the pairs and contacts of the last step and the
+     * solver buffers into a checkpoint. Pending adds and removes are applied first
+     * @param path checkpoint file
+     * @param seed seed of the random generator the scene was built with, kept for the caller
+     * @return false if the file could not be written
+     * @note Stalls until the gpu finishes the step, meant for tools and benchmarks
+     */
+    bool saveCheckpoint(const std::string& path, uint64_t seed = 0);
+
+    /**
+     * @brief Replaces every body and the solver state with the ones of a checkpoint. Each buffer
+     * is uploaded with one glBufferData straight from the mapped file
+     * @param path checkpoint file (of this simulator or of the cpu one)
+     * @param seed receives the seed stored in the checkpoint (may be null)
+     * @return false (and nothing changes) if the file is not a valid checkpoint
+     * @note The mesh is not part of the checkpoint, the bodies must have the one they were saved with
+     */
+    bool loadCheckpoint(const std::string& path, uint64_t* seed = nullptr);
+
+    /**
+     * @brief Keeps an instance color buffer (one vec4 per body) in the same order as the bodies
+     * @param colors color buffer of the renderer
+     */
+    void attachColorBuffer(ShaderStorageBuffer* colors);
+
+    /**
+     * @brief Gets the profiler with the gpu time of each phase of the step
+     */
+    inline profiling::GpuProfiler& getProfiler() { return m_profiler; }
+
+    /**
+     * @brief Binds the transforms of the newest completed step to binding point 1 and the ones of
+     * the step before to binding point 12, without waiting for the step in flight. Call it before
+     * drawing the bodies
+     * @note If the last step is still running the frame is drawn one step behind
+     */
+    void bindRenderState();
+
 private:
 
     /**
      * @brief Initializes the data for the sumulation
      */
     void initializeData();
+
+    /**
+     * @brief Applies the pending adds and removes to the gpu buffers
+     */
+    void applyPendingChanges();
+
+    /**
+     * @brief Copies the transforms of the step into the next render slot and fences the copy
+     */
+    void publishRenderState();
+
+    /**
+     * @brief Tells whether the gpu finished the copy into a render slot (never blocks)
+     */
+    bool isRenderSlotReady(unsigned int slot);
+
+    /**
+     * @brief Uploads the staged run of added bodies with one glBufferSubData per buffer
+     * @param first index of the first staged body
+     */
+    void flushStagedBodies(unsigned int first);
+
+    /**
+     * @brief Grows the per body buffers keeping their contents
+     * @param capacity new number of bodies that fit in the buffers
+     */
+    void growBodyBuffers(unsigned int capacity);
+
+    /**
+     * @brief Uploads the world of each body, the world ranges and their parameters
+     */
+    void uploadWorlds();
+
+    /**
+     * @brief Grows the collision pair and manifold buffers if the bodies can form more pairs than they fit
+     */
+    void growPairBuffers();
+
+    /**
+     * @brief Gets the defines of the narrow phase shaders for the current settings
+     */
+    ComputeShader::Defines getNarrowDefines() const;
+
+    /**
+     * @brief Points m_narrow_shader to the narrow phase program of the current settings, compiling
+     * it the first time they are used. Called when they change, not on every step
+     */
+    void selectNarrowShader();
+
+    /**
+     * @brief Sorts the broad phase pairs and drops the repeated and static-static ones, which are
+     * left as (-1, -1) at the end
+     * @param count number of pairs
+     */
+    void sortPairs(unsigned int count);
+
+    /**
+     * @brief Drops the empty manifolds of the ordered narrow phase, moving the rest from
+     * m_manifold_scratch_ssbo to m_contact_manifolds_ssbo. The collision count gets their number
+     * @param count number of pairs the narrow phase ran on
+     */
+    void compactManifolds(unsigned int count);
+
+    /**
+     * @brief Runs one pass of sort_pairs.glsl from the buffer on binding 6 to the one on binding 8
+     * @param mode key of the pass (see the shader)
+     * @param count number of elements
+     * @param element_size bytes per element
+     * @param component body index of the digit (mode 0)
+     * @param shift first bit of the digit (mode 0)
+     */
+    void sortPass(unsigned int mode, unsigned int count, unsigned int element_size, unsigned int component = 0, unsigned int shift = 0);
+
+    /**
+     * @brief Moves the elements of a per body buffer into the order of m_reorder_ssbo
+     * @param buffer per body buffer
+     * @param element_size bytes per body (a multiple of 16)
+     */
+    void permuteBuffer(ShaderStorageBuffer& buffer, unsigned int element_size);
+
+    /**
+     * @brief Copies the transforms into the render slots the renderer can still pick, after the
+     * bodies changed their indices
+     */
+    void refreshRenderSlots();
 };
 
 
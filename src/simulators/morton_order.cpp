@@ -0,0 +1,70 @@
+#include "morton_order.h"
+
+#include <algorithm>
+
+namespace physics{
+
+    namespace{
+        /**
+         * @brief Spreads the lower 10 bits of a value so there are two zero bits between each of them
+         */
+        uint32_t spreadBits(uint32_t value){
+            value &= 0x3ff;
+            value = (value | (value << 16)) & 0x030000ff;
+            value = (value | (value << 8)) & 0x0300f00f;
+            value = (value | (value << 4)) & 0x030c30c3;
+            value = (value | (value << 2)) & 0x09249249;
+            return value;
+        }
+
+        /**
+         * @brief Sorts one range of bodies by their Morton codes
+         * @param keys scratch memory, Morton code in the upper half and old index in the lower one
+         */
+        void sortRange(const glm::mat4* transforms, uint32_t first, uint32_t last, std::vector<uint64_t>& keys, uint32_t* order){
+            if (last <= first)
+                return;
+
+            glm::vec3 lower = glm::vec3(transforms[first][3]);
+            glm::vec3 upper = lower;
+            for (uint32_t i = first + 1; i < last; i++){
+                glm::vec3 position = glm::vec3(transforms[i][3]);
+                lower = glm::min(lower, position);
+                upper = glm::max(upper, position);
+            }
+            glm::vec3 inverse_size = 1.0f / glm::max(upper - lower, glm::vec3(1e-6f));
+
+            keys.clear();
+            for (uint32_t i = first; i < last; i++){
+                glm::vec3 position = (glm::vec3(transforms[i][3]) - lower) * inverse_size;
+                keys.push_back((static_cast<uint64_t>(mortonCode(position)) << 32) | i);
+            }
+            std::sort(keys.begin(), keys.end());
+
+            for (uint32_t i = first; i < last; i++)
+                order[i] = static_cast<uint32_t>(keys[i - first]);
+        }
+    }
+
+    uint32_t mortonCode(glm::vec3 position){
+        //NaN goes to 0 as well
+        glm::vec3 cell = glm::clamp(position * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+        if (!(cell.x >= 0.0f)) cell.x = 0.0f;
+        if (!(cell.y >= 0.0f)) cell.y = 0.0f;
+        if (!(cell.z >= 0.0f)) cell.z = 0.0f;
+        return (spreadBits(static_cast<uint32_t>(cell.x)) << 2) | (spreadBits(static_cast<uint32_t>(cell.y)) << 1) | spreadBits(static_cast<uint32_t>(cell.z));
+    }
+
+    void computeMortonOrder(const glm::mat4* transforms, size_t count, const WorldLayout& worlds, std::vector<uint32_t>& order,
+                            std::vector<uint64_t>& keys){
+        order.resize(count);
+        keys.reserve(count);
+
+        if (worlds.getWorldCount() == 0){
+            sortRange(transforms, 0, static_cast<uint32_t>(count), keys, order.data());
+            return;
+        }
+        for (unsigned int w = 0; w < worlds.getWorldCount(); w++)
+            sortRange(transforms, worlds.offsets[w], worlds.offsets[w + 1], keys, order.data());
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef MORTON_ORDER_H
+#define MORTON_ORDER_H
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "world_batch.h"
+
+namespace physics{
+
+    /**
+     * @brief Interleaves the bits of a point inside the unit cube into a 30 bit Morton code (10 bits
+     * per axis), so points close in space get close codes
+     * @param position point with every coordinate in [0, 1] (clamped otherwise)
+     */
+    uint32_t mortonCode(glm::vec3 position);
+
+    /**
+     * @brief Computes the order that sorts the bodies by the Morton code of their position, so the
+     * bodies that touch each other end up close in the body arrays. Each world is sorted within its
+     * range (the layout stays valid) over the bounds of its own bodies; ties keep the old order
+     * @param transforms transform of each body
+     * @param count number of bodies
+     * @param worlds worlds the bodies are split in (empty for a single world)
+     * @param order receives the old index of the body that goes to each new index
+     * @param keys scratch memory, kept by the caller so a reorder allocates nothing once it has
+     * room for count keys
+     */
+    void computeMortonOrder(const glm::mat4* transforms, size_t count, const WorldLayout& worlds, std::vector<uint32_t>& order,
+                            std::vector<uint64_t>& keys);
+}
+
+
+#endif // MORTON_ORDER_H
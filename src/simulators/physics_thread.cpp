@@ -0,0 +1,83 @@
+#include "physics_thread.h"
+
+#include <chrono>
+
+#include "../profiling/cpu_profiler.h"
+
+namespace physics{
+
+    PhysicsThread::PhysicsThread(Simulable* simulator, const std::vector<glm::mat4>* transforms, float step_hz)
+        : m_simulator(simulator), m_transforms(transforms), m_running(false), m_steps(0),
+        m_step_hz(step_hz), m_time_factor(1.0f), m_gravity_x(0.0f), m_gravity_y(0.0f), m_gravity_z(0.0f),
+        m_realtime(true){
+    }
+
+    PhysicsThread::~PhysicsThread(){
+        stop();
+    }
+
+    void PhysicsThread::start(){
+        if (m_running.exchange(true))
+            return;
+
+        m_thread = std::thread(&PhysicsThread::run, this);
+    }
+
+    void PhysicsThread::stop(){
+        m_running.store(false, std::memory_order_release);
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    void PhysicsThread::setGravity(const glm::vec3& gravity){
+        m_gravity_x.store(gravity.x, std::memory_order_relaxed);
+        m_gravity_y.store(gravity.y, std::memory_order_relaxed);
+        m_gravity_z.store(gravity.z, std::memory_order_relaxed);
+    }
+
+    void PhysicsThread::run(){
+        using clock = std::chrono::steady_clock;
+        clock::time_point next_step = clock::now();
+        PROFILE_THREAD_NAME("physics");
+
+        while (m_running.load(std::memory_order_acquire)){
+            const float delta_time = 1.0f / m_step_hz.load(std::memory_order_relaxed);
+            const glm::vec3 gravity(
+                m_gravity_x.load(std::memory_order_relaxed),
+                m_gravity_y.load(std::memory_order_relaxed),
+                m_gravity_z.load(std::memory_order_relaxed)
+            );
+
+            const float step_time = delta_time * m_time_factor.load(std::memory_order_relaxed);
+            clock::time_point begin = clock::now();
+            m_simulator->update(step_time, gravity);
+            clock::time_point end = clock::now();
+            m_time += step_time;
+
+            //The slots keep their capacity, so after the first laps this does not allocate
+            const uint64_t step = m_steps.fetch_add(1, std::memory_order_relaxed) + 1;
+            {
+                PROFILE_ZONE("publish state");
+                PhysicsState& state = m_states.getWriteBuffer();
+                state.transforms.assign(m_transforms->begin(), m_transforms->end());
+                state.step = step;
+                state.step_ms = std::chrono::duration<float, std::milli>(end - begin).count();
+                m_states.publish();
+            }
+
+            if (m_publisher)
+                m_publisher->publish(step, m_time, *m_transforms);
+
+            if (!m_realtime.load(std::memory_order_relaxed))
+                continue;
+
+            //Pace to wall time. A step slower than real time is not caught up, the simulation just slows down
+            next_step += std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(delta_time));
+            clock::time_point now = clock::now();
+            if (next_step < now)
+                next_step = now;
+            else
+                std::this_thread::sleep_until(next_step);
+        }
+    }
+}
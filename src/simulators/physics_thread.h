@@ -0,0 +1,141 @@
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "simulators/simulable.h"
+#include "../jobs/triple_buffer.h"
+#include "../recording/state_publisher.h"
+
+namespace physics{
+
+    /**
+     * @brief Snapshot of the simulation published by the physics thread
+     */
+    struct PhysicsState{
+        std::vector<glm::mat4> transforms;
+        uint64_t step = 0; /* Number of steps taken when the snapshot was made */
+        float step_ms = 0.0f; /* Wall time of the step in milliseconds */
+    };
+
+    /**
+     * @brief Steps a cpu simulator at a fixed rate on its own thread. Every completed step is
+     * published through a triple buffer, so the render thread picks the latest state without
+     * ever blocking on the simulation.
+     * @note Only for simulators that do not need the OpenGL context (e.g. Simulator). Once started,
+     * the simulator and its transforms belong to the physics thread until stop()
+     */
+    class PhysicsThread{
+    private:
+        Simulable* m_simulator;
+        const std::vector<glm::mat4>* m_transforms; /* Transforms written by the simulator */
+
+        jobs::TripleBuffer<PhysicsState> m_states;
+        std::thread m_thread;
+        std::atomic<bool> m_running;
+        std::atomic<uint64_t> m_steps;
+
+        //Settings, written by the render thread and read once per step
+        std::atomic<float> m_step_hz;
+        std::atomic<float> m_time_factor;
+        std::atomic<float> m_gravity_x, m_gravity_y, m_gravity_z;
+        std::atomic<bool> m_realtime;
+
+        recording::StatePublisher* m_publisher = nullptr; /* Shared memory the steps are also published to, if any */
+        double m_time = 0.0; /* Simulated seconds so far */
+
+    public:
+        /**
+         * @brief Constructor
+         * @param simulator simulator to step
+         * @param transforms transforms written by the simulator (published after each step)
+         * @param step_hz frequency of the fixed step
+         */
+        PhysicsThread(Simulable* simulator, const std::vector<glm::mat4>* transforms, float step_hz = 60.0f);
+
+        /**
+         * @brief Destructor, stops the thread
+         */
+        ~PhysicsThread();
+
+        PhysicsThread(const PhysicsThread&) = delete;
+        PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+        /**
+         * @brief Starts stepping the simulation
+         */
+        void start();
+
+        /**
+         * @brief Stops the thread after the current step
+         */
+        void stop();
+
+        /**
+         * @brief Takes the latest published state (never blocks)
+         * @return true if there is a state newer than the one returned by getLatest()
+         * @note render thread only
+         */
+        inline bool acquireLatest() { return m_states.acquire(); }
+
+        /**
+         * @brief Gets the state taken by the last acquireLatest()
+         * @note render thread only
+         */
+        inline const PhysicsState& getLatest() const { return m_states.getReadBuffer(); }
+
+        /**
+         * @brief Sets the frequency of the fixed step
+         */
+        inline void setStepHz(float hz) { m_step_hz.store(hz, std::memory_order_relaxed); }
+
+        /**
+         * @brief Sets the factor applied to the step duration
+         */
+        inline void setTimeFactor(float factor) { m_time_factor.store(factor, std::memory_order_relaxed); }
+
+        /**
+         * @brief Sets the gravity of the next steps
+         */
+        void setGravity(const glm::vec3& gravity);
+
+        /**
+         * @brief If true the steps are paced to wall time, otherwise they run back to back
+         * (as fast as possible, e.g. to generate datasets)
+         */
+        inline void setRealtime(bool realtime) { m_realtime.store(realtime, std::memory_order_relaxed); }
+
+        /**
+         * @brief Also publishes every step into shared memory, for other processes
+         * @param publisher open publisher (null to stop publishing), it must outlive the thread
+         * @note Only while the thread is stopped
+         */
+        inline void setPublisher(recording::StatePublisher* publisher) { m_publisher = publisher; }
+
+        /**
+         * @brief Gets the number of steps taken
+         */
+        inline uint64_t getStepCount() const { return m_steps.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Tells whether the thread is running
+         */
+        inline bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+
+    private:
+        /**
+         * @brief Loop of the physics thread
+         */
+        void run();
+    };
+}
+
+
+#endif // PHYSICS_THREAD_H
@@ -6,7 +6,7 @@
 #include <vector>
 
 #include "glm/glm.hpp"
-#include "vertex_buffer.h"
+#include "../vertex.h"
 
 #include "utils.h"
 
@@ -1,99 +1,714 @@
 #include "simulator.h"
 
+#include <algorithm>
 #include <iostream>
 
-#include "glm/gtc/matrix_transform.hpp" 
+#include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/transform.hpp"
 #include "glm/glm.hpp"
 #include "glm/gtc/quaternion.hpp"
-#include "glm/gtc/random.hpp" 
+#include "glm/gtc/random.hpp"
 #include "glm/gtx/component_wise.hpp"
+#include "../profiling/cpu_profiler.h"
+#include "../recording/checkpoint.h"
+#include "morton_order.h"
 
+namespace{
+    //Same values as the uniforms and constants of the compute shaders
+    constexpr float C_RESTITUTION = 0.2f;
+    constexpr float C_FRICTION = 0.1f;
+    constexpr float C_BAUMGARTE_BETA = 0.1f;
+    constexpr float C_BAUMGARTE_SLOP = 0.01f;
+    constexpr float C_MIN_SOLVER_DELTA_TIME = 0.01f; //jacobi_friction_impulse.glsl skips smaller steps
 
-Simulator::Simulator(
-    std::vector<glm::mat4>* transforms, 
-    const std::vector<Vertex>* static_vertices, 
-    const std::vector<unsigned int>* static_indices
-) : sim_transforms(transforms), 
-    sim_static_vertices(static_vertices), 
-    sim_static_indices(static_indices){
-    //Create the objects
-    sim_objects.reserve(sim_transforms->size());
+    /**
+     * @brief Rotates R by omega during dt using Rodrigues' rotation formula
+     */
+    glm::mat3 updateRotation(const glm::mat3& R, const glm::vec3& omega, float dt){
+        float angle = glm::length(omega) * dt;
+        if (angle < 0.0001f)
+            return R;
+
+        glm::vec3 axis = omega / glm::length(omega);
+        float s = glm::sin(angle);
+        float c = glm::cos(angle);
+        float t = 1.0f - c;
+        glm::mat3 K = glm::mat3(
+            0, -axis.z, axis.y,
+            axis.z, 0, -axis.x,
+            -axis.y, axis.x, 0
+        );
+        glm::mat3 rot_mat = glm::mat3(1.0f) + s * K + t * (K * K);
+        return rot_mat * R;
+    }
+
+    /**
+     * @brief Projects both vertex sets on an axis and measures their overlap
+     * @return the penetration depth along the axis, negative if the sets are separated
+     */
+    float overlapOnAxis(const glm::vec3& axis, const glm::vec3* vertices_a, const glm::vec3* vertices_b, size_t count){
+        float min_a = glm::dot(axis, vertices_a[0]);
+        float max_a = min_a;
+        float min_b = glm::dot(axis, vertices_b[0]);
+        float max_b = min_b;
+
+        for (size_t i = 1; i < count; i++){
+            float proj_a = glm::dot(axis, vertices_a[i]);
+            min_a = std::min(min_a, proj_a);
+            max_a = std::max(max_a, proj_a);
+            float proj_b = glm::dot(axis, vertices_b[i]);
+            min_b = std::min(min_b, proj_b);
+            max_b = std::max(max_b, proj_b);
+        }
 
-    physics::AABB base_aabb = utils::calculateAABB(*sim_static_vertices);
+        if (min_a > max_b || max_a < min_b)
+            return -1.0f;
 
-    for (int i = 0; i < sim_transforms->size(); i++){
-        physics::Object object;
+        return std::min(max_b - min_a, max_a - min_b);
+    }
+}
 
-        object.transform = &sim_transforms->at(i);
-        object.static_vertices = sim_static_vertices;
 
-        object.aabb = base_aabb;
-        object.aabb.extents *= utils::scaleFromTransform(*object.transform);
-        float max_extent = std::max(std::max(object.aabb.extents.x, object.aabb.extents.y), object.aabb.extents.z);
-        object.aabb.extents = glm::vec3(max_extent * 1.01f);
-        object.aabb = utils::updateAABB(object.aabb, object.transform);
+Simulator::Simulator(
+    std::vector<glm::mat4>* transforms,
+    const std::vector<SimpleVertex>* static_vertices,
+    const std::vector<unsigned int>* static_indices,
+    const std::vector<glm::vec4>* object_vertices,
+    const std::vector<glm::vec4>* object_normals,
+    const std::vector<glm::vec4>* object_edges,
+    std::vector<physics::Properties>* properties,
+    jobs::JobSystem* job_system
+) : sim_transforms(transforms),
+    sim_static_vertices(static_vertices),
+    sim_static_indices(static_indices),
+    m_object_vertices(object_vertices),
+    m_object_normals(object_normals),
+    m_object_edges(object_edges),
+    sim_properties(properties),
+    m_job_system(job_system){
 
-        object.physics.velocity = glm::linearRand(glm::vec3(-0.05f), glm::vec3(0.05f));
-        object.physics.acceleration = glm::vec3(0.0f);
-        object.physics.angular_velocity = glm::linearRand(glm::vec3(-0.05f), glm::vec3(0.05f));
-        object.physics.angular_acceleration = glm::vec3(0.0f);
+    if (!m_job_system){
+        m_own_job_system = std::make_unique<jobs::JobSystem>();
+        m_job_system = m_own_job_system.get();
+    }
 
-        
-        sim_objects.push_back(object);
-    }   
+    initializeData();
+    buildStepGraph();
 }
 
 Simulator::~Simulator(){
     sim_transforms = nullptr;
     sim_static_vertices = nullptr;
     sim_static_indices = nullptr;
-    sim_objects.clear();
+    sim_properties = nullptr;
 }
 
 void Simulator::update(float delta_time, glm::vec3 gravity){
-    for (auto& object : sim_objects) {
-        updateObject(object, delta_time);
-    }
-}
-
-void Simulator::updateObject(physics::Object& object, float delta_time){
-    // Create rotation quaternion
-    glm::quat rotation_quat = glm::quat(object.physics.angular_velocity * delta_time);
-    
-    // Extract current position and rotation from transform
-    glm::vec3 position = glm::vec3((*object.transform)[3]);
-    glm::mat3 rotation = glm::mat3(*object.transform);
-    
-    // Apply new rotation to current rotation
-    glm::mat3 new_rotation = glm::mat3_cast(rotation_quat) * rotation;
-    
-    // Apply velocity to position
-    glm::vec3 new_position = position + object.physics.velocity * delta_time;
-    
-    // Build new transform matrix
-    glm::mat4 new_transform = glm::mat4(1.0f);
-    
-    // Set rotation part
-    new_transform[0][0] = new_rotation[0][0];
-    new_transform[0][1] = new_rotation[0][1];
-    new_transform[0][2] = new_rotation[0][2];
-    
-    new_transform[1][0] = new_rotation[1][0];
-    new_transform[1][1] = new_rotation[1][1];
-    new_transform[1][2] = new_rotation[1][2];
-    
-    new_transform[2][0] = new_rotation[2][0];
-    new_transform[2][1] = new_rotation[2][1];
-    new_transform[2][2] = new_rotation[2][2];
-    
-    // Set position part
-    new_transform[3][0] = new_position.x;
-    new_transform[3][1] = new_position.y;
-    new_transform[3][2] = new_position.z;
-    
-    // Update transform
-    *object.transform = new_transform;
-
-    object.aabb = utils::updateAABB(object.aabb, object.transform);
+    m_delta_time = delta_time;
+    m_gravity = gravity;
+
+    PROFILE_ZONE("cpu step");
+    if (m_reorder_interval > 0 && ++m_steps_since_reorder >= m_reorder_interval)
+        reorderBodies();
+
+    m_step_graph.run(*m_job_system);
+    PROFILE_COUNTER("cpu pairs", m_pair_count);
+    PROFILE_COUNTER("cpu contacts", m_contact_count);
+
+    //How the work is split between the threads changes every step, so any thread arena may have
+    //to hold what all of them used together
+    size_t thread_bytes = 0;
+    for (const auto& arena : m_thread_arenas)
+        thread_bytes += arena.getUsed();
+    m_thread_arena_peak = std::max(m_thread_arena_peak, thread_bytes);
+
+    //Nothing of the step survives it, so the arenas start empty on the next one
+    m_step_arena.reset();
+    for (auto& arena : m_thread_arenas){
+        arena.reset();
+        arena.reserve(m_thread_arena_peak);
+    }
+}
+
+size_t Simulator::getArenaHighWaterMark() const{
+    size_t bytes = m_step_arena.getHighWaterMark();
+    for (const auto& arena : m_thread_arenas)
+        bytes += arena.getHighWaterMark();
+    return bytes;
+}
+
+size_t Simulator::getArenaCapacity() const{
+    size_t bytes = m_step_arena.getCapacity();
+    for (const auto& arena : m_thread_arenas)
+        bytes += arena.getCapacity();
+    return bytes;
+}
+
+void Simulator::initializeData(){
+    size_t objects = sim_transforms->size();
+    unsigned int threads = m_job_system->getThreadCount();
+
+    //Bounding spheres
+    float base_radius = utils::calculateRadius(*sim_static_vertices);
+    sim_spheres.resize(objects, glm::vec4(0.0f, 0.0f, 0.0f, base_radius));
+
+    for (size_t i = 0; i < objects; i++){
+        const glm::mat4& transform = sim_transforms->at(i);
+
+        glm::vec3 scale = utils::scaleFromTransform(transform);
+        sim_spheres[i].w *= glm::max(scale.x, glm::max(scale.y, scale.z));
+        sim_spheres[i][0] = transform[3][0];
+        sim_spheres[i][1] = transform[3][1];
+        sim_spheres[i][2] = transform[3][2];
+    }
+
+    //Per object data
+    m_sweep_order.resize(objects);
+    for (size_t i = 0; i < objects; i++)
+        m_sweep_order[i] = static_cast<unsigned int>(i);
+    resizeObjectData();
+
+    //Per thread data
+    m_thread_arenas.reserve(threads);
+    for (unsigned int t = 0; t < threads; t++)
+        m_thread_arenas.emplace_back(256 * 1024);
+    m_thread_pairs.resize(threads);
+    m_thread_manifolds.resize(threads);
+    m_thread_vertices.resize(threads);
+    for (auto& vertices : m_thread_vertices)
+        vertices.resize(m_object_vertices->size() * 2);
+}
+
+void Simulator::resizeObjectData(){
+    size_t objects = sim_transforms->size();
+    m_sweep_min.resize(objects);
+    m_island_parent.resize(objects);
+    m_island_counts.resize(objects);
+    m_delta_v.assign(objects, glm::vec3(0.0f));
+    resizeReorderData(m_reorder_interval > 0 ? objects : 0);
+}
+
+void Simulator::resizeReorderData(size_t objects){
+    m_reorder.reserve(objects);
+    m_reorder_keys.reserve(objects);
+    m_reorder_transforms.resize(objects);
+    m_reorder_properties.resize(objects);
+    m_reorder_spheres.resize(objects);
+    m_reorder_new_index.resize(objects);
+    if (objects == 0){
+        m_reorder_keys.shrink_to_fit();
+        m_reorder_transforms.shrink_to_fit();
+        m_reorder_properties.shrink_to_fit();
+        m_reorder_spheres.shrink_to_fit();
+        m_reorder_new_index.shrink_to_fit();
+    }
+}
+
+bool Simulator::saveCheckpoint(const std::string& path, uint64_t seed){
+    recording::CheckpointWriter writer;
+    writer.addSection(recording::CheckpointSection::Transforms, sim_transforms->data(), sim_transforms->size());
+    writer.addSection(recording::CheckpointSection::Properties, sim_properties->data(), sim_properties->size());
+    writer.addSection(recording::CheckpointSection::Spheres, sim_spheres.data(), sim_spheres.size());
+    writer.addSection(recording::CheckpointSection::SweepOrder, m_sweep_order.data(), m_sweep_order.size());
+
+    recording::CheckpointHeader header{};
+    header.body_count = static_cast<uint32_t>(sim_transforms->size());
+    header.seed = seed;
+    header.pair_count = static_cast<uint32_t>(m_pair_count);
+    header.contact_count = static_cast<uint32_t>(m_contact_count);
+    header.free_slot = UINT32_MAX;
+    return writer.save(path, header);
+}
+
+bool Simulator::loadCheckpoint(const std::string& path, uint64_t* seed){
+    recording::CheckpointReader reader;
+    if (!reader.open(path))
+        return false;
+
+    const recording::CheckpointHeader& header = reader.getHeader();
+    size_t objects = header.body_count;
+
+    size_t transform_count, properties_count, sphere_count, order_count;
+    const glm::mat4* transforms = reader.getSection<glm::mat4>(recording::CheckpointSection::Transforms, transform_count);
+    const physics::Properties* properties = reader.getSection<physics::Properties>(recording::CheckpointSection::Properties, properties_count);
+    const glm::vec4* spheres = reader.getSection<glm::vec4>(recording::CheckpointSection::Spheres, sphere_count);
+    const uint32_t* order = reader.getSection<uint32_t>(recording::CheckpointSection::SweepOrder, order_count);
+    if (!transforms || !properties || transform_count != objects || properties_count != objects){
+        std::cerr << "Simulator: the bodies of " << path << " do not match its header" << std::endl;
+        return false;
+    }
+
+    sim_transforms->assign(transforms, transforms + objects);
+    sim_properties->assign(properties, properties + objects);
+
+    //Checkpoints without spheres get them from the transforms
+    if (spheres && sphere_count == objects)
+        sim_spheres.assign(spheres, spheres + objects);
+    else{
+        float base_radius = utils::calculateRadius(*sim_static_vertices);
+        sim_spheres.resize(objects);
+        for (size_t i = 0; i < objects; i++){
+            glm::vec3 scale = utils::scaleFromTransform(transforms[i]);
+            sim_spheres[i] = glm::vec4(glm::vec3(transforms[i][3]), base_radius * glm::max(scale.x, glm::max(scale.y, scale.z)));
+        }
+    }
+
+    //The sort of the broad phase starts from the saved order, so the pairs come in the same order
+    //as in the run that was saved. Anything but a permutation of the objects is ignored
+    bool valid_order = order && order_count == objects;
+    std::vector<bool> seen(valid_order ? objects : 0, false);
+    for (size_t i = 0; valid_order && i < objects; i++){
+        valid_order = order[i] < objects && !seen[order[i]];
+        if (valid_order)
+            seen[order[i]] = true;
+    }
+    //The worlds are kept if the bodies still fit them, the saved order must then keep each world in its range
+    if (!m_worlds.isValid(objects)){
+        std::cerr << "Simulator: " << path << " does not fit the worlds, going back to a single world" << std::endl;
+        m_worlds = physics::WorldLayout();
+    }
+    m_worlds.getBodyWorlds(m_body_worlds);
+    for (unsigned int w = 0; valid_order && w < m_worlds.getWorldCount(); w++){
+        for (unsigned int i = m_worlds.offsets[w]; valid_order && i < m_worlds.offsets[w + 1]; i++)
+            valid_order = m_body_worlds[order[i]] == w;
+    }
+
+    m_sweep_order.resize(objects);
+    for (size_t i = 0; i < objects; i++)
+        m_sweep_order[i] = valid_order ? order[i] : static_cast<unsigned int>(i);
+    resizeObjectData();
+
+    m_pair_count = header.pair_count;
+    m_contact_count = header.contact_count;
+
+    if (seed)
+        *seed = header.seed;
+    return true;
+}
+
+void Simulator::resetBodies(){
+    size_t objects = sim_transforms->size();
+    float base_radius = utils::calculateRadius(*sim_static_vertices);
+    sim_spheres.resize(objects);
+    for (size_t i = 0; i < objects; i++){
+        const glm::mat4& transform = (*sim_transforms)[i];
+        glm::vec3 scale = utils::scaleFromTransform(transform);
+        sim_spheres[i] = glm::vec4(glm::vec3(transform[3]), base_radius * glm::max(scale.x, glm::max(scale.y, scale.z)));
+    }
+
+    m_sweep_order.resize(objects);
+    for (size_t i = 0; i < objects; i++)
+        m_sweep_order[i] = static_cast<unsigned int>(i);
+
+    if (!m_worlds.isValid(objects)){
+        std::cerr << "Simulator: the worlds do not fit the new bodies, going back to a single world" << std::endl;
+        m_worlds = physics::WorldLayout();
+    }
+    m_worlds.getBodyWorlds(m_body_worlds);
+    resizeObjectData();
+}
+
+void Simulator::reorderBodies(){
+    PROFILE_ZONE("reorder bodies");
+    m_steps_since_reorder = 0;
+    size_t objects = sim_transforms->size();
+    //Only a reorder requested while reordering is disabled has to make room first
+    if (m_reorder_spheres.size() != objects)
+        resizeReorderData(objects);
+    physics::computeMortonOrder(sim_transforms->data(), objects, m_worlds, m_reorder, m_reorder_keys);
+
+    for (size_t i = 0; i < objects; i++){
+        m_reorder_transforms[i] = (*sim_transforms)[m_reorder[i]];
+        m_reorder_properties[i] = (*sim_properties)[m_reorder[i]];
+        m_reorder_spheres[i] = sim_spheres[m_reorder[i]];
+        m_reorder_new_index[m_reorder[i]] = static_cast<unsigned int>(i);
+    }
+    //Copied back so the vectors of the caller keep their storage
+    std::copy(m_reorder_transforms.begin(), m_reorder_transforms.begin() + objects, sim_transforms->begin());
+    std::copy(m_reorder_properties.begin(), m_reorder_properties.begin() + objects, sim_properties->begin());
+    sim_spheres.swap(m_reorder_spheres);
+
+    //The sweep order keeps the same objects in the same places, so it stays almost sorted
+    for (unsigned int& index : m_sweep_order)
+        index = m_reorder_new_index[index];
+
+    //The pairs and contacts of the last step refer to the old indices
+    m_pair_count = 0;
+    m_contact_count = 0;
+    m_reorder_count++;
+}
+
+void Simulator::setReorderInterval(unsigned int steps){
+    m_reorder_interval = steps;
+    m_steps_since_reorder = 0;
+    resizeReorderData(steps > 0 ? sim_transforms->size() : 0);
+}
+
+bool Simulator::setWorlds(const physics::WorldLayout& worlds){
+    if (!worlds.isValid(sim_transforms->size())){
+        std::cerr << "Simulator: the worlds do not cover the " << sim_transforms->size() << " objects" << std::endl;
+        return false;
+    }
+
+    m_worlds = worlds;
+    m_worlds.getBodyWorlds(m_body_worlds);
+
+    //Each world takes the range of its objects in the sweep order
+    for (size_t i = 0; i < m_sweep_order.size(); i++)
+        m_sweep_order[i] = static_cast<unsigned int>(i);
+    return true;
+}
+
+void Simulator::buildStepGraph(){
+    auto integrate = m_step_graph.addTask("integrate", [this]{ this->integrate(); });
+    auto prepare = m_step_graph.addTask("prepare solver", [this]{ this->prepareSolver(); });
+    auto broad = m_step_graph.addTask("broad phase", [this]{ this->broadPhase(); });
+    auto narrow = m_step_graph.addTask("narrow phase", [this]{ this->narrowPhase(); });
+    auto islands = m_step_graph.addTask("islands", [this]{ this->buildIslands(); });
+    auto solve = m_step_graph.addTask("solve", [this]{ this->solve(); });
+
+    //Solver data is reset while the collision phases run
+    m_step_graph.addDependency(integrate, broad);
+    m_step_graph.addDependency(broad, narrow);
+    m_step_graph.addDependency(narrow, islands);
+    m_step_graph.addDependency(prepare, islands);
+    m_step_graph.addDependency(islands, solve);
+}
+
+void Simulator::integrate(){
+    m_job_system->parallelFor(sim_transforms->size(), [this](size_t begin, size_t end){
+        for (size_t i = begin; i < end; i++){
+            glm::mat4& transform = (*sim_transforms)[i];
+            physics::Properties& properties = (*sim_properties)[i];
+
+            glm::vec3 velocity = properties.velocity;
+            if (properties.inverseMass != 0.0f)
+                velocity += (m_body_worlds.empty() ? m_gravity : m_worlds.params[m_body_worlds[i]].gravity) * m_delta_time;
+
+            glm::vec3 position = glm::vec3(transform[3]) + velocity * m_delta_time;
+            glm::mat3 rotation = updateRotation(glm::mat3(transform), properties.angular_velocity, m_delta_time);
+
+            properties.velocity = velocity;
+            transform = glm::mat4(
+                glm::vec4(rotation[0], 0.0f),
+                glm::vec4(rotation[1], 0.0f),
+                glm::vec4(rotation[2], 0.0f),
+                glm::vec4(position, 1.0f)
+            );
+            sim_spheres[i] = glm::vec4(position, sim_spheres[i].w);
+        }
+    }, 256);
+}
+
+void Simulator::prepareSolver(){
+    m_job_system->parallelFor(m_island_parent.size(), [this](size_t begin, size_t end){
+        for (size_t i = begin; i < end; i++){
+            m_island_parent[i] = static_cast<unsigned int>(i);
+            m_island_counts[i] = 0;
+        }
+    }, 1024);
+}
+
+void Simulator::broadPhase(){
+    //Sort by the lower x of each sphere, the order of the last step is kept so it is almost sorted
+    for (size_t i = 0; i < sim_spheres.size(); i++)
+        m_sweep_min[i] = sim_spheres[i].x - sim_spheres[i].w;
+
+    auto byMin = [this](unsigned int a, unsigned int b){
+        return m_sweep_min[a] < m_sweep_min[b];
+    };
+
+    for (size_t t = 0; t < m_thread_pairs.size(); t++)
+        m_thread_pairs[t] = memory::FrameVector<glm::uvec2>(m_thread_arenas[t]);
+
+    if (m_worlds.getWorldCount() == 0){
+        std::sort(m_sweep_order.begin(), m_sweep_order.end(), byMin);
+
+        m_job_system->parallelFor(m_sweep_order.size(), [this](size_t begin, size_t end){
+            memory::FrameVector<glm::uvec2>& pairs = m_thread_pairs[m_job_system->getThreadIndex()];
+            for (size_t i = begin; i < end; i++)
+                sweep(i, m_sweep_order.size(), pairs);
+        }, 64);
+    }
+    else{
+        //Worlds are small, each one is sorted and swept by a single thread
+        m_job_system->parallelFor(m_worlds.getWorldCount(), [this, &byMin](size_t begin, size_t end){
+            memory::FrameVector<glm::uvec2>& pairs = m_thread_pairs[m_job_system->getThreadIndex()];
+            for (size_t w = begin; w < end; w++){
+                size_t first = m_worlds.offsets[w];
+                size_t last = m_worlds.offsets[w + 1];
+                std::sort(m_sweep_order.begin() + first, m_sweep_order.begin() + last, byMin);
+
+                for (size_t i = first; i < last; i++)
+                    sweep(i, last, pairs);
+            }
+        }, 4);
+    }
+
+    size_t pair_count = 0;
+    for (const auto& pairs : m_thread_pairs)
+        pair_count += pairs.size();
+
+    m_collision_pairs = memory::FrameVector<glm::uvec2>(m_step_arena, pair_count);
+    for (const auto& pairs : m_thread_pairs)
+        m_collision_pairs.append(pairs.data(), pairs.size());
+    m_pair_count = pair_count;
+
+    //How the pairs are split between the threads depends on their number
+    if (m_deterministic){
+        std::sort(m_collision_pairs.begin(), m_collision_pairs.end(), [](const glm::uvec2& a, const glm::uvec2& b){
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+    }
+}
+
+void Simulator::narrowPhase(){
+    for (size_t t = 0; t < m_thread_manifolds.size(); t++)
+        m_thread_manifolds[t] = memory::FrameVector<physics::ContactManifold>(m_thread_arenas[t]);
+
+    m_job_system->parallelFor(m_collision_pairs.size(), [this](size_t begin, size_t end){
+        unsigned int thread = m_job_system->getThreadIndex();
+        memory::FrameVector<physics::ContactManifold>& manifolds = m_thread_manifolds[thread];
+        glm::vec3* world_vertices = m_thread_vertices[thread].data();
+
+        physics::ContactManifold manifold;
+        for (size_t i = begin; i < end; i++){
+            if (collide(m_collision_pairs[i].x, m_collision_pairs[i].y, world_vertices, manifold))
+                manifolds.push_back(manifold);
+        }
+    }, 16);
+
+    size_t contact_count = 0;
+    for (const auto& manifolds : m_thread_manifolds)
+        contact_count += manifolds.size();
+
+    m_manifolds = memory::FrameVector<physics::ContactManifold>(m_step_arena, contact_count);
+    for (const auto& manifolds : m_thread_manifolds)
+        m_manifolds.append(manifolds.data(), manifolds.size());
+    m_contact_count = contact_count;
+
+    //The solver walks the contacts in this order, so it must not depend on the number of threads
+    if (m_deterministic){
+        std::sort(m_manifolds.begin(), m_manifolds.end(), [](const physics::ContactManifold& a, const physics::ContactManifold& b){
+            return a.indexA < b.indexA || (a.indexA == b.indexA && a.indexB < b.indexB);
+        });
+    }
+}
+
+bool Simulator::collide(unsigned int a, unsigned int b, glm::vec3* world_vertices, physics::ContactManifold& manifold) const{
+    const glm::mat4& transform_a = (*sim_transforms)[a];
+    const glm::mat4& transform_b = (*sim_transforms)[b];
+    const size_t vertex_count = m_object_vertices->size();
+
+    //Transform the vertices once instead of once per axis
+    glm::vec3* vertices_a = world_vertices;
+    glm::vec3* vertices_b = world_vertices + vertex_count;
+    for (size_t i = 0; i < vertex_count; i++){
+        vertices_a[i] = glm::vec3(transform_a * (*m_object_vertices)[i]);
+        vertices_b[i] = glm::vec3(transform_b * (*m_object_vertices)[i]);
+    }
+
+    float best_depth = 1e10f;
+    glm::vec3 best_axis = glm::vec3(0.0f);
+
+    auto testAxis = [&](const glm::vec3& axis){
+        float depth = overlapOnAxis(axis, vertices_a, vertices_b, vertex_count);
+        if (depth < 0.0f)
+            return false;
+
+        if (depth < best_depth){
+            best_depth = depth;
+            best_axis = axis;
+        }
+        return true;
+    };
+
+    //Face normals of both objects
+    for (const auto& normal : *m_object_normals){
+        if (!testAxis(glm::normalize(glm::vec3(transform_a * normal))))
+            return false;
+    }
+    for (const auto& normal : *m_object_normals){
+        if (!testAxis(glm::normalize(glm::vec3(transform_b * normal))))
+            return false;
+    }
+
+    //Cross products of the edges
+    for (const auto& edge_a : *m_object_edges){
+        glm::vec3 world_edge_a = glm::vec3(transform_a * edge_a);
+
+        for (const auto& edge_b : *m_object_edges){
+            glm::vec3 axis = glm::cross(world_edge_a, glm::vec3(transform_b * edge_b));
+            if (glm::length(axis) < 0.001f)
+                continue;
+
+            if (!testAxis(glm::normalize(axis)))
+                return false;
+        }
+    }
+
+    //Normal always points from A to B
+    glm::vec3 center_offset = glm::vec3(transform_b[3]) - glm::vec3(transform_a[3]);
+    if (glm::dot(best_axis, center_offset) < 0.0f)
+        best_axis = -best_axis;
+
+    manifold = physics::ContactManifold();
+    manifold.indexA = a;
+    manifold.indexB = b;
+    manifold.normal = glm::vec4(best_axis, 0.0f);
+    manifold.depth = best_depth;
+    return true;
+}
+
+void Simulator::sweep(size_t position, size_t end, memory::FrameVector<glm::uvec2>& pairs) const{
+    unsigned int a = m_sweep_order[position];
+    glm::vec4 current = sim_spheres[a];
+    float max_x = current.x + current.w;
+
+    for (size_t j = position + 1; j < end && m_sweep_min[m_sweep_order[j]] <= max_x; j++){
+        unsigned int b = m_sweep_order[j];
+        glm::vec4 other = sim_spheres[b];
+        float r = current.w + other.w;
+        glm::vec3 distance = glm::vec3(current) - glm::vec3(other);
+
+        if (glm::dot(distance, distance) <= r * r)
+            pairs.push_back(a < b ? glm::uvec2(a, b) : glm::uvec2(b, a));
+    }
+}
+
+unsigned int Simulator::findIsland(unsigned int object){
+    while (m_island_parent[object] != object){
+        m_island_parent[object] = m_island_parent[m_island_parent[object]];
+        object = m_island_parent[object];
+    }
+    return object;
+}
+
+void Simulator::buildIslands(){
+    const std::vector<physics::Properties>& properties = *sim_properties;
+
+    //Join the dynamic objects of each contact. Static objects are not joined,
+    //otherwise the floor would merge every pile into a single island
+    for (const auto& manifold : m_manifolds){
+        if (properties[manifold.indexA].inverseMass == 0.0f || properties[manifold.indexB].inverseMass == 0.0f)
+            continue;
+
+        unsigned int root_a = findIsland(manifold.indexA);
+        unsigned int root_b = findIsland(manifold.indexB);
+        if (root_a != root_b)
+            m_island_parent[std::max(root_a, root_b)] = std::min(root_a, root_b);
+    }
+
+    //Count the contacts of each island (contacts between static objects do nothing)
+    m_contact_island = memory::FrameVector<unsigned int>(m_step_arena, m_manifolds.size());
+    m_contact_island.resize(m_manifolds.size());
+    for (size_t c = 0; c < m_manifolds.size(); c++){
+        const auto& manifold = m_manifolds[c];
+        unsigned int dynamic = properties[manifold.indexA].inverseMass != 0.0f ? manifold.indexA : manifold.indexB;
+
+        if (properties[dynamic].inverseMass == 0.0f){
+            m_contact_island[c] = UINT32_MAX;
+            continue;
+        }
+
+        m_contact_island[c] = findIsland(dynamic);
+        m_island_counts[m_contact_island[c]]++;
+    }
+
+    //Offsets of each island, the counts become the scatter cursors
+    m_island_offsets = memory::FrameVector<unsigned int>(m_step_arena);
+    unsigned int total = 0;
+    for (size_t i = 0; i < m_island_counts.size(); i++){
+        if (m_island_counts[i] == 0)
+            continue;
+
+        m_island_offsets.push_back(total);
+        unsigned int count = m_island_counts[i];
+        m_island_counts[i] = total;
+        total += count;
+    }
+    m_island_offsets.push_back(total);
+
+    m_island_contacts = memory::FrameVector<unsigned int>(m_step_arena, total);
+    m_island_contacts.resize(total);
+    for (size_t c = 0; c < m_manifolds.size(); c++){
+        if (m_contact_island[c] != UINT32_MAX)
+            m_island_contacts[m_island_counts[m_contact_island[c]]++] = static_cast<unsigned int>(c);
+    }
+}
+
+void Simulator::solve(){
+    if (m_delta_time < C_MIN_SOLVER_DELTA_TIME || m_manifolds.empty())
+        return;
+
+    m_contact_impulses = memory::FrameVector<glm::vec3>(m_step_arena, m_manifolds.size());
+    m_contact_impulses.resize(m_manifolds.size());
+    size_t island_count = m_island_offsets.size() - 1;
+
+    //Islands share no dynamic object, so they are solved without atomics
+    m_job_system->parallelFor(island_count, [this](size_t begin, size_t end){
+        std::vector<physics::Properties>& properties = *sim_properties;
+        const float inv_dt = 1.0f / m_delta_time;
+
+        for (size_t island = begin; island < end; island++){
+            const unsigned int* contacts = m_island_contacts.data() + m_island_offsets[island];
+            const unsigned int contact_count = m_island_offsets[island + 1] - m_island_offsets[island];
+
+            for (unsigned int iteration = 0; iteration < m_solver_iterations; iteration++){
+                //Impulses from the velocities of the previous iteration (Jacobi)
+                for (unsigned int k = 0; k < contact_count; k++){
+                    const physics::ContactManifold& contact = m_manifolds[contacts[k]];
+                    glm::vec3& impulse = m_contact_impulses[contacts[k]];
+                    impulse = glm::vec3(0.0f);
+
+                    const physics::Properties& props_a = properties[contact.indexA];
+                    const physics::Properties& props_b = properties[contact.indexB];
+                    float inv_mass_sum = props_a.inverseMass + props_b.inverseMass;
+
+                    if (contact.depth <= C_BAUMGARTE_SLOP || inv_mass_sum <= 0.00001f)
+                        continue;
+
+                    glm::vec3 normal = glm::vec3(contact.normal);
+                    glm::vec3 rel_vel = props_b.velocity - props_a.velocity;
+                    float rel_vel_along_normal = glm::dot(rel_vel, normal);
+
+                    float restitution = m_body_worlds.empty() ? C_RESTITUTION : m_worlds.params[m_body_worlds[contact.indexA]].restitution;
+                    float bias = -C_BAUMGARTE_BETA * inv_dt * std::max(0.0f, contact.depth - C_BAUMGARTE_SLOP);
+                    float j_normal = std::max(0.0f, -(rel_vel_along_normal * (1.0f + restitution) + bias) / inv_mass_sum);
+                    impulse = j_normal * normal;
+
+                    //Coulomb friction against the tangential motion
+                    glm::vec3 tangent_vel = rel_vel - rel_vel_along_normal * normal;
+                    float tangent_speed = glm::length(tangent_vel);
+                    if (tangent_speed > 0.00001f){
+                        float friction = std::min(tangent_speed / inv_mass_sum, C_FRICTION * j_normal);
+                        impulse += -friction * (tangent_vel / tangent_speed);
+                    }
+                }
+
+                //Accumulate the velocity changes of the dynamic objects
+                for (unsigned int k = 0; k < contact_count; k++){
+                    const physics::ContactManifold& contact = m_manifolds[contacts[k]];
+                    const glm::vec3& impulse = m_contact_impulses[contacts[k]];
+
+                    if (properties[contact.indexA].inverseMass > 0.0f)
+                        m_delta_v[contact.indexA] -= impulse * properties[contact.indexA].inverseMass;
+                    if (properties[contact.indexB].inverseMass > 0.0f)
+                        m_delta_v[contact.indexB] += impulse * properties[contact.indexB].inverseMass;
+                }
+
+                //Apply them, the accumulator is reset on the first visit so later visits add nothing
+                for (unsigned int k = 0; k < contact_count; k++){
+                    const physics::ContactManifold& contact = m_manifolds[contacts[k]];
+
+                    for (unsigned int object : {contact.indexA, contact.indexB}){
+                        if (properties[object].inverseMass > 0.0f){
+                            properties[object].velocity += m_delta_v[object];
+                            m_delta_v[object] = glm::vec3(0.0f);
+                        }
+                    }
+                }
+            }
+        }
+    });
 }
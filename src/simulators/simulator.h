@@ -3,33 +3,116 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "glm/glm.hpp"
-#include "vertex_buffer.h"
+#include "../vertex.h"
 
 #include "simulators/simulable.h"
 #include "utils.h"
+#include "../jobs/job_system.h"
+#include "../jobs/task_graph.h"
+#include "../memory/frame_arena.h"
+#include "world_batch.h"
 
 /**
- * @brief class representation of a simulator running on the cpu
+ * @brief class representation of a simulator running on the cpu. It follows the same
+ * pipeline as GpuSimulator (integrate, broad phase, narrow phase, impulse resolution),
+ * with every phase spread over the job system
  */
 class Simulator : public Simulable{
 private:
     std::vector<glm::mat4>* sim_transforms; /* Transform matrices for each object */
-    const std::vector<Vertex>* sim_static_vertices; //Vertex data
-    const std::vector<unsigned int>* sim_static_indices; //Vertex indices
+    const std::vector<SimpleVertex>* sim_static_vertices; //SimpleVertex data
+    const std::vector<unsigned int>* sim_static_indices; //SimpleVertex indices
+    const std::vector<glm::vec4>* m_object_vertices;
+    const std::vector<glm::vec4>* m_object_normals;
+    const std::vector<glm::vec4>* m_object_edges;
+
+    std::vector<glm::vec4> sim_spheres; /* Bounding sphere of each object (xyz center, w radius) */
+    std::vector<physics::Properties>* sim_properties;
+
+    std::unique_ptr<jobs::JobSystem> m_own_job_system; /* Used when no job system is given */
+    jobs::JobSystem* m_job_system;
+    jobs::TaskGraph m_step_graph; /* Phases of a step and their dependencies */
+
+    //Step parameters, read by the phases
+    float m_delta_time = 0.0f;
+    glm::vec3 m_gravity = glm::vec3(0.0f);
+    unsigned int m_solver_iterations = 10;
+    bool m_deterministic = false; /* Sort the pairs and contacts so the result does not depend on the threads */
+
+    //Independent worlds, empty for a single world
+    physics::WorldLayout m_worlds;
+    std::vector<unsigned int> m_body_worlds; /* World of each object */
+
+    //Reordering of the objects by Morton code, so the ones that touch sit close in memory
+    unsigned int m_reorder_interval = 0; /* Steps between two reorders, 0 to never reorder */
+    unsigned int m_steps_since_reorder = 0;
+    uint64_t m_reorder_count = 0;
+    std::vector<uint32_t> m_reorder; /* Old index of each object after the last reorder */
+    //Scratch of a reorder, sized while reordering is enabled so the steps that reorder allocate nothing
+    std::vector<uint64_t> m_reorder_keys; /* Morton keys */
+    std::vector<glm::mat4> m_reorder_transforms; /* Permuted copies, the transforms and properties are copied back */
+    std::vector<physics::Properties> m_reorder_properties;
+    std::vector<glm::vec4> m_reorder_spheres; /* Permuted spheres, swapped with sim_spheres */
+    std::vector<unsigned int> m_reorder_new_index; /* New index of each old one */
+
+    //Transient memory, everything allocated from these arenas is released at the end of the step
+    memory::FrameArena m_step_arena; /* Used by the serial parts of the phases */
+    std::vector<memory::FrameArena> m_thread_arenas; /* One per job system thread */
+    size_t m_thread_arena_peak = 0; /* Largest memory used by all the thread arenas together in a step */
+
+    //Broad phase
+    std::vector<unsigned int> m_sweep_order; /* Objects sorted by the lower x of their sphere, each world sorted within its range */
+    std::vector<float> m_sweep_min; /* Lower x of each sphere */
+    std::vector<memory::FrameVector<glm::uvec2>> m_thread_pairs; /* Pairs found by each thread */
+    memory::FrameVector<glm::uvec2> m_collision_pairs;
+    size_t m_pair_count = 0;
+
+    //Narrow phase
+    std::vector<std::vector<glm::vec3>> m_thread_vertices; /* World vertices of both objects, per thread */
+    std::vector<memory::FrameVector<physics::ContactManifold>> m_thread_manifolds; /* Contacts found by each thread */
+    memory::FrameVector<physics::ContactManifold> m_manifolds;
+    size_t m_contact_count = 0;
+
+    //Islands
+    std::vector<unsigned int> m_island_parent; /* Union-find forest over the dynamic objects */
+    std::vector<unsigned int> m_island_counts; /* Contacts per island root, then scatter cursor */
+    memory::FrameVector<unsigned int> m_contact_island; /* Island root of each contact */
+    memory::FrameVector<unsigned int> m_island_offsets; /* Start of each island in m_island_contacts */
+    memory::FrameVector<unsigned int> m_island_contacts; /* Contacts grouped by island */
+
+    //Solver
+    memory::FrameVector<glm::vec3> m_contact_impulses; /* Impulse applied on B by each contact */
+    std::vector<glm::vec3> m_delta_v; /* Velocity change accumulated in one iteration */
 
-    std::vector<physics::Object> sim_objects; /* Vector containing each object in the simulation */
 public:
     /**
      * @brief Constructor
      * @param transforms pointer to the transform matrix of the objects
      * @param static_vertices pointer to the original vertices of the geometry
      * @param static_indices pointer to the order in which each triangle is being drawn
+     * @param object_vertices pointer to the vertices of the collision shape
+     * @param object_normals pointer to the unique face normals of the collision shape
+     * @param object_edges pointer to the unique edge directions of the collision shape
+     * @param properties pointer to the physics properties of the objects
+     * @param job_system job system running the phases (if null, the simulator creates one using every hardware thread)
      */
-    Simulator(std::vector<glm::mat4>* transforms, const std::vector<Vertex>* static_vertices, const std::vector<unsigned int>* static_indices);
-    
+    Simulator(
+        std::vector<glm::mat4>* transforms,
+        const std::vector<SimpleVertex>* static_vertices,
+        const std::vector<unsigned int>* static_indices,
+        const std::vector<glm::vec4>* object_vertices,
+        const std::vector<glm::vec4>* object_normals,
+        const std::vector<glm::vec4>* object_edges,
+        std::vector<physics::Properties>* properties,
+        jobs::JobSystem* job_system = nullptr
+    );
+
     /**
      * @brief class destroyer. The memory is not dereferenced.
      */
@@ -40,14 +123,198 @@ public:
      */
     void update(float delta_time, glm::vec3 gravity = glm::vec3(0.0f, 0.0f, 0.0f)) override;
 
+    /**
+     * @brief Gets the number of contacts found in the last step
+     */
+    inline size_t getContactCount() const { return m_contact_count; }
+
+    /**
+     * @brief Gets the number of broad phase pairs found in the last step
+     */
+    inline size_t getPairCount() const { return m_pair_count; }
+
+    /**
+     * @brief Sorts the pairs and the contacts of each step by their bodies, so the result is the
+     * same bit for bit with any number of threads. Costs two sorts per step
+     */
+    inline void setDeterministic(bool deterministic) { m_deterministic = deterministic; }
+
+    /**
+     * @brief Tells whether the steps are independent of the number of threads
+     */
+    inline bool isDeterministic() const { return m_deterministic; }
+
+    /**
+     * @brief Splits the objects in independent worlds that are stepped together. Objects of different
+     * worlds are never tested against each other, and each world has its own gravity (the gravity
+     * given to update is ignored) and restitution
+     * @param worlds ranges of the worlds in the object arrays and their parameters (empty for a single world)
+     * @return false (and nothing changes) if the ranges do not cover the objects
+     * @note Call it between steps (with the physics thread stopped). Loading a checkpoint with
+     * another number of objects goes back to a single world
+     */
+    bool setWorlds(const physics::WorldLayout& worlds);
+
+    /**
+     * @brief Gets the worlds the objects are split in (empty for a single world)
+     */
+    inline const physics::WorldLayout& getWorlds() const { return m_worlds; }
+
+    /**
+     * @brief Gets the phases of a step, with the time each one took in the last step
+     */
+    inline const jobs::TaskGraph& getStepGraph() const { return m_step_graph; }
+
+    /**
+     * @brief Saves the bodies and the sweep order of the broad phase into a checkpoint
+     * @param path checkpoint file
+     * @param seed seed of the random generator the scene was built with, kept for the caller
+     * @return false if the file could not be written
+     * @note Call it between steps (with the physics thread stopped)
+     */
+    bool saveCheckpoint(const std::string& path, uint64_t seed = 0);
+
+    /**
+     * @brief Replaces every body with the ones of a checkpoint. The transform and properties
+     * vectors given to the constructor are resized to the bodies of the checkpoint
+     * @param path checkpoint file (of this simulator or of the gpu one)
+     * @param seed receives the seed stored in the checkpoint (may be null)
+     * @return false (and nothing changes) if the file is not a valid checkpoint
+     * @note Call it between steps (with the physics thread stopped). The mesh is not part of the
+     * checkpoint, the bodies must have the one they were saved with
+     */
+    bool loadCheckpoint(const std::string& path, uint64_t* seed = nullptr);
+
+    /**
+     * @brief Picks up bodies the caller put in the transform and property vectors given to the
+     * constructor (any number of them, replacing the previous ones). The bounding spheres are
+     * rebuilt and the sweep order restarts from the order of the vectors, so bodies handed over
+     * sorted by x sort fastest
+     * @note Call it between steps (with the physics thread stopped). The worlds are kept if the
+     * bodies still fit them
+     */
+    void resetBodies();
+
+    /**
+     * @brief Sorts the objects by the Morton code of their position (each world within its range),
+     * moving their transforms and properties in the vectors given to the constructor. Objects that
+     * touch end up close in memory, which the phases gather much faster once a scene has scattered
+     * @note Call it between steps (with the physics thread stopped). Anything the caller keeps per
+     * object (colors, ids) has to follow getLastReorder()
+     */
+    void reorderBodies();
+
+    /**
+     * @brief Reorders the objects every steps steps, at the start of the step
+     * @param steps steps between two reorders, 0 to never reorder
+     */
+    void setReorderInterval(unsigned int steps);
+
+    /**
+     * @brief Gets the steps between two reorders (0 if they are disabled)
+     */
+    inline unsigned int getReorderInterval() const { return m_reorder_interval; }
+
+    /**
+     * @brief Gets the number of reorders so far, it changes when the objects move
+     */
+    inline uint64_t getReorderCount() const { return m_reorder_count; }
+
+    /**
+     * @brief Gets the old index of the object at each index after the last reorder
+     */
+    inline const std::vector<uint32_t>& getLastReorder() const { return m_reorder; }
+
+    /**
+     * @brief Gets the largest amount of transient memory used by a step (all the arenas together)
+     */
+    size_t getArenaHighWaterMark() const;
+
+    /**
+     * @brief Gets the memory currently reserved by the arenas
+     */
+    size_t getArenaCapacity() const;
+
 private:
     /**
-     * @brief take a step for each object
+     * @brief Initializes the data for the simulation
+     */
+    void initializeData();
+
+    /**
+     * @brief Sizes the per object data of the phases for the current number of objects
+     */
+    void resizeObjectData();
+
+    /**
+     * @brief Sizes the reorder scratch
+     * @param objects objects to make room for, 0 releases the scratch
+     */
+    void resizeReorderData(size_t objects);
+
+    /**
+     * @brief Builds the task graph of a step
+     */
+    void buildStepGraph();
+
+    /**
+     * @brief Integrates velocities and transforms (cpu version of sphere_transforms.glsl)
+     */
+    void integrate();
+
+    /**
+     * @brief Resets the per step data of the island and solver phases
+     */
+    void prepareSolver();
+
+    /**
+     * @brief Finds the pairs of overlapping bounding spheres (sweep and prune on x). Each world
+     * is sorted and swept on its own, so there are no pairs between worlds
+     */
+    void broadPhase();
+
+    /**
+     * @brief Tests the sphere at a position of the sweep order against the following ones until they no longer overlap in x
+     * @param position position of the sphere in m_sweep_order
+     * @param end end of the range of its world in m_sweep_order
+     * @param pairs receives the overlapping pairs
+     */
+    void sweep(size_t position, size_t end, memory::FrameVector<glm::uvec2>& pairs) const;
+
+    /**
+     * @brief Runs SAT over the broad phase pairs and builds the contact manifolds
+     * (cpu version of narrow_working.glsl)
+     */
+    void narrowPhase();
+
+    /**
+     * @brief Groups the contacts in islands of dynamic objects touching each other
+     */
+    void buildIslands();
+
+    /**
+     * @brief Applies the contact impulses, each island being solved independently
+     * (cpu version of jacobi_friction_impulse.glsl and accumulator.glsl)
+     */
+    void solve();
+
+    /**
+     * @brief Runs SAT between two objects
+     * @param a index of the first object
+     * @param b index of the second object
+     * @param world_vertices scratch memory for the world vertices of both objects
+     * @param manifold output contact if the objects overlap
+     * @return true if the objects overlap
+     */
+    bool collide(unsigned int a, unsigned int b, glm::vec3* world_vertices, physics::ContactManifold& manifold) const;
+
+    /**
+     * @brief Finds the root of an island (with path halving)
      */
-    void updateObject(physics::Object& object, float delta_time);
+    unsigned int findIsland(unsigned int object);
 };
 
 
 
 
-#endif // SIMULATOR_H
\ No newline at end of file
+#endif // SIMULATOR_H
@@ -0,0 +1,69 @@
+#include "world_batch.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace physics{
+
+    bool WorldLayout::isValid(size_t bodies) const{
+        if (offsets.empty())
+            return params.empty();
+
+        if (offsets.front() != 0 || offsets.back() != bodies || params.size() != offsets.size() - 1)
+            return false;
+
+        for (size_t w = 1; w < offsets.size(); w++){
+            if (offsets[w] < offsets[w - 1])
+                return false;
+        }
+        return true;
+    }
+
+    uint64_t WorldLayout::getPairBound(size_t bodies) const{
+        if (offsets.empty())
+            return static_cast<uint64_t>(bodies) * bodies;
+
+        uint64_t pairs = 0;
+        for (size_t w = 1; w < offsets.size(); w++){
+            uint64_t size = offsets[w] - offsets[w - 1];
+            pairs += size * size;
+        }
+        return pairs;
+    }
+
+    void WorldLayout::getBodyWorlds(std::vector<unsigned int>& body_worlds) const{
+        body_worlds.resize(offsets.empty() ? 0 : offsets.back());
+        for (unsigned int w = 0; w < getWorldCount(); w++)
+            std::fill(body_worlds.begin() + offsets[w], body_worlds.begin() + offsets[w + 1], w);
+    }
+
+    void WorldBatch::reserve(unsigned int worlds, size_t bodies){
+        m_transforms.reserve(bodies);
+        m_properties.reserve(bodies);
+        m_layout.offsets.reserve(worlds + 1);
+        m_layout.params.reserve(worlds);
+    }
+
+    unsigned int WorldBatch::addWorld(const std::vector<glm::mat4>& transforms, const std::vector<Properties>& properties, const WorldParams& params){
+        if (transforms.size() != properties.size()){
+            std::cerr << "WorldBatch: a world has " << transforms.size() << " transforms but " << properties.size() << " properties" << std::endl;
+            return UINT32_MAX;
+        }
+
+        if (m_layout.offsets.empty())
+            m_layout.offsets.push_back(0);
+
+        m_transforms.insert(m_transforms.end(), transforms.begin(), transforms.end());
+        m_properties.insert(m_properties.end(), properties.begin(), properties.end());
+        m_layout.offsets.push_back(static_cast<unsigned int>(m_transforms.size()));
+        m_layout.params.push_back(params);
+        return m_layout.getWorldCount() - 1;
+    }
+
+    void WorldBatch::clear(){
+        m_transforms.clear();
+        m_properties.clear();
+        m_layout.offsets.clear();
+        m_layout.params.clear();
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef WORLD_BATCH_H
+#define WORLD_BATCH_H
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "../physics.h"
+
+namespace physics{
+
+    /**
+     * @brief Parameters of one world of a batch. Same layout as WorldParams in the compute shaders
+     * (std430, 16 bytes)
+     */
+    struct WorldParams{
+        glm::vec3 gravity = glm::vec3(0.0f);
+        float restitution = 0.2f;
+    };
+
+    /**
+     * @brief Splits the bodies of a simulator in independent worlds. The bodies of world w are the
+     * range [offsets[w], offsets[w + 1]) of the body arrays, bodies of different worlds never collide
+     * @note An empty layout is a single world that takes the gravity given to update
+     */
+    struct WorldLayout{
+        std::vector<unsigned int> offsets; /* First body of each world, followed by the number of bodies */
+        std::vector<WorldParams> params; /* One per world */
+
+        /**
+         * @brief Gets the number of worlds (0 for an empty layout)
+         */
+        inline unsigned int getWorldCount() const { return offsets.empty() ? 0 : static_cast<unsigned int>(offsets.size() - 1); }
+
+        /**
+         * @brief Tells whether the layout is empty or covers exactly bodies bodies with ordered ranges
+         */
+        bool isValid(size_t bodies) const;
+
+        /**
+         * @brief Gets the largest number of pairs the bodies can form without crossing worlds
+         * (the sum of the squared world sizes, or bodies squared for an empty layout)
+         */
+        uint64_t getPairBound(size_t bodies) const;
+
+        /**
+         * @brief Gets the world of each body
+         * @param body_worlds receives one world index per body
+         */
+        void getBodyWorlds(std::vector<unsigned int>& body_worlds) const;
+    };
+
+    /**
+     * @brief Many small independent scenes stored back to back in one set of body arrays, so a
+     * single simulator steps all of them at once. The transforms and properties are given to the
+     * constructor of Simulator or GpuSimulator like the ones of a scene, then setWorlds with the
+     * layout keeps the broad phase inside each world and takes gravity and restitution per world.
+     * Every body shares the mesh given to the simulator
+     */
+    class WorldBatch{
+    private:
+        std::vector<glm::mat4> m_transforms;
+        std::vector<Properties> m_properties;
+        WorldLayout m_layout;
+
+    public:
+        WorldBatch() = default;
+
+        /**
+         * @brief Reserves memory for the worlds and bodies that will be added
+         */
+        void reserve(unsigned int worlds, size_t bodies);
+
+        /**
+         * @brief Appends a world after the last one
+         * @param transforms transform of each body of the world
+         * @param properties physics properties of each body, as many as transforms
+         * @param params gravity and restitution of the world
+         * @return index of the world, or UINT32_MAX (and nothing is added) if the sizes differ
+         */
+        unsigned int addWorld(const std::vector<glm::mat4>& transforms, const std::vector<Properties>& properties, const WorldParams& params);
+
+        /**
+         * @brief Removes every world
+         */
+        void clear();
+
+        /**
+         * @brief Gets the transforms of every world, to give to a simulator (the gpu one only reads the initial ones)
+         */
+        inline std::vector<glm::mat4>& getTransforms() { return m_transforms; }
+
+        /**
+         * @brief Gets the physics properties of every world, to give to a simulator
+         */
+        inline std::vector<Properties>& getProperties() { return m_properties; }
+
+        /**
+         * @brief Gets the layout of the worlds, to give to setWorlds of the simulator
+         */
+        inline const WorldLayout& getLayout() const { return m_layout; }
+
+        /**
+         * @brief Gets the number of worlds
+         */
+        inline unsigned int getWorldCount() const { return m_layout.getWorldCount(); }
+
+        /**
+         * @brief Gets the number of bodies of every world together
+         */
+        inline size_t getBodyCount() const { return m_transforms.size(); }
+
+        /**
+         * @brief Gets the index of the first body of a world in the body arrays
+         */
+        inline unsigned int getFirstBody(unsigned int world) const { return m_layout.offsets[world]; }
+
+        /**
+         * @brief Gets the number of bodies of a world
+         */
+        inline unsigned int getWorldSize(unsigned int world) const { return m_layout.offsets[world + 1] - m_layout.offsets[world]; }
+    };
+}
+
+
+#endif // WORLD_BATCH_H
@@ -10,6 +10,9 @@
 namespace test {
     
     class Test {
+    protected:
+        float m_interpolation = 1.0f; /* Position between the previous (0) and current (1) physics step */
+
     public:
         /**
          * @brief Construct a new Test object
@@ -22,11 +25,17 @@ namespace test {
         virtual ~Test() {};
 
         /**
-         * @brief Update the test (called once per frame)
+         * @brief Update the test (called once per fixed physics step)
          * @param deltaTime 
          */
         virtual void onUpdate(float deltaTime) {}
 
+        /**
+         * @brief Set how far the frame is between the last two physics steps (called once per frame, before onRender)
+         * @param alpha 0 at the previous step, 1 at the current one
+         */
+        inline void setInterpolation(float alpha) { m_interpolation = alpha; }
+
         /**
          * @brief Render the test
          */
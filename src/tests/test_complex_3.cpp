@@ -146,6 +146,7 @@ namespace test{
             &object_edges,
             &properties
         );
+        m_simulator->attachColorBuffer(&m_cube.getColorBuffer());
 
         m_light_shader.setShader("light.glsl");
 
@@ -191,13 +192,15 @@ namespace test{
         m_shader.setUniformVec4f("u_light_color", light_color);
         m_shader.setUniformVec3f("u_light_pos", m_camera.getPosition());
         m_shader.setUniformVec3f("u_cam_pos", m_camera.getPosition());
+        m_shader.setUniform1f("u_alpha", m_interpolation);
+        m_simulator->bindRenderState(); // Newest completed step, the next one may still be running
         m_shader.setUniform1f("u_a", m_quadriatic);
         m_shader.setUniform1f("u_b", m_linear);
         m_shader.setUniform1i("u_noise_texture", 0); // Set texture unit
         m_shader.setUniform1f("u_noise_intensity", m_noise_intensity); // Add noise intensity control
     
         // Draw the cube
-        renderer.instancedDraw(m_cube.getVertexArray(), m_cube.getIndexBuffer(), m_shader, m_camera, m_instances);
+        renderer.instancedDraw(m_cube.getVertexArray(), m_cube.getIndexBuffer(), m_shader, m_camera, m_simulator->getBodyCount());
         
         // Unbind texture
         if (m_noiseTexture)
@@ -218,9 +221,46 @@ namespace test{
 
         
         ImGui::SliderFloat("Time factor", &m_time_factor, 0.0f, 100.0f);
+
+        ImGui::Text("Bodies: %u (%zu spawned)", m_simulator->getBodyCount(), m_spawned.size());
+        ImGui::SliderInt("Spawn count", &m_spawn_count, 1, 1000);
+        if (ImGui::Button("Spawn"))
+            spawnBodies(m_spawn_count);
+        ImGui::SameLine();
+        if (ImGui::Button("Despawn"))
+            despawnBodies(m_spawn_count);
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        m_simulator->getProfiler().onImGuiRender();
 
         ImGui::Text("Texture Settings");
         ImGui::SliderFloat("Noise Intensity", &m_noise_intensity, 0.0f, 1.0f);
     }
-}
\ No newline at end of file
+
+    void TestComplex3::spawnBodies(int count){
+        float inertia = (1.0f / 6.0f);
+        glm::mat3 inverseTensor = glm::mat3(1.0f / inertia);
+
+        for (int i = 0; i < count; i++){
+            glm::vec3 position = glm::linearRand(glm::vec3(-10.0f, 10.0f, -10.0f), glm::vec3(10.0f, 30.0f, 10.0f));
+
+            physics::Properties body;
+            body.velocity = glm::vec3(0.0f);
+            body.acceleration = glm::vec3(0.0f);
+            body.angular_velocity = glm::linearRand(glm::vec3(-0.2f), glm::vec3(0.2f));
+            body.angular_acceleration = glm::vec3(0.0f);
+            body.inverseMass = 1.0f;
+            body.setInverseInertiaTensor(inverseTensor);
+            body.friction = 0.0f;
+
+            glm::vec4 color = glm::vec4(glm::linearRand(glm::vec3(0.0f), glm::vec3(1.0f)), 1.0f);
+            m_spawned.push_back(m_simulator->addBody(glm::translate(glm::mat4(1.0f), position), body, color));
+        }
+    }
+
+    void TestComplex3::despawnBodies(int count){
+        for (int i = 0; i < count && !m_spawned.empty(); i++){
+            m_simulator->removeBody(m_spawned.back());
+            m_spawned.pop_back();
+        }
+    }
+}
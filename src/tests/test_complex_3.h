@@ -55,7 +55,10 @@ namespace test{
 
         std::vector<glm::mat4> m_cube_models;
 
-        Simulable* m_simulator;
+        GpuSimulator* m_simulator;
+
+        std::vector<physics::BodyHandle> m_spawned; /* Bodies added at runtime */
+        int m_spawn_count = 100;
 
         std::unique_ptr<Texture> m_noiseTexture;
         float m_noise_intensity;
@@ -70,6 +73,17 @@ namespace test{
         void onUpdate(float deltaTime) override;
         void onRender() override;
         void onImGuiRender() override;
+
+    private:
+        /**
+         * @brief Adds count cubes with random positions and colors above the grid
+         */
+        void spawnBodies(int count);
+
+        /**
+         * @brief Removes up to count of the cubes added at runtime (newest first)
+         */
+        void despawnBodies(int count);
     
     };
 }
@@ -192,6 +192,8 @@ namespace test{
         m_shader.setUniformVec4f("u_light_color", light_color);
         m_shader.setUniformVec3f("u_light_pos", m_camera.getPosition());
         m_shader.setUniformVec3f("u_cam_pos", m_camera.getPosition());
+        m_shader.setUniform1f("u_alpha", m_interpolation);
+        m_simulator->bindRenderState(); // Newest completed step, the next one may still be running
         m_shader.setUniform1f("u_a", m_quadriatic);
         m_shader.setUniform1f("u_b", m_linear);
         m_shader.setUniform1i("u_noise_texture", 0); // Set texture unit
@@ -54,7 +54,7 @@ namespace test{
 
         std::vector<glm::mat4> m_cube_models;
 
-        Simulable* m_simulator;
+        GpuSimulator* m_simulator;
 
         std::unique_ptr<Texture> m_noiseTexture;
         float m_noise_intensity;
@@ -0,0 +1,218 @@
+#include "test_cpu_simulator.h"
+#include "../renderer.h"
+
+#include <random>
+
+#include "imgui.h"
+#include "imgui_impl_glfw.h"
+#include "imgui_impl_opengl3.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/random.hpp" 
+#include "glm/gtx/component_wise.hpp"
+
+#include "constants.h"
+
+extern GLFWwindow * c_window;
+
+namespace test{
+
+    TestCpuSimulator::TestCpuSimulator()
+        : m_camera(m_width, m_height, glm::vec3(0.0f, 0.0f, 60.0f)),
+        m_noise_intensity(0.0f) {
+
+        //Object distribution grid
+        int grid_x = 10;
+        int grid_y = 10;
+        int grid_z = 10;
+
+        float spacing = 1.5f;
+
+        m_instances = grid_x * grid_y * grid_z + 1;
+
+        // Cube vertices
+        m_vertices = std::vector<SimpleVertex>(std::begin(CONSTANTS::CUBE_MESH_SIMPLE_VERTICES), std::end(CONSTANTS::CUBE_MESH_SIMPLE_VERTICES));
+    
+        m_indices = std::vector<unsigned int>(std::begin(CONSTANTS::CUBE_MESH_INDICES), std::end(CONSTANTS::CUBE_MESH_INDICES));
+
+        object_vertices = utils::extractPositions(CONSTANTS::CUBE_MESH_SIMPLE_VERTICES, std::size(CONSTANTS::CUBE_MESH_SIMPLE_VERTICES));
+        object_normals = utils::extractNormals  (CONSTANTS::CUBE_MESH_SIMPLE_VERTICES, std::size(CONSTANTS::CUBE_MESH_SIMPLE_VERTICES));
+        object_edges = utils::extractEdges    (CONSTANTS::CUBE_MESH_SIMPLE_VERTICES,
+                                CONSTANTS::CUBE_MESH_INDICES,
+                                std::size(CONSTANTS::CUBE_MESH_INDICES));
+
+        // Generate random colors for each instance
+        static std::mt19937 gen(42);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+        m_colors.resize(m_instances);
+        for (int i = 0; i < m_instances; i++) {
+            m_colors[i] = glm::vec4(dist(gen), dist(gen), dist(gen), 1.0f);
+        }
+
+        m_model_matrices.resize(m_instances);
+
+        glm::vec3 center_offset = glm::vec3((grid_x - 1) * 0.5f * spacing, 
+                                    (grid_y - 1) * 0.5f * spacing, 
+                                    -(grid_z - 1) * 0.5f * spacing);
+
+        for (int x = 0; x < grid_x; x++) {
+            for (int y = 0; y < grid_y; y++) {
+                for (int z = 0; z < grid_z; z++) {
+                    glm::vec3 position = glm::vec3(x * spacing, y * spacing, -z * spacing) - center_offset;
+                    m_model_matrices[x * grid_y * grid_z + y * grid_z + z] = glm::translate(glm::mat4(1.0f), position);
+                }
+            }
+        }
+
+        // Static floor under the grid
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, -(grid_y * spacing * 0.5f) - 25.5f, 0.0f));
+        model = glm::scale(model, glm::vec3(50.0f));
+        m_model_matrices[m_instances - 1] = model;
+
+        float mass = 1.0f;
+        float side = 1.0f;
+        float inertia = (1.0f / 6.0f) * mass * side * side;
+
+        glm::mat3 inverseTensor = glm::mat3(
+            1.0f / inertia, 0.0f, 0.0f,
+            0.0f, 1.0f / inertia, 0.0f,
+            0.0f, 0.0f, 1.0f / inertia
+        );
+
+        properties.resize(m_instances);
+
+        std::srand(42);
+        for (int i = 0; i < m_instances; i++){
+            properties[i].velocity = glm::vec3(0.0f);
+            properties[i].acceleration = glm::vec3(0.0f);
+            properties[i].angular_velocity = glm::vec3(0.0f);
+            properties[i].angular_acceleration = glm::vec3(0.0f);
+            properties[i].inverseMass = 1.0f;
+            properties[i].setInverseInertiaTensor(inverseTensor);
+            properties[i].friction = 0.0f;
+        }
+
+        properties[m_instances - 1].inverseMass = 0.0f;
+        properties[m_instances - 1].setInverseInertiaTensor(glm::mat3(0.0f));
+
+        m_transform_ssbo.setBuffer(m_model_matrices.data(), m_model_matrices.size() * sizeof(glm::mat4), GL_DYNAMIC_DRAW);
+        m_transform_ssbo.unbind();
+        m_transform_ssbo.bindToBindingPoint(1);
+
+        m_cube.setData(m_vertices, m_indices, m_model_matrices, m_colors, m_instances);
+        m_shader.setShader("tex_gpu_renderer.glsl");
+
+        m_simulator = std::make_unique<Simulator>(
+            &m_model_matrices,
+            &m_vertices,
+            &m_indices,
+            &object_vertices,
+            &object_normals,
+            &object_edges,
+            &properties
+        );
+
+        m_physics = std::make_unique<physics::PhysicsThread>(m_simulator.get(), &m_model_matrices, m_step_hz);
+        m_physics->setGravity(m_gravity);
+        m_physics->start();
+
+        try {
+            m_noiseTexture = std::make_unique<Texture>("noise512.png");
+        } catch (std::exception& e) {
+            std::cerr << "Failed to load noise texture: " << e.what() << std::endl;
+            m_noiseTexture = nullptr;
+        }
+
+        GLCall(glViewport(0, 0, m_width, m_height));
+        GLCall(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
+        GLCall(glEnable(GL_DEPTH_TEST));
+
+        GLCall(glEnable(GL_CULL_FACE));
+        GLCall(glCullFace(GL_BACK));
+        GLCall(glFrontFace(GL_CCW));
+    }
+
+    TestCpuSimulator::~TestCpuSimulator(){
+        //The thread uses the simulator, stop it first
+        m_physics->stop();
+    }
+
+    void TestCpuSimulator::onUpdate(float delta_time){ 
+        //The simulation runs on its own thread, only forward the settings
+        m_physics->setGravity(m_gravity);
+        m_physics->setTimeFactor(m_time_factor);
+        m_physics->setStepHz(m_step_hz);
+        m_physics->setRealtime(m_realtime);
+    }
+
+    void TestCpuSimulator::onRender(){
+        Renderer renderer;
+    
+        m_camera.input(c_window);
+        m_camera.updateMatrix(55.0f, 0.1f, 10000.0f);
+
+        //Upload the latest state if the physics thread published a new one
+        if (m_physics->acquireLatest()){
+            const physics::PhysicsState& state = m_physics->getLatest();
+            m_transform_ssbo.bind();
+            m_transform_ssbo.updateData(state.transforms.data(), state.transforms.size() * sizeof(glm::mat4));
+            m_transform_ssbo.unbind();
+            m_rendered_step = state.step;
+        }
+    
+        // Bind the noise texture
+        if (m_noiseTexture)
+            m_noiseTexture->bind(0);
+    
+        // Place the cube 
+        m_shader.bind();
+        m_shader.setUniformVec4f("u_light_color", light_color);
+        m_shader.setUniformVec3f("u_light_pos", m_camera.getPosition());
+        m_shader.setUniformVec3f("u_cam_pos", m_camera.getPosition());
+        m_shader.setUniform1f("u_a", m_quadriatic);
+        m_shader.setUniform1f("u_b", m_linear);
+        m_shader.setUniform1i("u_noise_texture", 0);
+        m_shader.setUniform1f("u_noise_intensity", m_noise_intensity);
+    
+        // Draw the cube
+        renderer.instancedDraw(m_cube.getVertexArray(), m_cube.getIndexBuffer(), m_shader, m_camera, m_instances);
+        
+        // Unbind texture
+        if (m_noiseTexture)
+            m_noiseTexture->unbind();
+    }
+
+    void TestCpuSimulator::onImGuiRender(){
+        ImGui::Text("CPU simulator on a physics thread");
+        ImGui::SliderFloat("Sensitivity", &m_camera.m_sensitivity, 10.0f, 100.0f);
+
+        ImGui::Text("Physics");
+        ImGui::SliderFloat3("Gravity", &m_gravity.x, -1.0f, 1.0f);
+        ImGui::SliderFloat("Time factor", &m_time_factor, 0.0f, 10.0f);
+        ImGui::SliderFloat("Step Hz", &m_step_hz, 20.0f, 100.0f);
+        ImGui::Checkbox("Real time (off: as fast as possible)", &m_realtime);
+
+        //The publisher belongs to the physics thread while it runs
+        if (ImGui::Checkbox("Publish state (shared memory)", &m_publish)){
+            m_physics->stop();
+            if (m_publish && !m_publisher.open("physics_state", m_instances))
+                m_publish = false;
+            if (!m_publish)
+                m_publisher.close();
+            m_physics->setPublisher(m_publish ? &m_publisher : nullptr);
+            m_physics->start();
+        }
+        if (m_publish)
+            ImGui::Text("Published: %llu to \"%s\"", (unsigned long long)m_publisher.getPublishedCount(), m_publisher.getName().c_str());
+
+        ImGui::Text("Steps: %llu (rendering step %llu)", (unsigned long long)m_physics->getStepCount(), (unsigned long long)m_rendered_step);
+        ImGui::Text("Last step: %.3f ms", m_physics->getLatest().step_ms);
+        ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+        ImGui::Text("Texture Settings");
+        ImGui::SliderFloat("Noise Intensity", &m_noise_intensity, 0.0f, 1.0f);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef TEST_CPU_SIMULATOR_H
+#define TEST_CPU_SIMULATOR_H
+
+#pragma once
+
+#include <memory>
+
+#include "test.h"
+
+#include "../buffers/vertex_buffer.h"
+#include "../buffers/index_buffer.h"
+#include "../buffers/vertex_array.h"
+#include "../buffers/vertex_buffer_layout.h"
+#include "../shader.h"
+#include "../camera.h"
+#include "../meshes/gpu_mesh.h"
+#include "../simulators/simulator.h"
+#include "../simulators/physics_thread.h"
+#include "../recording/state_publisher.h"
+#include "../texture.h"
+
+namespace test{
+
+    /**
+     * @brief Pile of cubes simulated on the cpu by a physics thread. The render loop only
+     * uploads the latest published state, it never waits for the simulation
+     */
+    class TestCpuSimulator : public Test{
+    private:
+        const unsigned int m_width = 1920;
+        const unsigned int m_height = 1080;
+
+        unsigned int m_instances;
+
+        std::vector<glm::mat4> m_model_matrices; /* Owned by the physics thread while it runs */
+        std::vector<glm::vec4> m_colors;
+
+        glm::vec4 light_color = glm::vec4(1.0f ,1.0f, 1.0f, 1.0f);
+
+        Shader m_shader;
+
+        float m_time_factor = 1.0f;
+        float m_step_hz = 60.0f;
+        bool m_realtime = true;
+        glm::vec3 m_gravity = glm::vec3(0.0f, -1.0f, 0.0f);
+
+        std::vector<SimpleVertex> m_vertices;
+        std::vector<unsigned int> m_indices;
+        std::vector<physics::Properties> properties;
+        std::vector<glm::vec4> object_vertices;
+        std::vector<glm::vec4> object_normals;
+        std::vector<glm::vec4> object_edges;
+        GpuMesh m_cube;
+
+        Camera m_camera;
+
+        ShaderStorageBuffer m_transform_ssbo;
+
+        std::unique_ptr<Simulator> m_simulator;
+        recording::StatePublisher m_publisher; /* Steps for other processes (physics_state_reader) */
+        bool m_publish = false;
+        std::unique_ptr<physics::PhysicsThread> m_physics;
+        uint64_t m_rendered_step = 0; /* Step of the state currently in m_transform_ssbo */
+
+        std::unique_ptr<Texture> m_noiseTexture;
+        float m_noise_intensity;
+
+        float m_quadriatic = 0.00f;
+        float m_linear = 0.00f;
+
+    public:
+        TestCpuSimulator();
+        ~TestCpuSimulator();
+
+        void onUpdate(float deltaTime) override;
+        void onRender() override;
+        void onImGuiRender() override;
+    };
+}
+
+
+#endif // TEST_CPU_SIMULATOR_H
@@ -203,6 +203,7 @@ namespace test{
         
         ImGui::SliderFloat("Time factor", &m_time_factor, 0.0f, 100.0f);
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        m_simulator->getProfiler().onImGuiRender();
 
         ImGui::Text("Texture Settings");
         ImGui::SliderFloat("Noise Intensity", &m_noise_intensity, 0.0f, 1.0f);
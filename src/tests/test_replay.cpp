@@ -0,0 +1,149 @@
+#include "test_replay.h"
+#include "../renderer.h"
+
+#include <random>
+
+#include "imgui.h"
+#include "imgui_impl_glfw.h"
+#include "imgui_impl_opengl3.h"
+
+#include "glm/glm.hpp"
+
+extern GLFWwindow * c_window;
+
+namespace test{
+
+    TestReplay::TestReplay()
+        : m_camera(m_width, m_height, glm::vec3(0.0f, 0.0f, 100.0f)),
+        m_noise_intensity(0.0f) {
+
+        m_shader.setShader("tex_gpu_renderer.glsl");
+
+        try {
+            m_noiseTexture = std::make_unique<Texture>("noise512.png");
+        } catch (std::exception& e) {
+            std::cerr << "Failed to load noise texture: " << e.what() << std::endl;
+            m_noiseTexture = nullptr;
+        }
+
+        openTrajectory();
+
+        GLCall(glViewport(0, 0, m_width, m_height));
+        GLCall(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
+        GLCall(glEnable(GL_DEPTH_TEST));
+
+        GLCall(glEnable(GL_CULL_FACE));
+        GLCall(glCullFace(GL_BACK));
+        GLCall(glFrontFace(GL_CCW));
+    }
+
+    TestReplay::~TestReplay(){
+        m_player.close();
+    }
+
+    void TestReplay::openTrajectory(){
+        m_mesh.reset();
+        if (!m_player.open(m_path)){
+            m_status = std::string("Could not open ") + m_path;
+            return;
+        }
+        m_status = std::string("Playing ") + m_path;
+
+        //Trajectories only keep the positions of the shapes, the normals are rebuilt from the
+        //triangles (meshes with a vertex per face corner, like the cube, get flat normals)
+        const recording::Shape& shape = m_player.getDesc().shapes[0];
+        std::vector<glm::vec3> normals(shape.vertices.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < shape.indices.size(); i += 3){
+            unsigned int a = shape.indices[i], b = shape.indices[i + 1], c = shape.indices[i + 2];
+            if (a >= normals.size() || b >= normals.size() || c >= normals.size())
+                continue;
+            glm::vec3 normal = glm::cross(shape.vertices[b] - shape.vertices[a], shape.vertices[c] - shape.vertices[a]);
+            normals[a] += normal;
+            normals[b] += normal;
+            normals[c] += normal;
+        }
+
+        m_vertices.resize(shape.vertices.size());
+        for (size_t i = 0; i < shape.vertices.size(); i++){
+            glm::vec3 normal = glm::length(normals[i]) > 0.0f ? glm::normalize(normals[i]) : glm::vec3(0.0f, 1.0f, 0.0f);
+            m_vertices[i] = SimpleVertex{ { shape.vertices[i].x, shape.vertices[i].y, shape.vertices[i].z }, { normal.x, normal.y, normal.z } };
+        }
+        m_indices.assign(shape.indices.begin(), shape.indices.end());
+
+        static std::mt19937 gen(42);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        m_colors.resize(m_player.getBodyCount());
+        for (glm::vec4& color : m_colors)
+            color = glm::vec4(dist(gen), dist(gen), dist(gen), 1.0f);
+
+        m_mesh = std::make_unique<GpuMesh>();
+        m_mesh->setData(m_vertices, m_indices, m_model_matrices, m_colors, m_player.getBodyCount());
+
+        m_player.setRate(m_rate);
+        m_player.setPaused(m_paused);
+        m_player.setLoop(m_loop);
+    }
+
+    void TestReplay::onUpdate(float delta_time){
+        m_player.update(delta_time);
+    }
+
+    void TestReplay::onRender(){
+        if (!m_player.isOpen() || !m_mesh)
+            return;
+
+        Renderer renderer;
+
+        m_camera.input(c_window);
+        m_camera.updateMatrix(55.0f, 0.1f, 10000.0f);
+
+        if (m_noiseTexture)
+            m_noiseTexture->bind(0);
+
+        m_shader.bind();
+        m_shader.setUniformVec4f("u_light_color", light_color);
+        m_shader.setUniformVec3f("u_light_pos", m_camera.getPosition());
+        m_shader.setUniformVec3f("u_cam_pos", m_camera.getPosition());
+        m_shader.setUniform1f("u_alpha", 1.0f); // Recorded frames are drawn as they are
+        m_player.bindRenderState();
+        m_shader.setUniform1f("u_a", m_quadriatic);
+        m_shader.setUniform1f("u_b", m_linear);
+        m_shader.setUniform1i("u_noise_texture", 0);
+        m_shader.setUniform1f("u_noise_intensity", m_noise_intensity);
+
+        renderer.instancedDraw(m_mesh->getVertexArray(), m_mesh->getIndexBuffer(), m_shader, m_camera, m_player.getBodyCount());
+
+        if (m_noiseTexture)
+            m_noiseTexture->unbind();
+    }
+
+    void TestReplay::onImGuiRender(){
+        ImGui::Text("Trajectory replay");
+        ImGui::InputText("File", m_path, sizeof(m_path));
+        if (ImGui::Button("Open"))
+            openTrajectory();
+        ImGui::Text("%s", m_status.c_str());
+
+        if (m_player.isOpen()){
+            ImGui::Text("%u bodies, %u frames", m_player.getBodyCount(), m_player.getFrameCount());
+
+            m_paused = m_player.isPaused();
+            if (ImGui::Checkbox("Paused", &m_paused))
+                m_player.setPaused(m_paused);
+            if (ImGui::Checkbox("Loop", &m_loop))
+                m_player.setLoop(m_loop);
+            if (ImGui::SliderFloat("Playback rate", &m_rate, 0.0f, 8.0f))
+                m_player.setRate(m_rate);
+
+            int frame = static_cast<int>(m_player.getFrame());
+            if (ImGui::SliderInt("Frame", &frame, 0, static_cast<int>(m_player.getFrameCount()) - 1))
+                m_player.seek(static_cast<uint32_t>(frame));
+            ImGui::Text("Late frames: %llu", (unsigned long long)m_player.getLateFrames());
+        }
+
+        ImGui::SliderFloat("Sensitivity", &m_camera.m_sensitivity, 10.0f, 100.0f);
+        ImGui::SliderFloat4("Light color", &light_color.x, 0.0f, 1.0f);
+        ImGui::SliderFloat("Noise Intensity", &m_noise_intensity, 0.0f, 1.0f);
+        ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef TEST_REPLAY_H
+#define TEST_REPLAY_H
+
+#pragma once
+
+#include <memory>
+
+#include "test.h"
+
+#include "../shader.h"
+#include "../camera.h"
+#include "../meshes/gpu_mesh.h"
+#include "../recording/replay_player.h"
+#include "../texture.h"
+
+namespace test{
+
+    /**
+     * @brief Plays a trajectory recorded with physics_bench --record without simulating it, e.g.
+     * to render the same run again with other lighting while recording frames
+     */
+    class TestReplay : public Test{
+    private:
+        const unsigned int m_width = 1920;
+        const unsigned int m_height = 1080;
+
+        char m_path[256] = "trajectory.traj";
+        std::string m_status;
+
+        recording::ReplayPlayer m_player;
+        float m_rate = 1.0f;
+        bool m_paused = false;
+        bool m_loop = true;
+
+        //Mesh of the first shape of the trajectory, drawn for every body
+        std::vector<SimpleVertex> m_vertices;
+        std::vector<unsigned int> m_indices;
+        std::vector<glm::mat4> m_model_matrices; /* Unused by GpuMesh, the transforms come from the player */
+        std::vector<glm::vec4> m_colors;
+        std::unique_ptr<GpuMesh> m_mesh;
+
+        glm::vec4 light_color = glm::vec4(1.0f ,1.0f, 1.0f, 1.0f);
+
+        Shader m_shader;
+        Camera m_camera;
+
+        std::unique_ptr<Texture> m_noiseTexture;
+        float m_noise_intensity;
+
+        float m_quadriatic = 0.00f;
+        float m_linear = 0.00f;
+
+    public:
+        TestReplay();
+        ~TestReplay();
+
+        void onUpdate(float deltaTime) override;
+        void onRender() override;
+        void onImGuiRender() override;
+
+    private:
+        /**
+         * @brief Opens the trajectory in m_path and builds the mesh of its first shape
+         */
+        void openTrajectory();
+    };
+}
+
+
+#endif // TEST_REPLAY_H
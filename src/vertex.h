@@ -0,0 +1,28 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#pragma once
+
+/**
+ * Vertex formats shared by the meshes and the simulators. Kept apart from vertex_buffer.h so
+ * the physics core can use them without OpenGL
+ */
+
+struct Vertex{
+public:
+    // glm::vec3 position;
+    // glm::vec4 color;
+    // glm::vec3 normal;
+    float position[3];
+    float color[4];
+    float normal[3];
+};
+
+struct SimpleVertex{
+public:
+    float position[3];
+    float normal[3];
+};
+
+
+#endif // VERTEX_H